@@ -0,0 +1,172 @@
+/**
+ * Latency of light clients while one heavy client pipelines, per command budget
+ *
+ * Runs against a server that is already up. For each budget it sets
+ * client-command-budget with CONFIG SET, then for --seconds:
+ *   heavy   one connection sending --pipeline SETs at a time, back to back
+ *   light   --light connections, each one GET and its reply at a time
+ * and prints the heavy client's throughput next to the light clients' latency.
+ *
+ *   fairness_benchmark [--port=6379] [--light=50] [--seconds=5] [--pipeline=10000]
+ *                      [--budgets=0,256]
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+int connect_to(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        std::perror("connect");
+        std::exit(1);
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+std::string command(const std::vector<std::string>& parts) {
+    std::string out = "*" + std::to_string(parts.size()) + "\r\n";
+    for (const auto& part : parts) {
+        out += "$" + std::to_string(part.size()) + "\r\n" + part + "\r\n";
+    }
+    return out;
+}
+
+bool send_all(int fd, const std::string& data) {
+    for (size_t sent = 0; sent < data.size();) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Every reply used here is 5 bytes: +OK\r\n or $-1\r\n
+bool receive_bytes(int fd, size_t count) {
+    char buffer[64 * 1024];
+    while (count > 0) {
+        ssize_t n = recv(fd, buffer, std::min(sizeof(buffer), count), 0);
+        if (n <= 0) return false;
+        count -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+double percentile(std::vector<double>& values, double p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    return values[static_cast<size_t>(p * (values.size() - 1))];
+}
+
+void run(int port, size_t budget, size_t light_clients, double seconds, size_t pipeline) {
+    int admin = connect_to(port);
+    if (!send_all(admin, command({"CONFIG", "SET", "client-command-budget",
+                                  std::to_string(budget)}))) {
+        std::exit(1);
+    }
+    char answer[64] = {};
+    if (recv(admin, answer, sizeof(answer) - 1, 0) <= 0 || std::string(answer) != "+OK\r\n") {
+        std::fprintf(stderr, "CONFIG SET client-command-budget failed: %s\n", answer);
+        std::exit(1);
+    }
+    close(admin);
+
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> heavy_ops{0};
+    std::thread heavy([&] {
+        int fd = connect_to(port);
+        std::string batch;
+        for (size_t i = 0; i < pipeline; ++i) {
+            batch += command({"SET", "heavy:" + std::to_string(i), "value"});
+        }
+        while (!stop && send_all(fd, batch) && receive_bytes(fd, 5 * pipeline)) {
+            heavy_ops += pipeline;
+        }
+        close(fd);
+    });
+
+    std::mutex mutex;
+    std::vector<double> latencies_us;
+    std::vector<std::thread> light;
+    for (size_t c = 0; c < light_clients; ++c) {
+        light.emplace_back([&, c] {
+            int fd = connect_to(port);
+            std::string get = command({"GET", "light:" + std::to_string(c)});
+            std::vector<double> mine;
+            while (!stop) {
+                auto before = Clock::now();
+                if (!send_all(fd, get) || !receive_bytes(fd, 5)) break;
+                mine.push_back(std::chrono::duration<double, std::micro>(Clock::now() - before)
+                                   .count());
+            }
+            close(fd);
+            std::lock_guard<std::mutex> lock(mutex);
+            latencies_us.insert(latencies_us.end(), mine.begin(), mine.end());
+        });
+    }
+
+    auto start = Clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop = true;
+    for (auto& thread : light) thread.join();
+    heavy.join();
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::printf("%-8zu %14.0f %12zu %10.1f %10.1f %10.1f\n", budget, heavy_ops / elapsed,
+                latencies_us.size(), percentile(latencies_us, 0.50),
+                percentile(latencies_us, 0.99), percentile(latencies_us, 1.0));
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int port = 6379;
+    size_t light_clients = 50;
+    double seconds = 5;
+    size_t pipeline = 10000;
+    std::vector<size_t> budgets = {0, 256};
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--port=", 0) == 0) port = std::stoi(arg.substr(7));
+        if (arg.rfind("--light=", 0) == 0) light_clients = std::stoul(arg.substr(8));
+        if (arg.rfind("--seconds=", 0) == 0) seconds = std::stod(arg.substr(10));
+        if (arg.rfind("--pipeline=", 0) == 0) pipeline = std::stoul(arg.substr(11));
+        if (arg.rfind("--budgets=", 0) == 0) {
+            budgets.clear();
+            std::istringstream list(arg.substr(10));
+            for (std::string item; std::getline(list, item, ',');) {
+                budgets.push_back(std::stoul(item));
+            }
+        }
+    }
+
+    std::printf("1 heavy client (pipeline %zu) + %zu light clients, %.0fs per budget "
+                "(latency in us)\n\n",
+                pipeline, light_clients, seconds);
+    std::printf("%-8s %14s %12s %10s %10s %10s\n", "budget", "heavy ops/sec", "light reqs", "p50",
+                "p99", "max");
+    for (size_t budget : budgets) run(port, budget, light_clients, seconds, pipeline);
+    return 0;
+}
@@ -0,0 +1,115 @@
+/**
+ * Keyspace hash cost on typical 20-60 byte keys
+ *
+ * For each hash: nanoseconds per hash at each key length, then lookups per
+ * second in an unordered_map of the same keys using it:
+ *   std::hash         libstdc++'s unseeded murmur variant (the old keyspace hash)
+ *   siphash-1-3       seeded, the default keyspace hash
+ *   siphash-2-4       seeded, the conservative SipHash variant, for reference
+ *   wyhash            seeded, the -DREDIS_CLONE_KEY_HASH=wyhash keyspace hash
+ *
+ *   hash_benchmark [--keys=1000000]
+ */
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "storage/key_hash.h"
+
+namespace storage = redis_clone::storage;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct StdHash {
+    size_t operator()(const std::string& key) const { return std::hash<std::string>{}(key); }
+};
+
+struct Sip13Hash {
+    size_t operator()(const std::string& key) const {
+        return storage::siphash13(key.data(), key.size(), storage::key_hash_seed());
+    }
+};
+
+struct Sip24Hash {
+    size_t operator()(const std::string& key) const {
+        return storage::siphash24(key.data(), key.size(), storage::key_hash_seed());
+    }
+};
+
+struct WyHash {
+    size_t operator()(const std::string& key) const {
+        return storage::wyhash(key.data(), key.size(), storage::key_hash_seed().k0);
+    }
+};
+
+std::vector<std::string> make_keys(size_t count, size_t length) {
+    std::vector<std::string> keys;
+    keys.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        std::string key = "object:" + std::to_string(i) + ":";
+        key.resize(length, 'f');
+        keys.push_back(std::move(key));
+    }
+    return keys;
+}
+
+template <typename Hash>
+double ns_per_hash(const std::vector<std::string>& keys) {
+    Hash hash;
+    size_t sink = 0;
+    auto start = Clock::now();
+    for (int round = 0; round < 5; ++round) {
+        for (const auto& key : keys) sink += hash(key);
+    }
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    if (sink == 42) std::printf(" ");  // Keeps the loop from being optimized away
+    return ns / (5.0 * keys.size());
+}
+
+template <typename Hash>
+double lookups_per_sec(const std::vector<std::string>& keys) {
+    std::unordered_map<std::string, size_t, Hash> map;
+    map.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) map.emplace(keys[i], i);
+
+    size_t found = 0;
+    auto start = Clock::now();
+    for (int round = 0; round < 3; ++round) {
+        for (const auto& key : keys) found += map.count(key);
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return found / seconds;
+}
+
+template <typename Hash>
+void measure(const char* name, const std::vector<std::vector<std::string>>& key_sets) {
+    std::printf("%-12s", name);
+    for (const auto& keys : key_sets) std::printf(" %8.1f", ns_per_hash<Hash>(keys));
+    std::printf(" %14.0f\n", lookups_per_sec<Hash>(key_sets[1]));
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    size_t count = 1000000;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--keys=", 0) == 0) count = std::stoul(arg.substr(7));
+    }
+
+    std::vector<std::vector<std::string>> key_sets = {make_keys(count, 20), make_keys(count, 40),
+                                                      make_keys(count, 60)};
+
+    std::printf("%zu keys (ns per hash by key length, lookups/sec with 40 byte keys)\n\n", count);
+    std::printf("%-12s %8s %8s %8s %14s\n", "hash", "20B", "40B", "60B", "lookups/sec");
+    measure<StdHash>("std::hash", key_sets);
+    measure<Sip13Hash>("siphash-1-3", key_sets);
+    measure<Sip24Hash>("siphash-2-4", key_sets);
+    measure<WyHash>("wyhash", key_sets);
+    return 0;
+}
@@ -0,0 +1,162 @@
+/**
+ * GET throughput for large values
+ *
+ * Runs against a server that is already up. For each value size, sets --keys
+ * keys to values of that size, then for --seconds: --clients connections
+ * each send --depth GETs of random keys, read the replies, and repeat.
+ * Values of 16KB and up are sent from the stored buffer with writev rather
+ * than copied into the client's output buffer, so the MB/s column is where a
+ * copy would show.
+ *
+ *   large_value_benchmark [--port=6379] [--keys=64] [--clients=4] [--seconds=5]
+ *                         [--depth=4] [--sizes=1024,65536,1048576]
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+int connect_to(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        std::perror("connect");
+        std::exit(1);
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+std::string command(const std::vector<std::string>& parts) {
+    std::string out = "*" + std::to_string(parts.size()) + "\r\n";
+    for (const auto& part : parts) {
+        out += "$" + std::to_string(part.size()) + "\r\n" + part + "\r\n";
+    }
+    return out;
+}
+
+bool send_all(int fd, const std::string& data) {
+    for (size_t sent = 0; sent < data.size();) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool receive_bytes(int fd, size_t count) {
+    static thread_local char buffer[256 * 1024];
+    while (count > 0) {
+        ssize_t n = recv(fd, buffer, std::min(sizeof(buffer), count), 0);
+        if (n <= 0) return false;
+        count -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+std::string key_name(size_t i) { return "large:" + std::to_string(i); }
+
+// $<size>\r\n<value>\r\n
+size_t reply_size(size_t value_size) {
+    return 1 + std::to_string(value_size).size() + 2 + value_size + 2;
+}
+
+void load(int port, size_t keys, size_t size) {
+    int fd = connect_to(port);
+    const std::string value(size, 'v');
+    for (size_t i = 0; i < keys; ++i) {
+        if (!send_all(fd, command({"SET", key_name(i), value})) || !receive_bytes(fd, 5)) {
+            std::fprintf(stderr, "loading failed\n");
+            std::exit(1);
+        }
+    }
+    close(fd);
+}
+
+void run(int port, size_t keys, size_t clients, double seconds, size_t depth, size_t size) {
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> gets{0};
+    std::vector<std::thread> threads;
+    for (size_t c = 0; c < clients; ++c) {
+        threads.emplace_back([&, c] {
+            int fd = connect_to(port);
+            std::mt19937_64 rng(c + 1);
+            std::uniform_int_distribution<size_t> pick(0, keys - 1);
+            std::vector<std::string> batches(64);
+            for (auto& batch : batches) {
+                for (size_t i = 0; i < depth; ++i) batch += command({"GET", key_name(pick(rng))});
+            }
+            for (size_t round = 0; !stop; ++round) {
+                if (!send_all(fd, batches[round % batches.size()]) ||
+                    !receive_bytes(fd, reply_size(size) * depth)) {
+                    break;
+                }
+                gets += depth;
+            }
+            close(fd);
+        });
+    }
+
+    auto start = Clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop = true;
+    for (auto& thread : threads) thread.join();
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    double per_second = gets / elapsed;
+    std::printf("%-10zu %14.0f %12.1f\n", size, per_second, per_second * size / (1 << 20));
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int port = 6379;
+    size_t keys = 64;
+    size_t clients = 4;
+    double seconds = 5;
+    size_t depth = 4;
+    std::vector<size_t> sizes = {1024, 64 * 1024, 1024 * 1024};
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--port=", 0) == 0) port = std::stoi(arg.substr(7));
+        if (arg.rfind("--keys=", 0) == 0) keys = std::stoul(arg.substr(7));
+        if (arg.rfind("--clients=", 0) == 0) clients = std::stoul(arg.substr(10));
+        if (arg.rfind("--seconds=", 0) == 0) seconds = std::stod(arg.substr(10));
+        if (arg.rfind("--depth=", 0) == 0) depth = std::stoul(arg.substr(8));
+        if (arg.rfind("--sizes=", 0) == 0) {
+            sizes.clear();
+            std::istringstream list(arg.substr(8));
+            for (std::string item; std::getline(list, item, ',');) {
+                sizes.push_back(std::stoul(item));
+            }
+        }
+    }
+
+    std::printf("%zu keys, %zu clients, depth %zu, %.0fs per size\n\n", keys, clients, depth,
+                seconds);
+    std::printf("%-10s %14s %12s\n", "bytes", "GETs/sec", "MB/s");
+    for (size_t size : sizes) {
+        load(port, keys, size);
+        run(port, keys, clients, seconds, depth, size);
+    }
+    return 0;
+}
@@ -0,0 +1,160 @@
+/**
+ * GET throughput by pipeline depth
+ *
+ * Runs against a server that is already up. Loads --keys keys with 16 byte
+ * values, then for each depth, for --seconds: --clients connections each
+ * send depth GETs of random keys, read the depth replies, and repeat. Deep
+ * pipelines are where the server's batch prefetch has lookups to overlap;
+ * with a keyspace much larger than the CPU caches each lookup is otherwise a
+ * chain of cache misses.
+ *
+ *   pipeline_benchmark [--port=6379] [--keys=1000000] [--clients=4] [--seconds=5]
+ *                      [--depths=1,16,64]
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr size_t kValueSize = 16;
+constexpr size_t kGetReplySize = 5 + kValueSize + 2;  // $16\r\n<value>\r\n
+
+int connect_to(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        std::perror("connect");
+        std::exit(1);
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+std::string command(const std::vector<std::string>& parts) {
+    std::string out = "*" + std::to_string(parts.size()) + "\r\n";
+    for (const auto& part : parts) {
+        out += "$" + std::to_string(part.size()) + "\r\n" + part + "\r\n";
+    }
+    return out;
+}
+
+bool send_all(int fd, const std::string& data) {
+    for (size_t sent = 0; sent < data.size();) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool receive_bytes(int fd, size_t count) {
+    char buffer[64 * 1024];
+    while (count > 0) {
+        ssize_t n = recv(fd, buffer, std::min(sizeof(buffer), count), 0);
+        if (n <= 0) return false;
+        count -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+std::string key_name(size_t i) { return "key:" + std::to_string(i); }
+
+void load(int port, size_t keys) {
+    int fd = connect_to(port);
+    const std::string value(kValueSize, 'v');
+    for (size_t start = 0; start < keys; start += 1000) {
+        size_t count = std::min<size_t>(1000, keys - start);
+        std::string batch;
+        for (size_t i = start; i < start + count; ++i) {
+            batch += command({"SET", key_name(i), value});
+        }
+        if (!send_all(fd, batch) || !receive_bytes(fd, 5 * count)) {
+            std::fprintf(stderr, "loading failed\n");
+            std::exit(1);
+        }
+    }
+    close(fd);
+}
+
+void run(int port, size_t keys, size_t clients, double seconds, size_t depth) {
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> gets{0};
+    std::vector<std::thread> threads;
+    for (size_t c = 0; c < clients; ++c) {
+        threads.emplace_back([&, c] {
+            int fd = connect_to(port);
+            std::mt19937_64 rng(c + 1);
+            std::uniform_int_distribution<size_t> pick(0, keys - 1);
+            // A few hundred pre-built batches, so the client is not what gets measured
+            std::vector<std::string> batches(256);
+            for (auto& batch : batches) {
+                for (size_t i = 0; i < depth; ++i) batch += command({"GET", key_name(pick(rng))});
+            }
+            for (size_t round = 0; !stop; ++round) {
+                if (!send_all(fd, batches[round % batches.size()]) ||
+                    !receive_bytes(fd, kGetReplySize * depth)) {
+                    break;
+                }
+                gets += depth;
+            }
+            close(fd);
+        });
+    }
+
+    auto start = Clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop = true;
+    for (auto& thread : threads) thread.join();
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    std::printf("%-8zu %14.0f\n", depth, gets / elapsed);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int port = 6379;
+    size_t keys = 1000000;
+    size_t clients = 4;
+    double seconds = 5;
+    std::vector<size_t> depths = {1, 16, 64};
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--port=", 0) == 0) port = std::stoi(arg.substr(7));
+        if (arg.rfind("--keys=", 0) == 0) keys = std::stoul(arg.substr(7));
+        if (arg.rfind("--clients=", 0) == 0) clients = std::stoul(arg.substr(10));
+        if (arg.rfind("--seconds=", 0) == 0) seconds = std::stod(arg.substr(10));
+        if (arg.rfind("--depths=", 0) == 0) {
+            depths.clear();
+            std::istringstream list(arg.substr(9));
+            for (std::string item; std::getline(list, item, ',');) {
+                depths.push_back(std::stoul(item));
+            }
+        }
+    }
+
+    load(port, keys);
+    std::printf("%zu keys, %zu clients, %.0fs per depth\n\n", keys, clients, seconds);
+    std::printf("%-8s %14s\n", "depth", "GETs/sec");
+    for (size_t depth : depths) run(port, keys, clients, seconds, depth);
+    return 0;
+}
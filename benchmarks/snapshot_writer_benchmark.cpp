@@ -0,0 +1,149 @@
+/**
+ * Foreground fsync latency while a large snapshot is written in the background
+ *
+ * A writer thread produces a --size-mb file, first through a plain ofstream
+ * (what save_snapshot_to_file used to do), then through BackgroundWriter.
+ * Meanwhile the main thread appends a small record and fdatasync()s it every
+ * millisecond, like an AOF with appendfsync always, and records the latency.
+ *
+ *   snapshot_writer_benchmark [--size-mb=1024] [--sync-interval-mb=4]
+ *                             [--bandwidth-mb=0] [--drop-cache] [--dir=.]
+ */
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "persistence/background_writer.h"
+
+using redis_clone::persistence::BackgroundWriter;
+using redis_clone::persistence::BackgroundWriterOptions;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Args {
+    size_t size_mb = 1024;
+    size_t sync_interval_mb = 4;
+    size_t bandwidth_mb = 0;
+    bool drop_cache = false;
+    std::string dir = ".";
+};
+
+Args parse_args(int argc, char* argv[]) {
+    Args args;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&](const char* prefix) { return arg.substr(std::string(prefix).size()); };
+        if (arg.rfind("--size-mb=", 0) == 0) {
+            args.size_mb = std::stoul(value("--size-mb="));
+        } else if (arg.rfind("--sync-interval-mb=", 0) == 0) {
+            args.sync_interval_mb = std::stoul(value("--sync-interval-mb="));
+        } else if (arg.rfind("--bandwidth-mb=", 0) == 0) {
+            args.bandwidth_mb = std::stoul(value("--bandwidth-mb="));
+        } else if (arg == "--drop-cache") {
+            args.drop_cache = true;
+        } else if (arg.rfind("--dir=", 0) == 0) {
+            args.dir = value("--dir=");
+        }
+    }
+    return args;
+}
+
+struct Result {
+    double write_seconds;
+    std::vector<double> latencies_us;
+};
+
+double percentile(std::vector<double>& values, double p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t index = static_cast<size_t>(p * (values.size() - 1));
+    return values[index];
+}
+
+template <typename WriteFn>
+Result run(const Args& args, WriteFn&& write_snapshot) {
+    std::string aof_path = args.dir + "/bench_foreground.aof";
+    int aof_fd = open(aof_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    const std::string record = "*3\r\n$3\r\nSET\r\n$8\r\nkey:0001\r\n$64\r\n" +
+                               std::string(64, 'v') + "\r\n";
+
+    std::atomic<bool> done{false};
+    auto start = Clock::now();
+    std::thread writer([&] {
+        write_snapshot();
+        done = true;
+    });
+
+    Result result;
+    while (!done) {
+        auto before = Clock::now();
+        (void)!write(aof_fd, record.data(), record.size());
+        fdatasync(aof_fd);
+        auto after = Clock::now();
+        result.latencies_us.push_back(
+            std::chrono::duration<double, std::micro>(after - before).count());
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    writer.join();
+    result.write_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    close(aof_fd);
+    std::remove(aof_path.c_str());
+    return result;
+}
+
+void report(const char* name, Result result, size_t size_mb) {
+    auto& l = result.latencies_us;
+    std::printf("%-18s %8.1f MB/s %9zu %9.0f %9.0f %9.0f %9.0f\n", name,
+                size_mb / result.write_seconds, l.size(), percentile(l, 0.50),
+                percentile(l, 0.99), percentile(l, 0.999), percentile(l, 1.0));
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    Args args = parse_args(argc, argv);
+    std::string snapshot_path = args.dir + "/bench_snapshot.tmp";
+    const std::string block(64 * 1024, 'x');
+    size_t blocks = args.size_mb * 1024 * 1024 / block.size();
+
+    std::printf("%zu MB snapshot, foreground: write + fdatasync every 1ms (latency in us)\n\n",
+                args.size_mb);
+    std::printf("%-18s %13s %9s %9s %9s %9s %9s\n", "writer", "throughput", "fsyncs", "p50",
+                "p99", "p99.9", "max");
+
+    Result baseline = run(args, [&] {
+        std::ofstream file(snapshot_path);
+        for (size_t i = 0; i < blocks; ++i) file << block;
+        file.flush();
+        file.close();
+        int fd = open(snapshot_path.c_str(), O_RDONLY);
+        fsync(fd);
+        close(fd);
+    });
+    report("ofstream", baseline, args.size_mb);
+
+    BackgroundWriterOptions options;
+    options.sync_interval = args.sync_interval_mb * 1024 * 1024;
+    options.max_bytes_per_sec = args.bandwidth_mb * 1024 * 1024;
+    options.drop_page_cache = args.drop_cache;
+
+    Result throttled = run(args, [&] {
+        BackgroundWriter file(snapshot_path, options);
+        for (size_t i = 0; i < blocks; ++i) file.write(block);
+        file.finish();
+    });
+    report("BackgroundWriter", throttled, args.size_mb);
+
+    std::remove(snapshot_path.c_str());
+    return 0;
+}
@@ -0,0 +1,107 @@
+/**
+ * Keyspace table: DashTable against std::unordered_map
+ *
+ * Inserts the same keys into both, then reports ns per insert and per lookup,
+ * the table's own bytes per key (buckets, directory), the same plus each
+ * entry's heap node, and the largest single allocation growth made.
+ * unordered_map rehashes into one bucket array twice the size; DashTable only
+ * ever adds a segment. Node sizes assume glibc malloc.
+ *
+ *   table_benchmark [--keys=1000000]
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "storage/dash_table.h"
+#include "storage/key_hash.h"
+
+namespace storage = redis_clone::storage;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct KeyHash {
+    size_t operator()(const std::string& key) const { return storage::hash_key(key); }
+};
+
+std::vector<std::string> make_keys(size_t count) {
+    std::vector<std::string> keys;
+    keys.reserve(count);
+    for (size_t i = 0; i < count; ++i) keys.push_back("user:session:" + std::to_string(i));
+    return keys;
+}
+
+double ns_since(Clock::time_point start, size_t operations) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / operations;
+}
+
+// A malloc chunk for an object of this size: 8-byte header, 16-byte steps, 32 at least
+double chunk_bytes(size_t size) { return std::max<size_t>((size + 8 + 15) / 16 * 16, 32); }
+
+void report(const char* name, double insert_ns, double lookup_ns, double table, double total,
+            double largest, size_t found) {
+    std::printf("%-14s %10.1f %10.1f %12.1f %12.1f %12.1f %10zu\n", name, insert_ns, lookup_ns,
+                table, total, largest, found);
+}
+
+void measure_unordered_map(const std::vector<std::string>& keys) {
+    std::unordered_map<std::string, int, KeyHash> map;
+    auto start = Clock::now();
+    for (const auto& key : keys) map.try_emplace(key, 1);
+    double insert_ns = ns_since(start, keys.size());
+
+    size_t found = 0;
+    start = Clock::now();
+    for (const auto& key : keys) found += map.count(key);
+    double lookup_ns = ns_since(start, keys.size());
+
+    // Bucket array plus the next pointer libstdc++ keeps in each node; the node also caches
+    // the hash, since KeyHash is not marked fast
+    double buckets = map.bucket_count() * sizeof(void*);
+    double table = (buckets + map.size() * sizeof(void*)) / map.size();
+    double node = chunk_bytes(sizeof(void*) + sizeof(std::pair<const std::string, int>) +
+                              sizeof(size_t));
+    double total = buckets / map.size() + node;
+    report("unordered_map", insert_ns, lookup_ns, table, total, buckets / (1 << 20), found);
+}
+
+void measure_dash_table(const std::vector<std::string>& keys) {
+    storage::DashTable<int> table;
+    auto start = Clock::now();
+    for (const auto& key : keys) table.try_emplace(key).first->second = 1;
+    double insert_ns = ns_since(start, keys.size());
+
+    size_t found = 0;
+    start = Clock::now();
+    for (const auto& key : keys) found += table.find(key) != nullptr;
+    double lookup_ns = ns_since(start, keys.size());
+
+    double own = static_cast<double>(table.table_memory()) / table.size();
+    double total = static_cast<double>(table.memory_overhead()) / table.size();
+    // A new segment, or the directory when it doubles
+    double segment = storage::DashTable<int>::kSegmentBuckets * 64.0;
+    double largest = std::max(segment, table.directory_size() * 2.0 * sizeof(void*));
+    report("DashTable", insert_ns, lookup_ns, own, total, largest / (1 << 20), found);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    size_t count = 1000000;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--keys=", 0) == 0) count = std::stoul(arg.substr(7));
+    }
+
+    std::vector<std::string> keys = make_keys(count);
+    std::printf("%zu keys\n\n", count);
+    std::printf("%-14s %10s %10s %12s %12s %12s %10s\n", "table", "insert ns", "lookup ns",
+                "table B/key", "+nodes B/key", "largest MB", "found");
+    measure_unordered_map(keys);
+    measure_dash_table(keys);
+    return 0;
+}
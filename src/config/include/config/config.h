@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "persistence/aof_writer.h"
+
+namespace redis_clone {
+namespace config {
+
+enum class AppendFsync { ALWAYS, EVERYSEC, NO };
+enum class MaxmemoryPolicy { NOEVICTION, TIERED };
+
+/**
+ * "save <seconds> <changes>": snapshot once both thresholds are reached
+ */
+struct SavePoint {
+    int64_t seconds;
+    int64_t changes;
+};
+
+/**
+ * One immutable version of every tunable, named as in redis.conf
+ */
+struct Settings {
+    std::vector<SavePoint> save_points = {{900, 1}, {300, 10}, {60, 10000}};
+    bool incremental_checkpoints = false;  // Save points write deltas on top of the last base
+    size_t checkpoint_max_deltas = 10;     // Then a full base again
+    bool checkpoint_fork = true;  // no: pin the values, write from a thread of this process
+    bool appendonly = true;
+    AppendFsync appendfsync = AppendFsync::EVERYSEC;
+    persistence::AofWriteMode aof_write_mode = persistence::AofWriteMode::BUFFERED;
+    size_t aof_preallocate_size = 64 * 1024 * 1024;  // 0 disables fallocate
+    bool aof_timestamp_enabled = false;              // Write #TS:<unix> markers in the AOF
+    // appendfsync everysec: hold writes while the background fsync falls this far behind
+    size_t aof_max_unsynced_bytes = 64 * 1024 * 1024;  // 0 = no limit
+    size_t aof_max_fsync_lag_ms = 2000;                 // 0 = no limit
+    size_t auto_aof_rewrite_percentage = 100;
+    size_t auto_aof_rewrite_min_size = 64 * 1024 * 1024;
+    std::string upgrade_socket;        // Unix socket a new binary takes over through; "" = off
+    bool loading_serve_reads = false;  // GET/EXISTS answer from keys loaded so far
+    size_t maxmemory = 0;              // 0 means no limit
+    MaxmemoryPolicy maxmemory_policy = MaxmemoryPolicy::NOEVICTION;
+    size_t client_query_buffer_limit = 1024 * 1024 * 1024;
+    size_t client_output_buffer_limit = 0;  // 0 means no limit
+    size_t client_command_budget = 256;     // Per client per loop iteration, 0 = unlimited
+    bool client_priority_lane = true;  // Clients about to run PING, INFO, ... go first
+    size_t client_buffer_pool_size = 64 * 1024 * 1024;  // Idle large buffers kept for reuse
+    // Snapshot and AOF rewrite writers, see persistence::BackgroundWriter
+    size_t background_write_sync_interval = 4 * 1024 * 1024;  // 0 disables incremental sync
+    size_t background_write_max_bandwidth = 0;               // Bytes per second, 0 = unlimited
+    bool background_write_drop_cache = false;
+};
+
+/**
+ * Parse "100", "64mb", "1gb" style sizes; throws std::invalid_argument
+ */
+size_t parse_memory_size(const std::string& text);
+
+/**
+ * Server configuration: redis.conf-style file plus CONFIG GET/SET/REWRITE
+ *
+ * Readers call snapshot() from any thread without locking: it returns the
+ * current immutable Settings through an atomic pointer. set() copies the
+ * current version, applies the change and publishes the copy. Old versions
+ * stay alive, so a reader never sees a freed snapshot, until the owner calls
+ * reclaim() at a point where no reader can still hold one.
+ */
+class Config {
+   public:
+    Config();
+
+    Config(const Config&) = delete;
+    Config& operator=(const Config&) = delete;
+
+    const Settings& snapshot() const { return *current_.load(std::memory_order_acquire); }
+
+    // Throws std::runtime_error naming the offending line
+    void load_file(const std::string& path);
+    const std::string& file_path() const { return file_path_; }
+
+    /**
+     * Change one parameter. Parameters marked immutable are only accepted
+     * with at_startup. Returns an error message, empty on success.
+     */
+    std::string set(const std::string& name, const std::string& value, bool at_startup = false);
+
+    // Name/value pairs for every parameter matching a glob pattern
+    std::vector<std::pair<std::string, std::string>> get(const std::string& pattern) const;
+
+    // Write the current values back into the config file; error message or empty
+    std::string rewrite() const;
+
+    /**
+     * Free every version but the current one. Only safe while no thread
+     * holds a reference from an earlier snapshot(): the event loop calls it
+     * between iterations, when its I/O threads are idle.
+     */
+    void reclaim();
+    size_t version_count() const;
+
+   private:
+    mutable std::mutex write_mutex_;
+    std::atomic<const Settings*> current_;
+    std::vector<std::unique_ptr<const Settings>> versions_;
+    std::string file_path_;
+
+    void publish(std::unique_ptr<const Settings> settings);
+};
+
+}  // namespace config
+}  // namespace redis_clone
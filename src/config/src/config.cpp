@@ -0,0 +1,488 @@
+#include "config/config.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace redis_clone {
+namespace config {
+
+namespace {
+
+struct Parameter {
+    const char* name;
+    bool mutable_at_runtime;
+    void (*apply)(Settings&, const std::string&);  // Throws std::invalid_argument
+    std::string (*render)(const Settings&);
+};
+
+std::string to_lower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    return text;
+}
+
+int64_t parse_integer(const std::string& text) {
+    size_t consumed = 0;
+    int64_t value = 0;
+    try {
+        value = std::stoll(text, &consumed);
+    } catch (const std::exception&) {
+        consumed = 0;
+    }
+    if (text.empty() || consumed != text.size() || value < 0) {
+        throw std::invalid_argument("argument must be a non-negative integer");
+    }
+    return value;
+}
+
+bool parse_yes_no(const std::string& text) {
+    std::string lower = to_lower(text);
+    if (lower == "yes") return true;
+    if (lower == "no") return false;
+    throw std::invalid_argument("argument must be 'yes' or 'no'");
+}
+
+std::vector<SavePoint> parse_save_points(const std::string& text) {
+    std::istringstream stream(text);
+    std::vector<std::string> tokens;
+    for (std::string token; stream >> token;) {
+        tokens.push_back(token);
+    }
+    if (tokens.size() % 2 != 0) {
+        throw std::invalid_argument("save expects <seconds> <changes> pairs");
+    }
+
+    std::vector<SavePoint> points;
+    for (size_t i = 0; i < tokens.size(); i += 2) {
+        points.push_back({parse_integer(tokens[i]), parse_integer(tokens[i + 1])});
+    }
+    return points;
+}
+
+std::string render_save_points(const Settings& settings) {
+    std::string out;
+    for (const auto& point : settings.save_points) {
+        if (!out.empty()) out += ' ';
+        out += std::to_string(point.seconds) + " " + std::to_string(point.changes);
+    }
+    return out;
+}
+
+const std::vector<Parameter>& parameters() {
+    static const std::vector<Parameter> table = {
+        {"save", true,
+         [](Settings& s, const std::string& v) { s.save_points = parse_save_points(v); },
+         render_save_points},
+        {"incremental-checkpoints", false,
+         [](Settings& s, const std::string& v) { s.incremental_checkpoints = parse_yes_no(v); },
+         [](const Settings& s) -> std::string {
+             return s.incremental_checkpoints ? "yes" : "no";
+         }},
+        {"checkpoint-max-deltas", true,
+         [](Settings& s, const std::string& v) { s.checkpoint_max_deltas = parse_integer(v); },
+         [](const Settings& s) { return std::to_string(s.checkpoint_max_deltas); }},
+        {"checkpoint-fork", true,
+         [](Settings& s, const std::string& v) { s.checkpoint_fork = parse_yes_no(v); },
+         [](const Settings& s) -> std::string { return s.checkpoint_fork ? "yes" : "no"; }},
+        {"appendonly", false,
+         [](Settings& s, const std::string& v) { s.appendonly = parse_yes_no(v); },
+         [](const Settings& s) -> std::string { return s.appendonly ? "yes" : "no"; }},
+        {"appendfsync", true,
+         [](Settings& s, const std::string& v) {
+             std::string lower = to_lower(v);
+             if (lower == "always") {
+                 s.appendfsync = AppendFsync::ALWAYS;
+             } else if (lower == "everysec") {
+                 s.appendfsync = AppendFsync::EVERYSEC;
+             } else if (lower == "no") {
+                 s.appendfsync = AppendFsync::NO;
+             } else {
+                 throw std::invalid_argument("argument must be 'always', 'everysec' or 'no'");
+             }
+         },
+         [](const Settings& s) -> std::string {
+             switch (s.appendfsync) {
+                 case AppendFsync::ALWAYS:
+                     return "always";
+                 case AppendFsync::EVERYSEC:
+                     return "everysec";
+                 default:
+                     return "no";
+             }
+         }},
+        {"aof-write-mode", false,
+         [](Settings& s, const std::string& v) {
+             std::string lower = to_lower(v);
+             if (lower == "buffered") {
+                 s.aof_write_mode = persistence::AofWriteMode::BUFFERED;
+             } else if (lower == "dsync") {
+                 s.aof_write_mode = persistence::AofWriteMode::DSYNC;
+             } else if (lower == "direct") {
+                 s.aof_write_mode = persistence::AofWriteMode::DIRECT;
+             } else {
+                 throw std::invalid_argument("argument must be 'buffered', 'dsync' or 'direct'");
+             }
+         },
+         [](const Settings& s) -> std::string {
+             switch (s.aof_write_mode) {
+                 case persistence::AofWriteMode::DSYNC:
+                     return "dsync";
+                 case persistence::AofWriteMode::DIRECT:
+                     return "direct";
+                 default:
+                     return "buffered";
+             }
+         }},
+        {"aof-preallocate-size", true,
+         [](Settings& s, const std::string& v) { s.aof_preallocate_size = parse_memory_size(v); },
+         [](const Settings& s) { return std::to_string(s.aof_preallocate_size); }},
+        {"aof-timestamp-enabled", true,
+         [](Settings& s, const std::string& v) { s.aof_timestamp_enabled = parse_yes_no(v); },
+         [](const Settings& s) -> std::string { return s.aof_timestamp_enabled ? "yes" : "no"; }},
+        {"aof-max-unsynced-bytes", true,
+         [](Settings& s, const std::string& v) { s.aof_max_unsynced_bytes = parse_memory_size(v); },
+         [](const Settings& s) { return std::to_string(s.aof_max_unsynced_bytes); }},
+        {"aof-max-fsync-lag-ms", true,
+         [](Settings& s, const std::string& v) { s.aof_max_fsync_lag_ms = parse_integer(v); },
+         [](const Settings& s) { return std::to_string(s.aof_max_fsync_lag_ms); }},
+        {"auto-aof-rewrite-percentage", true,
+         [](Settings& s, const std::string& v) {
+             s.auto_aof_rewrite_percentage = parse_integer(v);
+         },
+         [](const Settings& s) { return std::to_string(s.auto_aof_rewrite_percentage); }},
+        {"auto-aof-rewrite-min-size", true,
+         [](Settings& s, const std::string& v) {
+             s.auto_aof_rewrite_min_size = parse_memory_size(v);
+         },
+         [](const Settings& s) { return std::to_string(s.auto_aof_rewrite_min_size); }},
+        {"upgrade-socket", false,
+         [](Settings& s, const std::string& v) { s.upgrade_socket = v; },
+         [](const Settings& s) { return s.upgrade_socket; }},
+        {"loading-serve-reads", true,
+         [](Settings& s, const std::string& v) { s.loading_serve_reads = parse_yes_no(v); },
+         [](const Settings& s) -> std::string { return s.loading_serve_reads ? "yes" : "no"; }},
+        {"maxmemory", true,
+         [](Settings& s, const std::string& v) { s.maxmemory = parse_memory_size(v); },
+         [](const Settings& s) { return std::to_string(s.maxmemory); }},
+        {"maxmemory-policy", false,
+         [](Settings& s, const std::string& v) {
+             std::string lower = to_lower(v);
+             if (lower == "noeviction") {
+                 s.maxmemory_policy = MaxmemoryPolicy::NOEVICTION;
+             } else if (lower == "tiered") {
+                 s.maxmemory_policy = MaxmemoryPolicy::TIERED;
+             } else {
+                 throw std::invalid_argument("argument must be 'noeviction' or 'tiered'");
+             }
+         },
+         [](const Settings& s) -> std::string {
+             return s.maxmemory_policy == MaxmemoryPolicy::TIERED ? "tiered" : "noeviction";
+         }},
+        {"client-query-buffer-limit", true,
+         [](Settings& s, const std::string& v) {
+             s.client_query_buffer_limit = parse_memory_size(v);
+         },
+         [](const Settings& s) { return std::to_string(s.client_query_buffer_limit); }},
+        {"client-output-buffer-limit", true,
+         [](Settings& s, const std::string& v) {
+             s.client_output_buffer_limit = parse_memory_size(v);
+         },
+         [](const Settings& s) { return std::to_string(s.client_output_buffer_limit); }},
+        {"client-buffer-pool-size", true,
+         [](Settings& s, const std::string& v) {
+             s.client_buffer_pool_size = parse_memory_size(v);
+         },
+         [](const Settings& s) { return std::to_string(s.client_buffer_pool_size); }},
+        {"client-command-budget", true,
+         [](Settings& s, const std::string& v) { s.client_command_budget = parse_integer(v); },
+         [](const Settings& s) { return std::to_string(s.client_command_budget); }},
+        {"client-priority-lane", true,
+         [](Settings& s, const std::string& v) { s.client_priority_lane = parse_yes_no(v); },
+         [](const Settings& s) -> std::string { return s.client_priority_lane ? "yes" : "no"; }},
+        {"background-write-sync-interval", true,
+         [](Settings& s, const std::string& v) {
+             s.background_write_sync_interval = parse_memory_size(v);
+         },
+         [](const Settings& s) { return std::to_string(s.background_write_sync_interval); }},
+        {"background-write-max-bandwidth", true,
+         [](Settings& s, const std::string& v) {
+             s.background_write_max_bandwidth = parse_memory_size(v);
+         },
+         [](const Settings& s) { return std::to_string(s.background_write_max_bandwidth); }},
+        {"background-write-drop-cache", true,
+         [](Settings& s, const std::string& v) { s.background_write_drop_cache = parse_yes_no(v); },
+         [](const Settings& s) -> std::string {
+             return s.background_write_drop_cache ? "yes" : "no";
+         }},
+    };
+    return table;
+}
+
+const Parameter* find_parameter(const std::string& name) {
+    for (const auto& parameter : parameters()) {
+        if (name == parameter.name) return &parameter;
+    }
+    return nullptr;
+}
+
+// Redis-style glob with '*' and '?'
+bool glob_match(const char* pattern, const char* text) {
+    while (*pattern) {
+        if (*pattern == '*') {
+            for (const char* rest = text;; ++rest) {
+                if (glob_match(pattern + 1, rest)) return true;
+                if (!*rest) return false;
+            }
+        }
+        if (!*text || (*pattern != '?' && *pattern != *text)) return false;
+        ++pattern;
+        ++text;
+    }
+    return !*text;
+}
+
+// Split a config line into words, honouring double quotes ("save \"\"")
+std::vector<std::string> split_line(const std::string& line) {
+    std::vector<std::string> words;
+    size_t i = 0;
+    while (i < line.size()) {
+        while (i < line.size() && std::isspace(static_cast<unsigned char>(line[i]))) ++i;
+        if (i >= line.size()) break;
+
+        std::string word;
+        if (line[i] == '"') {
+            size_t close = line.find('"', i + 1);
+            if (close == std::string::npos) {
+                throw std::invalid_argument("unbalanced quotes");
+            }
+            word = line.substr(i + 1, close - i - 1);
+            i = close + 1;
+        } else {
+            while (i < line.size() && !std::isspace(static_cast<unsigned char>(line[i]))) {
+                word += line[i++];
+            }
+        }
+        words.push_back(word);
+    }
+    return words;
+}
+
+std::string join(const std::vector<std::string>& words, size_t from) {
+    std::string out;
+    for (size_t i = from; i < words.size(); ++i) {
+        if (i > from) out += ' ';
+        out += words[i];
+    }
+    return out;
+}
+
+std::string quote_if_empty(const std::string& value) { return value.empty() ? "\"\"" : value; }
+
+// Directive lines as they should appear in the file for one parameter
+std::vector<std::string> render_lines(const Parameter& parameter, const Settings& settings) {
+    std::string name = parameter.name;
+    if (name != "save") {
+        return {name + " " + quote_if_empty(parameter.render(settings))};
+    }
+
+    if (settings.save_points.empty()) {
+        return {"save \"\""};
+    }
+    std::vector<std::string> lines;
+    for (const auto& point : settings.save_points) {
+        lines.push_back("save " + std::to_string(point.seconds) + " " +
+                        std::to_string(point.changes));
+    }
+    return lines;
+}
+
+}  // namespace
+
+size_t parse_memory_size(const std::string& text) {
+    std::string lower = to_lower(text);
+    size_t suffix_at = lower.find_first_not_of("0123456789");
+    if (lower.empty() || suffix_at == 0) {
+        throw std::invalid_argument("argument must be a memory value");
+    }
+
+    size_t amount = std::stoull(lower.substr(0, suffix_at));
+    std::string suffix = suffix_at == std::string::npos ? "" : lower.substr(suffix_at);
+    if (suffix.empty() || suffix == "b") return amount;
+    if (suffix == "k" || suffix == "kb") return amount * 1024;
+    if (suffix == "m" || suffix == "mb") return amount * 1024 * 1024;
+    if (suffix == "g" || suffix == "gb") return amount * 1024 * 1024 * 1024;
+    throw std::invalid_argument("argument must be a memory value");
+}
+
+Config::Config() { publish(std::make_unique<const Settings>()); }
+
+void Config::publish(std::unique_ptr<const Settings> settings) {
+    current_.store(settings.get(), std::memory_order_release);
+    versions_.push_back(std::move(settings));
+}
+
+void Config::reclaim() {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    if (versions_.size() > 1) versions_.erase(versions_.begin(), versions_.end() - 1);
+}
+
+size_t Config::version_count() const {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    return versions_.size();
+}
+
+void Config::load_file(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open config file " + path);
+    }
+
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    auto settings = std::make_unique<Settings>(snapshot());
+    bool seen_save = false;
+    std::string line;
+
+    for (int line_number = 1; std::getline(file, line); ++line_number) {
+        try {
+            std::vector<std::string> words = split_line(line);
+            if (words.empty() || words[0][0] == '#') continue;
+
+            std::string name = to_lower(words[0]);
+            const Parameter* parameter = find_parameter(name);
+            if (!parameter || words.size() < 2) {
+                throw std::invalid_argument("Bad directive or wrong number of arguments");
+            }
+
+            std::string value = join(words, 1);
+            if (name == "save" && seen_save && !value.empty()) {
+                // Like redis.conf, each further save line adds a point
+                auto points = parse_save_points(value);
+                settings->save_points.insert(settings->save_points.end(), points.begin(),
+                                             points.end());
+            } else {
+                parameter->apply(*settings, value);
+            }
+            seen_save = seen_save || name == "save";
+        } catch (const std::exception& e) {
+            throw std::runtime_error("Config file " + path + ", line " +
+                                     std::to_string(line_number) + ": " + e.what());
+        }
+    }
+
+    file_path_ = path;
+    publish(std::move(settings));
+}
+
+std::string Config::set(const std::string& name, const std::string& value, bool at_startup) {
+    const Parameter* parameter = find_parameter(to_lower(name));
+    if (!parameter) {
+        return "Unknown option or number of arguments for CONFIG SET - '" + name + "'";
+    }
+    if (!parameter->mutable_at_runtime && !at_startup) {
+        return "CONFIG SET failed (possibly related to argument '" + name +
+               "') - can't set immutable config";
+    }
+
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    auto settings = std::make_unique<Settings>(snapshot());
+    try {
+        parameter->apply(*settings, value);
+    } catch (const std::exception& e) {
+        return "CONFIG SET failed (possibly related to argument '" + name + "') - " + e.what();
+    }
+    publish(std::move(settings));
+    return "";
+}
+
+std::vector<std::pair<std::string, std::string>> Config::get(const std::string& pattern) const {
+    const Settings& settings = snapshot();
+    std::string lower = to_lower(pattern);
+
+    std::vector<std::pair<std::string, std::string>> matches;
+    for (const auto& parameter : parameters()) {
+        if (glob_match(lower.c_str(), parameter.name)) {
+            matches.emplace_back(parameter.name, parameter.render(settings));
+        }
+    }
+    return matches;
+}
+
+std::string Config::rewrite() const {
+    if (file_path_.empty()) {
+        return "The server is running without a config file";
+    }
+
+    std::vector<std::string> original;
+    {
+        std::ifstream file(file_path_);
+        for (std::string line; std::getline(file, line);) {
+            original.push_back(line);
+        }
+    }
+
+    const Settings& settings = snapshot();
+    const Settings defaults;
+    std::vector<std::string> written_names;
+    std::vector<std::string> output;
+
+    // Keep comments and ordering, replace the first occurrence of each directive
+    for (const auto& line : original) {
+        std::vector<std::string> words;
+        try {
+            words = split_line(line);
+        } catch (const std::exception&) {
+        }
+        const Parameter* parameter =
+            words.empty() || words[0][0] == '#' ? nullptr : find_parameter(to_lower(words[0]));
+        if (!parameter) {
+            output.push_back(line);
+            continue;
+        }
+
+        if (std::find(written_names.begin(), written_names.end(), parameter->name) ==
+            written_names.end()) {
+            written_names.push_back(parameter->name);
+            for (auto& rendered : render_lines(*parameter, settings)) {
+                output.push_back(rendered);
+            }
+        }
+    }
+
+    // Append whatever differs from the defaults and is not in the file yet
+    for (const auto& parameter : parameters()) {
+        bool written = std::find(written_names.begin(), written_names.end(), parameter.name) !=
+                       written_names.end();
+        if (!written && parameter.render(settings) != parameter.render(defaults)) {
+            for (auto& rendered : render_lines(parameter, settings)) {
+                output.push_back(rendered);
+            }
+        }
+    }
+
+    const std::string temp_path = file_path_ + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::trunc);
+        if (!file.is_open()) {
+            return "Rewriting config file: cannot open " + temp_path;
+        }
+        for (const auto& line : output) {
+            file << line << "\n";
+        }
+        if (!file.good()) {
+            return "Rewriting config file: write failed";
+        }
+    }
+
+    if (std::rename(temp_path.c_str(), file_path_.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        return "Rewriting config file: rename failed";
+    }
+    return "";
+}
+
+}  // namespace config
+}  // namespace redis_clone
@@ -1,17 +1,24 @@
 #include <unistd.h>
 
+#include <algorithm>
 #include <csignal>
+#include <cstdint>
 #include <cstdlib>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <thread>
 
+#include "config/config.h"
 #include "network/server.h"
+#include "network/sharded_server.h"
 #include "network/threaded_server.h"
 
 // Global variable for signal handling
 volatile sig_atomic_t g_running = 1;
 
-enum class ServerMode { EVENT_LOOP, MULTI_THREADED };
+enum class ServerMode { EVENT_LOOP, MULTI_THREADED, COROUTINE, SHARDED };
 
 namespace {
 
@@ -50,20 +57,45 @@ int get_port_from_env() {
 void print_usage(const char* program_name) {
     std::cout << "Usage: " << program_name << " [OPTIONS]\n"
               << "Options:\n"
-              << "  --mode=<type>     Server mode: 'eventloop' (default) or 'threaded'\n"
+              << "  --mode=<type>     Server mode: 'eventloop' (default), 'threaded',\n"
+              << "                    'sharded' (shard per core) or 'coroutine'\n"
+              << "                    (needs -DREDIS_CLONE_ENABLE_COROUTINES=ON)\n"
               << "  --port=<number>   Port number (default: 6379)\n"
+              << "  --io-threads=<n>  I/O threads for the event loop, incl. main (default: 1)\n"
+              << "  --reactor-threads=<n>  Reactor threads for coroutine mode (default: 4)\n"
+              << "  --shards=<n>      Shard threads for sharded mode (default: one per core,\n"
+              << "                    at most 16)\n"
+              << "  --ordered-index   Maintain an ordered key index for SCANPREFIX/SCANRANGE\n"
+              << "  --tiered-max-memory=<bytes>  Spill cold values to disk above this (512mb)\n"
+              << "  --config=<file>   redis.conf-style config file (event loop mode)\n"
+              << "  --aof-truncate-to-timestamp=<unix time>  Restore the AOF state as of this\n"
+              << "                    time: replay stops at the first later #TS marker and the\n"
+              << "                    rest of the AOF is cut off (needs aof-timestamp-enabled)\n"
+              << "  --upgrade-from=<socket>  Hot upgrade: take over the listener, clients and\n"
+              << "                    keyspace of the server on this upgrade-socket\n"
               << "  -h, --help        Show this help message\n"
               << "\nExamples:\n"
               << "  " << program_name << "                    # Event loop server on port 6379\n"
               << "  " << program_name << " --mode=threaded    # Multi-threaded server\n"
-              << "  " << program_name << " --port=8080        # Custom port\n";
+              << "  " << program_name << " --mode=sharded --shards=8  # Shard per core\n"
+              << "  " << program_name << " --port=8080        # Custom port\n"
+              << "  " << program_name << " --io-threads=4     # Parallel socket I/O\n";
 }
 
 struct ServerConfig {
     ServerMode mode = ServerMode::EVENT_LOOP;
     int port = 6379;
+    size_t io_threads = 1;
+    size_t reactor_threads = 4;
+    size_t shards = 0;  // 0: one per core
+    bool ordered_index = false;
+    size_t tiered_max_memory = 0;
+    std::string config_file;
+    int64_t aof_truncate_to_timestamp = 0;
+    std::string upgrade_from;
 };
 
+
 ServerConfig parse_arguments(int argc, char* argv[]) {
     ServerConfig config;
     config.port = get_port_from_env();
@@ -80,15 +112,56 @@ ServerConfig parse_arguments(int argc, char* argv[]) {
                 config.mode = ServerMode::EVENT_LOOP;
             } else if (mode == "threaded") {
                 config.mode = ServerMode::MULTI_THREADED;
+            } else if (mode == "sharded") {
+                config.mode = ServerMode::SHARDED;
+            } else if (mode == "coroutine") {
+#ifdef REDIS_CLONE_COROUTINES
+                config.mode = ServerMode::COROUTINE;
+#else
+                throw std::invalid_argument(
+                    "Coroutine mode requires a build with -DREDIS_CLONE_ENABLE_COROUTINES=ON");
+#endif
             } else {
                 throw std::invalid_argument("Invalid mode: " + mode +
-                                            ". Use 'eventloop' or 'threaded'");
+                                            ". Use 'eventloop', 'threaded', 'sharded' or "
+                                            "'coroutine'");
             }
         } else if (arg.substr(0, 7) == "--port=") {
             config.port = std::stoi(arg.substr(7));
             if (config.port <= 0 || config.port > 65535) {
                 throw std::out_of_range("Port number out of range");
             }
+        } else if (arg.substr(0, 13) == "--io-threads=") {
+            int io_threads = std::stoi(arg.substr(13));
+            if (io_threads < 1 || io_threads > 128) {
+                throw std::out_of_range("I/O thread count must be between 1 and 128");
+            }
+            config.io_threads = static_cast<size_t>(io_threads);
+        } else if (arg == "--ordered-index") {
+            config.ordered_index = true;
+        } else if (arg.substr(0, 20) == "--tiered-max-memory=") {
+            config.tiered_max_memory = redis_clone::config::parse_memory_size(arg.substr(20));
+        } else if (arg.substr(0, 28) == "--aof-truncate-to-timestamp=") {
+            config.aof_truncate_to_timestamp = std::stoll(arg.substr(28));
+            if (config.aof_truncate_to_timestamp <= 0) {
+                throw std::out_of_range("Timestamp must be a positive unix time");
+            }
+        } else if (arg.substr(0, 15) == "--upgrade-from=") {
+            config.upgrade_from = arg.substr(15);
+        } else if (arg.substr(0, 9) == "--config=") {
+            config.config_file = arg.substr(9);
+        } else if (arg.substr(0, 18) == "--reactor-threads=") {
+            int reactor_threads = std::stoi(arg.substr(18));
+            if (reactor_threads < 1 || reactor_threads > 128) {
+                throw std::out_of_range("Reactor thread count must be between 1 and 128");
+            }
+            config.reactor_threads = static_cast<size_t>(reactor_threads);
+        } else if (arg.substr(0, 9) == "--shards=") {
+            int shards = std::stoi(arg.substr(9));
+            if (shards < 1 || shards > 128) {
+                throw std::out_of_range("Shard count must be between 1 and 128");
+            }
+            config.shards = static_cast<size_t>(shards);
         } else {
             // Try to parse as port number for backward compatibility
             try {
@@ -102,6 +175,17 @@ ServerConfig parse_arguments(int argc, char* argv[]) {
         }
     }
 
+    if (config.tiered_max_memory > 0 && config.mode != ServerMode::EVENT_LOOP) {
+        throw std::invalid_argument("--tiered-max-memory is only supported in eventloop mode");
+    }
+    if (config.aof_truncate_to_timestamp > 0 && config.mode != ServerMode::EVENT_LOOP) {
+        throw std::invalid_argument(
+            "--aof-truncate-to-timestamp is only supported in eventloop mode");
+    }
+    if (!config.upgrade_from.empty() && config.mode != ServerMode::EVENT_LOOP) {
+        throw std::invalid_argument("--upgrade-from is only supported in eventloop mode");
+    }
+
     return config;
 }
 }  // namespace
@@ -112,8 +196,10 @@ int main(int argc, char* argv[]) {
 
         ServerConfig config = parse_arguments(argc, argv);
 
-        const char* mode_name =
-            (config.mode == ServerMode::EVENT_LOOP) ? "Event Loop" : "Multi-threaded";
+        const char* mode_name = (config.mode == ServerMode::EVENT_LOOP)       ? "Event Loop"
+                                : (config.mode == ServerMode::MULTI_THREADED) ? "Multi-threaded"
+                                : (config.mode == ServerMode::SHARDED)        ? "Sharded"
+                                                                              : "Coroutine";
 
         std::cout << "Redis Clone Server v0.1.0\n"
                   << "Mode: " << mode_name << "\n"
@@ -122,13 +208,45 @@ int main(int argc, char* argv[]) {
                   << "--------------------------------\n";
 
         if (config.mode == ServerMode::EVENT_LOOP) {
-            redis_clone::network::RedisServer server(config.port);
-            std::cout << "Event loop server ready to accept connections\n";
+            redis_clone::network::ServerOptions options;
+            options.io_threads = config.io_threads;
+            options.ordered_index = config.ordered_index;
+            options.aof_truncate_to_timestamp = config.aof_truncate_to_timestamp;
+            options.upgrade_from = config.upgrade_from;
+            options.config = std::make_shared<redis_clone::config::Config>();
+            if (!config.config_file.empty()) {
+                options.config->load_file(config.config_file);
+                std::cout << "Loaded config from " << config.config_file << "\n";
+            }
+            // Command-line flags win over the config file
+            if (config.tiered_max_memory > 0) {
+                options.config->set("maxmemory", std::to_string(config.tiered_max_memory), true);
+                options.config->set("maxmemory-policy", "tiered", true);
+            }
+            redis_clone::network::RedisServer server(config.port, options);
+            std::cout << "Event loop server ready to accept connections ("
+                      << config.io_threads << " I/O threads)\n";
             server.run();
-        } else {
-            redis_clone::network::ThreadedRedisServer server(config.port);
+        } else if (config.mode == ServerMode::MULTI_THREADED) {
+            redis_clone::network::ThreadedRedisServer server(config.port, 0, config.ordered_index);
             std::cout << "Multi-threaded server ready to accept connections\n";
             server.run();
+        } else if (config.mode == ServerMode::SHARDED) {
+            size_t shards = config.shards;
+            if (shards == 0) {
+                shards = std::min<size_t>(16, std::max(1u, std::thread::hardware_concurrency()));
+            }
+            redis_clone::network::ShardedRedisServer server(config.port, shards,
+                                                            config.ordered_index);
+            std::cout << "Sharded server ready to accept connections (" << shards
+                      << " shards)\n";
+            server.run();
+        } else {
+            redis_clone::network::ThreadedRedisServer server(config.port, config.reactor_threads,
+                                                             config.ordered_index);
+            std::cout << "Coroutine server ready to accept connections ("
+                      << config.reactor_threads << " reactor threads)\n";
+            server.run();
         }
 
         return 0;
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace redis_clone {
+namespace network {
+
+/**
+ * Large client buffers, lent out on demand and taken back when idle
+ *
+ * A client read or write buffer that has to grow past kSmallBuffer takes
+ * its storage from here instead of the allocator. The client cron hands it
+ * back with reclaim() once the client has gone quiet with the buffer empty,
+ * so one pipelined burst no longer pins megabytes on an idle connection,
+ * and the next burst on any connection reuses the storage. The pool keeps
+ * at most max_bytes; anything beyond that is freed. Thread safe, since
+ * reads grow their buffers on the I/O threads.
+ */
+class BufferPool {
+   public:
+    static constexpr size_t kSmallBuffer = 64 * 1024;  // Left alone below this
+
+    explicit BufferPool(size_t max_bytes) : max_bytes_(max_bytes) {}
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // Room for extra more bytes in buffer, with pooled storage past kSmallBuffer
+    void reserve(std::string& buffer, size_t extra);
+
+    // Takes a large, empty buffer's storage back; false if there was nothing to take
+    bool reclaim(std::string& buffer);
+
+    // Frees pooled storage beyond the new limit
+    void set_max_bytes(size_t max_bytes);
+
+    size_t pooled_bytes() const;
+    size_t pooled_buffers() const;
+
+   private:
+    static constexpr size_t kMaxBuffers = 256;
+
+    mutable std::mutex mutex_;
+    std::vector<std::string> free_;
+    size_t bytes_ = 0;
+    size_t max_bytes_;
+
+    void give_back(std::string&& storage);
+};
+
+}  // namespace network
+}  // namespace redis_clone
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace redis_clone {
+namespace network {
+
+/**
+ * Per-connection state indexed by fd
+ *
+ * fds are small, densely reused integers, so slot fd of a vector replaces a
+ * hash lookup. Each entry has its own allocation and never moves: the
+ * pointer insert() returns is what the poller hands back with events. Live
+ * entries are also kept in a dense list, so iterating connections walks a
+ * vector of pointers instead of hash buckets. Erased entries are reset and
+ * kept on a free list for the next connection.
+ */
+template <typename T>
+class ConnectionSlab {
+   public:
+    using iterator = typename std::vector<T*>::const_iterator;
+
+    // Slot fd must be free; the entry is default constructed (or reset, if reused)
+    T& insert(int fd) {
+        size_t slot = static_cast<size_t>(fd);
+        if (slot >= slots_.size()) {
+            slots_.resize(slot + 1);
+            positions_.resize(slot + 1);
+        }
+
+        std::unique_ptr<T> entry;
+        if (free_.empty()) {
+            entry = std::make_unique<T>();
+        } else {
+            entry = std::move(free_.back());
+            free_.pop_back();
+        }
+        positions_[slot] = live_.size();
+        live_.push_back(entry.get());
+        live_fds_.push_back(fd);
+        slots_[slot] = std::move(entry);
+        return *slots_[slot];
+    }
+
+    T* find(int fd) const {
+        size_t slot = static_cast<size_t>(fd);
+        return fd >= 0 && slot < slots_.size() ? slots_[slot].get() : nullptr;
+    }
+
+    // Invalidates iterators, so callers collect fds first and erase afterwards
+    void erase(int fd) {
+        if (!find(fd)) return;
+        size_t slot = static_cast<size_t>(fd);
+
+        // Swap-remove from the dense list
+        size_t position = positions_[slot];
+        live_[position] = live_.back();
+        live_fds_[position] = live_fds_.back();
+        positions_[static_cast<size_t>(live_fds_[position])] = position;
+        live_.pop_back();
+        live_fds_.pop_back();
+
+        *slots_[slot] = T();  // Drops the old connection's buffers now, not on reuse
+        if (free_.size() < kMaxFree) {
+            free_.push_back(std::move(slots_[slot]));
+        }
+        slots_[slot].reset();
+    }
+
+    size_t size() const { return live_.size(); }
+    bool empty() const { return live_.empty(); }
+    iterator begin() const { return live_.begin(); }
+    iterator end() const { return live_.end(); }
+
+   private:
+    static constexpr size_t kMaxFree = 1024;
+
+    std::vector<std::unique_ptr<T>> slots_;  // By fd, null when free
+    std::vector<size_t> positions_;          // By fd, index into live_
+    std::vector<T*> live_;
+    std::vector<int> live_fds_;  // Parallel to live_
+    std::vector<std::unique_ptr<T>> free_;
+};
+
+}  // namespace network
+}  // namespace redis_clone
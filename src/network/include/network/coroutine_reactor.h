@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "network/poller.h"
+
+namespace redis_clone {
+namespace network {
+
+/**
+ * Fire-and-forget coroutine type for connection handlers
+ *
+ * Starts running immediately and frees its own frame when it returns, so a
+ * connection costs one small heap frame instead of a thread stack.
+ */
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+/**
+ * Single-threaded reactor that resumes coroutines when their socket is ready
+ *
+ * Sockets are registered edge-triggered for reads; each watch remembers a
+ * readiness edge that arrived while its coroutine was busy, so a handler simply
+ * retries recv()/send() until EAGAIN and then co_awaits readable()/writable().
+ * Write interest is only armed while a writer is parked on a full socket.
+ * Everything except post() and stop() must be called on the reactor thread.
+ */
+class Reactor {
+   private:
+    struct Watch {
+        int fd;
+        bool readable = true;  // Optimistic until the first EAGAIN
+        bool detached = false;
+        std::coroutine_handle<> reader;
+        std::coroutine_handle<> writer;
+    };
+
+   public:
+    class IoAwaiter {
+       public:
+        IoAwaiter(Reactor* reactor, Watch* watch, bool for_write)
+            : reactor_(reactor), watch_(watch), for_write_(for_write) {}
+
+        // Writers only wait after EAGAIN, so they always park; readers may have a
+        // pending edge that arrived while they were busy
+        bool await_ready() noexcept {
+            return !for_write_ && std::exchange(watch_->readable, false);
+        }
+        void await_suspend(std::coroutine_handle<> handle) {
+            if (for_write_) {
+                watch_->writer = handle;
+                reactor_->watch_writes(*watch_, true);
+            } else {
+                watch_->reader = handle;
+            }
+        }
+        void await_resume() noexcept {}
+
+       private:
+        Reactor* reactor_;
+        Watch* watch_;
+        bool for_write_;
+    };
+
+    Reactor();
+    ~Reactor();
+
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    void run();
+    void stop();
+
+    // Queue a task for the reactor thread (thread-safe)
+    void post(std::function<void()> task);
+
+    // fd must already be non-blocking
+    void attach(int fd);
+    void detach(int fd);
+
+    IoAwaiter readable(int fd) { return IoAwaiter(this, watches_.at(fd).get(), false); }
+    IoAwaiter writable(int fd) { return IoAwaiter(this, watches_.at(fd).get(), true); }
+
+   private:
+    Poller poller_;
+    int wake_pipe_[2];
+    std::atomic<bool> stopping_{false};
+
+    std::mutex queue_mutex_;
+    std::vector<std::function<void()>> queue_;
+
+    std::unordered_map<int, std::unique_ptr<Watch>> watches_;
+    std::vector<std::unique_ptr<Watch>> retired_;  // Freed after the current event batch
+
+    void drain_queue();
+    void watch_writes(Watch& watch, bool enabled);
+};
+
+}  // namespace network
+}  // namespace redis_clone
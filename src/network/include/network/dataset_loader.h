@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "persistence/aof_format.h"
+#include "persistence/snapshot_format.h"
+
+namespace redis_clone {
+namespace network {
+
+/**
+ * Decodes the dataset on disk in batches, for a load that runs while the server serves clients
+ *
+ * next_batch() does the file I/O and parsing and is meant for a worker
+ * thread, one call at a time. The event loop applies each batch's ops to
+ * the keyspace, which therefore stays single-threaded. A snapshot is read
+ * as its base followed by the deltas of its chain; an AOF as its SET/DEL
+ * records up to the point-in-time cutoff, if one is given.
+ */
+class DatasetLoader {
+   public:
+    struct Op {
+        std::string key;
+        std::optional<std::string> value;  // nullopt deletes the key
+    };
+
+    struct Batch {
+        std::vector<Op> ops;
+        uint64_t bytes_done = 0;  // Input consumed once this batch is applied
+        bool last = false;
+        std::string error;  // The dataset cannot be loaded; nothing follows
+    };
+
+    // Input read per batch, so applying one never stalls the event loop for long
+    static constexpr uint64_t kBatchBytes = 1024 * 1024;
+
+    DatasetLoader(const std::string& snapshot_path, const persistence::SnapshotChain& chain);
+    DatasetLoader(const std::string& aof_path, int64_t truncate_to_timestamp);
+    ~DatasetLoader();
+
+    DatasetLoader(const DatasetLoader&) = delete;
+    DatasetLoader& operator=(const DatasetLoader&) = delete;
+
+    bool is_aof() const { return is_aof_; }
+    const std::string& path() const { return path_; }
+    uint64_t total_bytes() const { return total_bytes_; }
+
+    Batch next_batch();
+
+    // AOF only, valid after the last batch: where replay stopped, and why if it
+    // stopped early because of a bad record. The file should be cut there.
+    uint64_t aof_replay_end() const { return aof_replay_end_; }
+    uint64_t aof_data_size() const { return aof_ ? aof_->data_size() : 0; }
+    const std::string& aof_error() const { return aof_error_; }
+
+   private:
+    bool is_aof_;
+    std::string path_;
+    uint64_t total_bytes_ = 0;
+
+    // Snapshot: one file of the chain at a time, in line-aligned parts
+    std::vector<std::string> files_;
+    size_t file_ = 0;
+    std::unique_ptr<persistence::SnapshotReader> snapshot_;
+    size_t part_ = 0;
+    size_t parts_ = 0;
+    uint64_t bytes_before_file_ = 0;
+
+    // AOF
+    std::unique_ptr<persistence::AofReader> aof_;
+    int64_t truncate_to_timestamp_ = 0;
+    uint64_t aof_replay_end_ = 0;
+    std::string aof_error_;
+
+    void next_snapshot_batch(Batch& batch);
+    void next_aof_batch(Batch& batch);
+};
+
+}  // namespace network
+}  // namespace redis_clone
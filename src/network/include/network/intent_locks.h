@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace redis_clone {
+namespace network {
+
+/**
+ * Per-key intent locks of one shard, kept in transaction id order
+ *
+ * The lock table of a VLL-style scheduler: instead of a lock manager with
+ * wait queues, each key just records which transactions intend to touch it.
+ * A transaction may run once it is the oldest holder of every one of its
+ * keys. Because a shard refuses an intent that would jump ahead of a later
+ * transaction, one holding the key or one already run on it here, every
+ * shard orders conflicting transactions by id alike, and cross-shard
+ * transactions cannot deadlock: the coordinator backs out of a refusal and
+ * retries with a fresh id.
+ *
+ * What ran last on each key is remembered for the newest max_run_history
+ * runs; older entries are forgotten into one shard-wide floor, which only a
+ * transaction in flight across that many others can run into.
+ */
+class IntentLocks {
+   public:
+    static constexpr size_t kDefaultMaxRunHistory = 64 * 1024;
+
+    explicit IntentLocks(size_t max_run_history = kDefaultMaxRunHistory)
+        : max_run_history_(max_run_history) {}
+
+    // Takes txid's intent on every key, or nothing if a later transaction holds one of them
+    // or has run on one already
+    bool acquire(uint64_t txid, const std::vector<std::string>& keys);
+    void release(uint64_t txid, const std::vector<std::string>& keys);
+    void mark_run(uint64_t txid, const std::vector<std::string>& keys);
+
+    // txid is the oldest holder of each of its keys
+    bool first_in_line(uint64_t txid, const std::vector<std::string>& keys) const;
+
+    bool locked(const std::string& key) const { return holders_.count(key) > 0; }
+    bool empty() const { return holders_.empty(); }
+
+   private:
+    std::unordered_map<std::string, std::set<uint64_t>> holders_;
+    std::unordered_map<std::string, uint64_t> last_run_;  // Newest txid run on each key
+    std::deque<std::pair<uint64_t, std::string>> run_history_;  // Oldest run first
+    size_t max_run_history_;
+    uint64_t forgotten_run_ = 0;  // Newest txid of a forgotten entry, for every key
+};
+
+}  // namespace network
+}  // namespace redis_clone
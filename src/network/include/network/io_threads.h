@@ -0,0 +1,56 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace redis_clone {
+namespace network {
+
+/**
+ * Fixed pool of I/O helper threads for the event-driven server
+ *
+ * Each event loop iteration hands the pool a batch of clients to read/parse or
+ * to write. Work items are split round-robin between the workers and the
+ * calling (main) thread, and run_batch() only returns once every item is done.
+ * That barrier is what lets command execution stay single-threaded.
+ */
+class IoThreadPool {
+   public:
+    // num_threads counts the main thread, so 1 means "no helper threads"
+    explicit IoThreadPool(size_t num_threads);
+    ~IoThreadPool();
+
+    IoThreadPool(const IoThreadPool&) = delete;
+    IoThreadPool& operator=(const IoThreadPool&) = delete;
+
+    size_t size() const { return workers_.size() + 1; }
+
+    /**
+     * Run job(i) for every i in [0, count) and wait for all of them to finish
+     */
+    void run_batch(size_t count, const std::function<void(size_t)>& job);
+
+   private:
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable work_ready_;
+    std::condition_variable work_done_;
+
+    // Current batch, published under mutex_
+    const std::function<void(size_t)>* job_ = nullptr;
+    size_t job_count_ = 0;
+    size_t generation_ = 0;
+    size_t pending_workers_ = 0;
+    bool stopping_ = false;
+
+    void worker_loop(size_t worker_index);
+    void run_share(size_t thread_index, size_t count, const std::function<void(size_t)>& job);
+};
+
+}  // namespace network
+}  // namespace redis_clone
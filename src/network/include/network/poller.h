@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#ifndef __linux__
+#include <poll.h>
+
+#include <unordered_map>
+#endif
+
+namespace redis_clone {
+namespace network {
+
+/**
+ * Thin readiness-notification wrapper
+ *
+ * Uses epoll on Linux and falls back to poll() elsewhere (macOS dev builds).
+ * Every registered fd carries an opaque user pointer that is handed back
+ * with its events, so callers never need an fd -> state lookup.
+ */
+class Poller {
+   public:
+    enum Interest : uint32_t { READABLE = 1u << 0, WRITABLE = 1u << 1 };
+
+    struct Event {
+        void* data;
+        bool readable;
+        bool writable;
+        bool hangup;
+    };
+
+    Poller();
+    ~Poller();
+
+    Poller(const Poller&) = delete;
+    Poller& operator=(const Poller&) = delete;
+
+    // With edge_triggered, readiness is only reported on transitions (epoll only;
+    // the poll() fallback is always level-triggered)
+    void add(int fd, uint32_t interest, void* data, bool edge_triggered = false);
+    void modify(int fd, uint32_t interest, void* data, bool edge_triggered = false);
+    void remove(int fd);
+
+    /**
+     * Wait up to timeout_ms (-1 blocks) and fill events; returns the event count
+     */
+    int wait(std::vector<Event>& events, int timeout_ms);
+
+   private:
+#ifdef __linux__
+    int epoll_fd_;
+#else
+    struct Registration {
+        uint32_t interest;
+        void* data;
+    };
+    std::unordered_map<int, Registration> registrations_;
+    std::vector<pollfd> poll_fds_;
+#endif
+};
+
+}  // namespace network
+}  // namespace redis_clone
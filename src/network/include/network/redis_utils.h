@@ -1,6 +1,10 @@
 #pragma once
 
 #include <string>
+#include <vector>
+
+#include "storage/ordered_index.h"
+#include "storage/storage_engine.h"
 
 namespace redis_clone {
 namespace network {
@@ -13,19 +17,218 @@ struct CommandParts {
     std::string command;
     std::string key;
     std::string value;
+    std::vector<std::string> args;  // Every argument after the command name
 };
 
+/**
+ * Result of trying to parse one command out of a client read buffer
+ */
+enum class ParseStatus { OK, INCOMPLETE, ERROR };
+
 /**
  * Parse Redis command string into components
  */
 CommandParts extract_command(const std::string& input);
 
+/**
+ * Build command components from already split tokens (command name first)
+ */
+CommandParts command_from_tokens(std::vector<std::string> tokens);
+
+/**
+ * Parse the next command from buffer starting at pos
+ *
+ * Accepts both RESP multibulk requests (*<n>\r\n$<len>\r\n...) and inline
+ * commands terminated by \n or \r\n. On OK, pos is advanced past the command.
+ * On INCOMPLETE, pos is left untouched so parsing can resume after more data
+ * arrives. On ERROR, error holds a protocol error message.
+ */
+ParseStatus parse_command(const std::string& buffer, size_t& pos, CommandParts& parts,
+                          std::string& error);
+
+/**
+ * Render parsed command as a RESP multibulk request
+ *
+ * Survives arguments with spaces, quotes or CRLF, which an inline command
+ * would split or mangle.
+ */
+std::string format_multibulk_command(const CommandParts& parts);
+
+/**
+ * RESP reply helpers
+ */
+inline std::string bulk_string_reply(const std::string& value) {
+    return "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+}
+
+inline std::string array_reply(const std::vector<std::string>& items) {
+    std::string reply = "*" + std::to_string(items.size()) + "\r\n";
+    for (const auto& item : items) {
+        reply += bulk_string_reply(item);
+    }
+    return reply;
+}
+
+inline std::string integer_reply(long long value) { return ":" + std::to_string(value) + "\r\n"; }
+
+inline std::string wrong_arity_reply(const std::string& command) {
+    return "-ERR wrong number of arguments for '" + command + "' command\r\n";
+}
+
+/**
+ * Parse SCANPREFIX/SCANRANGE arguments into a key range and page size
+ *
+ *   SCANPREFIX <prefix> <cursor> [COUNT n]
+ *   SCANRANGE <min> <max> <cursor> [COUNT n]   (bounds as in ZRANGEBYLEX: [a (a - +)
+ *
+ * A cursor of 0 starts a scan; otherwise the scan resumes after the key the
+ * cursor encodes. On failure, error holds the RESP error reply.
+ */
+bool parse_scan_request(const CommandParts& parts, storage::KeyRange& range, size_t& count,
+                        std::string& error);
+
+/**
+ * Build the [next_cursor, [keys...]] reply for one page of an ordered scan
+ */
+std::string scan_reply(const std::vector<std::string>& keys, size_t count);
+
+/**
+ * Parse COPY arguments: COPY <source> <destination> [DB <db>] [REPLACE]
+ *
+ * Only database 0 exists. On failure, error holds the RESP error reply.
+ */
+bool parse_copy_request(const CommandParts& parts, bool& replace, std::string& error);
+
+/**
+ * Command handlers, written once against the storage engine concept
+ * (storage/storage_engine.h) and instantiated per backend at compile time
+ */
+namespace commands {
+
+template <typename Store>
+std::string set(const CommandParts& parts, Store& store) {
+    // An empty key or value is valid; only the argument count matters
+    if (parts.args.size() < 2) {
+        return wrong_arity_reply("set");
+    }
+    if (parts.args.size() > 2) {
+        return "-ERR syntax error\r\n";  // No SET options are supported
+    }
+    store.set(parts.key, parts.value);
+    return "+OK\r\n";
+}
+
+template <typename Store>
+std::string get(const CommandParts& parts, const Store& store) {
+    if (parts.args.size() != 1) {
+        return wrong_arity_reply("get");
+    }
+    auto value = store.get(parts.key);
+    if (value.has_value()) {
+        return bulk_string_reply(*value);
+    }
+    return "$-1\r\n";  // Redis null bulk string
+}
+
+// DEL key [key ...]: the number of keys removed
+template <typename Store>
+std::string del(const CommandParts& parts, Store& store) {
+    if (parts.args.empty()) {
+        return wrong_arity_reply("del");
+    }
+    long long removed = 0;
+    for (const auto& key : parts.args) {
+        removed += store.del(key) ? 1 : 0;
+    }
+    return integer_reply(removed);
+}
+
+// EXISTS key [key ...]: a key named twice counts twice, like in Redis
+template <typename Store>
+std::string exists(const CommandParts& parts, const Store& store) {
+    if (parts.args.empty()) {
+        return wrong_arity_reply("exists");
+    }
+    long long found = 0;
+    for (const auto& key : parts.args) {
+        found += store.exists(key) ? 1 : 0;
+    }
+    return integer_reply(found);
+}
+
+template <typename Store>
+std::string dbsize(const CommandParts&, const Store& store) {
+    return integer_reply(static_cast<long long>(store.size()));
+}
+
+template <typename Store>
+std::string scan(const CommandParts& parts, const Store& store) {
+    if constexpr (!storage::supports_ordered_scan_v<Store>) {
+        return "-ERR ordered scans are not supported by this storage engine\r\n";
+    } else {
+        storage::KeyRange range;
+        size_t count = 0;
+        std::string error;
+        if (!parse_scan_request(parts, range, count, error)) {
+            return error;
+        }
+        if (!store.has_ordered_index()) {
+            return "-ERR ordered index is disabled (start the server with --ordered-index)\r\n";
+        }
+        return scan_reply(store.scan_keys(range, count), count);
+    }
+}
+
+template <typename Store>
+std::string copy(const CommandParts& parts, Store& store) {
+    if constexpr (!storage::supports_copy_v<Store>) {
+        return "-ERR COPY is not supported by this storage engine\r\n";
+    } else {
+        bool replace = false;
+        std::string error;
+        if (!parse_copy_request(parts, replace, error)) {
+            return error;
+        }
+        return integer_reply(store.copy(parts.args[0], parts.args[1], replace) ? 1 : 0);
+    }
+}
+
+}  // namespace commands
+
 /**
  * Process Redis command and return RESP formatted response
  */
 template <typename DataStore>
-std::string process_command_with_store(const CommandParts& parts, DataStore& data);
+std::string process_command_with_store(const CommandParts& parts, DataStore& data) {
+    static_assert(storage::is_storage_engine_v<DataStore>,
+                  "DataStore must model the storage engine concept (storage/storage_engine.h)");
+
+    if (parts.command == "SET") {
+        return commands::set(parts, data);
+    } else if (parts.command == "GET") {
+        return commands::get(parts, data);
+    } else if (parts.command == "DEL") {
+        return commands::del(parts, data);
+    } else if (parts.command == "EXISTS") {
+        return commands::exists(parts, data);
+    } else if (parts.command == "DBSIZE") {
+        return commands::dbsize(parts, data);
+    } else if (parts.command == "SCANPREFIX" || parts.command == "SCANRANGE") {
+        return commands::scan(parts, data);
+    } else if (parts.command == "COPY") {
+        return commands::copy(parts, data);
+    } else if (parts.command == "PING") {
+        if (parts.args.size() > 1) return wrong_arity_reply("ping");
+        return parts.args.empty() ? "+PONG\r\n" : bulk_string_reply(parts.args[0]);
+    } else if (parts.command == "QUIT") {
+        return "+OK\r\n";
+    } else if (parts.command == "BGSAVE") {
+        return "+BGSAVE\r\n";  // Handled specially by server
+    }
+
+    return "-ERR unknown command '" + parts.command + "'\r\n";
+}
 
 }  // namespace redis_utils
 }  // namespace network
-}  // namespace redis_clone
\ No newline at end of file
+}  // namespace redis_clone
@@ -1,80 +1,300 @@
 #pragma once
 
+#include <sys/types.h>
+
 #include <chrono>
+#include <deque>
 #include <fstream>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <string>
 #include <unordered_map>
+#include <vector>
+
+#include "config/config.h"
+#include "network/buffer_pool.h"
+#include "network/connection_slab.h"
+#include "network/dataset_loader.h"
+#include "network/io_threads.h"
+#include "network/poller.h"
+#include "network/redis_utils.h"
+#include "network/signal_events.h"
+#include "network/task_pool.h"
+#include "network/upgrade.h"
+#include "persistence/aof_writer.h"
+#include "persistence/background_writer.h"
+#include "persistence/snapshot_format.h"
+#include "storage/database.h"
+#include "storage/shared_value.h"
 
 namespace redis_clone {
 namespace network {
 
+/**
+ * Startup options for the event-driven server
+ */
+struct ServerOptions {
+    size_t io_threads = 1;       // Including the main thread; 1 disables helpers
+    bool ordered_index = false;  // Maintain the ordered key index for SCANPREFIX/SCANRANGE
+    std::shared_ptr<config::Config> config;  // Runtime-tunable settings; defaults when null
+    // Point-in-time recovery: stop AOF replay at the first #TS marker after this unix
+    // time and cut the file there; 0 replays everything
+    int64_t aof_truncate_to_timestamp = 0;
+    // Hot upgrade: take over from the server listening on this upgrade socket
+    std::string upgrade_from;
+};
+
 /**
  * Event-driven Redis server with persistence support
  *
- * Uses select() for I/O multiplexing and fork() for background saves.
+ * Uses epoll (poll() elsewhere, see Poller) for I/O multiplexing and fork()
+ * for background saves. Client state lives in an fd-indexed slab whose
+ * entries are the poller's user data, so events need no fd lookup.
+ * SIGCHLD, SIGINT and SIGTERM arrive as readable events (SignalEvents), so
+ * child bookkeeping and shutdown run in the loop, not in signal handlers.
+ * Socket reads, command parsing and reply writes can be fanned out to a pool
+ * of I/O threads, while command execution always stays on the main thread.
+ * With tiered storage on, a GET for a spilled value parks only its client
+ * while the value is read off-thread; the loop keeps serving everyone else.
+ * The dataset on disk is loaded the same way: the listener is up at once,
+ * and commands get -LOADING until the last batch has been applied.
+ * A large GET value is not copied into the reply: the client holds a
+ * reference to the stored value and writev() sends it from there.
  * This is the main Redis-like implementation for distributed systems learning.
  */
 class RedisServer {
    public:
-    explicit RedisServer(int port);
+    explicit RedisServer(int port, const ServerOptions& options = ServerOptions());
     void run();
 
-    // Public methods for signal handler access
-    void handle_aof_rewrite_completion(pid_t pid);
-
    private:
     int server_fd_;
-    std::unordered_map<std::string, std::string> data_;
+    storage::Database data_;
+    std::shared_ptr<config::Config> config_;
 
     // Persistence tracking
     int changes_since_save = 0;
     std::chrono::steady_clock::time_point last_save_time_;
     std::chrono::steady_clock::time_point server_start_time_;
 
+    // Incremental checkpoints: the epoch data/dump.json and its deltas reach
+    uint32_t checkpoint_epoch_ = 0;  // 0 until a base is loaded or saved
+    size_t deltas_since_base_ = 0;
+
     // AOF persistence
     bool aof_enabled = true;
-    std::ofstream aof_file_;
-    enum class FsyncPolicy { ALWAYS, EVERYSEC, NO } fsync_policy_ = FsyncPolicy::EVERYSEC;
+    std::unique_ptr<persistence::AofWriter> aof_;
     std::chrono::steady_clock::time_point last_fsync_time_;
+    int64_t aof_last_timestamp_ = 0;  // Second of the last #TS marker written
+
+    // appendfsync everysec: fsync runs on its own thread; writes are held while it lags
+    std::unique_ptr<TaskPool> aof_fsync_tasks_;
+    bool aof_fsync_in_flight_ = false;
+    std::chrono::steady_clock::time_point aof_fsync_started_;
+    double aof_last_fsync_ms_ = 0;
+    uint64_t aof_generation_ = 0;   // Bumped per open, so a stale fsync is not credited
+    uint64_t aof_synced_size_ = 0;  // AOF size the last finished fsync covered
+    bool aof_backpressure_ = false;
+    uint64_t aof_backpressure_events_ = 0;
+
+    // AOF auto-rewrite tracking, thresholds come from the config
+    size_t aof_last_rewrite_size_ = 0;  // Size of AOF after last rewrite
+
+    // Forked children (BGSAVE, BGREWRITEAOF) and how the last ones ended
+    enum class ChildType { SNAPSHOT, AOF_REWRITE };
+    struct ChildProcess {
+        ChildType type;
+        std::chrono::steady_clock::time_point started;
+        int changes_at_start = 0;
+        uint32_t epoch = 0;  // Snapshots: epoch the checkpoint closes
+        bool delta = false;
+    };
+    struct ChildHistory {
+        bool last_ok = true;
+        int last_exit_status = 0;  // Exit code, or 128 + signal number
+        double last_duration_sec = -1;
+        std::chrono::steady_clock::time_point last_finished;
+    };
+    std::unordered_map<pid_t, ChildProcess> children_;
+    // checkpoint-fork no: a checkpoint written from pinned values by a thread, not a child
+    std::unique_ptr<TaskPool> checkpoint_tasks_;
+    std::optional<ChildProcess> checkpoint_thread_;
+    ChildHistory snapshot_history_;
+    ChildHistory rewrite_history_;
 
-    // AOF auto-rewrite configuration
-    size_t aof_last_rewrite_size_ = 0;                     // Size of AOF after last rewrite
-    size_t aof_auto_rewrite_percentage_ = 100;             // Rewrite when AOF is 2x size
-    size_t aof_auto_rewrite_min_size_ = 64 * 1024 * 1024;  // 64MB minimum
+    std::unique_ptr<SignalEvents> signal_events_;
 
-    // Background process tracking
-    pid_t aof_rewrite_pid_ = -1;  // Track AOF rewrite process PID
+    // Startup load: a DatasetLoader decodes on its own thread, the loop applies
+    struct LoadState {
+        std::unique_ptr<DatasetLoader> loader;  // Null once the dataset is loaded
+        std::unique_ptr<TaskPool> tasks;
+        std::chrono::steady_clock::time_point started;
+        uint64_t bytes_loaded = 0;
+        uint64_t ops_applied = 0;
+        uint32_t next_epoch = 0;  // Snapshots: epoch new writes get once loaded keys are clean
+        int keyspace_fd = -1;     // Hot upgrade: the old process's keyspace
+    };
+    LoadState loading_;
+
+    // Hot upgrade, old side: a new process waiting on the upgrade socket
+    int upgrade_listen_fd_ = -1;
+    int upgrade_conn_fd_ = -1;
 
     struct ClientState {
-        int fd;
+        int fd = -1;
+        uint64_t id = 0;  // Never reused, unlike fds
         std::string read_buffer;   // Accumulated incomplete commands
         std::string write_buffer;  // Queued responses
+        // Large GET values, sent from the keyspace's own buffer right before write_buffer[offset]
+        struct SharedReply {
+            size_t offset = 0;
+            storage::SharedValue value;
+            size_t sent = 0;
+        };
+        std::deque<SharedReply> shared_replies;
+        size_t shared_bytes = 0;  // Not yet sent from shared_replies
+        // Parsed, not yet executed; a deque, as each budget's worth leaves from the front
+        std::deque<redis_utils::CommandParts> pending_commands;
+        std::string protocol_error;  // Set by the parser, reported after pending commands
         bool should_disconnect = false;
+        bool waiting_on_disk = false;  // Cold GET in flight, later commands stay queued
+        bool over_budget = false;  // Hit client-command-budget, the rest runs next iteration
+        bool reading = true;       // Registered with the poller for readability
+
+        // Which of the server's client lists this client is on, so it is added only once
+        bool on_over_budget_list = false;
+        bool on_held_list = false;
+        bool on_output_list = false;
+        bool on_closing_list = false;
+        std::chrono::steady_clock::time_point closing_since;  // Replies get a while to drain
+        bool closed = false;  // Being taken off every list by close_clients()
+
+        // CLIENT LIST/INFO; plain field updates, nothing allocated per command
+        std::string addr;  // ip:port of the peer
+        std::string name;  // CLIENT SETNAME
+        std::chrono::steady_clock::time_point created;
+        std::chrono::steady_clock::time_point last_interaction;
+        uint64_t commands = 0;
+        uint64_t bytes_in = 0;
+        uint64_t bytes_out = 0;
+        std::string last_command;  // Command names fit the small string buffer
+
+        bool has_output() const { return !write_buffer.empty() || !shared_replies.empty(); }
+        size_t output_size() const { return write_buffer.size() + shared_bytes; }
+        void clear_output() {
+            write_buffer.clear();
+            shared_replies.clear();
+            shared_bytes = 0;
+        }
     };
 
-    std::unordered_map<int, ClientState> clients_;
+    ConnectionSlab<ClientState> clients_;  // By fd; entries are the poller's user data
+
+    // Clients the loop has work for, so an iteration costs what the busy clients cost rather
+    // than what every connection costs. update_client_lists() adds, the loop drops the ones
+    // no longer in that state when it next walks the list
+    std::vector<ClientState*> over_budget_clients_;  // Commands left over past the budget
+    std::vector<ClientState*> held_clients_;  // Queued behind a pause, backpressure or disk
+    std::vector<ClientState*> output_clients_;   // Replies not sent yet
+    std::vector<ClientState*> closing_clients_;  // Closed once their replies are sent
+    Poller poller_;
+
+    // Client cron: gives idle clients' large buffers back to the pool
+    BufferPool buffer_pool_;
+    std::chrono::steady_clock::time_point last_clients_cron_;
+    size_t clients_cron_cursor_ = 0;
+    uint64_t client_buffers_reclaimed_ = 0;
+    uint64_t next_client_id_ = 1;
+
+    // CLIENT PAUSE: matching commands stay queued until pause_end_
+    enum class PauseMode { NONE, WRITE, ALL };
+    PauseMode pause_mode_ = PauseMode::NONE;
+    std::chrono::steady_clock::time_point pause_end_;
+    IoThreadPool io_threads_;
+    std::unique_ptr<TaskPool> disk_tasks_;  // Cold reads and value log compaction
 
     // Network operations
+    void create_listener(int port);
     void accept_new_connections();
-    void handle_client_data(int client_fd);
-    std::string process_command(const std::string& command);
+    void read_client_data(ClientState& client);  // Safe to run on I/O threads
+    void parse_commands(ClientState& client);
+    void execute_pending_commands(ClientState& client);
+    void prefetch_pending(const ClientState& client, size_t from);
+    std::vector<ClientState*> runnable_clients(const std::vector<ClientState*>& ready_clients);
+    bool write_held(const ClientState& client) const;  // Next command waits on AOF backpressure
+    void write_client_data(ClientState& client);  // Safe to run on I/O threads
+    static void handle_write_error(ClientState& client);  // After a failed send, errno set
+    std::string process_command(const redis_utils::CommandParts& parts);
+    std::string config_command(const redis_utils::CommandParts& parts);
+    std::string info_command(const redis_utils::CommandParts& parts);
+
+    // Client introspection and control
+    std::string client_command(ClientState& client, const redis_utils::CommandParts& parts);
+    std::string client_info(const ClientState& client) const;
+    void append_reply(ClientState& client, const std::string& reply);
+    void append_value_reply(ClientState& client, storage::SharedValue value);  // GET
+    static void flatten_output(ClientState& client);  // Copies shared values into write_buffer
+    void clients_cron();
+    bool is_paused(const redis_utils::CommandParts& parts) const;
+    void unpause_if_expired();
+    int poll_timeout_ms(bool backlog) const;  // -1 when only an event can wake the loop
+    void resume_held_clients();
+    void update_client_lists(ClientState& client);  // After anything that changes its state
+    void sync_read_interest(ClientState& client);
+    void close_clients(const std::vector<ClientState*>& closing);
+
+    // Signals and forked children
+    void handle_signals();
+    pid_t fork_child(ChildType type, const std::function<bool()>& work);
+    void reap_children();
+    void finish_child(const ChildProcess& child, bool ok, int exit_status,
+                      const std::string& source);
+    bool child_running(ChildType type) const;
+
+    // Tiered storage
+    bool start_cold_read(ClientState& client, const std::string& key);
+    void finish_cold_read(int fd, uint64_t client_id, const std::string& key,
+                          const storage::ValueLog::Location& location,
+                          std::optional<std::string> value);
+    void tiering_cron();
 
     // Persistence operations
     bool should_save_snapshot();
-    void save_snapshot_to_file();
+    persistence::BackgroundWriterOptions background_writer_options() const;
+    // Off data_ when pinned is given, so they can run on another thread
+    bool save_snapshot_to_file(uint32_t epoch,
+                               const storage::Database::PinnedKeyspace* pinned = nullptr);
+    bool save_delta_to_file(uint32_t base_epoch, uint32_t epoch,
+                            const storage::Database::PinnedKeyspace* pinned = nullptr);
+    pid_t start_checkpoint(bool allow_delta);  // Child's pid, 0 if fork-less, -1 on failure
     std::string background_save();    // For BGSAVE command
     void background_save_internal();  // For automatic saves
-    void load_snapshot_from_file();
+
+    // Asynchronous startup load
+    void start_loading(std::unique_ptr<DatasetLoader> loader);
+    void submit_load_batch();
+    void apply_load_batch(DatasetLoader::Batch& batch);
+    void finish_loading();  // Also opens the AOF, which must wait for the load
+    std::string loading_reply(const redis_utils::CommandParts& parts) const;
+
+    // Hot upgrade
+    void take_over(const std::string& socket_path);
+    void accept_upgrade_connection();
+    bool try_hand_off();  // True once the new process has everything
 
     // AOF persistence operations
-    void append_to_aof(const std::string& command);
+    void append_to_aof(const redis_utils::CommandParts& parts);
     void fsync_aof_if_needed();
-    void load_aof_from_file();
-    void rewrite_aof_internal();
+    uint64_t aof_unsynced_bytes() const;
+    bool aof_falling_behind() const;
+    void update_aof_backpressure();
+    bool rewrite_aof_internal();
     std::string background_rewrite_aof();  // For BGREWRITEAOF command
 
     // AOF auto-rewrite helpers
     size_t get_aof_file_size();
+    bool open_aof();
     bool should_auto_rewrite_aof();
     void reopen_aof_after_rewrite();
 };
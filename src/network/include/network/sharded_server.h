@@ -0,0 +1,244 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "network/connection_slab.h"
+#include "network/intent_locks.h"
+#include "network/poller.h"
+#include "network/redis_utils.h"
+#include "network/spsc_queue.h"
+#include "storage/database.h"
+
+namespace redis_clone {
+namespace network {
+
+/**
+ * Shared-nothing Redis server: one reactor thread per core, each owning a shard
+ *
+ * Every shard thread runs its own poller, connections and storage::Database,
+ * and is the only thread that ever touches that keyspace, so the data path
+ * takes no locks. The main thread accepts connections and deals them out
+ * round robin. A command whose key lives on another shard is forwarded to the
+ * owner over a single-producer/single-consumer queue (one per ordered pair
+ * of shards), and the owner sends the reply back the same way. Replies are
+ * slotted in per connection so pipelined commands still answer in order.
+ *
+ * Commands spanning shards are split by the connection's shard, which acts
+ * as coordinator: it sends each owner its part and combines the partial
+ * results. Like the threaded mode, there is no persistence: BGSAVE is
+ * refused. INFO and CLIENT are not supported either, since a connection's
+ * state and the server's stats are spread over the shard threads.
+ *
+ * DBSIZE and SCANPREFIX/SCANRANGE just gather from every shard. MSET, RENAME,
+ * COPY, DEL/EXISTS with several keys and MULTI/EXEC are atomic across shards
+ * without a global lock, VLL style: the coordinator takes a transaction id
+ * from one shared counter and has every shard involved record intent locks
+ * on its keys (SCHEDULE). Each shard runs its part once the transaction is
+ * the oldest holder of all of its keys there, and a command on a key with a
+ * pending transaction waits behind it, so nobody sees one shard's half of a
+ * transaction without the other's. Commands whose keys all live on one shard
+ * skip all of this.
+ */
+class ShardedRedisServer {
+   public:
+    ShardedRedisServer(int port, size_t shards, bool ordered_index = false);
+    ~ShardedRedisServer();
+
+    ShardedRedisServer(const ShardedRedisServer&) = delete;
+    ShardedRedisServer& operator=(const ShardedRedisServer&) = delete;
+
+    void run();
+
+   private:
+    static constexpr size_t kQueueCapacity = 256;  // Per ordered pair of shards; overflow waits
+    static constexpr size_t kMaxInFlight = 1024;   // Unanswered commands per connection
+
+    struct ShardMessage {
+        enum class Kind {
+            ACCEPT,
+            COMMAND,
+            GATHER,
+            REPLY,
+            // Transactions: coordinator to shard
+            SCHEDULE,
+            EXECUTE,
+            RELEASE,  // Backing out, or after the last hop
+            // Transactions: shard to coordinator
+            SCHEDULED,
+            EXECUTED
+        };
+        Kind kind = Kind::COMMAND;
+        size_t from = 0;  // Sending shard
+        int fd = -1;      // Connection on the coordinating shard
+        uint64_t client_id = 0;
+        uint64_t seq = 0;                 // Reply slot on that connection
+        redis_utils::CommandParts parts;  // COMMAND, GATHER
+        std::string reply;                // REPLY to a COMMAND
+        long long count = 0;              // REPLY to a GATHER: partial count
+        std::vector<std::string> keys;    // REPLY to a GATHER: partial scan; SCHEDULE: keys
+        bool gather = false;              // REPLY: answers a GATHER
+        uint64_t txid = 0;                // Transaction id; 0 for a one-shard EXECUTE
+        uint64_t transaction = 0;         // Coordinator's handle for the transaction
+        std::vector<redis_utils::CommandParts> commands;  // EXECUTE
+        std::vector<std::string> replies;                 // EXECUTED, one per command
+        bool ok = true;                                   // SCHEDULED: intent locks taken
+        bool conclude = true;  // EXECUTE: release the locks once run, no RELEASE follows
+    };
+
+    // One per command, in arrival order; flushed to the socket once ready
+    struct PendingReply {
+        bool ready = false;
+        std::string reply;
+        // Gathers: what the owners sent back so far
+        std::string command;
+        size_t parts_left = 0;
+        long long count = 0;
+        std::vector<std::string> keys;
+        size_t scan_count = 0;
+    };
+
+    struct Connection {
+        int fd = -1;
+        uint64_t id = 0;
+        std::string read_buffer;
+        std::string write_buffer;
+        std::deque<PendingReply> replies;
+        uint64_t first_seq = 0;  // seq of replies.front()
+        uint32_t interest = Poller::READABLE;
+        bool stalled = false;      // Stopped parsing with commands left in read_buffer
+        bool barrier = false;      // ...because a transaction waits for earlier replies
+        uint64_t transaction = 0;  // Cross-shard transaction in flight; later commands wait
+        bool quit = false;         // QUIT or a protocol error: close once answered
+        bool closed = false;
+        bool dirty = false;
+        // MULTI: commands queued for EXEC
+        bool in_multi = false;
+        bool multi_error = false;
+        std::vector<redis_utils::CommandParts> queued;
+    };
+
+    // Coordinator side: what one shard does for a transaction
+    struct Participant {
+        size_t shard = 0;
+        std::vector<std::string> keys;                    // Intent locks to take
+        std::vector<redis_utils::CommandParts> commands;  // Run there, in order
+        std::vector<size_t> positions;                    // Reply slot of each command
+        bool scheduled = false;
+    };
+
+    struct Transaction {
+        int fd = -1;
+        uint64_t client_id = 0;
+        uint64_t seq = 0;
+        std::string command;  // MSET, RENAME, COPY, DEL, EXISTS or EXEC
+        uint64_t txid = 0;    // 0 while only one shard is involved
+        std::vector<Participant> participants;
+        std::vector<std::string> replies;  // EXEC: one per queued command; else just one
+        size_t waiting = 0;                // SCHEDULED or EXECUTED still to come
+        bool rejected = false;
+        bool storing = false;  // Cross-shard COPY: the target is storing the value
+    };
+
+    // Shard side: a scheduled transaction's part here
+    struct TransactionPart {
+        size_t coordinator = 0;
+        uint64_t transaction = 0;
+        std::vector<std::string> keys;
+        std::vector<redis_utils::CommandParts> commands;
+        bool execute = false;  // EXECUTE arrived
+        bool executed = false;
+        bool conclude = true;
+    };
+
+    struct Shard {
+        size_t id = 0;
+        storage::Database db;
+        Poller poller;
+        int wake_pipe[2] = {-1, -1};
+        std::atomic<bool> wake_pending{false};
+        // inbox[i]: messages from shard i, or from the acceptor at i == shard count
+        std::vector<std::unique_ptr<SpscQueue<ShardMessage>>> inbox;
+        std::vector<std::deque<ShardMessage>> outbox;  // By destination, waiting for queue room
+        ConnectionSlab<Connection> connections;
+        std::vector<Connection*> dirty;
+        uint64_t next_client_id = 1;
+        // Transactions coordinated here, by handle
+        std::unordered_map<uint64_t, Transaction> transactions;
+        uint64_t next_transaction = 1;
+        // Transactions scheduled here, by id, and the keys they hold
+        IntentLocks locks;
+        std::map<uint64_t, TransactionPart> scheduled;
+        // Requests waiting for locked keys, in arrival order, and the keys they wait on
+        std::deque<ShardMessage> blocked;
+        std::unordered_map<std::string, size_t> blocked_keys;
+        std::thread thread;
+    };
+
+    int port_;
+    int server_fd_ = -1;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<uint64_t> next_txid_{1};  // The one thing shards share
+
+    void initialize_server();
+    void run_shard(Shard& shard);
+    void wake(Shard& shard);
+
+    // Connections
+    void accept_connection(Shard& shard, int fd);
+    void read_connection(Shard& shard, Connection& connection);
+    void parse_commands(Shard& shard, Connection& connection);
+    void finish_connection(Shard& shard, Connection& connection);
+    void close_connection(Shard& shard, Connection& connection);
+    void mark_dirty(Shard& shard, Connection& connection);
+
+    // Routing and execution
+    void dispatch(Shard& shard, Connection& connection, redis_utils::CommandParts&& parts);
+    void start_gather(Shard& shard, Connection& connection, uint64_t seq,
+                      redis_utils::CommandParts&& parts);
+    std::string execute(Shard& shard, const redis_utils::CommandParts& parts);
+    void execute_part(Shard& shard, const redis_utils::CommandParts& parts, ShardMessage& result);
+    void add_part(PendingReply& slot, ShardMessage& result);
+
+    // Locks: a request on a key some transaction holds waits until it is released
+    bool keys_free(const Shard& shard, const redis_utils::CommandParts& parts) const;
+    void run_or_block(Shard& shard, ShardMessage&& request);
+    void run_request(Shard& shard, ShardMessage& request);
+    void retry_blocked(Shard& shard);
+
+    // Transactions: coordinator
+    std::string queue_in_multi(Connection& connection, redis_utils::CommandParts&& parts);
+    bool plan_transaction(Shard& shard, const Connection& connection,
+                          const redis_utils::CommandParts& parts, Transaction& tx);
+    void start_transaction(Shard& shard, Connection& connection, Transaction&& tx);
+    void schedule(Shard& shard, uint64_t handle, Transaction& tx);
+    void handle_scheduled(Shard& shard, ShardMessage& message);
+    void handle_executed(Shard& shard, ShardMessage& message);
+    void complete_transaction(Shard& shard, uint64_t handle);
+    static ShardMessage transaction_message(ShardMessage::Kind kind, size_t from, uint64_t txid,
+                                            uint64_t transaction);
+
+    // Transactions: participant
+    void handle_schedule(Shard& shard, ShardMessage& message);
+    void release(Shard& shard, uint64_t txid);
+    void run_ready(Shard& shard);
+
+    // Message passing
+    void send(Shard& shard, size_t to, ShardMessage&& message);
+    void flush_outboxes(Shard& shard);
+    void drain_inboxes(Shard& shard);
+    void handle_message(Shard& shard, ShardMessage& message);
+    void handle_reply(Shard& shard, ShardMessage& message);
+};
+
+}  // namespace network
+}  // namespace redis_clone
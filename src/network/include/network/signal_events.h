@@ -0,0 +1,46 @@
+#pragma once
+
+#include <csignal>
+#include <initializer_list>
+#include <vector>
+
+namespace redis_clone {
+namespace network {
+
+/**
+ * Delivers signals as readable events on a file descriptor
+ *
+ * The signals are blocked for the calling thread (helper threads already
+ * block them) and read from a signalfd on Linux, or from a self-pipe fed by
+ * a minimal handler elsewhere. Either way the event loop handles them as
+ * ordinary input instead of running code inside a signal handler.
+ */
+class SignalEvents {
+   public:
+    // Throws std::runtime_error if the descriptor cannot be set up
+    explicit SignalEvents(std::initializer_list<int> signals);
+    ~SignalEvents();
+
+    SignalEvents(const SignalEvents&) = delete;
+    SignalEvents& operator=(const SignalEvents&) = delete;
+
+    int fd() const { return fd_; }
+
+    // Signal numbers received since the last call, oldest first
+    std::vector<int> read_pending();
+
+    // In a forked child: give the signals their default behaviour back
+    void release_in_child();
+
+   private:
+    std::vector<int> signals_;
+    sigset_t previous_mask_;
+    int fd_ = -1;
+#ifndef __linux__
+    int write_fd_ = -1;
+    std::vector<struct sigaction> previous_actions_;
+#endif
+};
+
+}  // namespace network
+}  // namespace redis_clone
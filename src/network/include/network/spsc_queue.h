@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace redis_clone {
+namespace network {
+
+/**
+ * Bounded lock-free queue for exactly one producer and one consumer thread
+ *
+ * A ring of preallocated slots indexed by two ever-increasing counters. Each
+ * side owns one counter and only reads the other's when its cached copy says
+ * the ring is full (producer) or empty (consumer), so in steady state a push
+ * or pop touches no cache line the other thread is writing.
+ */
+template <typename T>
+class SpscQueue {
+   public:
+    // Rounded up to a power of two
+    explicit SpscQueue(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        slots_.resize(size);
+        mask_ = size - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer only; false (item untouched) when full
+    bool try_push(T&& item) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_head_ == slots_.size()) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail - cached_head_ == slots_.size()) return false;
+        }
+        slots_[tail & mask_] = std::move(item);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only; false when empty
+    bool try_pop(T& item) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cached_tail_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head == cached_tail_) return false;
+        }
+        item = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const { return slots_.size(); }
+
+   private:
+    static constexpr size_t kCacheLine = 64;
+
+    std::vector<T> slots_;
+    size_t mask_ = 0;
+
+    // Consumer side
+    alignas(kCacheLine) std::atomic<size_t> head_{0};
+    size_t cached_tail_ = 0;
+
+    // Producer side
+    alignas(kCacheLine) std::atomic<size_t> tail_{0};
+    size_t cached_head_ = 0;
+};
+
+}  // namespace network
+}  // namespace redis_clone
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace redis_clone {
+namespace network {
+
+/**
+ * Background workers whose results are handed back to the event loop
+ *
+ * submit() queues a work function for a worker thread; once it finishes, its
+ * completion is queued and completion_fd() becomes readable. The event loop
+ * then calls run_completions() so completions run on the main thread, next
+ * to the data they touch. Unlike IoThreadPool there is no barrier: jobs may
+ * take as long as the disk needs.
+ */
+class TaskPool {
+   public:
+    explicit TaskPool(size_t num_threads);
+    ~TaskPool();
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    void submit(std::function<void()> work, std::function<void()> completion);
+
+    int completion_fd() const { return wake_pipe_[0]; }
+    size_t run_completions();
+    size_t in_flight() const { return in_flight_; }
+
+   private:
+    struct Job {
+        std::function<void()> work;
+        std::function<void()> completion;
+    };
+
+    std::vector<std::thread> workers_;
+    int wake_pipe_[2] = {-1, -1};
+
+    std::mutex mutex_;
+    std::condition_variable work_ready_;
+    std::deque<Job> queue_;
+    std::deque<std::function<void()>> completions_;
+    bool stopping_ = false;
+
+    size_t in_flight_ = 0;  // Main thread only
+
+    void worker_loop();
+};
+
+}  // namespace network
+}  // namespace redis_clone
@@ -1,9 +1,13 @@
 #pragma once
 
-#include <mutex>
 #include <string>
 
-#include "storage/database.h"
+#include "network/redis_utils.h"
+#include "storage/sharded_database.h"
+
+#ifdef REDIS_CLONE_COROUTINES
+#include "network/coroutine_reactor.h"
+#endif
 
 namespace redis_clone {
 namespace network {
@@ -13,10 +17,16 @@ namespace network {
  *
  * Alternative implementation using one thread per client and the storage layer.
  * Demonstrates different concurrency patterns but lacks persistence features.
+ *
+ * When built with REDIS_CLONE_ENABLE_COROUTINES, passing reactor_threads > 0
+ * switches to coroutine mode: every connection becomes a C++20 coroutine that
+ * keeps the same sequential style but parks on a small set of reactor threads
+ * instead of owning an OS thread.
  */
 class ThreadedRedisServer {
    public:
-    explicit ThreadedRedisServer(int port);
+    explicit ThreadedRedisServer(int port, size_t reactor_threads = 0,
+                                 bool ordered_index = false);
     void run();
 
     ThreadedRedisServer(const ThreadedRedisServer&) = delete;
@@ -25,13 +35,18 @@ class ThreadedRedisServer {
    private:
     int port_;
     int server_fd_;
-    redis_clone::storage::Database db_;
-    std::mutex db_mutex_;  // Protects database access across threads
+    size_t reactor_threads_;
+    redis_clone::storage::ShardedDatabase db_;  // Internally locked per shard
 
     void handle_client(int client_fd);
-    std::string process_command(const std::string& command);
+    std::string process_command(const redis_utils::CommandParts& parts);
     void initialize_server();
     void send_command(int client_fd, const std::string& response);
+
+#ifdef REDIS_CLONE_COROUTINES
+    void run_reactors();
+    DetachedTask handle_client_async(int client_fd, Reactor& reactor);
+#endif
 };
 
 }  // namespace network
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "network/redis_utils.h"
+
+namespace redis_clone {
+namespace network {
+
+/**
+ * What a running server hands to the process that replaces it
+ *
+ * The old process listens on a unix socket; the new one connects and
+ * receives everything over SCM_RIGHTS: the listening socket, every client
+ * socket, and the keyspace written to an anonymous file (memfd on Linux)
+ * in the snapshot format. No connection is dropped and nothing touches
+ * the disk; the new process loads the keyspace while it already serves
+ * -LOADING to the clients it took over.
+ */
+struct UpgradeState {
+    struct Client {
+        int fd = -1;
+        uint64_t id = 0;
+        std::string read_buffer;  // Commands not yet executed, see unexecuted_input()
+    };
+
+    int listener_fd = -1;
+    int keyspace_fd = -1;  // Snapshot format, read through fd_path()
+    uint64_t next_client_id = 1;
+    std::vector<Client> clients;
+};
+
+// What a client's read buffer becomes in the new process: the commands parsed here but not
+// run yet, back in RESP, ahead of the bytes not parsed yet
+std::string unexecuted_input(const std::deque<redis_utils::CommandParts>& pending,
+                             const std::string& read_buffer);
+
+// Unix socket the old process accepts the new one on; replaces a stale socket file
+int listen_upgrade_socket(const std::string& path);
+
+// Anonymous read-write file: memfd on Linux, an unlinked file in dir elsewhere
+int create_anonymous_file(const std::string& name, const std::string& dir);
+
+// A path that opens the file behind fd, for APIs that take paths
+std::string fd_path(int fd);
+
+/**
+ * Old process: send the state and wait for the new process to confirm
+ *
+ * Returns false with error set if the new process went away or did not
+ * confirm within timeout_ms; the caller still owns every fd either way.
+ */
+bool send_upgrade_state(int conn_fd, const UpgradeState& state, int timeout_ms,
+                        std::string& error);
+
+/**
+ * New process: connect to the old process and take over its state
+ *
+ * Throws std::runtime_error if the handoff fails; the old process keeps
+ * serving in that case.
+ */
+UpgradeState receive_upgrade_state(const std::string& socket_path);
+
+}  // namespace network
+}  // namespace redis_clone
@@ -0,0 +1,81 @@
+#include "network/buffer_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace redis_clone {
+namespace network {
+
+void BufferPool::reserve(std::string& buffer, size_t extra) {
+    size_t needed = buffer.size() + extra;
+    if (needed <= buffer.capacity() || needed <= kSmallBuffer) return;
+
+    // Best fit among the pooled buffers, otherwise grow geometrically like std::string
+    std::string storage;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto best = free_.end();
+        for (auto it = free_.begin(); it != free_.end(); ++it) {
+            if (it->capacity() >= needed &&
+                (best == free_.end() || it->capacity() < best->capacity())) {
+                best = it;
+            }
+        }
+        if (best != free_.end()) {
+            bytes_ -= best->capacity();
+            storage = std::move(*best);
+            if (best + 1 != free_.end()) *best = std::move(free_.back());
+            free_.pop_back();
+        }
+    }
+    if (storage.capacity() < needed) {
+        storage.reserve(std::max(needed, buffer.capacity() * 2));
+    }
+
+    storage.append(buffer);
+    buffer.swap(storage);
+    give_back(std::move(storage));
+}
+
+bool BufferPool::reclaim(std::string& buffer) {
+    if (!buffer.empty() || buffer.capacity() <= kSmallBuffer) return false;
+    std::string storage;
+    storage.swap(buffer);
+    give_back(std::move(storage));
+    return true;
+}
+
+void BufferPool::give_back(std::string&& storage) {
+    if (storage.capacity() <= kSmallBuffer) return;
+    storage.clear();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_.size() < kMaxBuffers && bytes_ + storage.capacity() <= max_bytes_) {
+        bytes_ += storage.capacity();
+        free_.push_back(std::move(storage));
+    }
+}
+
+void BufferPool::set_max_bytes(size_t max_bytes) {
+    std::vector<std::string> dropped;
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_bytes_ = max_bytes;
+    while (bytes_ > max_bytes_) {
+        bytes_ -= free_.back().capacity();
+        dropped.push_back(std::move(free_.back()));
+        free_.pop_back();
+    }
+}
+
+size_t BufferPool::pooled_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+}
+
+size_t BufferPool::pooled_buffers() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return free_.size();
+}
+
+}  // namespace network
+}  // namespace redis_clone
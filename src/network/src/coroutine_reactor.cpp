@@ -0,0 +1,133 @@
+#include "network/coroutine_reactor.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace redis_clone {
+namespace network {
+
+Reactor::Reactor() {
+    if (pipe(wake_pipe_) < 0) {
+        throw std::runtime_error("Failed to create reactor wake pipe: " +
+                                 std::string(strerror(errno)));
+    }
+    for (int fd : wake_pipe_) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+
+    // A null user pointer marks the wake pipe
+    poller_.add(wake_pipe_[0], Poller::READABLE, nullptr);
+}
+
+Reactor::~Reactor() {
+    // Tear down handlers still parked on a socket, then the sockets themselves
+    for (auto& [fd, watch] : watches_) {
+        if (watch->reader) {
+            watch->reader.destroy();
+        } else if (watch->writer) {
+            watch->writer.destroy();
+        }
+        close(fd);
+    }
+
+    close(wake_pipe_[0]);
+    close(wake_pipe_[1]);
+}
+
+void Reactor::run() {
+    std::vector<Poller::Event> events;
+
+    while (!stopping_) {
+        if (poller_.wait(events, -1) < 0) {
+            throw std::runtime_error("Reactor poll failed: " + std::string(strerror(errno)));
+        }
+
+        for (const auto& event : events) {
+            if (event.data == nullptr) {
+                char drain[64];
+                while (read(wake_pipe_[0], drain, sizeof(drain)) > 0) {
+                }
+                drain_queue();
+                continue;
+            }
+
+            Watch* watch = static_cast<Watch*>(event.data);
+            if (watch->detached) continue;
+
+            if (event.readable || event.hangup) watch->readable = true;
+
+            // Resuming consumes the edge; the handler retries its syscall anyway
+            if (watch->readable && watch->reader) {
+                watch->readable = false;
+                std::exchange(watch->reader, nullptr).resume();
+            }
+            if (!watch->detached && (event.writable || event.hangup) && watch->writer) {
+                watch_writes(*watch, false);
+                std::exchange(watch->writer, nullptr).resume();
+            }
+        }
+
+        retired_.clear();
+    }
+
+    // Adopt anything posted during shutdown so the destructor closes it
+    drain_queue();
+}
+
+void Reactor::stop() {
+    stopping_ = true;
+    char byte = 0;
+    (void)write(wake_pipe_[1], &byte, 1);
+}
+
+void Reactor::post(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        queue_.push_back(std::move(task));
+    }
+    char byte = 0;
+    (void)write(wake_pipe_[1], &byte, 1);
+}
+
+void Reactor::attach(int fd) {
+    auto watch = std::make_unique<Watch>();
+    watch->fd = fd;
+    poller_.add(fd, Poller::READABLE, watch.get(), true);
+    watches_[fd] = std::move(watch);
+}
+
+void Reactor::detach(int fd) {
+    auto it = watches_.find(fd);
+    if (it == watches_.end()) return;
+
+    poller_.remove(fd);
+    it->second->detached = true;
+    retired_.push_back(std::move(it->second));
+    watches_.erase(it);
+}
+
+void Reactor::watch_writes(Watch& watch, bool enabled) {
+    uint32_t interest = Poller::READABLE | (enabled ? uint32_t{Poller::WRITABLE} : 0u);
+    poller_.modify(watch.fd, interest, &watch, true);
+}
+
+void Reactor::drain_queue() {
+    std::vector<std::function<void()>> tasks;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        tasks.swap(queue_);
+    }
+    for (auto& task : tasks) {
+        task();
+    }
+}
+
+}  // namespace network
+}  // namespace redis_clone
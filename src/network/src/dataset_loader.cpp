@@ -0,0 +1,140 @@
+#include "network/dataset_loader.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "network/redis_utils.h"
+
+namespace redis_clone {
+namespace network {
+
+namespace {
+
+uint64_t file_size(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+}
+
+}  // namespace
+
+DatasetLoader::DatasetLoader(const std::string& snapshot_path,
+                             const persistence::SnapshotChain& chain)
+    : is_aof_(false), path_(snapshot_path) {
+    files_.push_back(snapshot_path);
+    files_.insert(files_.end(), chain.deltas.begin(), chain.deltas.end());
+    for (const auto& file : files_) total_bytes_ += file_size(file);
+}
+
+DatasetLoader::DatasetLoader(const std::string& aof_path, int64_t truncate_to_timestamp)
+    : is_aof_(true),
+      path_(aof_path),
+      aof_(std::make_unique<persistence::AofReader>(aof_path)),
+      truncate_to_timestamp_(truncate_to_timestamp) {
+    total_bytes_ = aof_->data_size();
+    aof_replay_end_ = total_bytes_;
+}
+
+DatasetLoader::~DatasetLoader() = default;
+
+DatasetLoader::Batch DatasetLoader::next_batch() {
+    Batch batch;
+    if (is_aof_) {
+        next_aof_batch(batch);
+    } else {
+        next_snapshot_batch(batch);
+    }
+    return batch;
+}
+
+void DatasetLoader::next_snapshot_batch(Batch& batch) {
+    // Like Redis with a bad RDB: refuse to start rather than serve a partial dataset
+    const std::string& path = files_[file_];
+    const std::string advice = " (inspect it with redis-clone-tools check-snapshot)";
+
+    if (!snapshot_) {
+        snapshot_ = std::make_unique<persistence::SnapshotReader>(path);
+        if (!snapshot_->is_open()) {
+            batch.error = "Bad snapshot " + path + ": " + snapshot_->error() + advice;
+            return;
+        }
+        if (snapshot_->verify_checksum() == persistence::SnapshotReader::ChecksumStatus::MISMATCH) {
+            batch.error = "Snapshot " + path + " checksum mismatch" + advice;
+            return;
+        }
+        parts_ = std::max<size_t>(1, (snapshot_->file_size() + kBatchBytes - 1) / kBatchBytes);
+        part_ = 0;
+
+        std::string error;
+        if (snapshot_->metadata().delta &&
+            !snapshot_->for_each_deleted(
+                [&](std::string&& key) { batch.ops.push_back({std::move(key), std::nullopt}); },
+                error)) {
+            batch.error = "Bad snapshot " + path + ": " + error + advice;
+            return;
+        }
+    }
+
+    std::string error;
+    bool ok = snapshot_->for_each(
+        [&](std::string&& key, std::string&& value) {
+            batch.ops.push_back({std::move(key), std::move(value)});
+        },
+        error, part_, parts_);
+    if (!ok) {
+        batch.error = "Bad snapshot " + path + ": " + error + advice;
+        return;
+    }
+
+    uint64_t size = snapshot_->file_size();
+    batch.bytes_done = bytes_before_file_ + size * ++part_ / parts_;
+    if (part_ == parts_) {
+        bytes_before_file_ += size;
+        snapshot_.reset();
+        ++file_;
+    }
+    batch.last = file_ == files_.size();
+}
+
+void DatasetLoader::next_aof_batch(Batch& batch) {
+    batch.last = true;
+    if (!aof_->is_open()) return;
+
+    uint64_t start = aof_->offset();
+    persistence::AofRecord record;
+    while (aof_->offset() - start < kBatchBytes) {
+        if (!aof_->next(record)) {
+            // Like aof-load-truncated yes: keep what was readable, drop the torn tail
+            if (!aof_->error().empty()) {
+                aof_error_ = aof_->error();
+                aof_replay_end_ = aof_->offset();
+            }
+            batch.bytes_done = total_bytes_;
+            return;
+        }
+        if (record.type == persistence::AofRecord::Type::TIMESTAMP &&
+            truncate_to_timestamp_ > 0 && record.timestamp > truncate_to_timestamp_) {
+            aof_replay_end_ = record.offset;
+            batch.bytes_done = total_bytes_;
+            return;
+        }
+        if (record.type != persistence::AofRecord::Type::COMMAND || record.tokens.empty()) {
+            continue;
+        }
+
+        // Only SET and DEL are logged; anything else never changed the keyspace
+        auto parts = redis_utils::command_from_tokens(std::move(record.tokens));
+        if (parts.command == "SET" && parts.args.size() == 2) {
+            batch.ops.push_back({std::move(parts.key), std::move(parts.value)});
+        } else if (parts.command == "DEL") {
+            for (auto& key : parts.args) batch.ops.push_back({std::move(key), std::nullopt});
+        }
+    }
+
+    batch.bytes_done = aof_->offset();
+    batch.last = false;
+}
+
+}  // namespace network
+}  // namespace redis_clone
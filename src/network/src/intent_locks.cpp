@@ -0,0 +1,55 @@
+#include "network/intent_locks.h"
+
+#include <algorithm>
+
+namespace redis_clone {
+namespace network {
+
+bool IntentLocks::acquire(uint64_t txid, const std::vector<std::string>& keys) {
+    if (txid < forgotten_run_) return false;
+    for (const auto& key : keys) {
+        auto it = holders_.find(key);
+        if (it != holders_.end() && *it->second.rbegin() > txid) return false;
+        auto run = last_run_.find(key);
+        if (run != last_run_.end() && run->second > txid) return false;
+    }
+    for (const auto& key : keys) holders_[key].insert(txid);
+    return true;
+}
+
+void IntentLocks::release(uint64_t txid, const std::vector<std::string>& keys) {
+    for (const auto& key : keys) {
+        auto it = holders_.find(key);
+        if (it == holders_.end()) continue;
+        it->second.erase(txid);
+        if (it->second.empty()) holders_.erase(it);
+    }
+}
+
+void IntentLocks::mark_run(uint64_t txid, const std::vector<std::string>& keys) {
+    for (const auto& key : keys) {
+        uint64_t& last = last_run_[key];
+        if (last >= txid) continue;
+        last = txid;
+        run_history_.emplace_back(txid, key);
+    }
+
+    while (run_history_.size() > max_run_history_) {
+        auto& [old_txid, key] = run_history_.front();
+        auto it = last_run_.find(key);
+        if (it != last_run_.end() && it->second == old_txid) last_run_.erase(it);
+        forgotten_run_ = std::max(forgotten_run_, old_txid);
+        run_history_.pop_front();
+    }
+}
+
+bool IntentLocks::first_in_line(uint64_t txid, const std::vector<std::string>& keys) const {
+    for (const auto& key : keys) {
+        auto it = holders_.find(key);
+        if (it != holders_.end() && *it->second.begin() != txid) return false;
+    }
+    return true;
+}
+
+}  // namespace network
+}  // namespace redis_clone
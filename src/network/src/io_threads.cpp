@@ -0,0 +1,99 @@
+#include "network/io_threads.h"
+
+#include <pthread.h>
+
+#include <csignal>
+
+namespace redis_clone {
+namespace network {
+
+IoThreadPool::IoThreadPool(size_t num_threads) {
+    size_t helpers = num_threads > 1 ? num_threads - 1 : 0;
+    workers_.reserve(helpers);
+    for (size_t i = 0; i < helpers; ++i) {
+        // Worker index 0 is the main thread, helpers start at 1
+        workers_.emplace_back(&IoThreadPool::worker_loop, this, i + 1);
+    }
+}
+
+IoThreadPool::~IoThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_ready_.notify_all();
+
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void IoThreadPool::run_batch(size_t count, const std::function<void(size_t)>& job) {
+    if (count == 0) return;
+
+    // Not worth waking anyone up for a single client
+    if (workers_.empty() || count == 1) {
+        for (size_t i = 0; i < count; ++i) job(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_ = &job;
+        job_count_ = count;
+        pending_workers_ = workers_.size();
+        ++generation_;
+    }
+    work_ready_.notify_all();
+
+    // Main thread takes its own share instead of idling at the barrier
+    run_share(0, count, job);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    work_done_.wait(lock, [this] { return pending_workers_ == 0; });
+    job_ = nullptr;
+}
+
+void IoThreadPool::run_share(size_t thread_index, size_t count,
+                             const std::function<void(size_t)>& job) {
+    for (size_t i = thread_index; i < count; i += size()) {
+        job(i);
+    }
+}
+
+void IoThreadPool::worker_loop(size_t worker_index) {
+    // Signals are handled by the main thread only
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    sigaddset(&set, SIGCHLD);
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+
+    size_t seen_generation = 0;
+
+    while (true) {
+        const std::function<void(size_t)>* job;
+        size_t count;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_ready_.wait(lock, [&] { return stopping_ || generation_ != seen_generation; });
+            if (stopping_) return;
+
+            seen_generation = generation_;
+            job = job_;
+            count = job_count_;
+        }
+
+        run_share(worker_index, count, *job);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --pending_workers_;
+        }
+        work_done_.notify_one();
+    }
+}
+
+}  // namespace network
+}  // namespace redis_clone
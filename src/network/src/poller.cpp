@@ -0,0 +1,122 @@
+#include "network/poller.h"
+
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+namespace redis_clone {
+namespace network {
+
+#ifdef __linux__
+
+namespace {
+
+uint32_t to_epoll_events(uint32_t interest, bool edge_triggered) {
+    uint32_t events = 0;
+    if (interest & Poller::READABLE) events |= EPOLLIN | EPOLLRDHUP;
+    if (interest & Poller::WRITABLE) events |= EPOLLOUT;
+    if (edge_triggered) events |= EPOLLET;
+    return events;
+}
+
+}  // namespace
+
+Poller::Poller() : epoll_fd_(epoll_create1(EPOLL_CLOEXEC)) {
+    if (epoll_fd_ < 0) {
+        throw std::runtime_error("Failed to create epoll instance: " +
+                                 std::string(strerror(errno)));
+    }
+}
+
+Poller::~Poller() { close(epoll_fd_); }
+
+void Poller::add(int fd, uint32_t interest, void* data, bool edge_triggered) {
+    epoll_event ev{};
+    ev.events = to_epoll_events(interest, edge_triggered);
+    ev.data.ptr = data;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        throw std::runtime_error("Failed to register fd " + std::to_string(fd) + ": " +
+                                 std::string(strerror(errno)));
+    }
+}
+
+void Poller::modify(int fd, uint32_t interest, void* data, bool edge_triggered) {
+    epoll_event ev{};
+    ev.events = to_epoll_events(interest, edge_triggered);
+    ev.data.ptr = data;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev) < 0) {
+        throw std::runtime_error("Failed to modify fd " + std::to_string(fd) + ": " +
+                                 std::string(strerror(errno)));
+    }
+}
+
+void Poller::remove(int fd) { epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr); }
+
+int Poller::wait(std::vector<Event>& events, int timeout_ms) {
+    epoll_event raw[256];
+    int count = epoll_wait(epoll_fd_, raw, 256, timeout_ms);
+
+    events.clear();
+    if (count < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        uint32_t e = raw[i].events;
+        events.push_back({raw[i].data.ptr, (e & EPOLLIN) != 0, (e & EPOLLOUT) != 0,
+                          (e & (EPOLLHUP | EPOLLERR | EPOLLRDHUP)) != 0});
+    }
+    return count;
+}
+
+#else  // poll() fallback
+
+Poller::Poller() = default;
+Poller::~Poller() = default;
+
+void Poller::add(int fd, uint32_t interest, void* data, bool) {
+    registrations_[fd] = {interest, data};
+}
+
+void Poller::modify(int fd, uint32_t interest, void* data, bool) {
+    registrations_[fd] = {interest, data};
+}
+
+void Poller::remove(int fd) { registrations_.erase(fd); }
+
+int Poller::wait(std::vector<Event>& events, int timeout_ms) {
+    poll_fds_.clear();
+    for (const auto& [fd, registration] : registrations_) {
+        short mask = 0;
+        if (registration.interest & READABLE) mask |= POLLIN;
+        if (registration.interest & WRITABLE) mask |= POLLOUT;
+        poll_fds_.push_back({fd, mask, 0});
+    }
+
+    int count = poll(poll_fds_.data(), poll_fds_.size(), timeout_ms);
+
+    events.clear();
+    if (count < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+
+    for (const auto& pfd : poll_fds_) {
+        if (pfd.revents == 0) continue;
+        events.push_back({registrations_[pfd.fd].data, (pfd.revents & POLLIN) != 0,
+                          (pfd.revents & POLLOUT) != 0,
+                          (pfd.revents & (POLLHUP | POLLERR | POLLNVAL)) != 0});
+    }
+    return static_cast<int>(events.size());
+}
+
+#endif
+
+}  // namespace network
+}  // namespace redis_clone
@@ -1,71 +1,334 @@
 #include "network/redis_utils.h"
 
+#include <algorithm>
 #include <cctype>
+#include <iterator>
 #include <sstream>
-#include <unordered_map>
+#include <stdexcept>
+#include <utility>
 
 namespace redis_clone {
 namespace network {
 namespace redis_utils {
 
+namespace {
+
+// Limits mirror Redis defaults so a misbehaving client cannot make us buffer forever
+constexpr size_t kMaxInlineSize = 64 * 1024;
+constexpr long long kMaxMultibulkLength = 1024 * 1024;
+constexpr long long kMaxBulkLength = 512LL * 1024 * 1024;
+
+// Read a "\r\n" terminated integer line starting at pos (just after the type byte)
+ParseStatus read_length(const std::string& buffer, size_t& pos, long long& out,
+                        std::string& error) {
+    size_t line_end = buffer.find("\r\n", pos);
+    if (line_end == std::string::npos) {
+        if (buffer.size() - pos > 32) {
+            error = "Protocol error: too big count";
+            return ParseStatus::ERROR;
+        }
+        return ParseStatus::INCOMPLETE;
+    }
+
+    try {
+        size_t consumed = 0;
+        out = std::stoll(buffer.substr(pos, line_end - pos), &consumed);
+        if (consumed != line_end - pos) throw std::invalid_argument("trailing data");
+    } catch (const std::exception&) {
+        error = "Protocol error: invalid length";
+        return ParseStatus::ERROR;
+    }
+
+    pos = line_end + 2;
+    return ParseStatus::OK;
+}
+
+void fill_parts(std::vector<std::string>&& tokens, CommandParts& parts) {
+    parts = CommandParts{};
+    if (tokens.empty()) return;
+
+    parts.command = std::move(tokens[0]);
+    for (char& c : parts.command) {
+        c = std::toupper(static_cast<unsigned char>(c));
+    }
+
+    parts.args.assign(std::make_move_iterator(tokens.begin() + 1),
+                      std::make_move_iterator(tokens.end()));
+    if (!parts.args.empty()) parts.key = parts.args[0];
+    if (parts.args.size() > 1) parts.value = parts.args[1];
+}
+
+ParseStatus parse_multibulk(const std::string& buffer, size_t& pos, CommandParts& parts,
+                            std::string& error) {
+    size_t cursor = pos + 1;  // Skip '*'
+    long long count = 0;
+    ParseStatus status = read_length(buffer, cursor, count, error);
+    if (status != ParseStatus::OK) return status;
+
+    if (count > kMaxMultibulkLength) {
+        error = "Protocol error: invalid multibulk length";
+        return ParseStatus::ERROR;
+    }
+
+    std::vector<std::string> tokens;
+    tokens.reserve(count > 0 ? static_cast<size_t>(count) : 0);
+
+    for (long long i = 0; i < count; ++i) {
+        if (cursor >= buffer.size()) return ParseStatus::INCOMPLETE;
+        if (buffer[cursor] != '$') {
+            error = "Protocol error: expected '$', got '" + std::string(1, buffer[cursor]) + "'";
+            return ParseStatus::ERROR;
+        }
+
+        ++cursor;
+        long long length = 0;
+        status = read_length(buffer, cursor, length, error);
+        if (status != ParseStatus::OK) return status;
+
+        if (length < 0 || length > kMaxBulkLength) {
+            error = "Protocol error: invalid bulk length";
+            return ParseStatus::ERROR;
+        }
+
+        if (buffer.size() - cursor < static_cast<size_t>(length) + 2) {
+            return ParseStatus::INCOMPLETE;
+        }
+
+        tokens.emplace_back(buffer, cursor, static_cast<size_t>(length));
+        cursor += static_cast<size_t>(length) + 2;  // Payload + trailing \r\n
+    }
+
+    pos = cursor;
+    fill_parts(std::move(tokens), parts);
+    return ParseStatus::OK;
+}
+
+}  // namespace
+
+CommandParts command_from_tokens(std::vector<std::string> tokens) {
+    CommandParts parts;
+    fill_parts(std::move(tokens), parts);
+    return parts;
+}
+
 CommandParts extract_command(const std::string& input) {
     std::istringstream iss(input);
-    std::string cmd, key, value;
+    std::vector<std::string> tokens;
+    std::string token;
+
+    while (iss >> token) {
+        tokens.push_back(std::move(token));
+    }
+
+    CommandParts parts;
+    fill_parts(std::move(tokens), parts);
+    return parts;
+}
+
+ParseStatus parse_command(const std::string& buffer, size_t& pos, CommandParts& parts,
+                          std::string& error) {
+    while (pos < buffer.size()) {
+        if (buffer[pos] == '*') {
+            return parse_multibulk(buffer, pos, parts, error);
+        }
+
+        // Inline command, delimited by \n
+        size_t line_end = buffer.find('\n', pos);
+        if (line_end == std::string::npos) {
+            if (buffer.size() - pos > kMaxInlineSize) {
+                error = "Protocol error: too big inline request";
+                return ParseStatus::ERROR;
+            }
+            return ParseStatus::INCOMPLETE;
+        }
 
-    iss >> cmd;
-    if (iss >> key) {
-        iss >> value;
+        std::string line = buffer.substr(pos, line_end - pos);
+        pos = line_end + 1;
+
+        // Strip carriage return if present
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+
+        if (!line.empty()) {
+            parts = extract_command(line);
+            if (!parts.command.empty()) return ParseStatus::OK;
+        }
+    }
+
+    return ParseStatus::INCOMPLETE;
+}
+
+std::string format_multibulk_command(const CommandParts& parts) {
+    std::string out = "*" + std::to_string(parts.args.size() + 1) + "\r\n";
+    out += "$" + std::to_string(parts.command.size()) + "\r\n" + parts.command + "\r\n";
+    for (const auto& arg : parts.args) {
+        out += "$" + std::to_string(arg.size()) + "\r\n" + arg + "\r\n";
+    }
+    return out;
+}
+
+namespace {
+
+constexpr size_t kDefaultScanCount = 10;
+constexpr size_t kMaxScanCount = 10000;
+
+// Cursors are hex-encoded keys so that any key (including "0") round-trips
+std::string encode_cursor(const std::string& key) {
+    static const char digits[] = "0123456789abcdef";
+    std::string cursor;
+    cursor.reserve(key.size() * 2);
+    for (unsigned char c : key) {
+        cursor += digits[c >> 4];
+        cursor += digits[c & 0x0f];
+    }
+    return cursor;
+}
+
+bool decode_cursor(const std::string& cursor, std::string& key) {
+    if (cursor.size() % 2 != 0) return false;
+
+    auto nibble = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+
+    key.clear();
+    for (size_t i = 0; i < cursor.size(); i += 2) {
+        int high = nibble(cursor[i]);
+        int low = nibble(cursor[i + 1]);
+        if (high < 0 || low < 0) return false;
+        key += static_cast<char>((high << 4) | low);
     }
+    return true;
+}
+
+// ZRANGEBYLEX-style bound: "[key" inclusive, "(key" exclusive, "-" / "+" open
+bool parse_lex_bound(const std::string& spec, bool is_start, storage::KeyRange& range) {
+    std::string& key = is_start ? range.start : range.end;
+    bool& inclusive = is_start ? range.start_inclusive : range.end_inclusive;
+    bool& unbounded = is_start ? range.start_unbounded : range.end_unbounded;
 
-    // Convert command to uppercase for case-insensitive matching
-    for (char& c : cmd) {
-        c = std::toupper(c);
+    if (spec == (is_start ? "-" : "+")) {
+        unbounded = true;
+        return true;
+    }
+    if (spec.empty() || (spec[0] != '[' && spec[0] != '(')) {
+        return false;
     }
 
-    return {cmd, key, value};
+    key = spec.substr(1);
+    inclusive = spec[0] == '[';
+    unbounded = false;
+    return true;
 }
 
-/**
- * Template specialization for std::unordered_map storage
- * Implements basic Redis commands with RESP protocol responses
- */
-template <>
-std::string process_command_with_store<std::unordered_map<std::string, std::string>>(
-    const CommandParts& parts, std::unordered_map<std::string, std::string>& data) {
-    if (parts.command == "SET") {
-        if (parts.key.empty() || parts.value.empty()) {
-            return "-ERR wrong number of arguments for 'set' command\r\n";
+}  // namespace
+
+bool parse_scan_request(const CommandParts& parts, storage::KeyRange& range, size_t& count,
+                        std::string& error) {
+    bool prefix_scan = parts.command == "SCANPREFIX";
+    size_t positional = prefix_scan ? 2 : 3;
+    const std::string name = prefix_scan ? "scanprefix" : "scanrange";
+
+    if (parts.args.size() != positional && parts.args.size() != positional + 2) {
+        error = wrong_arity_reply(name);
+        return false;
+    }
+
+    if (prefix_scan) {
+        range = storage::KeyRange::for_prefix(parts.args[0]);
+    } else {
+        range = storage::KeyRange{};
+        if (!parse_lex_bound(parts.args[0], true, range) ||
+            !parse_lex_bound(parts.args[1], false, range)) {
+            error = "-ERR min or max not valid string range item\r\n";
+            return false;
         }
-        data[parts.key] = parts.value;
-        return "+OK\r\n";
-    } else if (parts.command == "GET") {
-        if (parts.key.empty()) {
-            return "-ERR wrong number of arguments for 'get' command\r\n";
+    }
+
+    count = kDefaultScanCount;
+    if (parts.args.size() == positional + 2) {
+        std::string option = parts.args[positional];
+        for (char& c : option) c = std::toupper(static_cast<unsigned char>(c));
+        if (option != "COUNT") {
+            error = "-ERR syntax error\r\n";
+            return false;
+        }
+        try {
+            long long requested = std::stoll(parts.args[positional + 1]);
+            if (requested < 1) throw std::out_of_range("count");
+            count = std::min(static_cast<size_t>(requested), kMaxScanCount);
+        } catch (const std::exception&) {
+            error = "-ERR value is not an integer or out of range\r\n";
+            return false;
         }
-        auto it = data.find(parts.key);
-        if (it != data.end()) {
-            return "$" + std::to_string(it->second.size()) + "\r\n" + it->second + "\r\n";
+    }
+
+    // Resume strictly after the last key of the previous page
+    const std::string& cursor = parts.args[positional - 1];
+    if (cursor != "0") {
+        std::string last_key;
+        if (!decode_cursor(cursor, last_key)) {
+            error = "-ERR invalid cursor\r\n";
+            return false;
         }
-        return "$-1\r\n";  // Redis null bulk string
-    } else if (parts.command == "DEL") {
-        if (parts.key.empty()) {
-            return "-ERR wrong number of arguments for 'del' command\r\n";
+        if (range.start_unbounded || last_key >= range.start) {
+            range.start = std::move(last_key);
+            range.start_inclusive = false;
+            range.start_unbounded = false;
         }
-        size_t deleted = data.erase(parts.key);
-        return ":" + std::to_string(deleted) + "\r\n";
-    } else if (parts.command == "EXISTS") {
-        if (parts.key.empty()) {
-            return "-ERR wrong number of arguments for 'exists' command\r\n";
+    }
+
+    return true;
+}
+
+std::string scan_reply(const std::vector<std::string>& keys, size_t count) {
+    // A short page means the range is exhausted
+    std::string next_cursor = keys.size() == count ? encode_cursor(keys.back()) : "0";
+
+    return "*2\r\n" + bulk_string_reply(next_cursor) + array_reply(keys);
+}
+
+bool parse_copy_request(const CommandParts& parts, bool& replace, std::string& error) {
+    if (parts.args.size() < 2) {
+        error = wrong_arity_reply("copy");
+        return false;
+    }
+
+    replace = false;
+    for (size_t i = 2; i < parts.args.size(); ++i) {
+        std::string option = parts.args[i];
+        for (char& c : option) c = std::toupper(static_cast<unsigned char>(c));
+        if (option == "REPLACE") {
+            replace = true;
+        } else if (option == "DB" && i + 1 < parts.args.size()) {
+            long long db = 0;
+            try {
+                size_t consumed = 0;
+                db = std::stoll(parts.args[++i], &consumed);
+                if (consumed != parts.args[i].size()) throw std::invalid_argument("db");
+            } catch (const std::exception&) {
+                error = "-ERR value is not an integer or out of range\r\n";
+                return false;
+            }
+            if (db != 0) {
+                error = "-ERR DB index is out of range\r\n";
+                return false;
+            }
+        } else {
+            error = "-ERR syntax error\r\n";
+            return false;
         }
-        bool exists = data.find(parts.key) != data.end();
-        return ":" + std::to_string(exists ? 1 : 0) + "\r\n";
-    } else if (parts.command == "QUIT") {
-        return "+OK\r\n";
-    } else if (parts.command == "BGSAVE") {
-        return "+BGSAVE\r\n";  // Handled specially by server
     }
 
-    return "-ERR unknown command '" + parts.command + "'\r\n";
+    if (parts.args[0] == parts.args[1]) {
+        error = "-ERR source and destination objects are the same\r\n";
+        return false;
+    }
+    return true;
 }
 
 }  // namespace redis_utils
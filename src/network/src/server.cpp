@@ -2,11 +2,14 @@
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
-#include <sys/select.h>
+#include <poll.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <cctype>
 #include <cerrno>
 #include <csignal>
 #include <cstdio>
@@ -14,85 +17,197 @@
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <sstream>
 #include <stdexcept>
 #include <vector>
 
 #include "network/redis_utils.h"
+#include "persistence/aof_format.h"
+#include "persistence/background_writer.h"
+#include "persistence/snapshot_format.h"
+#include "storage/key_hash.h"
 
 extern volatile sig_atomic_t g_running;
 
+// Helper function to check if file exists
+bool file_exists(const std::string& filename) {
+    std::ifstream file(filename);
+    return file.good();
+}
+
 namespace redis_clone {
 namespace network {
 
-// Global pointer for signal handler access
-static RedisServer* g_server_instance = nullptr;
-
-}  // namespace network
-}  // namespace redis_clone
+namespace {
+
+constexpr size_t kDiskThreads = 4;
+constexpr size_t kMaxEvictionsPerTick = 256;
+constexpr int kLoadCronInterval = 1024;
+constexpr int kBgsaveRetryDelaySeconds = 5;
+constexpr const char* kSnapshotPath = "data/dump.json";
+constexpr int kHandoffTimeoutMs = 5000;
+constexpr auto kClientsCronInterval = std::chrono::milliseconds(100);
+constexpr auto kClientBufferIdleTime = std::chrono::seconds(2);
+constexpr auto kClosingDrainTimeout = std::chrono::seconds(5);  // Then a closing client just goes
+constexpr size_t kClientsCronBatch = 1000;
+constexpr size_t kPrefetchWindow = 32;  // Pipelined lookups warmed up at a time
+// GET values at least this large are sent from the stored value, not copied into the reply
+constexpr size_t kSharedReplyMinSize = 16 * 1024;
+constexpr size_t kMaxWriteParts = 64;  // iovecs per writev
+
+// Held by CLIENT PAUSE WRITE and by AOF backpressure
+bool is_write_command(const std::string& command) {
+    return command == "SET" || command == "DEL" || command == "COPY";
+}
 
-// SIGCHLD handler to clean up background save processes
-void handle_child_exit(int sig) {
-    int status;
-    pid_t pid;
+// Admin and health-check commands: their clients run first (client-priority-lane), still
+// within the command budget, so a stream of them cannot starve anyone either
+bool is_priority_command(const std::string& command) {
+    return command == "PING" || command == "INFO" || command == "CLIENT" || command == "CONFIG" ||
+           command == "QUIT";
+}
 
-    // Reap all finished child processes (non-blocking)
-    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
-        if (WIFEXITED(status)) {
-            std::cout << "Background operation completed (PID: " << pid
-                      << ", exit code: " << WEXITSTATUS(status) << ")" << std::endl;
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
 
-            // Check if this was an AOF rewrite process
-            if (redis_clone::network::g_server_instance) {
-                redis_clone::network::g_server_instance->handle_aof_rewrite_completion(pid);
-            }
-        } else {
-            std::cout << "Background operation failed (PID: " << pid << ")" << std::endl;
+// Blocks until buffer is sent, for at most timeout_ms; false if the peer cannot take it
+bool send_all(int fd, std::string& buffer, int timeout_ms) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (!buffer.empty()) {
+        ssize_t sent = send(fd, buffer.data(), buffer.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent > 0) {
+            buffer.erase(0, static_cast<size_t>(sent));
+            continue;
         }
+        if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) return false;
+
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        deadline - std::chrono::steady_clock::now())
+                        .count();
+        pollfd writable{fd, POLLOUT, 0};
+        if (left <= 0 || poll(&writable, 1, static_cast<int>(left)) <= 0) return false;
     }
+    return true;
 }
 
-// Helper function to check if file exists
-bool file_exists(const std::string& filename) {
-    std::ifstream file(filename);
-    return file.good();
+// "ip:port" of the peer, as CLIENT LIST shows it
+std::string peer_address(int fd) {
+    sockaddr_storage address{};
+    socklen_t length = sizeof(address);
+    if (getpeername(fd, reinterpret_cast<sockaddr*>(&address), &length) != 0) return "?:0";
+
+    char ip[INET6_ADDRSTRLEN] = "?";
+    int port = 0;
+    if (address.ss_family == AF_INET) {
+        const auto* in = reinterpret_cast<const sockaddr_in*>(&address);
+        inet_ntop(AF_INET, &in->sin_addr, ip, sizeof(ip));
+        port = ntohs(in->sin_port);
+    } else if (address.ss_family == AF_INET6) {
+        const auto* in6 = reinterpret_cast<const sockaddr_in6*>(&address);
+        inet_ntop(AF_INET6, &in6->sin6_addr, ip, sizeof(ip));
+        port = ntohs(in6->sin6_port);
+    }
+    return std::string(ip) + ":" + std::to_string(port);
 }
 
-namespace redis_clone {
-namespace network {
+std::string to_upper(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(),
+                   [](unsigned char c) { return std::toupper(c); });
+    return text;
+}
 
-RedisServer::RedisServer(int port) : server_fd_(-1) {
+// Drops the clients no longer in the list's state, clearing their flag so they can come back
+template <typename Client, typename InState>
+void prune(std::vector<Client*>& list, bool Client::*on_list, InState in_state) {
+    size_t kept = 0;
+    for (Client* client : list) {
+        if (in_state(*client)) {
+            list[kept++] = client;
+        } else {
+            client->*on_list = false;
+        }
+    }
+    list.resize(kept);
+}
+
+}  // namespace
+
+RedisServer::RedisServer(int port, const ServerOptions& options)
+    : server_fd_(-1),
+      config_(options.config ? options.config : std::make_shared<config::Config>()),
+      buffer_pool_(config_->snapshot().client_buffer_pool_size),
+      io_threads_(options.io_threads) {
     server_start_time_ = std::chrono::steady_clock::now();
     last_save_time_ = server_start_time_;
 
-    // Set global instance for signal handler
-    g_server_instance = this;
+    // First thing, so a Ctrl-C during a long load is seen by the loop
+    signal_events_ = std::make_unique<SignalEvents>(
+        std::initializer_list<int>{SIGCHLD, SIGINT, SIGTERM});
+
+    const config::Settings& settings = config_->snapshot();
+    aof_enabled = settings.appendonly;
+    if (aof_enabled) {
+        aof_fsync_tasks_ = std::make_unique<TaskPool>(1);
+    }
+    checkpoint_tasks_ = std::make_unique<TaskPool>(1);
+
+    // Enable before loading so the index is built incrementally
+    if (options.ordered_index) {
+        data_.enable_ordered_index();
+    }
+
+    // Also before loading, so datasets larger than memory can be restored
+    if (settings.maxmemory_policy == config::MaxmemoryPolicy::TIERED) {
+        storage::TieringOptions tiering;
+        tiering.max_hot_memory = settings.maxmemory;
+        data_.enable_tiering(tiering);
+        disk_tasks_ = std::make_unique<TaskPool>(kDiskThreads);
+        std::cout << "Tiered storage enabled: values spill to " << tiering.log_path << " above "
+                  << tiering.max_hot_memory << " bytes" << std::endl;
+    }
+
+    // Epochs keep growing across restarts, so a new delta never reuses an old one's name
+    persistence::SnapshotChain chain = persistence::find_snapshot_chain(kSnapshotPath);
+    for (const auto& path : chain.stale) std::remove(path.c_str());
+    data_.set_epoch(static_cast<uint32_t>(chain.latest_epoch) + 1);
+    if (settings.incremental_checkpoints) {
+        data_.enable_change_tracking();
+    }
 
-    // Redis-style recovery: AOF takes precedence over RDB
-    if (aof_enabled && file_exists("data/appendonly.aof")) {
+    // Redis-style recovery: AOF takes precedence over RDB. The load runs in the
+    // background, so the listener below comes up right away and answers -LOADING.
+    last_fsync_time_ = server_start_time_;
+    if (!options.upgrade_from.empty()) {
+        take_over(options.upgrade_from);
+    } else if (aof_enabled && file_exists("data/appendonly.aof")) {
         std::cout << "Loading data from AOF file ..." << std::endl;
-        load_aof_from_file();
-    } else if (file_exists("data/dump.json")) {
+        start_loading(std::make_unique<DatasetLoader>("data/appendonly.aof",
+                                                      options.aof_truncate_to_timestamp));
+    } else if (file_exists(kSnapshotPath)) {
         std::cout << "Loading data from snapshot ..." << std::endl;
-        load_snapshot_from_file();
+        // Loaded keys are clean: stamped with the epoch the files on disk reach
+        loading_.next_epoch = data_.current_epoch();
+        data_.set_epoch(static_cast<uint32_t>(chain.epoch));
+        checkpoint_epoch_ = static_cast<uint32_t>(chain.epoch);
+        deltas_since_base_ = chain.deltas.size();
+        start_loading(std::make_unique<DatasetLoader>(kSnapshotPath, chain));
     } else {
         std::cout << "No persistence files found, starting with empty database" << std::endl;
+        finish_loading();
     }
 
-    signal(SIGCHLD, handle_child_exit);
-
-    // Initialize AOF
-    last_fsync_time_ = server_start_time_;
-    if (aof_enabled) {
-        aof_file_.open("data/appendonly.aof", std::ios::app);
-        if (!aof_file_.is_open()) {
-            std::cerr << "Warning: Could not open AOF file for writing" << std::endl;
-            aof_enabled = false;
-        } else {
-            std::cout << "AOF logging enabled" << std::endl;
-        }
+    // A takeover brings the listener along; otherwise the port is bound here
+    if (server_fd_ < 0) {
+        create_listener(port);
     }
+    if (!settings.upgrade_socket.empty()) {
+        upgrade_listen_fd_ = listen_upgrade_socket(settings.upgrade_socket);
+        std::cout << "Accepting hot upgrades on " << settings.upgrade_socket << std::endl;
+    }
+}
 
-    // Create and configure server socket
+void RedisServer::create_listener(int port) {
     server_fd_ = socket(AF_INET, SOCK_STREAM, 0);
     if (server_fd_ < 0) {
         throw std::runtime_error("Failed to create socket");
@@ -126,54 +241,334 @@ void RedisServer::accept_new_connections() {
         return;
     }
 
-    ClientState new_client;
+    ClientState& new_client = clients_.insert(client_fd);
     new_client.fd = client_fd;
-    clients_[client_fd] = new_client;
+    new_client.id = next_client_id_++;
+    new_client.addr = peer_address(client_fd);
+    new_client.created = std::chrono::steady_clock::now();
+    new_client.last_interaction = new_client.created;
+    poller_.add(client_fd, Poller::READABLE, &new_client);
 }
 
-void RedisServer::handle_client_data(int client_fd) {
-    char buffer[1024];
-    ssize_t bytes_read = recv(client_fd, buffer, sizeof(buffer) - 1, MSG_DONTWAIT);
+void RedisServer::read_client_data(ClientState& client) {
+    char buffer[16 * 1024];
+    ssize_t bytes_read = recv(client.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
 
+    if (bytes_read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return;
+    }
+
+    // No logging here: this runs on every I/O thread at once, and cout would serialize them
     if (bytes_read <= 0) {
-        std::cout << "Client " << client_fd << " disconnected" << std::endl;
-        clients_[client_fd].should_disconnect = true;
+        client.should_disconnect = true;
         return;
     }
 
-    buffer[bytes_read] = '\0';
-    clients_[client_fd].read_buffer += buffer;
+    buffer_pool_.reserve(client.read_buffer, static_cast<size_t>(bytes_read));
+    client.read_buffer.append(buffer, bytes_read);
+    client.bytes_in += static_cast<uint64_t>(bytes_read);
+    parse_commands(client);
+}
+
+void RedisServer::parse_commands(ClientState& client) {
+    // Parse every complete command; execution happens later on the main thread
+    size_t pos = 0;
+    redis_utils::CommandParts parts;
+    while (true) {
+        redis_utils::ParseStatus status =
+            redis_utils::parse_command(client.read_buffer, pos, parts, client.protocol_error);
+        if (status != redis_utils::ParseStatus::OK) break;
+        client.pending_commands.push_back(std::move(parts));
+    }
+    client.read_buffer.erase(0, pos);
+
+    // An unfinished command this large is a misbehaving client
+    if (client.read_buffer.size() > config_->snapshot().client_query_buffer_limit &&
+        client.protocol_error.empty()) {
+        client.protocol_error = "Protocol error: query buffer limit exceeded";
+    }
+}
+
+void RedisServer::execute_pending_commands(ClientState& client) {
+    if (client.waiting_on_disk) return;
 
-    std::cout << "Received " << bytes_read << " bytes from client " << client_fd << std::endl;
+    // A pipelining client gets a slice per iteration, so it cannot starve the others
+    const size_t budget = config_->snapshot().client_command_budget;
+    size_t spent = 0;
+    client.over_budget = false;
 
-    // Extract and process complete commands (delimited by \n)
-    size_t pos;
-    while ((pos = clients_[client_fd].read_buffer.find('\n')) != std::string::npos) {
-        std::string complete_command = clients_[client_fd].read_buffer.substr(0, pos);
-        clients_[client_fd].read_buffer.erase(0, pos + 1);
+    auto account = [&](const redis_utils::CommandParts& parts) {
+        ++client.commands;
+        client.last_command = parts.command;
+    };
 
-        // Strip carriage return if present
-        if (!complete_command.empty() && complete_command.back() == '\r') {
-            complete_command.pop_back();
+    size_t executed = 0;
+    for (; executed < client.pending_commands.size(); ++executed) {
+        if (executed % kPrefetchWindow == 0) prefetch_pending(client, executed);
+        const auto& parts = client.pending_commands[executed];
+        if (client.should_disconnect) break;
+
+        if (budget > 0 && spent++ == budget) {
+            client.over_budget = true;
+            break;
         }
 
-        if (!complete_command.empty()) {
-            std::cout << "Processing command: '" << complete_command << "'" << std::endl;
+        // Stays queued, with everything after it, until the pause ends
+        if (pause_mode_ != PauseMode::NONE && is_paused(parts)) break;
+        if (aof_backpressure_ && is_write_command(parts.command)) break;
 
-            redis_utils::CommandParts parts = redis_utils::extract_command(complete_command);
-            if (parts.command == "QUIT") {
-                clients_[client_fd].write_buffer += "+OK\r\n";
-                clients_[client_fd].should_disconnect = true;
-            } else {
-                std::string response = process_command(complete_command);
-                clients_[client_fd].write_buffer += response;
+        if (loading_.loader) {
+            std::string reply = loading_reply(parts);
+            if (!reply.empty()) {
+                account(parts);
+                append_reply(client, reply);
+                continue;
             }
         }
+
+        // Replies must stay in order, so the GET (or COPY, whose source is the key) and
+        // everything after it waits
+        if ((parts.command == "GET" || parts.command == "COPY") &&
+            start_cold_read(client, parts.key)) {
+            break;
+        }
+
+        account(parts);
+        if (parts.command == "QUIT") {
+            client.write_buffer += "+OK\r\n";
+            client.should_disconnect = true;
+        } else if (parts.command == "CLIENT") {
+            append_reply(client, client_command(client, parts));
+        } else if (parts.command == "GET" && parts.args.size() == 1) {
+            append_value_reply(client, data_.get_shared(parts.key));
+        } else {
+            append_reply(client, process_command(parts));
+        }
+    }
+    if (executed > 0) {
+        client.last_interaction = std::chrono::steady_clock::now();
+    }
+
+    if (client.should_disconnect) {
+        client.pending_commands.clear();
+    } else {
+        client.pending_commands.erase(client.pending_commands.begin(),
+                                      client.pending_commands.begin() + executed);
+    }
+
+    size_t output_limit = config_->snapshot().client_output_buffer_limit;
+    if (output_limit > 0 && client.output_size() > output_limit) {
+        std::cerr << "Client " << client.fd << " exceeded the output buffer limit, closing"
+                  << std::endl;
+        client.clear_output();
+        client.pending_commands.clear();
+        client.should_disconnect = true;
+        return;
+    }
+    if (client.waiting_on_disk) return;
+
+    // Protocol errors are fatal for the connection, like in Redis
+    if (!client.protocol_error.empty() && !client.should_disconnect) {
+        client.write_buffer += "-ERR " + client.protocol_error + "\r\n";
+        client.should_disconnect = true;
+    }
+}
+
+void RedisServer::prefetch_pending(const ClientState& client, size_t from) {
+    // Batch prefetch, as in Dragonfly and Redis 8: a lone command has no misses to overlap
+    size_t end = std::min(client.pending_commands.size(), from + kPrefetchWindow);
+    std::vector<const std::string*> keys;
+    for (size_t i = from; i < end; ++i) {
+        const auto& parts = client.pending_commands[i];
+        const std::string& command = parts.command;
+        if (command == "GET" || command == "EXISTS" || is_write_command(command)) {
+            keys.push_back(&parts.key);
+        }
+    }
+    if (keys.size() > 1) data_.prefetch(keys);
+}
+
+std::vector<RedisServer::ClientState*> RedisServer::runnable_clients(
+    const std::vector<ClientState*>& ready_clients) {
+    // Round robin: clients that just sent something go first, clients carrying work over
+    // from the last iteration queue up behind them; with the priority lane on, either waits
+    // behind a client whose next command is a priority one
+    const bool priority_lane = config_->snapshot().client_priority_lane;
+    std::vector<ClientState*> fresh;
+    std::vector<ClientState*> carried_over;
+    std::vector<ClientState*> priority;
+    auto add = [&](ClientState* client, std::vector<ClientState*>& queue) {
+        if (priority_lane && !client->pending_commands.empty() &&
+            is_priority_command(client->pending_commands.front().command)) {
+            priority.push_back(client);
+        } else {
+            queue.push_back(client);
+        }
+    };
+    // Over-budget clients are not polled for reading, so they are never in ready_clients
+    for (ClientState* client : ready_clients) add(client, fresh);
+    for (ClientState* client : over_budget_clients_) {
+        if (client->over_budget) add(client, carried_over);
+    }
+    priority.insert(priority.end(), fresh.begin(), fresh.end());
+    priority.insert(priority.end(), carried_over.begin(), carried_over.end());
+    return priority;
+}
+
+void RedisServer::append_reply(ClientState& client, const std::string& reply) {
+    buffer_pool_.reserve(client.write_buffer, reply.size());
+    client.write_buffer += reply;
+}
+
+void RedisServer::append_value_reply(ClientState& client, storage::SharedValue value) {
+    if (!value) {
+        append_reply(client, "$-1\r\n");  // Redis null bulk string
+        return;
+    }
+
+    std::string header = "$" + std::to_string(value->size()) + "\r\n";
+    if (value->size() < kSharedReplyMinSize) {
+        // Cheaper to copy once than to track
+        buffer_pool_.reserve(client.write_buffer, header.size() + value->size() + 2);
+        client.write_buffer += header;
+        client.write_buffer += *value;
+        client.write_buffer += "\r\n";
+        return;
+    }
+
+    // The reference keeps these bytes as they are, whatever later writes do to the key
+    append_reply(client, header);
+    client.shared_bytes += value->size();
+    client.shared_replies.push_back({client.write_buffer.size(), std::move(value), 0});
+    append_reply(client, "\r\n");
+}
+
+void RedisServer::flatten_output(ClientState& client) {
+    std::string flat;
+    flat.reserve(client.output_size());
+    size_t copied = 0;
+    for (const auto& reply : client.shared_replies) {
+        flat.append(client.write_buffer, copied, reply.offset - copied);
+        flat.append(*reply.value, reply.sent, std::string::npos);
+        copied = reply.offset;
+    }
+    flat.append(client.write_buffer, copied, std::string::npos);
+    client.clear_output();
+    client.write_buffer = std::move(flat);
+}
+
+void RedisServer::clients_cron() {
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_clients_cron_ < kClientsCronInterval) return;
+    last_clients_cron_ = now;
+    buffer_pool_.set_max_bytes(config_->snapshot().client_buffer_pool_size);
+
+    // A slice of the clients per run, like Redis's clientsCron, so 20k connections stay cheap
+    size_t count = std::min(clients_.size(), kClientsCronBatch);
+    for (size_t i = 0; i < count; ++i) {
+        ClientState& client = *clients_.begin()[(clients_cron_cursor_ + i) % clients_.size()];
+        if (client.waiting_on_disk || now - client.last_interaction < kClientBufferIdleTime) {
+            continue;
+        }
+        client_buffers_reclaimed_ += buffer_pool_.reclaim(client.read_buffer);
+        client_buffers_reclaimed_ += buffer_pool_.reclaim(client.write_buffer);
+    }
+    clients_cron_cursor_ = clients_.empty() ? 0 : (clients_cron_cursor_ + count) % clients_.size();
+}
+
+bool RedisServer::write_held(const ClientState& client) const {
+    return aof_backpressure_ && !client.pending_commands.empty() &&
+           is_write_command(client.pending_commands.front().command);
+}
+
+void RedisServer::write_client_data(ClientState& client) {
+    if (client.shared_replies.empty()) {
+        // MSG_NOSIGNAL: a peer that reset must not take the server down with SIGPIPE
+        ssize_t bytes_sent = send(client.fd, client.write_buffer.data(),
+                                  client.write_buffer.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (bytes_sent > 0) {
+            client.write_buffer.erase(0, bytes_sent);
+            client.bytes_out += static_cast<uint64_t>(bytes_sent);
+        } else if (bytes_sent < 0) {
+            handle_write_error(client);
+        }
+        return;
+    }
+
+    // One writev: buffered replies up to each shared value, the value, and so on
+    iovec parts[kMaxWriteParts];
+    size_t count = 0;
+    size_t buffered = 0;
+    bool all_values = true;
+    for (const auto& reply : client.shared_replies) {
+        if (count + 2 > kMaxWriteParts) {
+            all_values = false;
+            break;
+        }
+        if (reply.offset > buffered) {
+            parts[count++] = {client.write_buffer.data() + buffered, reply.offset - buffered};
+        }
+        buffered = reply.offset;
+        parts[count++] = {const_cast<char*>(reply.value->data()) + reply.sent,
+                          reply.value->size() - reply.sent};
+    }
+    if (all_values && buffered < client.write_buffer.size()) {
+        parts[count++] = {client.write_buffer.data() + buffered,
+                          client.write_buffer.size() - buffered};
     }
+
+    msghdr message{};
+    message.msg_iov = parts;
+    message.msg_iovlen = count;
+    ssize_t bytes_sent = sendmsg(client.fd, &message, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (bytes_sent < 0) handle_write_error(client);
+    if (bytes_sent <= 0) return;
+    client.bytes_out += static_cast<uint64_t>(bytes_sent);
+
+    // Consume in the same order: buffered bytes before the front value, then the value
+    size_t left = static_cast<size_t>(bytes_sent);
+    size_t consumed = 0;  // From write_buffer
+    while (left > 0 && !client.shared_replies.empty()) {
+        auto& reply = client.shared_replies.front();
+        size_t before = std::min(left, reply.offset - consumed);
+        consumed += before;
+        left -= before;
+        size_t from_value = std::min(left, reply.value->size() - reply.sent);
+        reply.sent += from_value;
+        client.shared_bytes -= from_value;
+        left -= from_value;
+        if (reply.sent < reply.value->size()) break;
+        client.shared_replies.pop_front();
+    }
+    consumed += left;
+    client.write_buffer.erase(0, consumed);
+    for (auto& reply : client.shared_replies) reply.offset -= consumed;
 }
 
-std::string RedisServer::process_command(const std::string& command) {
-    redis_utils::CommandParts parts = redis_utils::extract_command(command);
+void RedisServer::handle_write_error(ClientState& client) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return;
+
+    // EPIPE, ECONNRESET and the like: nothing queued can reach the peer any more
+    client.clear_output();
+    client.should_disconnect = true;
+}
+
+std::string RedisServer::process_command(const redis_utils::CommandParts& parts) {
+    if (parts.command == "CONFIG") {
+        return config_command(parts);
+    }
+    if (parts.command == "INFO") {
+        return info_command(parts);
+    }
+
+    // noeviction: refuse writes that can grow memory, like Redis
+    const config::Settings& settings = config_->snapshot();
+    if ((parts.command == "SET" || parts.command == "COPY") && settings.maxmemory > 0 &&
+        settings.maxmemory_policy == config::MaxmemoryPolicy::NOEVICTION &&
+        data_.memory_usage() > settings.maxmemory) {
+        return "-OOM command not allowed when used memory > 'maxmemory'.\r\n";
+    }
+
     std::string response = redis_utils::process_command_with_store(parts, data_);
 
     if (parts.command == "BGSAVE") {
@@ -184,12 +579,18 @@ std::string RedisServer::process_command(const std::string& command) {
         return background_rewrite_aof();
     }
 
-    // Count successful write operations for persistence triggers
+    // Count successful write operations for persistence triggers; a DEL that removed nothing
+    // or a COPY that did not copy replies :0
     if ((response[0] == '+' && response.substr(0, 3) == "+OK") ||
-        (response[0] == ':' && response[1] == '1')) {
+        (response[0] == ':' && response != ":0\r\n")) {
         if (parts.command == "SET" || parts.command == "DEL") {
             // Write to AOF first (write-ahead logging)
-            append_to_aof(command);
+            append_to_aof(parts);
+            changes_since_save++;
+        } else if (parts.command == "COPY") {
+            // Logged as the SET it amounts to, so replay needs neither the source nor options
+            append_to_aof(redis_utils::command_from_tokens(
+                {"SET", parts.args[1], *data_.get_shared(parts.args[1])}));
             changes_since_save++;
         }
     }
@@ -197,232 +598,1168 @@ std::string RedisServer::process_command(const std::string& command) {
     return response;
 }
 
-void RedisServer::run() {
-    while (g_running) {
-        fd_set read_fds;
-        FD_ZERO(&read_fds);
+std::string RedisServer::config_command(const redis_utils::CommandParts& parts) {
+    const auto& args = parts.args;
+    std::string subcommand = args.empty() ? "" : args[0];
+    std::transform(subcommand.begin(), subcommand.end(), subcommand.begin(),
+                   [](unsigned char c) { return std::toupper(c); });
+
+    if (subcommand == "GET" && args.size() == 2) {
+        std::vector<std::string> items;
+        for (auto& [name, value] : config_->get(args[1])) {
+            items.push_back(name);
+            items.push_back(value);
+        }
+        return redis_utils::array_reply(items);
+    }
+
+    if (subcommand == "SET" && args.size() >= 3) {
+        // Multi-word values such as "save 900 1 300 10" may arrive unquoted
+        std::string value = args[2];
+        for (size_t i = 3; i < args.size(); ++i) {
+            value += " " + args[i];
+        }
+        std::string error = config_->set(args[1], value);
+        return error.empty() ? "+OK\r\n" : "-ERR " + error + "\r\n";
+    }
+
+    if (subcommand == "REWRITE" && args.size() == 1) {
+        std::string error = config_->rewrite();
+        return error.empty() ? "+OK\r\n" : "-ERR " + error + "\r\n";
+    }
+
+    if (subcommand == "GET" || subcommand == "SET" || subcommand == "REWRITE") {
+        std::string name = "config|" + subcommand;
+        std::transform(name.begin(), name.end(), name.begin(),
+                       [](unsigned char c) { return std::tolower(c); });
+        return redis_utils::wrong_arity_reply(name);
+    }
+    return "-ERR unknown subcommand '" + (args.empty() ? "" : args[0]) +
+           "'. Try CONFIG GET, SET or REWRITE.\r\n";
+}
 
-        FD_SET(server_fd_, &read_fds);
-        int max_fd = server_fd_;
+std::string RedisServer::info_command(const redis_utils::CommandParts& parts) {
+    std::string wanted = parts.args.empty() ? "default" : parts.args[0];
+    std::transform(wanted.begin(), wanted.end(), wanted.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    if (parts.args.size() > 1) {
+        return redis_utils::wrong_arity_reply("info");
+    }
 
-        for (const auto& [client_fd, client_state] : clients_) {
-            FD_SET(client_fd, &read_fds);
-            max_fd = std::max(max_fd, client_fd);
+    std::string info;
+    auto section = [&](const std::string& name) {
+        bool include = wanted == "default" || wanted == "all" || wanted == name;
+        if (include) {
+            if (!info.empty()) info += "\r\n";
+            info += "# " + std::string(1, std::toupper(name[0])) + name.substr(1) + "\r\n";
         }
+        return include;
+    };
+    auto field = [&](const std::string& name, const std::string& value) {
+        info += name + ":" + value + "\r\n";
+    };
+    auto seconds = [](double value) { return std::to_string(static_cast<long long>(value)); };
+
+    if (section("server")) {
+        field("redis_version", "0.1.0");
+        field("process_id", std::to_string(getpid()));
+        field("uptime_in_seconds", seconds(seconds_since(server_start_time_)));
+        field("io_threads", std::to_string(io_threads_.size()));
+        field("key_hash", storage::key_hash_name());
+    }
 
-        int activity = select(max_fd + 1, &read_fds, nullptr, nullptr, nullptr);
+    if (section("clients")) {
+        field("connected_clients", std::to_string(clients_.size()));
+        const char* pause = "none";
+        if (pause_mode_ != PauseMode::NONE && std::chrono::steady_clock::now() < pause_end_) {
+            pause = pause_mode_ == PauseMode::ALL ? "all" : "write";
+        }
+        field("paused_actions", pause);
+    }
 
-        if (activity < 0) {
-            if (errno == EINTR) {
-                continue;  // Signal interrupted, check g_running flag
+    if (section("memory")) {
+        const config::Settings& settings = config_->snapshot();
+        field("used_memory", std::to_string(data_.memory_usage()));
+        size_t client_buffers = 0;
+        for (const ClientState* client : clients_) {
+            client_buffers += client->read_buffer.capacity() + client->write_buffer.capacity();
+        }
+        field("mem_clients_normal", std::to_string(client_buffers));
+        field("client_buffer_pool_bytes", std::to_string(buffer_pool_.pooled_bytes()));
+        field("client_buffer_pool_buffers", std::to_string(buffer_pool_.pooled_buffers()));
+        field("client_buffers_reclaimed", std::to_string(client_buffers_reclaimed_));
+        field("maxmemory", std::to_string(settings.maxmemory));
+        field("maxmemory_policy", config_->get("maxmemory-policy").front().second);
+        if (data_.tiering_enabled()) {
+            storage::TieringStats stats = data_.tiering_stats();
+            field("tiered_cold_keys", std::to_string(stats.cold_keys));
+            field("tiered_evictions", std::to_string(stats.evictions));
+            field("tiered_promotions", std::to_string(stats.promotions));
+            field("tiered_log_size", std::to_string(stats.log_size));
+            field("tiered_log_dead_bytes", std::to_string(stats.log_dead_bytes));
+        }
+    }
+
+    if (section("persistence")) {
+        auto current = [&](ChildType type) {
+            for (const auto& [pid, child] : children_) {
+                if (child.type == type) return seconds(seconds_since(child.started));
             }
-            std::cerr << "select() error: " << strerror(errno) << std::endl;
-            break;
+            if (type == ChildType::SNAPSHOT && checkpoint_thread_) {
+                return seconds(seconds_since(checkpoint_thread_->started));
+            }
+            return std::string("-1");
+        };
+        auto last_duration = [&](const ChildHistory& history) {
+            return history.last_duration_sec < 0 ? std::string("-1")
+                                                 : seconds(history.last_duration_sec);
+        };
+
+        field("loading", loading_.loader ? "1" : "0");
+        if (loading_.loader) {
+            uint64_t total = loading_.loader->total_bytes();
+            uint64_t loaded = loading_.bytes_loaded;
+            double elapsed = seconds_since(loading_.started);
+            char perc[16];
+            std::snprintf(perc, sizeof(perc), "%.2f%%", total ? 100.0 * loaded / total : 0.0);
+            field("loading_source", loading_.loader->is_aof() ? "aof" : "snapshot");
+            field("loading_time_sec", seconds(elapsed));
+            field("loading_total_bytes", std::to_string(total));
+            field("loading_loaded_bytes", std::to_string(loaded));
+            field("loading_loaded_perc", perc);
+            field("loading_loaded_keys", std::to_string(data_.size()));
+            field("loading_eta_seconds",
+                  loaded ? seconds(elapsed * (total - loaded) / loaded) : std::string("1"));
         }
+        field("rdb_changes_since_last_save", std::to_string(changes_since_save));
+        field("rdb_bgsave_in_progress", child_running(ChildType::SNAPSHOT) ? "1" : "0");
+        field("rdb_last_bgsave_status", snapshot_history_.last_ok ? "ok" : "err");
+        field("rdb_last_bgsave_exit_status", std::to_string(snapshot_history_.last_exit_status));
+        field("rdb_last_bgsave_time_sec", last_duration(snapshot_history_));
+        field("rdb_current_bgsave_time_sec", current(ChildType::SNAPSHOT));
+        field("checkpoint_mode", config_->snapshot().incremental_checkpoints ? "incremental"
+                                                                             : "full");
+        field("checkpoint_epoch", std::to_string(checkpoint_epoch_));
+        field("checkpoint_deltas_since_base", std::to_string(deltas_since_base_));
+        field("checkpoint_tracked_deletions", std::to_string(data_.deletions_tracked()));
+        field("aof_enabled", aof_enabled ? "1" : "0");
+        field("aof_rewrite_in_progress", child_running(ChildType::AOF_REWRITE) ? "1" : "0");
+        field("aof_last_bgrewrite_status", rewrite_history_.last_ok ? "ok" : "err");
+        field("aof_last_bgrewrite_exit_status", std::to_string(rewrite_history_.last_exit_status));
+        field("aof_last_rewrite_time_sec", last_duration(rewrite_history_));
+        field("aof_current_rewrite_time_sec", current(ChildType::AOF_REWRITE));
+        size_t held = 0;
+        for (const ClientState* client : clients_) held += write_held(*client);
+        field("aof_pending_bio_fsync", aof_fsync_in_flight_ ? "1" : "0");
+        field("aof_unsynced_bytes", std::to_string(aof_unsynced_bytes()));
+        field("aof_last_fsync_ms", std::to_string(static_cast<long long>(aof_last_fsync_ms_)));
+        field("aof_backpressure", aof_backpressure_ ? "1" : "0");
+        field("aof_backpressure_events", std::to_string(aof_backpressure_events_));
+        field("aof_backpressure_held_clients", std::to_string(held));
+    }
 
-        if (FD_ISSET(server_fd_, &read_fds)) {
-            accept_new_connections();
+    return redis_utils::bulk_string_reply(info);
+}
+
+std::string RedisServer::client_command(ClientState& client,
+                                        const redis_utils::CommandParts& parts) {
+    const auto& args = parts.args;
+    std::string subcommand = to_upper(args.empty() ? "" : args[0]);
+
+    if (subcommand == "ID" && args.size() == 1) {
+        return ":" + std::to_string(client.id) + "\r\n";
+    }
+
+    if (subcommand == "SETNAME" && args.size() == 2) {
+        // CLIENT LIST is space separated, so names cannot contain spaces
+        for (unsigned char c : args[1]) {
+            if (c <= ' ' || c > '~') {
+                return "-ERR Client names cannot contain spaces, newlines or special "
+                       "characters.\r\n";
+            }
         }
+        client.name = args[1];
+        return "+OK\r\n";
+    }
+
+    if (subcommand == "GETNAME" && args.size() == 1) {
+        return client.name.empty() ? "$-1\r\n" : redis_utils::bulk_string_reply(client.name);
+    }
 
-        for (const auto& [client_fd, client_state] : clients_) {
-            if (FD_ISSET(client_fd, &read_fds)) {
-                handle_client_data(client_fd);
+    if (subcommand == "INFO" && args.size() == 1) {
+        return redis_utils::bulk_string_reply(client_info(client));
+    }
+
+    bool list_ids = args.size() > 2 && to_upper(args[1]) == "ID";
+    if (subcommand == "LIST" && (args.size() == 1 || list_ids)) {
+        std::vector<const ClientState*> listed;
+        for (const ClientState* other : clients_) {
+            bool wanted = args.size() == 1;
+            for (size_t i = 2; i < args.size() && !wanted; ++i) {
+                wanted = args[i] == std::to_string(other->id);
             }
+            if (wanted) listed.push_back(other);
         }
+        std::sort(listed.begin(), listed.end(),
+                  [](const ClientState* a, const ClientState* b) { return a->id < b->id; });
+        std::string list;
+        for (const ClientState* other : listed) list += client_info(*other);
+        return redis_utils::bulk_string_reply(list);
+    }
 
-        // Send pending responses and handle disconnections
-        std::vector<int> clients_to_disconnect;
-        for (auto& [client_fd, client_state] : clients_) {
-            if (!client_state.write_buffer.empty()) {
-                ssize_t bytes_sent = send(client_fd, client_state.write_buffer.c_str(),
-                                          client_state.write_buffer.size(), MSG_DONTWAIT);
-                if (bytes_sent > 0) {
-                    client_state.write_buffer.erase(0, bytes_sent);
+    if (subcommand == "KILL" && args.size() >= 2) {
+        // Old form: CLIENT KILL addr; new form: filter/value pairs, the caller spared by default
+        bool old_form = args.size() == 2;
+        std::optional<uint64_t> id;
+        std::string addr = old_form ? args[1] : "";
+        bool skip_me = !old_form;
+        if (!old_form) {
+            if (args.size() % 2 == 0) return "-ERR syntax error\r\n";
+            for (size_t i = 1; i + 1 < args.size(); i += 2) {
+                std::string filter = to_upper(args[i]);
+                const std::string& value = args[i + 1];
+                if (filter == "ID") {
+                    char* end = nullptr;
+                    unsigned long long parsed = std::strtoull(value.c_str(), &end, 10);
+                    if (value.empty() || *end != '\0' || parsed == 0) {
+                        return "-ERR client-id should be greater than 0\r\n";
+                    }
+                    id = parsed;
+                } else if (filter == "ADDR") {
+                    addr = value;
+                } else if (filter == "SKIPME") {
+                    std::string answer = to_upper(value);
+                    if (answer != "YES" && answer != "NO") return "-ERR syntax error\r\n";
+                    skip_me = answer == "YES";
+                } else {
+                    return "-ERR syntax error\r\n";
                 }
             }
+        }
+
+        long long killed = 0;
+        for (ClientState* other : clients_) {
+            if ((id && other->id != *id) || (!addr.empty() && other->addr != addr)) continue;
+            if (other == &client && skip_me) continue;
+            other->should_disconnect = true;
+            ++killed;
+            // The caller still gets this reply; anyone else is dropped as is
+            if (other != &client) {
+                other->clear_output();
+                other->pending_commands.clear();
+                update_client_lists(*other);
+            }
+        }
+        if (old_form) return killed ? "+OK\r\n" : "-ERR No such client\r\n";
+        return ":" + std::to_string(killed) + "\r\n";
+    }
 
-            if (client_state.should_disconnect && client_state.write_buffer.empty()) {
-                clients_to_disconnect.push_back(client_fd);
+    if (subcommand == "PAUSE" && (args.size() == 2 || args.size() == 3)) {
+        char* end = nullptr;
+        long long timeout = std::strtoll(args[1].c_str(), &end, 10);
+        if (args[1].empty() || *end != '\0' || timeout < 0) {
+            return "-ERR timeout is not an integer or out of range\r\n";
+        }
+        PauseMode mode = PauseMode::ALL;
+        if (args.size() == 3) {
+            std::string option = to_upper(args[2]);
+            if (option == "WRITE") {
+                mode = PauseMode::WRITE;
+            } else if (option != "ALL") {
+                return "-ERR syntax error\r\n";
             }
         }
 
-        for (int client_fd : clients_to_disconnect) {
-            close(client_fd);
-            clients_.erase(client_fd);
+        // Overlapping pauses combine to the longest and the strictest, like Redis
+        auto end_time = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+        if (pause_mode_ == PauseMode::NONE) {
+            pause_mode_ = mode;
+            pause_end_ = end_time;
+        } else {
+            pause_mode_ = std::max(pause_mode_, mode);
+            pause_end_ = std::max(pause_end_, end_time);
+        }
+        return "+OK\r\n";
+    }
+
+    if (subcommand == "UNPAUSE" && args.size() == 1) {
+        // Queued commands resume at the top of the next loop iteration
+        if (pause_mode_ != PauseMode::NONE) pause_end_ = std::chrono::steady_clock::now();
+        return "+OK\r\n";
+    }
+
+    static const std::vector<std::string> kSubcommands = {"ID",   "SETNAME", "GETNAME", "INFO",
+                                                          "LIST", "KILL",    "PAUSE",   "UNPAUSE"};
+    if (std::find(kSubcommands.begin(), kSubcommands.end(), subcommand) != kSubcommands.end()) {
+        std::string name = "client|" + subcommand;
+        std::transform(name.begin(), name.end(), name.begin(),
+                       [](unsigned char c) { return std::tolower(c); });
+        return redis_utils::wrong_arity_reply(name);
+    }
+    return "-ERR unknown subcommand '" + (args.empty() ? "" : args[0]) +
+           "'. Try CLIENT ID, SETNAME, GETNAME, INFO, LIST, KILL, PAUSE or UNPAUSE.\r\n";
+}
+
+std::string RedisServer::client_info(const ClientState& client) const {
+    auto now = std::chrono::steady_clock::now();
+    auto age = std::chrono::duration_cast<std::chrono::seconds>(now - client.created).count();
+    auto idle =
+        std::chrono::duration_cast<std::chrono::seconds>(now - client.last_interaction).count();
+    std::string command = client.last_command.empty() ? "NULL" : client.last_command;
+    std::transform(command.begin(), command.end(), command.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+
+    std::ostringstream line;
+    line << "id=" << client.id << " addr=" << client.addr << " fd=" << client.fd
+         << " name=" << client.name << " age=" << age << " idle=" << idle
+         << " flags=" << (client.waiting_on_disk ? "b" : "N")
+         << " qbuf=" << client.read_buffer.size()
+         << " qbuf-free=" << client.read_buffer.capacity() - client.read_buffer.size()
+         << " omem=" << client.output_size()
+         << " tot-mem=" << client.read_buffer.capacity() + client.write_buffer.capacity()
+         << " tot-net-in=" << client.bytes_in << " tot-net-out=" << client.bytes_out
+         << " tot-cmds=" << client.commands << " cmd=" << command << "\n";
+    return line.str();
+}
+
+bool RedisServer::is_paused(const redis_utils::CommandParts& parts) const {
+    if (std::chrono::steady_clock::now() >= pause_end_) return false;
+    if (pause_mode_ == PauseMode::ALL) return parts.command != "CLIENT";
+    return is_write_command(parts.command);
+}
+
+void RedisServer::unpause_if_expired() {
+    if (pause_mode_ == PauseMode::NONE || std::chrono::steady_clock::now() < pause_end_) return;
+
+    pause_mode_ = PauseMode::NONE;
+    resume_held_clients();
+}
+
+void RedisServer::resume_held_clients() {
+    // A client still held goes back on the list, so this walks a copy
+    std::vector<ClientState*> held = held_clients_;
+    for (ClientState* client : held) {
+        if (client->pending_commands.empty()) continue;
+        execute_pending_commands(*client);
+        update_client_lists(*client);
+    }
+}
+
+void RedisServer::update_client_lists(ClientState& client) {
+    auto add = [&](bool in_state, bool& on_list, std::vector<ClientState*>& list) {
+        if (in_state && !on_list) {
+            on_list = true;
+            list.push_back(&client);
+        }
+    };
+    add(client.over_budget, client.on_over_budget_list, over_budget_clients_);
+    add(!client.over_budget && !client.pending_commands.empty(), client.on_held_list,
+        held_clients_);
+    add(client.has_output(), client.on_output_list, output_clients_);
+    if (client.should_disconnect && !client.on_closing_list) {
+        client.closing_since = std::chrono::steady_clock::now();
+    }
+    add(client.should_disconnect, client.on_closing_list, closing_clients_);
+}
+
+void RedisServer::sync_read_interest(ClientState& client) {
+    // A client with commands left over is not read until it catches up, and one whose next
+    // command is a write held by AOF backpressure not until the fsync catches up
+    bool reading = !client.over_budget && !write_held(client);
+    if (reading != client.reading) {
+        poller_.modify(client.fd, reading ? uint32_t{Poller::READABLE} : 0u, &client);
+        client.reading = reading;
+    }
+}
+
+void RedisServer::close_clients(const std::vector<ClientState*>& closing) {
+    // One pass per list, however many clients go at once
+    for (ClientState* client : closing) client->closed = true;
+    auto unlist = [](std::vector<ClientState*>& list) {
+        list.erase(std::remove_if(list.begin(), list.end(),
+                                  [](const ClientState* client) { return client->closed; }),
+                   list.end());
+    };
+    unlist(over_budget_clients_);
+    unlist(held_clients_);
+    unlist(output_clients_);
+    unlist(closing_clients_);
+
+    for (ClientState* client : closing) {
+        // Explicitly: a forked child may still hold the fd, keeping epoll's entry alive
+        int fd = client->fd;
+        poller_.remove(fd);
+        close(fd);
+        clients_.erase(fd);
+    }
+}
+
+int RedisServer::poll_timeout_ms(bool backlog) const {
+    using std::chrono::steady_clock;
+    std::optional<steady_clock::time_point> wake;
+    auto earliest = [&](steady_clock::time_point when) {
+        if (!wake || when < *wake) wake = when;
+    };
+
+    // Left over commands only need a poll; timers need a wake-up even if nothing else happens
+    auto now = steady_clock::now();
+    if (backlog) earliest(now);
+    if (pause_mode_ != PauseMode::NONE) earliest(pause_end_);
+    if (!clients_.empty()) earliest(last_clients_cron_ + kClientsCronInterval);
+    size_t max_lag_ms = config_->snapshot().aof_max_fsync_lag_ms;
+    if (aof_fsync_in_flight_ && !aof_backpressure_ && max_lag_ms > 0) {
+        earliest(aof_fsync_started_ + std::chrono::milliseconds(max_lag_ms));
+    }
+    if (!wake) return -1;
+
+    // Rounded up, so a timer is never found not quite due yet
+    auto left = std::chrono::duration_cast<std::chrono::microseconds>(*wake - now).count();
+    return static_cast<int>(std::max<long long>(left + 999, 0) / 1000);
+}
+
+bool RedisServer::start_cold_read(ClientState& client, const std::string& key) {
+    if (!disk_tasks_) return false;
+
+    auto location = data_.cold_location(key);
+    if (!location) return false;
+
+    client.waiting_on_disk = true;
+    auto value = std::make_shared<std::optional<std::string>>();
+    disk_tasks_->submit(
+        [location = *location, value] { *value = storage::ValueLog::read(location); },
+        [this, fd = client.fd, id = client.id, key, location = *location, value] {
+            finish_cold_read(fd, id, key, location, std::move(*value));
+        });
+    return true;
+}
+
+void RedisServer::finish_cold_read(int fd, uint64_t client_id, const std::string& key,
+                                   const storage::ValueLog::Location& location,
+                                   std::optional<std::string> value) {
+    if (value) {
+        // Fails harmlessly if the key changed meanwhile; the command then re-runs on fresh state
+        data_.promote(key, location, std::move(*value));
+    }
+
+    ClientState* found = clients_.find(fd);
+    if (!found || found->id != client_id) {
+        return;  // Client went away while the read was in flight
+    }
+
+    ClientState& client = *found;
+    client.waiting_on_disk = false;
+    if (!value) {
+        std::cerr << "Failed to read value for key '" << key << "' from value log" << std::endl;
+        client.write_buffer += "-ERR failed to read value from disk\r\n";
+        client.pending_commands.erase(client.pending_commands.begin());
+    }
+    execute_pending_commands(client);
+    update_client_lists(client);
+}
+
+void RedisServer::tiering_cron() {
+    if (!disk_tasks_) return;
+
+    // maxmemory can change at runtime; 0 means no limit, so nothing to spill
+    size_t max_hot_memory = config_->snapshot().maxmemory;
+    if (max_hot_memory > 0) {
+        data_.set_max_hot_memory(max_hot_memory);
+        data_.evict_cold_values(kMaxEvictionsPerTick);
+    }
+
+    if (auto job = data_.prepare_compaction()) {
+        std::cout << "Value log compaction started (" << job->records.size() << " live values)"
+                  << std::endl;
+        disk_tasks_->submit([job] { job->run(); },
+                            [this, job] {
+                                data_.finish_compaction(*job);
+                                std::cout << "Value log compaction "
+                                          << (job->ok ? "finished" : "failed") << std::endl;
+                            });
+    }
+}
+
+void RedisServer::run() {
+    // Clients register on accept; every other fd is told apart by its user data
+    poller_.add(server_fd_, Poller::READABLE, &server_fd_);
+    poller_.add(signal_events_->fd(), Poller::READABLE, signal_events_.get());
+    if (disk_tasks_) {
+        poller_.add(disk_tasks_->completion_fd(), Poller::READABLE, disk_tasks_.get());
+    }
+    if (loading_.tasks) {
+        poller_.add(loading_.tasks->completion_fd(), Poller::READABLE, loading_.tasks.get());
+    }
+    if (upgrade_listen_fd_ >= 0) {
+        poller_.add(upgrade_listen_fd_, Poller::READABLE, &upgrade_listen_fd_);
+    }
+    if (aof_fsync_tasks_) {
+        poller_.add(aof_fsync_tasks_->completion_fd(), Poller::READABLE, aof_fsync_tasks_.get());
+    }
+    poller_.add(checkpoint_tasks_->completion_fd(), Poller::READABLE, checkpoint_tasks_.get());
+
+    std::vector<Poller::Event> events;
+    std::vector<ClientState*> ready_clients;
+    while (g_running) {
+        // Nothing from the last iteration still holds a Settings reference, on this thread or
+        // the I/O threads, so the versions CONFIG SET replaced can go
+        config_->reclaim();
+
+        // Only a client on these lists can have reading switched off, or have just left them
+        // and need it back on, so it is synced before the list drops it
+        for (ClientState* client : over_budget_clients_) sync_read_interest(*client);
+        for (ClientState* client : held_clients_) sync_read_interest(*client);
+        prune(over_budget_clients_, &ClientState::on_over_budget_list,
+              [](const ClientState& client) { return client.over_budget; });
+        prune(held_clients_, &ClientState::on_held_list, [](const ClientState& client) {
+            return !client.over_budget && !client.pending_commands.empty();
+        });
+        bool backlog = !over_budget_clients_.empty();
+
+        if (poller_.wait(events, poll_timeout_ms(backlog)) < 0) {
+            std::cerr << "poll error: " << strerror(errno) << std::endl;
+            break;
+        }
+
+        // A signal interrupting the wait yields no events; g_running is checked above
+        bool signalled = false, listener = false, upgrade = false;
+        bool disk_done = false, load_done = false, fsync_done = false, checkpoint_done = false;
+        ready_clients.clear();
+        for (const Poller::Event& event : events) {
+            if (event.data == &server_fd_) {
+                listener = true;
+            } else if (event.data == signal_events_.get()) {
+                signalled = true;
+            } else if (event.data == &upgrade_listen_fd_) {
+                upgrade = true;
+            } else if (event.data == disk_tasks_.get()) {
+                disk_done = true;
+            } else if (event.data == loading_.tasks.get()) {
+                load_done = true;
+            } else if (event.data == aof_fsync_tasks_.get()) {
+                fsync_done = true;
+            } else if (event.data == checkpoint_tasks_.get()) {
+                checkpoint_done = true;
+            } else {
+                // Readable, or a hangup reported even with reading switched off
+                auto* client = static_cast<ClientState*>(event.data);
+                if (!client->over_budget) ready_clients.push_back(client);
+            }
+        }
+
+        if (signalled) {
+            handle_signals();
+            if (!g_running) break;
+        }
+
+        if (listener) {
+            accept_new_connections();
+        }
+
+        if (upgrade) {
+            accept_upgrade_connection();
+        }
+
+        unpause_if_expired();
+
+        // Finished background fsyncs, then whether held writes can go ahead
+        if (fsync_done) {
+            aof_fsync_tasks_->run_completions();
+        }
+        update_aof_backpressure();
+
+        // Fan out reads and parsing, run_batch() is the barrier before execution
+        io_threads_.run_batch(ready_clients.size(),
+                              [&](size_t i) { read_client_data(*ready_clients[i]); });
+
+        // Commands only ever touch data_ from this thread
+        for (ClientState* client : runnable_clients(ready_clients)) {
+            execute_pending_commands(*client);
+            update_client_lists(*client);
+        }
+
+        // Cold reads and compactions that finished since the last iteration
+        if (disk_done) {
+            disk_tasks_->run_completions();
+        }
+        tiering_cron();
+
+        // At most one batch of the startup load per iteration
+        if (load_done) {
+            loading_.tasks->run_completions();
+            if (!loading_.loader) {
+                poller_.remove(loading_.tasks->completion_fd());
+                loading_.tasks.reset();
+            }
+        }
+
+        // Fan out pending responses; a failed send marks the client for closing
+        auto has_output = [](const ClientState& client) { return client.has_output(); };
+        prune(output_clients_, &ClientState::on_output_list, has_output);
+        io_threads_.run_batch(output_clients_.size(),
+                              [&](size_t i) { write_client_data(*output_clients_[i]); });
+        for (ClientState* client : output_clients_) update_client_lists(*client);
+        prune(output_clients_, &ClientState::on_output_list, has_output);
+
+        // Handle disconnections, once the last replies are out or the peer stopped reading them
+        // for too long; the clients cron wakes the loop often enough to notice
+        auto now = std::chrono::steady_clock::now();
+        std::vector<ClientState*> clients_to_disconnect;
+        for (ClientState* client : closing_clients_) {
+            if (!client->has_output() || now - client->closing_since > kClosingDrainTimeout) {
+                clients_to_disconnect.push_back(client);
+            }
+        }
+        close_clients(clients_to_disconnect);
+
+        clients_cron();
+
+        // A fork-less checkpoint finished; its bookkeeping is what reaping a child does
+        if (checkpoint_done) {
+            checkpoint_tasks_->run_completions();
         }
 
         // Check if automatic save conditions are met
-        if (should_save_snapshot()) {
+        if (!child_running(ChildType::SNAPSHOT) && should_save_snapshot()) {
             background_save_internal();
-            changes_since_save = 0;
-            last_save_time_ = std::chrono::steady_clock::now();
         }
 
         // Check if AOF needs fsync (for EVERYSEC policy)
         fsync_aof_if_needed();
+
+        if (upgrade_conn_fd_ >= 0 && try_hand_off()) break;
     }
 
     // Cleanup on shutdown
-    for (auto& [client_fd, client_state] : clients_) {
-        close(client_fd);
+    for (ClientState* client : clients_) {
+        close(client->fd);
     }
     close(server_fd_);
+    if (upgrade_listen_fd_ >= 0) close(upgrade_listen_fd_);
+
+    // Drops the preallocated tail so the file ends at its last command
+    if (aof_) aof_->close();
 }
 
 bool RedisServer::should_save_snapshot() {
+    if (loading_.loader) return false;
+
     auto now = std::chrono::steady_clock::now();
     auto seconds_since_last_save =
         std::chrono::duration_cast<std::chrono::seconds>(now - last_save_time_).count();
 
+    // A failed save is retried after a short delay, not on every iteration
+    if (!snapshot_history_.last_ok &&
+        seconds_since(snapshot_history_.last_finished) < kBgsaveRetryDelaySeconds) {
+        return false;
+    }
+
     // Redis-style save conditions: "save <seconds> <changes>"
-    if (seconds_since_last_save >= 900 && changes_since_save > 1) return true;  // 15 min + 1 change
-    if (seconds_since_last_save >= 300 && changes_since_save >= 10)
-        return true;  // 5 min + 10 changes
-    if (seconds_since_last_save >= 60 && changes_since_save >= 10000)
-        return true;  // 1 min + 10k changes
+    for (const auto& point : config_->snapshot().save_points) {
+        if (seconds_since_last_save >= point.seconds && changes_since_save >= point.changes) {
+            return true;
+        }
+    }
 
     return false;
 }
 
-void RedisServer::save_snapshot_to_file() {
-    const std::string temp_file = "data/dump.json.tmp";
-    const std::string final_file = "data/dump.json";
+persistence::BackgroundWriterOptions RedisServer::background_writer_options() const {
+    const config::Settings& settings = config_->snapshot();
+    persistence::BackgroundWriterOptions options;
+    options.sync_interval = settings.background_write_sync_interval;
+    options.max_bytes_per_sec = settings.background_write_max_bandwidth;
+    options.drop_page_cache = settings.background_write_drop_cache;
+    return options;
+}
+
+bool RedisServer::save_snapshot_to_file(uint32_t epoch,
+                                        const storage::Database::PinnedKeyspace* pinned) {
+    const std::string temp_file = std::string(kSnapshotPath) + ".tmp";
+    const std::string final_file = kSnapshotPath;
 
-    std::ofstream file(temp_file);
+    persistence::SnapshotWriter file(temp_file, background_writer_options());
     if (!file.is_open()) {
         std::cerr << "Error: Could not open " << temp_file << " for writing" << std::endl;
-        return;
+        return false;
+    }
+
+    // JSON snapshot with metadata and a trailing checksum, see persistence/snapshot_format.h
+    size_t keys = pinned ? pinned->entries.size() : data_.size();
+    file.begin(keys, epoch);
+    if (pinned) {
+        for (const auto& [key, value] : pinned->entries) file.add(key, *value);
+    } else {
+        data_.for_each(
+            [&](const std::string& key, const std::string& value) { file.add(key, value); });
+    }
+    if (!file.finish()) {
+        std::cerr << "Error: Failed to write " << temp_file << std::endl;
+        std::remove(temp_file.c_str());
+        return false;
     }
 
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    auto tm = *std::gmtime(&time_t);
+    // Atomic rename ensures data integrity (even if interrupted)
+    if (std::rename(temp_file.c_str(), final_file.c_str()) != 0) {
+        std::cerr << "Error: Failed to rename " << temp_file << " to " << final_file << std::endl;
+        std::remove(temp_file.c_str());
+        return false;
+    }
 
-    // Write JSON snapshot with metadata
-    file << "{\n";
-    file << "  \"metadata\": {\n";
-    file << "    \"version\": \"1.0\",\n";
-    file << "    \"timestamp\": \"";
-    file << std::put_time(&tm, "%Y-%m-%dT%H:%M:%SZ");
-    file << "\",\n";
-    file << "    \"key_count\": " << data_.size() << "\n";
-    file << "  },\n";
-    file << "  \"data\": {\n";
+    std::cout << "Snapshot saved: " << keys << " keys written to " << final_file << std::endl;
+    return true;
+}
 
-    bool first = true;
-    for (const auto& [key, value] : data_) {
-        if (!first) file << ",\n";
-        file << "    \"" << key << "\": \"" << value << "\"";
-        first = false;
+bool RedisServer::save_delta_to_file(uint32_t base_epoch, uint32_t epoch,
+                                     const storage::Database::PinnedKeyspace* pinned) {
+    const std::string final_file = persistence::snapshot_delta_path(kSnapshotPath, epoch);
+    const std::string temp_file = final_file + ".tmp";
+
+    persistence::SnapshotWriter file(temp_file, background_writer_options());
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open " << temp_file << " for writing" << std::endl;
+        return false;
     }
 
-    file << "\n  }\n}\n";
-    file.flush();
-    file.close();
+    // Only what changed after the last checkpoint: tombstones, then the keys set since
+    std::vector<std::string> deleted;
+    size_t changed = 0;
+    if (pinned) {
+        deleted = pinned->deleted;
+        changed = pinned->entries.size();
+    } else {
+        data_.for_each_deleted_since(base_epoch,
+                                     [&](const std::string& key) { deleted.push_back(key); });
+        changed = data_.count_changed_since(base_epoch);
+    }
+    file.begin_delta(changed, base_epoch, epoch, deleted);
+    if (pinned) {
+        for (const auto& [key, value] : pinned->entries) file.add(key, *value);
+    } else {
+        data_.for_each_changed_since(
+            base_epoch,
+            [&](const std::string& key, const std::string& value) { file.add(key, value); });
+    }
+    if (!file.finish()) {
+        std::cerr << "Error: Failed to write " << temp_file << std::endl;
+        std::remove(temp_file.c_str());
+        return false;
+    }
 
-    // Atomic rename ensures data integrity (even if interrupted)
     if (std::rename(temp_file.c_str(), final_file.c_str()) != 0) {
         std::cerr << "Error: Failed to rename " << temp_file << " to " << final_file << std::endl;
         std::remove(temp_file.c_str());
-        return;
+        return false;
     }
 
-    std::cout << "Snapshot saved: " << data_.size() << " keys written to " << final_file
-              << std::endl;
+    std::cout << "Incremental snapshot saved: " << changed << " changed and " << deleted.size()
+              << " deleted keys written to " << final_file << std::endl;
+    return true;
 }
 
-void RedisServer::load_snapshot_from_file() {
-    std::ifstream file("data/dump.json");
-    if (!file.is_open()) {
-        std::cout << "No existing snapshot found, starting with empty database" << std::endl;
-        return;
+void RedisServer::start_loading(std::unique_ptr<DatasetLoader> loader) {
+    loading_.loader = std::move(loader);
+    loading_.tasks = std::make_unique<TaskPool>(1);
+    loading_.started = std::chrono::steady_clock::now();
+    submit_load_batch();
+}
+
+void RedisServer::submit_load_batch() {
+    auto batch = std::make_shared<DatasetLoader::Batch>();
+    DatasetLoader* loader = loading_.loader.get();
+    loading_.tasks->submit([loader, batch] { *batch = loader->next_batch(); },
+                           [this, batch] { apply_load_batch(*batch); });
+}
+
+void RedisServer::apply_load_batch(DatasetLoader::Batch& batch) {
+    if (!batch.error.empty()) {
+        throw std::runtime_error(batch.error);
     }
 
-    std::string line;
-    bool in_data_section = false;
-    int loaded_count = 0;
+    // The worker decodes the next batch while this one is applied
+    if (!batch.last) submit_load_batch();
 
-    while (std::getline(file, line)) {
-        if (line.find("\"data\":") != std::string::npos) {
-            in_data_section = true;
-            continue;
+    for (auto& op : batch.ops) {
+        if (op.value) {
+            data_.set(op.key, *op.value);
+        } else {
+            data_.del(op.key);
         }
+        if (++loading_.ops_applied % kLoadCronInterval == 0) tiering_cron();
+    }
+    loading_.bytes_loaded = batch.bytes_done;
 
-        if (!in_data_section) continue;
+    if (batch.last) finish_loading();
+}
 
-        // End of data section
-        if (line.find("}") != std::string::npos && line.find("\"") == std::string::npos) {
-            break;
+void RedisServer::finish_loading() {
+    if (DatasetLoader* loader = loading_.loader.get()) {
+        if (loader->is_aof()) {
+            const std::string& path = loader->path();
+            if (!loader->aof_error().empty()) {
+                std::cerr << "Warning: AOF " << loader->aof_error() << ", truncating" << std::endl;
+            }
+            uint64_t replay_end = loader->aof_replay_end();
+            if (replay_end < loader->aof_data_size()) {
+                if (truncate(path.c_str(), static_cast<off_t>(replay_end)) != 0) {
+                    throw std::runtime_error("Failed to truncate " + path + ": " +
+                                             strerror(errno));
+                }
+                std::cout << "AOF truncated at offset " << replay_end << ", "
+                          << loader->aof_data_size() - replay_end << " bytes discarded"
+                          << std::endl;
+            }
+            std::cout << "AOF recovery complete: " << loading_.ops_applied
+                      << " commands replayed" << std::endl;
+        } else {
+            data_.forget_deletions_through(checkpoint_epoch_);
+            data_.set_epoch(loading_.next_epoch);
+            std::cout << "Loaded " << data_.size() << " keys from "
+                      << (loading_.keyspace_fd >= 0 ? "the previous process" : "snapshot");
+            if (deltas_since_base_ > 0) std::cout << " and " << deltas_since_base_ << " deltas";
+            std::cout << std::endl;
+        }
+        if (loading_.keyspace_fd >= 0) {
+            close(loading_.keyspace_fd);
+            loading_.keyspace_fd = -1;
         }
+        std::cout << "DB loaded from disk: " << std::fixed << std::setprecision(3)
+                  << seconds_since(loading_.started) << " seconds" << std::endl;
+        loading_.loader.reset();
+    }
 
-        // Simple JSON parsing for "key": "value" lines
-        size_t key_start = line.find("\"");
-        if (key_start == std::string::npos) continue;
+    if (aof_enabled) {
+        if (!open_aof()) {
+            std::cerr << "Warning: Could not open AOF file for writing" << std::endl;
+            aof_enabled = false;
+        } else {
+            std::cout << "AOF logging enabled" << std::endl;
+        }
+    }
+}
 
-        size_t key_end = line.find("\"", key_start + 1);
-        if (key_end == std::string::npos) continue;
+std::string RedisServer::loading_reply(const redis_utils::CommandParts& parts) const {
+    const std::string& command = parts.command;
+    if (command == "INFO" || command == "CONFIG" || command == "CLIENT" || command == "QUIT") {
+        return "";
+    }
+    // A hit returns the value loaded so far; a miss is an error, not a nil, as the key may follow
+    if (config_->snapshot().loading_serve_reads && (command == "GET" || command == "EXISTS")) {
+        if (parts.key.empty() || data_.exists(parts.key)) return "";
+        return "-LOADING Key not loaded yet, the dataset is still loading\r\n";
+    }
+    return "-LOADING Redis is loading the dataset in memory\r\n";
+}
 
-        size_t value_start = line.find("\"", key_end + 1);
-        if (value_start == std::string::npos) continue;
+void RedisServer::take_over(const std::string& socket_path) {
+    std::cout << "Taking over from the server on " << socket_path << " ..." << std::endl;
+    UpgradeState state = receive_upgrade_state(socket_path);
+
+    server_fd_ = state.listener_fd;
+    next_client_id_ = state.next_client_id;
+    for (auto& client : state.clients) {
+        ClientState& adopted = clients_.insert(client.fd);
+        adopted.fd = client.fd;
+        adopted.id = client.id;
+        adopted.read_buffer = std::move(client.read_buffer);
+        adopted.addr = peer_address(client.fd);
+        adopted.created = std::chrono::steady_clock::now();
+        adopted.last_interaction = adopted.created;
+        // Commands queued in the old process are carried over like ones past the budget, so
+        // they run without waiting for new input
+        parse_commands(adopted);
+        adopted.over_budget = !adopted.pending_commands.empty();
+        update_client_lists(adopted);
+        poller_.add(client.fd, Poller::READABLE, &adopted);
+    }
+    std::cout << "Took over the listener and " << clients_.size() << " clients" << std::endl;
 
-        size_t value_end = line.find("\"", value_start + 1);
-        if (value_end == std::string::npos) continue;
+    // Loaded like a snapshot with no checkpoint behind it, so the next save is a full one
+    loading_.next_epoch = data_.current_epoch();
+    loading_.keyspace_fd = state.keyspace_fd;
+    start_loading(std::make_unique<DatasetLoader>(fd_path(state.keyspace_fd),
+                                                  persistence::SnapshotChain()));
+}
+
+void RedisServer::accept_upgrade_connection() {
+    int fd = accept(upgrade_listen_fd_, nullptr, nullptr);
+    if (fd < 0) return;
+    if (upgrade_conn_fd_ >= 0 || loading_.loader) {
+        std::cerr << "Refusing hot upgrade: "
+                  << (loading_.loader ? "still loading" : "one is already pending") << std::endl;
+        close(fd);
+        return;
+    }
+    std::cout << "Hot upgrade requested, handing off at the next quiet point" << std::endl;
+    upgrade_conn_fd_ = fd;
+}
 
-        std::string key = line.substr(key_start + 1, key_end - key_start - 1);
-        std::string value = line.substr(value_start + 1, value_end - value_start - 1);
+bool RedisServer::try_hand_off() {
+    // Nothing may be left that only this process could finish. A pause is a promise the new
+    // process would not know about, so the handoff waits for it to end
+    if (!children_.empty() || checkpoint_thread_ ||
+        (disk_tasks_ && disk_tasks_->in_flight() > 0) || pause_mode_ != PauseMode::NONE) {
+        return false;
+    }
 
-        data_[key] = value;
-        loaded_count++;
+    UpgradeState state;
+    state.listener_fd = server_fd_;
+    state.next_client_id = next_client_id_;
+
+    // Replies go out first, so the new process starts with empty write buffers
+    std::vector<ClientState*> dropped;
+    for (ClientState* client : clients_) {
+        flatten_output(*client);
+        if (!client->should_disconnect &&
+            send_all(client->fd, client->write_buffer, kHandoffTimeoutMs)) {
+            // Commands held over the budget or behind AOF backpressure are parsed already
+            state.clients.push_back({client->fd, client->id,
+                                     unexecuted_input(client->pending_commands,
+                                                      client->read_buffer)});
+        } else {
+            dropped.push_back(client);
+        }
     }
+    close_clients(dropped);
 
-    file.close();
-    std::cout << "Loaded " << loaded_count << " keys from snapshot" << std::endl;
+    // The new process reopens the AOF once the keyspace is loaded
+    if (aof_) {
+        aof_->close();
+        aof_.reset();
+    }
+
+    // The keyspace goes over in the snapshot format, through memory rather than the disk
+    std::string error;
+    int keyspace_fd = create_anonymous_file("redis-clone-keyspace", "data");
+    bool ok = keyspace_fd >= 0;
+    if (!ok) error = std::string("cannot create the keyspace file: ") + strerror(errno);
+    if (ok) {
+        persistence::BackgroundWriterOptions options;
+        options.sync_interval = 0;
+        persistence::SnapshotWriter file(fd_path(keyspace_fd), options);
+        file.begin(data_.size());
+        data_.for_each(
+            [&](const std::string& key, const std::string& value) { file.add(key, value); });
+        ok = file.finish();
+        if (!ok) error = "cannot write the keyspace file";
+    }
+    if (ok) {
+        state.keyspace_fd = keyspace_fd;
+        ok = send_upgrade_state(upgrade_conn_fd_, state, kHandoffTimeoutMs, error);
+    }
+    if (keyspace_fd >= 0) close(keyspace_fd);
+    close(upgrade_conn_fd_);
+    upgrade_conn_fd_ = -1;
+
+    if (!ok) {
+        std::cerr << "Hot upgrade failed (" << error << "), still serving" << std::endl;
+        if (aof_enabled && !open_aof()) {
+            std::cerr << "Warning: Could not reopen AOF file for writing" << std::endl;
+            aof_enabled = false;
+        }
+        return false;
+    }
+
+    std::cout << "Handed " << data_.size() << " keys and " << state.clients.size()
+              << " clients to the new process, exiting" << std::endl;
+    return true;
+}
+
+pid_t RedisServer::start_checkpoint(bool allow_delta) {
+    const config::Settings& settings = config_->snapshot();
+    bool delta = allow_delta && settings.incremental_checkpoints && checkpoint_epoch_ > 0 &&
+                 deltas_since_base_ < settings.checkpoint_max_deltas;
+    uint32_t base_epoch = checkpoint_epoch_;
+    uint32_t epoch = data_.advance_epoch();
+
+    // Fork-less: pin the values here, a key copy per entry instead of a page table copy and
+    // copy-on-write, and write them from a thread. Tiered values would be read from disk
+    // right here, so tiering keeps forking
+    if (!settings.checkpoint_fork && !data_.tiering_enabled()) {
+        auto pinned = std::make_shared<storage::Database::PinnedKeyspace>(
+            delta ? data_.pin_changed_since(base_epoch) : data_.pin_all());
+        auto ok = std::make_shared<bool>(false);
+        checkpoint_thread_ = ChildProcess{ChildType::SNAPSHOT, std::chrono::steady_clock::now(),
+                                          changes_since_save, epoch, delta};
+        checkpoint_tasks_->submit(
+            [this, pinned, ok, delta, base_epoch, epoch] {
+                *ok = delta ? save_delta_to_file(base_epoch, epoch, pinned.get())
+                            : save_snapshot_to_file(epoch, pinned.get());
+            },
+            [this, ok] {
+                ChildProcess child = *checkpoint_thread_;
+                checkpoint_thread_.reset();
+                finish_child(child, *ok, *ok ? 0 : 1, "in process");
+            });
+        return 0;
+    }
+
+    pid_t pid = fork_child(ChildType::SNAPSHOT, [this, delta, base_epoch, epoch] {
+        return delta ? save_delta_to_file(base_epoch, epoch) : save_snapshot_to_file(epoch);
+    });
+    if (pid > 0) {
+        children_[pid].epoch = epoch;
+        children_[pid].delta = delta;
+    }
+    return pid;
 }
 
 std::string RedisServer::background_save() {
-    pid_t pid = fork();
+    if (child_running(ChildType::SNAPSHOT)) {
+        return "-ERR Background save already in progress\r\n";
+    }
 
-    if (pid == 0) {
-        // Child process: save and exit
-        save_snapshot_to_file();
-        exit(0);
-    } else if (pid > 0) {
-        // Parent process: continue serving
-        std::cout << "Background save started (PID: " << pid << ")" << std::endl;
-        return "+Background saving started\r\n";
-    } else {
+    // Always a full base, so BGSAVE leaves a single self-contained file
+    pid_t pid = start_checkpoint(false);
+    if (pid < 0) {
         return "-ERR Background save failed\r\n";
     }
+    std::cout << "Background save started ("
+              << (pid > 0 ? "PID: " + std::to_string(pid) : "in process") << ")" << std::endl;
+    return "+Background saving started\r\n";
 }
 
 void RedisServer::background_save_internal() {
+    pid_t pid = start_checkpoint(true);
+    if (pid >= 0) {
+        std::cout << "Automatic background save started ("
+                  << (pid > 0 ? "PID: " + std::to_string(pid) : "in process") << ")"
+                  << std::endl;
+    } else {
+        // Fork failed: log error but don't crash server
+        std::cerr << "Failed to fork for automatic save: " << strerror(errno) << std::endl;
+    }
+}
+
+pid_t RedisServer::fork_child(ChildType type, const std::function<bool()>& work) {
     pid_t pid = fork();
 
     if (pid == 0) {
-        // Child process: save and exit
-        save_snapshot_to_file();
-        exit(0);
-    } else if (pid > 0) {
-        // Parent process: log and continue
-        std::cout << "Automatic background save started (PID: " << pid << ")" << std::endl;
+        // Child: default signal behaviour, do the work, skip the parent's atexit state
+        signal_events_->release_in_child();
+        bool ok = work();
+        std::cout.flush();
+        _exit(ok ? 0 : 1);
+    }
+
+    if (pid > 0) {
+        children_[pid] = {type, std::chrono::steady_clock::now(), changes_since_save};
+    }
+    return pid;
+}
+
+bool RedisServer::child_running(ChildType type) const {
+    if (type == ChildType::SNAPSHOT && checkpoint_thread_) return true;
+    for (const auto& [pid, child] : children_) {
+        if (child.type == type) return true;
+    }
+    return false;
+}
+
+void RedisServer::reap_children() {
+    int status;
+    pid_t pid;
+
+    // Reap all finished child processes (non-blocking)
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        auto it = children_.find(pid);
+        if (it == children_.end()) continue;
+
+        ChildProcess child = it->second;
+        children_.erase(it);
+
+        bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        int exit_status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+        finish_child(child, ok, exit_status, "PID: " + std::to_string(pid));
+    }
+}
+
+void RedisServer::finish_child(const ChildProcess& child, bool ok, int exit_status,
+                               const std::string& source) {
+    ChildHistory& history =
+        child.type == ChildType::SNAPSHOT ? snapshot_history_ : rewrite_history_;
+    history.last_ok = ok;
+    history.last_exit_status = exit_status;
+    history.last_duration_sec = seconds_since(child.started);
+    history.last_finished = std::chrono::steady_clock::now();
+
+    const char* what =
+        child.type == ChildType::SNAPSHOT ? "Background save" : "Background AOF rewrite";
+    std::cout << what << (ok ? " completed" : " failed") << " (" << source
+              << ", status: " << history.last_exit_status << ", " << std::fixed
+              << std::setprecision(3) << history.last_duration_sec << "s)" << std::endl;
+
+    if (!ok) return;
+
+    if (child.type == ChildType::SNAPSHOT) {
+        // Writes that arrived while the child was saving still count
+        changes_since_save = std::max(0, changes_since_save - child.changes_at_start);
+        last_save_time_ = history.last_finished;
+
+        checkpoint_epoch_ = child.epoch;
+        data_.forget_deletions_through(child.epoch);
+        if (child.delta) {
+            ++deltas_since_base_;
+        } else {
+            // Deltas on top of the previous base are stale now
+            deltas_since_base_ = 0;
+            for (const auto& path : persistence::find_snapshot_chain(kSnapshotPath).stale) {
+                std::remove(path.c_str());
+            }
+        }
     } else {
-        // Fork failed: log error but don't crash server
-        std::cerr << "Failed to fork for automatic save: " << strerror(errno) << std::endl;
+        reopen_aof_after_rewrite();
     }
 }
 
-void RedisServer::append_to_aof(const std::string& command) {
-    if (!aof_enabled || !aof_file_.is_open()) {
+void RedisServer::handle_signals() {
+    for (int signal : signal_events_->read_pending()) {
+        if (signal == SIGCHLD) {
+            reap_children();
+        } else if (signal == SIGINT || signal == SIGTERM) {
+            std::cout << "\nShutting down gracefully..." << std::endl;
+            g_running = 0;
+        }
+    }
+}
+
+void RedisServer::append_to_aof(const redis_utils::CommandParts& parts) {
+    if (!aof_enabled || !aof_) {
         return;
     }
 
-    // Write command to AOF file with newline
-    aof_file_ << command << std::endl;
+    const config::Settings& settings = config_->snapshot();
+    std::string record;
+
+    // Mark the first command of each second so replay can stop at a point in time
+    if (settings.aof_timestamp_enabled) {
+        int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+                          std::chrono::system_clock::now().time_since_epoch())
+                          .count();
+        if (now > aof_last_timestamp_) {
+            record = persistence::encode_aof_timestamp(now);
+            aof_last_timestamp_ = now;
+        }
+    }
+
+    std::vector<std::string> tokens;
+    tokens.reserve(parts.args.size() + 1);
+    tokens.push_back(parts.command);
+    tokens.insert(tokens.end(), parts.args.begin(), parts.args.end());
+    record += persistence::encode_aof_command(tokens);
+
+    if (!aof_->append(record)) {
+        std::cerr << "Error: AOF write failed: " << strerror(errno) << std::endl;
+    }
 
     // Handle fsync policy
-    if (fsync_policy_ == FsyncPolicy::ALWAYS) {
-        aof_file_.flush();  // Force write to OS buffer
-        // Note: For cross-platform fsync, we'll handle this in fsync_aof_if_needed()
+    if (settings.appendfsync == config::AppendFsync::ALWAYS) {
+        aof_->sync();  // Nothing left to do in dsync/direct mode
+        aof_synced_size_ = aof_->size();
+    }
+
+    // Hold the next write right away; releasing happens in the loop
+    if (!aof_backpressure_ && aof_falling_behind()) {
+        update_aof_backpressure();
     }
 
     // Check if AOF needs auto-rewriting (every 100 commands to avoid excessive checking)
@@ -436,108 +1773,165 @@ void RedisServer::append_to_aof(const std::string& command) {
 }
 
 void RedisServer::fsync_aof_if_needed() {
-    if (!aof_enabled || !aof_file_.is_open()) {
+    if (!aof_enabled || !aof_ || aof_fsync_in_flight_) {
         return;
     }
 
+    // AppendFsync::NO means we never explicitly fsync - let OS decide
+    const config::Settings& settings = config_->snapshot();
+    if (settings.appendfsync != config::AppendFsync::EVERYSEC) return;
+
+    // Every second, or sooner once enough is unsynced to hold writes back
     auto now = std::chrono::steady_clock::now();
     auto seconds_since_fsync =
         std::chrono::duration_cast<std::chrono::seconds>(now - last_fsync_time_).count();
-
-    if (fsync_policy_ == FsyncPolicy::EVERYSEC && seconds_since_fsync >= 1) {
-        aof_file_.flush();  // Force to OS buffer
-        last_fsync_time_ = now;
-        std::cout << "AOF fsync performed" << std::endl;
-    }
-    // FsyncPolicy::NO means we never explicitly fsync - let OS decide
-}
-
-void RedisServer::load_aof_from_file() {
-    std::ifstream aof_file("data/appendonly.aof");
-    if (!aof_file.is_open()) {
-        std::cout << "No existing AOF file found" << std::endl;
+    uint64_t unsynced = aof_unsynced_bytes();
+    bool over_limit =
+        settings.aof_max_unsynced_bytes > 0 && unsynced > settings.aof_max_unsynced_bytes;
+    if (seconds_since_fsync < 1 && !over_limit) return;
+    last_fsync_time_ = now;
+    if (unsynced == 0) return;
+
+    // On the fsync thread, so a slow disk stalls neither reads nor the loop
+    uint64_t target = aof_->size();
+    int fd = aof_->dup_for_sync();
+    if (fd < 0) {
+        aof_synced_size_ = target;  // dsync/direct: appends are durable already
         return;
     }
+    aof_fsync_in_flight_ = true;
+    aof_fsync_started_ = now;
+    auto ok = std::make_shared<bool>(false);
+    aof_fsync_tasks_->submit(
+        [fd, ok] { *ok = persistence::AofWriter::sync_fd(fd); },
+        [this, ok, target, generation = aof_generation_] {
+            aof_fsync_in_flight_ = false;
+            aof_last_fsync_ms_ = std::chrono::duration<double, std::milli>(
+                                     std::chrono::steady_clock::now() - aof_fsync_started_)
+                                     .count();
+            if (!*ok) {
+                std::cerr << "Error: AOF fsync failed" << std::endl;
+            } else if (generation == aof_generation_) {
+                aof_synced_size_ = std::max(aof_synced_size_, target);
+                std::cout << "AOF fsync performed" << std::endl;
+            }
+        });
+}
 
-    std::string command_line;
-    int commands_replayed = 0;
+uint64_t RedisServer::aof_unsynced_bytes() const {
+    if (!aof_) return 0;
+    uint64_t size = aof_->size();
+    return size > aof_synced_size_ ? size - aof_synced_size_ : 0;
+}
 
-    std::cout << "Loading AOF file ..." << std::endl;
+bool RedisServer::aof_falling_behind() const {
+    const config::Settings& settings = config_->snapshot();
+    if (!aof_ || settings.appendfsync != config::AppendFsync::EVERYSEC) return false;
 
-    while (std::getline(aof_file, command_line)) {
-        if (!command_line.empty()) {
-            // Execute the command to rebuild database state
-            redis_utils::CommandParts parts = redis_utils::extract_command(command_line);
-            redis_utils::process_command_with_store(parts, data_);
-            commands_replayed++;
-        }
+    if (settings.aof_max_unsynced_bytes > 0 &&
+        aof_unsynced_bytes() > settings.aof_max_unsynced_bytes) {
+        return true;
     }
+    return settings.aof_max_fsync_lag_ms > 0 && aof_fsync_in_flight_ &&
+           std::chrono::steady_clock::now() - aof_fsync_started_ >
+               std::chrono::milliseconds(settings.aof_max_fsync_lag_ms);
+}
 
-    aof_file.close();
-    std::cout << "AOF recovery complete: " << commands_replayed << " commands replayed"
-              << std::endl;
+void RedisServer::update_aof_backpressure() {
+    bool behind = aof_falling_behind();
+    if (behind == aof_backpressure_) return;
+
+    aof_backpressure_ = behind;
+    if (behind) {
+        ++aof_backpressure_events_;
+        std::cerr << "AOF fsync is falling behind (" << aof_unsynced_bytes()
+                  << " bytes unsynced), holding writes" << std::endl;
+    } else {
+        std::cout << "AOF fsync caught up, releasing writes" << std::endl;
+        resume_held_clients();
+    }
 }
 
 std::string RedisServer::background_rewrite_aof() {
-    pid_t pid = fork();
+    if (child_running(ChildType::AOF_REWRITE)) {
+        return "-ERR Background append only file rewriting already in progress\r\n";
+    }
 
-    if (pid == 0) {
-        // Child process: rewrite AOF and exit
-        rewrite_aof_internal();
-        exit(0);
-    } else if (pid > 0) {
-        // Parent process: continue serving
-        aof_rewrite_pid_ = pid;  // Store PID for tracking
-        std::cout << "Background AOF rewrite started (PID: " << pid << ")" << std::endl;
-        return "+Background AOF rewrite started\r\n";
-    } else {
+    pid_t pid = fork_child(ChildType::AOF_REWRITE, [this] { return rewrite_aof_internal(); });
+    if (pid < 0) {
         return "-ERR Background AOF rewrite failed\r\n";
     }
+    std::cout << "Background AOF rewrite started (PID: " << pid << ")" << std::endl;
+    return "+Background AOF rewrite started\r\n";
 }
 
-void RedisServer::rewrite_aof_internal() {
+bool RedisServer::rewrite_aof_internal() {
     const std::string temp_aof = "data/appendonly.aof.tmp";
     const std::string final_aof = "data/appendonly.aof";
 
-    std::ofstream new_aof(temp_aof);
+    persistence::BackgroundWriter new_aof(temp_aof, background_writer_options());
     if (!new_aof.is_open()) {
         std::cerr << "Error: Could not open " << temp_aof << " for writing" << std::endl;
-        return;
+        return false;
     }
 
     // Generate minimal command set from current database state
-    for (const auto& [key, value] : data_) {
-        new_aof << "SET " << key << " " << value << std::endl;
-    }
+    data_.for_each([&](const std::string& key, const std::string& value) {
+        new_aof << persistence::encode_aof_command({"SET", key, value});
+    });
 
-    new_aof.flush();
-    new_aof.close();
+    if (!new_aof.finish()) {
+        std::cerr << "Error: Failed to write " << temp_aof << std::endl;
+        std::remove(temp_aof.c_str());
+        return false;
+    }
 
     // Atomic replace of old AOF with new compact AOF
     if (std::rename(temp_aof.c_str(), final_aof.c_str()) != 0) {
         std::cerr << "Error: Failed to rename " << temp_aof << " to " << final_aof << std::endl;
         std::remove(temp_aof.c_str());
-        return;
+        return false;
     }
 
     std::cout << "AOF rewrite completed: " << data_.size() << " keys written to new AOF"
               << std::endl;
+    return true;
 }
 
-// Get current AOF file size
+// Get current AOF size, not counting preallocated space
 size_t RedisServer::get_aof_file_size() {
-    std::ifstream file("data/appendonly.aof", std::ios::ate | std::ios::binary);
-    return file.tellg();
+    return aof_ ? aof_->size() : persistence::AofWriter::logical_size("data/appendonly.aof");
+}
+
+bool RedisServer::open_aof() {
+    const config::Settings& settings = config_->snapshot();
+    persistence::AofWriterOptions options;
+    options.mode = settings.aof_write_mode;
+    options.preallocate_size = settings.aof_preallocate_size;
+
+    aof_ = std::make_unique<persistence::AofWriter>("data/appendonly.aof", options);
+    aof_last_timestamp_ = 0;  // A fresh file starts with a marker
+    ++aof_generation_;
+    aof_synced_size_ = aof_->size();  // Whatever is on disk already is not ours to sync
+    if (!aof_->is_open()) {
+        aof_.reset();
+        return false;
+    }
+    if (aof_->mode() != options.mode) {
+        std::cerr << "Warning: O_DIRECT not supported for the AOF, using O_DSYNC" << std::endl;
+    }
+    return true;
 }
 
 // Check if AOF should be rewritten based on size thresholds
 bool RedisServer::should_auto_rewrite_aof() {
-    if (!aof_enabled) return false;
+    if (!aof_enabled || child_running(ChildType::AOF_REWRITE)) return false;
 
+    const config::Settings& settings = config_->snapshot();
     size_t current_size = get_aof_file_size();
 
     // Don't rewrite if file is smaller than minimum size
-    if (current_size < aof_auto_rewrite_min_size_) {
+    if (current_size < settings.auto_aof_rewrite_min_size) {
         return false;
     }
 
@@ -549,15 +1943,8 @@ bool RedisServer::should_auto_rewrite_aof() {
     }
 
     size_t size_increase = ((current_size - aof_last_rewrite_size_) * 100) / aof_last_rewrite_size_;
-    return size_increase >= aof_auto_rewrite_percentage_;
-}
-
-// Handle completion of AOF rewrite process
-void RedisServer::handle_aof_rewrite_completion(pid_t pid) {
-    if (aof_rewrite_pid_ == pid) {
-        reopen_aof_after_rewrite();
-        aof_rewrite_pid_ = -1;  // Reset
-    }
+    return settings.auto_aof_rewrite_percentage > 0 &&
+           size_increase >= settings.auto_aof_rewrite_percentage;
 }
 
 // Reopen AOF file after background rewrite
@@ -565,13 +1952,12 @@ void RedisServer::reopen_aof_after_rewrite() {
     if (!aof_enabled) return;
 
     // Close old file handle
-    if (aof_file_.is_open()) {
-        aof_file_.close();
+    if (aof_) {
+        aof_->close();
     }
 
     // Reopen AOF file (now points to rewritten file)
-    aof_file_.open("data/appendonly.aof", std::ios::app);
-    if (!aof_file_.is_open()) {
+    if (!open_aof()) {
         std::cerr << "Error: Could not reopen AOF file after rewrite" << std::endl;
         aof_enabled = false;  // Disable AOF if we can't reopen
     } else {
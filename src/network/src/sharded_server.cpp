@@ -0,0 +1,1097 @@
+#include "network/sharded_server.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+#include "storage/key_hash.h"
+
+extern volatile sig_atomic_t g_running;
+
+namespace redis_clone {
+namespace network {
+
+namespace {
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+// Block signals for shard threads (main thread handles them)
+void block_shutdown_signals() {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+}
+
+void pin_to_core(std::thread& thread, size_t core) {
+#ifdef __linux__
+    unsigned cores = std::thread::hardware_concurrency();
+    if (cores == 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core % cores, &set);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+    (void)thread;
+    (void)core;
+#endif
+}
+
+bool is_scan(const std::string& command) {
+    return command == "SCANPREFIX" || command == "SCANRANGE";
+}
+
+// Commands that only touch the shard owning their one key
+bool is_single_key(const redis_utils::CommandParts& parts) {
+    if (parts.args.empty()) return false;
+    if (parts.command == "GET" || parts.command == "SET") return true;
+    return (parts.command == "DEL" || parts.command == "EXISTS") && parts.args.size() == 1;
+}
+
+// Commands the connection's shard has to gather from every shard
+bool is_gather(const redis_utils::CommandParts& parts) {
+    return parts.command == "DBSIZE" || is_scan(parts.command);
+}
+
+// Commands that can turn into a transaction (after a check of their arguments)
+bool may_span_shards(const redis_utils::CommandParts& parts) {
+    const std::string& command = parts.command;
+    return command == "MSET" || command == "RENAME" || command == "COPY" || command == "EXEC" ||
+           ((command == "DEL" || command == "EXISTS") && parts.args.size() > 1);
+}
+
+// Keys a command reads or writes, for intent locks
+std::vector<std::string> command_keys(const redis_utils::CommandParts& parts) {
+    const std::string& command = parts.command;
+    if (command == "GET" || command == "SET") {
+        if (parts.args.empty()) return {};
+        return {parts.key};
+    }
+    if (command == "DEL" || command == "EXISTS") return parts.args;
+    if (command == "RENAME" && parts.args.size() == 2) return parts.args;
+    if (command == "COPY" && parts.args.size() >= 2) return {parts.args[0], parts.args[1]};
+    std::vector<std::string> keys;
+    if (command == "MSET") {
+        for (size_t i = 0; i + 1 < parts.args.size(); i += 2) keys.push_back(parts.args[i]);
+    }
+    return keys;
+}
+
+redis_utils::CommandParts make_command(std::string command, std::vector<std::string> args) {
+    redis_utils::CommandParts parts;
+    parts.command = std::move(command);
+    if (!args.empty()) parts.key = args[0];
+    if (args.size() > 1) parts.value = args[1];
+    parts.args = std::move(args);
+    return parts;
+}
+
+// The value in a GET reply; false for nil
+bool bulk_value(const std::string& reply, std::string& value) {
+    if (reply.empty() || reply[0] != '$' || reply.compare(0, 3, "$-1") == 0) return false;
+    size_t header = reply.find("\r\n");
+    value = reply.substr(header + 2, std::stoul(reply.substr(1, header - 1)));
+    return true;
+}
+
+std::string transaction_reply(const std::string& command, const std::vector<std::string>& replies) {
+    if (command == "DEL" || command == "EXISTS") {
+        // One count per shard involved
+        long long count = 0;
+        for (const auto& item : replies) {
+            if (!item.empty()) count += std::stoll(item.substr(1));
+        }
+        return redis_utils::integer_reply(count);
+    }
+    if (command != "EXEC") return replies.front();
+    std::string reply = "*" + std::to_string(replies.size()) + "\r\n";
+    for (const auto& item : replies) reply += item;
+    return reply;
+}
+
+}  // namespace
+
+ShardedRedisServer::ShardedRedisServer(int port, size_t shards, bool ordered_index) : port_(port) {
+    if (shards == 0) shards = 1;
+    for (size_t i = 0; i < shards; ++i) {
+        auto shard = std::make_unique<Shard>();
+        shard->id = i;
+        if (pipe(shard->wake_pipe) < 0) {
+            throw std::runtime_error("Failed to create shard wake pipe: " +
+                                     std::string(strerror(errno)));
+        }
+        for (int fd : shard->wake_pipe) {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+        // A null user pointer marks the wake pipe
+        shard->poller.add(shard->wake_pipe[0], Poller::READABLE, nullptr);
+
+        for (size_t from = 0; from <= shards; ++from) {
+            shard->inbox.push_back(std::make_unique<SpscQueue<ShardMessage>>(kQueueCapacity));
+        }
+        shard->outbox.resize(shards);
+        if (ordered_index) shard->db.enable_ordered_index();
+        shards_.push_back(std::move(shard));
+    }
+    initialize_server();
+}
+
+ShardedRedisServer::~ShardedRedisServer() {
+    stopping_ = true;
+    for (auto& shard : shards_) {
+        wake(*shard);
+        if (shard->thread.joinable()) shard->thread.join();
+    }
+    for (auto& shard : shards_) {
+        for (Connection* connection : shard->connections) close(connection->fd);
+        // Connections dealt out but never picked up
+        ShardMessage message;
+        while (shard->inbox.back()->try_pop(message)) close(message.fd);
+        close(shard->wake_pipe[0]);
+        close(shard->wake_pipe[1]);
+    }
+    if (server_fd_ >= 0) close(server_fd_);
+}
+
+void ShardedRedisServer::initialize_server() {
+    server_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (server_fd_ < 0) {
+        throw std::runtime_error("Failed to create socket: " + std::string(strerror(errno)));
+    }
+
+    int opt = 1;
+    if (setsockopt(server_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+        close(server_fd_);
+        throw std::runtime_error("Failed to set socket options: " + std::string(strerror(errno)));
+    }
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(port_);
+
+    if (bind(server_fd_, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0) {
+        close(server_fd_);
+        throw std::runtime_error("Failed to bind to port " + std::to_string(port_) + ": " +
+                                 std::string(strerror(errno)));
+    }
+
+    if (listen(server_fd_, SOMAXCONN) < 0) {
+        close(server_fd_);
+        throw std::runtime_error("Failed to listen: " + std::string(strerror(errno)));
+    }
+}
+
+void ShardedRedisServer::run() {
+    for (auto& shard : shards_) {
+        Shard* owned = shard.get();
+        shard->thread = std::thread([this, owned] {
+            block_shutdown_signals();
+            run_shard(*owned);
+        });
+        pin_to_core(shard->thread, shard->id);
+    }
+
+    size_t next_shard = 0;
+    while (g_running) {
+        int client_fd = accept(server_fd_, nullptr, nullptr);
+        if (client_fd < 0) {
+            if (errno != EINTR) {
+                std::cerr << "Failed to accept connection: " << strerror(errno) << std::endl;
+            }
+            continue;
+        }
+        fcntl(client_fd, F_SETFL, fcntl(client_fd, F_GETFL, 0) | O_NONBLOCK);
+
+        // The acceptor is the only producer on the last inbox of every shard
+        Shard& shard = *shards_[next_shard++ % shards_.size()];
+        ShardMessage message;
+        message.kind = ShardMessage::Kind::ACCEPT;
+        message.fd = client_fd;
+        while (!shard.inbox.back()->try_push(std::move(message))) {
+            std::this_thread::yield();
+        }
+        wake(shard);
+    }
+
+    std::cout << "Sharded server shutting down..." << std::endl;
+    stopping_ = true;
+    for (auto& shard : shards_) {
+        wake(*shard);
+    }
+    for (auto& shard : shards_) {
+        shard->thread.join();
+    }
+    close(server_fd_);
+    server_fd_ = -1;
+}
+
+void ShardedRedisServer::run_shard(Shard& shard) {
+    std::vector<Poller::Event> events;
+
+    while (!stopping_) {
+        // Messages still waiting for queue room are retried shortly, nobody wakes us for them
+        bool backlog = std::any_of(shard.outbox.begin(), shard.outbox.end(),
+                                   [](const auto& pending) { return !pending.empty(); });
+        int timeout_ms = !shard.dirty.empty() ? 0 : backlog ? 1 : -1;
+        if (shard.poller.wait(events, timeout_ms) < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("Shard poll failed: " + std::string(strerror(errno)));
+        }
+
+        for (const auto& event : events) {
+            if (event.data == nullptr) {
+                char drain[64];
+                while (read(shard.wake_pipe[0], drain, sizeof(drain)) > 0) {
+                }
+                // Cleared before the queues are drained, so a later push wakes us again
+                shard.wake_pending = false;
+                continue;
+            }
+
+            Connection& connection = *static_cast<Connection*>(event.data);
+            if (event.readable || event.hangup) read_connection(shard, connection);
+            if (event.writable) mark_dirty(shard, connection);
+        }
+
+        drain_inboxes(shard);
+
+        std::vector<Connection*> dirty;
+        dirty.swap(shard.dirty);
+        for (Connection* connection : dirty) {
+            connection->dirty = false;
+            finish_connection(shard, *connection);
+        }
+
+        flush_outboxes(shard);
+    }
+}
+
+void ShardedRedisServer::wake(Shard& shard) {
+    // One byte per batch of messages: the shard clears the flag before draining its queues
+    if (!shard.wake_pending.exchange(true)) {
+        char byte = 0;
+        (void)write(shard.wake_pipe[1], &byte, 1);
+    }
+}
+
+void ShardedRedisServer::accept_connection(Shard& shard, int fd) {
+    // Replies go out in pieces as owners answer; Nagle would hold each piece for an ACK
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    Connection& connection = shard.connections.insert(fd);
+    connection.fd = fd;
+    connection.id = shard.next_client_id++;
+    shard.poller.add(fd, Poller::READABLE, &connection);
+}
+
+void ShardedRedisServer::read_connection(Shard& shard, Connection& connection) {
+    char buffer[16 * 1024];
+    ssize_t bytes_read = recv(connection.fd, buffer, sizeof(buffer), 0);
+    if (bytes_read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return;
+    }
+
+    if (bytes_read <= 0) {
+        connection.closed = true;
+    } else {
+        connection.read_buffer.append(buffer, bytes_read);
+        parse_commands(shard, connection);
+    }
+    mark_dirty(shard, connection);
+}
+
+void ShardedRedisServer::parse_commands(Shard& shard, Connection& connection) {
+    // Past kMaxInFlight unanswered commands the rest waits in the buffer, unread. So does
+    // everything after a cross-shard transaction, until it completes
+    size_t pos = 0;
+    redis_utils::CommandParts parts;
+    std::string error;
+    connection.stalled = false;
+    connection.barrier = false;
+    while (!connection.quit) {
+        if (connection.replies.size() == kMaxInFlight || connection.transaction != 0) {
+            connection.stalled = true;
+            break;
+        }
+        size_t start = pos;
+        redis_utils::ParseStatus status =
+            redis_utils::parse_command(connection.read_buffer, pos, parts, error);
+        if (status == redis_utils::ParseStatus::OK) {
+            if (!may_span_shards(parts)) {
+                dispatch(shard, connection, std::move(parts));
+                continue;
+            }
+            Transaction tx;
+            if (!plan_transaction(shard, connection, parts, tx)) {
+                dispatch(shard, connection, std::move(parts));
+                continue;
+            }
+            // Spanning shards, it also waits for this connection's earlier commands: one still
+            // blocked on some shard could otherwise run after it there
+            bool answered = std::all_of(connection.replies.begin(), connection.replies.end(),
+                                        [](const PendingReply& slot) { return slot.ready; });
+            if (tx.participants.size() > 1 && !answered) {
+                pos = start;
+                connection.stalled = true;
+                connection.barrier = true;
+                break;
+            }
+            start_transaction(shard, connection, std::move(tx));
+            continue;
+        }
+        if (status == redis_utils::ParseStatus::ERROR) {
+            // Protocol errors are fatal for the connection, like in Redis
+            PendingReply slot;
+            slot.ready = true;
+            slot.reply = "-ERR " + error + "\r\n";
+            connection.replies.push_back(std::move(slot));
+            connection.quit = true;
+        }
+        break;
+    }
+    connection.read_buffer.erase(0, pos);
+}
+
+void ShardedRedisServer::finish_connection(Shard& shard, Connection& connection) {
+    // Answered commands leave in order; one still out on another shard holds back the rest
+    while (!connection.replies.empty() && connection.replies.front().ready) {
+        connection.write_buffer += connection.replies.front().reply;
+        connection.replies.pop_front();
+        ++connection.first_seq;
+    }
+
+    if (!connection.closed && !connection.write_buffer.empty()) {
+        ssize_t sent = ::send(connection.fd, connection.write_buffer.data(),
+                              connection.write_buffer.size(), kSendFlags);
+        if (sent > 0) {
+            connection.write_buffer.erase(0, sent);
+        } else if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            connection.closed = true;
+        }
+    }
+
+    if (connection.closed || (connection.quit && connection.replies.empty() &&
+                              connection.write_buffer.empty())) {
+        close_connection(shard, connection);
+        return;
+    }
+
+    // Commands left in the buffer go on once there is room, the connection's transaction is
+    // done, or every reply a waiting transaction has to follow is out
+    bool can_parse = connection.replies.size() < kMaxInFlight && connection.transaction == 0 &&
+                     (!connection.barrier || connection.replies.empty());
+    if (connection.stalled && can_parse) {
+        parse_commands(shard, connection);
+        mark_dirty(shard, connection);
+    }
+    bool can_read = !connection.quit && !connection.stalled;
+
+    uint32_t interest = (can_read ? Poller::READABLE : 0u) |
+                        (connection.write_buffer.empty() ? 0u : Poller::WRITABLE);
+    if (interest != connection.interest) {
+        shard.poller.modify(connection.fd, interest, &connection);
+        connection.interest = interest;
+    }
+}
+
+void ShardedRedisServer::close_connection(Shard& shard, Connection& connection) {
+    // Replies still on their way find no connection with this id and are dropped
+    int fd = connection.fd;
+    shard.poller.remove(fd);
+    close(fd);
+    shard.connections.erase(fd);
+}
+
+void ShardedRedisServer::mark_dirty(Shard& shard, Connection& connection) {
+    if (connection.dirty) return;
+    connection.dirty = true;
+    shard.dirty.push_back(&connection);
+}
+
+void ShardedRedisServer::dispatch(Shard& shard, Connection& connection,
+                                  redis_utils::CommandParts&& parts) {
+    uint64_t seq = connection.first_seq + connection.replies.size();
+    connection.replies.emplace_back();
+    PendingReply& slot = connection.replies.back();
+
+    if (parts.command == "QUIT") {
+        slot.ready = true;
+        slot.reply = "+OK\r\n";
+        connection.quit = true;
+        return;
+    }
+    if (connection.in_multi && parts.command != "EXEC" && parts.command != "DISCARD" &&
+        parts.command != "MULTI") {
+        slot.ready = true;
+        slot.reply = queue_in_multi(connection, std::move(parts));
+        return;
+    }
+    if (parts.command == "MULTI") {
+        slot.ready = true;
+        if (connection.in_multi) {
+            slot.reply = "-ERR MULTI calls can not be nested\r\n";
+            return;
+        }
+        connection.in_multi = true;
+        connection.multi_error = false;
+        slot.reply = "+OK\r\n";
+        return;
+    }
+    if (parts.command == "EXEC" || parts.command == "DISCARD") {
+        // EXEC of a MULTI without errors never gets here: it is a transaction
+        slot.ready = true;
+        if (!connection.in_multi) {
+            slot.reply = "-ERR " + parts.command + " without MULTI\r\n";
+            return;
+        }
+        connection.in_multi = false;
+        connection.queued.clear();
+        slot.reply = parts.command == "DISCARD"
+                         ? "+OK\r\n"
+                         : "-EXECABORT Transaction discarded because of previous errors.\r\n";
+        return;
+    }
+    if (is_gather(parts)) {
+        start_gather(shard, connection, seq, std::move(parts));
+        return;
+    }
+
+    // The fast path: a key on this shard that no transaction holds
+    size_t owner = is_single_key(parts) ? storage::key_shard(parts.key, shards_.size()) : shard.id;
+    if (owner == shard.id && keys_free(shard, parts)) {
+        slot.ready = true;
+        slot.reply = execute(shard, parts);
+        return;
+    }
+
+    ShardMessage message;
+    message.kind = ShardMessage::Kind::COMMAND;
+    message.from = shard.id;
+    message.fd = connection.fd;
+    message.client_id = connection.id;
+    message.seq = seq;
+    message.parts = std::move(parts);
+    if (owner == shard.id) {
+        run_or_block(shard, std::move(message));
+    } else {
+        send(shard, owner, std::move(message));
+    }
+}
+
+void ShardedRedisServer::start_gather(Shard& shard, Connection& connection, uint64_t seq,
+                                      redis_utils::CommandParts&& parts) {
+    PendingReply& slot = connection.replies.back();
+    slot.command = parts.command;
+    if (is_scan(parts.command)) {
+        storage::KeyRange range;
+        std::string error;
+        if (!redis_utils::parse_scan_request(parts, range, slot.scan_count, error)) {
+            slot.ready = true;
+            slot.reply = error;
+            return;
+        }
+        if (!shard.db.has_ordered_index()) {
+            slot.ready = true;
+            slot.reply =
+                "-ERR ordered index is disabled (start the server with --ordered-index)\r\n";
+            return;
+        }
+    }
+
+    // Not a snapshot: each shard answers for its keys as of when the request gets there
+    slot.parts_left = shards_.size();
+    for (size_t owner = 0; owner < shards_.size(); ++owner) {
+        if (owner == shard.id) {
+            ShardMessage result;
+            execute_part(shard, parts, result);
+            add_part(slot, result);
+            continue;
+        }
+        ShardMessage message;
+        message.kind = ShardMessage::Kind::GATHER;
+        message.from = shard.id;
+        message.fd = connection.fd;
+        message.client_id = connection.id;
+        message.seq = seq;
+        message.parts = parts;
+        send(shard, owner, std::move(message));
+    }
+}
+
+std::string ShardedRedisServer::execute(Shard& shard, const redis_utils::CommandParts& parts) {
+    // Multi-key commands only get here with all their keys on this shard
+    if (parts.command == "MSET") {
+        if (parts.args.empty() || parts.args.size() % 2 != 0) {
+            return redis_utils::wrong_arity_reply("mset");
+        }
+        for (size_t i = 0; i + 1 < parts.args.size(); i += 2) {
+            shard.db.set(parts.args[i], parts.args[i + 1]);
+        }
+        return "+OK\r\n";
+    }
+    if (parts.command == "RENAME") {
+        if (parts.args.size() != 2) return redis_utils::wrong_arity_reply("rename");
+        auto value = shard.db.get(parts.args[0]);
+        if (!value) return "-ERR no such key\r\n";
+        if (parts.args[0] != parts.args[1]) {
+            shard.db.set(parts.args[1], *value);
+            shard.db.del(parts.args[0]);
+        }
+        return "+OK\r\n";
+    }
+    if (parts.command == "BGSAVE") {
+        // The shared handler's +BGSAVE would promise a save this mode never makes
+        return "-ERR BGSAVE is not supported in sharded mode, which has no persistence\r\n";
+    }
+    return redis_utils::process_command_with_store(parts, shard.db);
+}
+
+void ShardedRedisServer::execute_part(Shard& shard, const redis_utils::CommandParts& parts,
+                                      ShardMessage& result) {
+    result.gather = true;
+    if (parts.command == "DBSIZE") {
+        result.count = static_cast<long long>(shard.db.size());
+    } else {
+        // Already validated by the coordinator
+        storage::KeyRange range;
+        size_t count = 0;
+        std::string error;
+        if (redis_utils::parse_scan_request(parts, range, count, error)) {
+            result.keys = shard.db.scan_keys(range, count);
+        }
+    }
+}
+
+void ShardedRedisServer::add_part(PendingReply& slot, ShardMessage& result) {
+    slot.count += result.count;
+    if (!result.keys.empty()) {
+        // Each shard's page is sorted; the smallest scan_count overall win
+        std::vector<std::string> merged;
+        merged.reserve(std::min(slot.keys.size() + result.keys.size(), slot.scan_count));
+        std::merge(std::make_move_iterator(slot.keys.begin()),
+                   std::make_move_iterator(slot.keys.end()),
+                   std::make_move_iterator(result.keys.begin()),
+                   std::make_move_iterator(result.keys.end()), std::back_inserter(merged));
+        if (merged.size() > slot.scan_count) merged.resize(slot.scan_count);
+        slot.keys = std::move(merged);
+    }
+    if (--slot.parts_left > 0) return;
+
+    slot.ready = true;
+    slot.reply = is_scan(slot.command) ? redis_utils::scan_reply(slot.keys, slot.scan_count)
+                                       : redis_utils::integer_reply(slot.count);
+    slot.keys.clear();
+}
+
+bool ShardedRedisServer::keys_free(const Shard& shard,
+                                   const redis_utils::CommandParts& parts) const {
+    if (shard.locks.empty() && shard.blocked_keys.empty()) return true;
+    for (const auto& key : command_keys(parts)) {
+        if (shard.locks.locked(key) || shard.blocked_keys.count(key) > 0) return false;
+    }
+    return true;
+}
+
+void ShardedRedisServer::run_or_block(Shard& shard, ShardMessage&& request) {
+    bool free = keys_free(shard, request.parts);
+    for (const auto& command : request.commands) free = free && keys_free(shard, command);
+    if (free) {
+        run_request(shard, request);
+        return;
+    }
+
+    // Behind the transaction holding a key, and behind whatever already waits for one
+    for (const auto& key : command_keys(request.parts)) ++shard.blocked_keys[key];
+    for (const auto& command : request.commands) {
+        for (const auto& key : command_keys(command)) ++shard.blocked_keys[key];
+    }
+    shard.blocked.push_back(std::move(request));
+}
+
+void ShardedRedisServer::run_request(Shard& shard, ShardMessage& request) {
+    // A command, gather part or one-shard transaction for keys this shard owns: run it,
+    // answer the sender
+    ShardMessage reply;
+    reply.kind = ShardMessage::Kind::REPLY;
+    reply.from = shard.id;
+    reply.fd = request.fd;
+    reply.client_id = request.client_id;
+    reply.seq = request.seq;
+    reply.transaction = request.transaction;
+    if (request.kind == ShardMessage::Kind::EXECUTE) {
+        reply.kind = ShardMessage::Kind::EXECUTED;
+        for (const auto& command : request.commands) {
+            reply.replies.push_back(execute(shard, command));
+        }
+    } else if (request.kind == ShardMessage::Kind::GATHER) {
+        execute_part(shard, request.parts, reply);
+    } else {
+        reply.reply = execute(shard, request.parts);
+    }
+    send(shard, request.from, std::move(reply));
+}
+
+void ShardedRedisServer::retry_blocked(Shard& shard) {
+    if (shard.blocked.empty()) return;
+    // In arrival order, so one still blocked keeps later requests on its keys behind it
+    std::deque<ShardMessage> waiting;
+    waiting.swap(shard.blocked);
+    shard.blocked_keys.clear();
+    for (auto& request : waiting) run_or_block(shard, std::move(request));
+}
+
+std::string ShardedRedisServer::queue_in_multi(Connection& connection,
+                                               redis_utils::CommandParts&& parts) {
+    // EXEC hands each queued command to the one shard owning its keys. Anything else fails
+    // the whole MULTI, like an unknown command does in Redis
+    const std::string& command = parts.command;
+    bool one_owner =
+        command == "GET" || command == "SET" || command == "MSET" || command == "PING" ||
+        ((command == "DEL" || command == "EXISTS") && parts.args.size() <= 1) ||
+        (command == "RENAME" &&
+         (parts.args.size() != 2 || storage::key_shard(parts.args[0], shards_.size()) ==
+                                        storage::key_shard(parts.args[1], shards_.size()))) ||
+        (command == "COPY" &&
+         (parts.args.size() < 2 || storage::key_shard(parts.args[0], shards_.size()) ==
+                                       storage::key_shard(parts.args[1], shards_.size())));
+    if (!one_owner) {
+        connection.multi_error = true;
+        return "-ERR " + command + " is not supported inside MULTI in sharded mode\r\n";
+    }
+    connection.queued.push_back(std::move(parts));
+    return "+QUEUED\r\n";
+}
+
+bool ShardedRedisServer::plan_transaction(Shard& shard, const Connection& connection,
+                                          const redis_utils::CommandParts& parts,
+                                          Transaction& tx) {
+    // Inside MULTI, the multi-key commands are just queued
+    const std::string& command = parts.command;
+    if (connection.in_multi && command != "EXEC") return false;
+    bool replace = false;  // COPY
+    if (command == "MSET") {
+        if (parts.args.empty() || parts.args.size() % 2 != 0) return false;
+    } else if (command == "DEL" || command == "EXISTS") {
+        if (parts.args.size() < 2) return false;
+    } else if (command == "RENAME") {
+        if (parts.args.size() != 2) return false;
+    } else if (command == "COPY") {
+        std::string error;
+        if (!redis_utils::parse_copy_request(parts, replace, error)) return false;
+    } else if (command != "EXEC" || !connection.in_multi || connection.multi_error) {
+        return false;
+    }
+    tx.command = command;
+
+    std::vector<size_t> index(shards_.size(), SIZE_MAX);
+    auto participant = [&](size_t owner) -> Participant& {
+        if (index[owner] == SIZE_MAX) {
+            index[owner] = tx.participants.size();
+            tx.participants.emplace_back();
+            tx.participants.back().shard = owner;
+        }
+        return tx.participants[index[owner]];
+    };
+    // MSET, DEL and EXISTS become one command per owner of their keys, answering for the given
+    // reply slot, or for the owner's own slot when the replies are summed up
+    auto split = [&](const redis_utils::CommandParts& queued, size_t position) {
+        size_t stride = queued.command == "MSET" ? 2 : 1;
+        std::vector<std::vector<std::string>> args(shards_.size());
+        for (size_t i = 0; i + stride <= queued.args.size(); i += stride) {
+            auto& owned = args[storage::key_shard(queued.args[i], shards_.size())];
+            owned.insert(owned.end(), queued.args.begin() + i, queued.args.begin() + i + stride);
+        }
+        for (size_t owner = 0; owner < args.size(); ++owner) {
+            if (args[owner].empty()) continue;
+            Participant& part = participant(owner);
+            for (size_t i = 0; i < args[owner].size(); i += stride) {
+                part.keys.push_back(args[owner][i]);
+            }
+            part.commands.push_back(make_command(queued.command, std::move(args[owner])));
+            part.positions.push_back(position == SIZE_MAX ? owner : position);
+        }
+    };
+    auto add = [&](const redis_utils::CommandParts& queued, size_t position) {
+        std::vector<std::string> keys = command_keys(queued);
+        if (keys.empty() || (queued.command == "MSET" && queued.args.size() % 2 != 0)) {
+            // PING, or an arity error: nothing to lock
+            tx.replies[position] = execute(shard, queued);
+        } else if (queued.command == "MSET") {
+            split(queued, position);
+        } else {
+            Participant& owner = participant(storage::key_shard(keys[0], shards_.size()));
+            owner.keys.insert(owner.keys.end(), keys.begin(), keys.end());
+            owner.commands.push_back(queued);
+            owner.positions.push_back(position);
+        }
+    };
+
+    if (command == "EXEC") {
+        tx.replies.resize(connection.queued.size());
+        for (size_t i = 0; i < connection.queued.size(); ++i) add(connection.queued[i], i);
+        return true;
+    }
+    if (command == "DEL" || command == "EXISTS") {
+        tx.replies.resize(shards_.size());
+        split(parts, SIZE_MAX);
+        return true;
+    }
+    tx.replies.resize(1);
+    size_t source = storage::key_shard(parts.args[0], shards_.size());
+    size_t target = storage::key_shard(parts.args[1], shards_.size());
+    if (command == "MSET" || source == target) {
+        add(parts, 0);
+        return true;
+    }
+    // RENAME across shards takes two hops: the source hands over the value, the target stores
+    // it. COPY too, but the source keeps its value, and without REPLACE the target first
+    // reports whether the key is taken
+    Participant& from = participant(source);
+    from.keys = {parts.args[0]};
+    from.commands = {make_command("GET", {parts.args[0]})};
+    if (command == "RENAME") {
+        from.commands.push_back(make_command("DEL", {parts.args[0]}));
+    } else {
+        from.positions = {0};
+    }
+    Participant& to = participant(target);
+    to.keys = {parts.args[1]};
+    if (command == "COPY") {
+        tx.replies.resize(2);
+        if (!replace) {
+            to.commands = {make_command("EXISTS", {parts.args[1]})};
+            to.positions = {1};
+        }
+    }
+    return true;
+}
+
+void ShardedRedisServer::start_transaction(Shard& shard, Connection& connection,
+                                           Transaction&& tx) {
+    uint64_t seq = connection.first_seq + connection.replies.size();
+    connection.replies.emplace_back();
+    PendingReply& slot = connection.replies.back();
+    if (tx.command == "EXEC") {
+        connection.in_multi = false;
+        connection.queued.clear();
+    }
+    if (tx.participants.empty()) {
+        slot.ready = true;
+        slot.reply = transaction_reply(tx.command, tx.replies);
+        return;
+    }
+
+    tx.fd = connection.fd;
+    tx.client_id = connection.id;
+    tx.seq = seq;
+    uint64_t handle = shard.next_transaction++;
+    if (tx.participants.size() == 1) {
+        // One shard runs it all back to back on its own thread, which is atomic already. It only
+        // waits, in order, if a transaction holds one of the keys
+        ShardMessage request =
+            transaction_message(ShardMessage::Kind::EXECUTE, shard.id, 0, handle);
+        size_t owner = tx.participants[0].shard;
+        request.commands = std::move(tx.participants[0].commands);
+        tx.waiting = 1;
+        shard.transactions.emplace(handle, std::move(tx));
+        if (owner == shard.id) {
+            run_or_block(shard, std::move(request));
+        } else {
+            send(shard, owner, std::move(request));
+        }
+        return;
+    }
+
+    connection.transaction = handle;
+    schedule(shard, handle, shard.transactions.emplace(handle, std::move(tx)).first->second);
+}
+
+void ShardedRedisServer::schedule(Shard& shard, uint64_t handle, Transaction& tx) {
+    tx.txid = next_txid_.fetch_add(1, std::memory_order_relaxed);
+    tx.waiting = tx.participants.size();
+    tx.rejected = false;
+    for (auto& participant : tx.participants) {
+        participant.scheduled = false;
+        ShardMessage message =
+            transaction_message(ShardMessage::Kind::SCHEDULE, shard.id, tx.txid, handle);
+        message.keys = participant.keys;
+        send(shard, participant.shard, std::move(message));
+    }
+}
+
+void ShardedRedisServer::handle_scheduled(Shard& shard, ShardMessage& message) {
+    auto it = shard.transactions.find(message.transaction);
+    if (it == shard.transactions.end()) return;
+    Transaction& tx = it->second;
+    for (auto& participant : tx.participants) {
+        if (participant.shard == message.from) participant.scheduled = message.ok;
+    }
+    if (!message.ok) tx.rejected = true;
+    if (--tx.waiting > 0) return;
+
+    if (tx.rejected) {
+        // A later transaction holds one of the keys somewhere. Letting this one in ahead of it
+        // there could deadlock, so back out everywhere and retry behind it with a fresh id
+        for (const auto& participant : tx.participants) {
+            if (!participant.scheduled) continue;
+            send(shard, participant.shard,
+                 transaction_message(ShardMessage::Kind::RELEASE, shard.id, tx.txid, it->first));
+        }
+        schedule(shard, it->first, tx);
+        return;
+    }
+
+    // A cross-shard RENAME or COPY runs its first hop and keeps the locks for the target's
+    bool hops = tx.command == "RENAME" || tx.command == "COPY";
+    for (auto& participant : tx.participants) {
+        if (participant.commands.empty()) continue;
+        ShardMessage execute =
+            transaction_message(ShardMessage::Kind::EXECUTE, shard.id, tx.txid, it->first);
+        execute.commands = std::move(participant.commands);
+        execute.conclude = !hops;
+        send(shard, participant.shard, std::move(execute));
+        ++tx.waiting;
+    }
+}
+
+void ShardedRedisServer::handle_executed(Shard& shard, ShardMessage& message) {
+    auto it = shard.transactions.find(message.transaction);
+    if (it == shard.transactions.end()) return;
+    Transaction& tx = it->second;
+    size_t index = 0;
+    while (tx.participants[index].shard != message.from) ++index;
+    const Participant& participant = tx.participants[index];
+    for (size_t i = 0; i < participant.positions.size() && i < message.replies.size(); ++i) {
+        tx.replies[participant.positions[i]] = std::move(message.replies[i]);
+    }
+
+    if (tx.txid != 0 && tx.command == "COPY") {
+        if (--tx.waiting > 0) return;
+        Participant& target = tx.participants[1];
+        std::string value;
+        if (!tx.storing && bulk_value(tx.replies[0], value) && tx.replies[1] != ":1\r\n") {
+            // The value moves on; the target concludes with it, the source stays locked till then
+            tx.storing = true;
+            target.positions.clear();
+            ShardMessage execute =
+                transaction_message(ShardMessage::Kind::EXECUTE, shard.id, tx.txid, it->first);
+            execute.commands = {make_command("SET", {target.keys[0], std::move(value)})};
+            send(shard, target.shard, std::move(execute));
+            tx.waiting = 1;
+            return;
+        }
+        if (!tx.storing) {
+            send(shard, target.shard,
+                 transaction_message(ShardMessage::Kind::RELEASE, shard.id, tx.txid, it->first));
+        }
+        send(shard, tx.participants[0].shard,
+             transaction_message(ShardMessage::Kind::RELEASE, shard.id, tx.txid, it->first));
+        tx.replies = {tx.storing ? ":1\r\n" : ":0\r\n"};
+        complete_transaction(shard, it->first);
+        return;
+    }
+    if (tx.txid != 0 && tx.command == "RENAME") {
+        const Participant& source = tx.participants[0];
+        const Participant& target = tx.participants[1];
+        std::string value;
+        if (index == 0 && bulk_value(message.replies[0], value)) {
+            // The value moves on; the source keeps its lock until the target has it
+            ShardMessage execute =
+                transaction_message(ShardMessage::Kind::EXECUTE, shard.id, tx.txid, it->first);
+            execute.commands = {make_command("SET", {target.keys[0], std::move(value)})};
+            send(shard, target.shard, std::move(execute));
+            tx.replies[0] = "+OK\r\n";
+            return;
+        }
+        if (index == 0) {
+            tx.replies[0] = "-ERR no such key\r\n";
+            send(shard, target.shard,
+                 transaction_message(ShardMessage::Kind::RELEASE, shard.id, tx.txid, it->first));
+        }
+        send(shard, source.shard,
+             transaction_message(ShardMessage::Kind::RELEASE, shard.id, tx.txid, it->first));
+    }
+    if (--tx.waiting > 0) return;
+    complete_transaction(shard, it->first);
+}
+
+void ShardedRedisServer::complete_transaction(Shard& shard, uint64_t handle) {
+    auto it = shard.transactions.find(handle);
+    Transaction& tx = it->second;
+    // The client may have gone while the shards were working
+    Connection* connection = shard.connections.find(tx.fd);
+    if (connection && connection->id == tx.client_id) {
+        PendingReply& slot = connection->replies[tx.seq - connection->first_seq];
+        slot.ready = true;
+        slot.reply = transaction_reply(tx.command, tx.replies);
+        if (connection->transaction == handle) connection->transaction = 0;
+        mark_dirty(shard, *connection);
+    }
+    shard.transactions.erase(it);
+}
+
+ShardedRedisServer::ShardMessage ShardedRedisServer::transaction_message(ShardMessage::Kind kind,
+                                                                         size_t from,
+                                                                         uint64_t txid,
+                                                                         uint64_t transaction) {
+    ShardMessage message;
+    message.kind = kind;
+    message.from = from;
+    message.txid = txid;
+    message.transaction = transaction;
+    return message;
+}
+
+void ShardedRedisServer::handle_schedule(Shard& shard, ShardMessage& message) {
+    ShardMessage reply = transaction_message(ShardMessage::Kind::SCHEDULED, shard.id,
+                                             message.txid, message.transaction);
+    reply.ok = shard.locks.acquire(message.txid, message.keys);
+    if (reply.ok) {
+        TransactionPart& part = shard.scheduled[message.txid];
+        part.coordinator = message.from;
+        part.transaction = message.transaction;
+        part.keys = std::move(message.keys);
+    }
+    send(shard, message.from, std::move(reply));
+}
+
+void ShardedRedisServer::release(Shard& shard, uint64_t txid) {
+    auto it = shard.scheduled.find(txid);
+    if (it == shard.scheduled.end()) return;
+    shard.locks.release(txid, it->second.keys);
+    shard.scheduled.erase(it);
+}
+
+void ShardedRedisServer::run_ready(Shard& shard) {
+    // In id order: a part can only wait for older ones, so one freed by a release earlier in
+    // the walk is reached in the same pass
+    for (auto it = shard.scheduled.begin(); it != shard.scheduled.end();) {
+        TransactionPart& part = it->second;
+        if (!part.execute || part.executed || !shard.locks.first_in_line(it->first, part.keys)) {
+            ++it;
+            continue;
+        }
+        ShardMessage reply = transaction_message(ShardMessage::Kind::EXECUTED, shard.id,
+                                                 it->first, part.transaction);
+        for (const auto& command : part.commands) reply.replies.push_back(execute(shard, command));
+        send(shard, part.coordinator, std::move(reply));
+        shard.locks.mark_run(it->first, part.keys);
+        part.executed = true;
+        if (part.conclude) {
+            shard.locks.release(it->first, part.keys);
+            it = shard.scheduled.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    retry_blocked(shard);
+}
+
+void ShardedRedisServer::send(Shard& shard, size_t to, ShardMessage&& message) {
+    // Queued locally and pushed once per loop iteration, so a batch costs one wakeup
+    shard.outbox[to].push_back(std::move(message));
+}
+
+void ShardedRedisServer::flush_outboxes(Shard& shard) {
+    for (size_t to = 0; to < shards_.size(); ++to) {
+        auto& pending = shard.outbox[to];
+        if (pending.empty()) continue;
+
+        SpscQueue<ShardMessage>& queue = *shards_[to]->inbox[shard.id];
+        size_t pushed = 0;
+        while (!pending.empty() && queue.try_push(std::move(pending.front()))) {
+            pending.pop_front();
+            ++pushed;
+        }
+        if (pushed > 0) wake(*shards_[to]);
+    }
+}
+
+void ShardedRedisServer::drain_inboxes(Shard& shard) {
+    ShardMessage message;
+    for (auto& queue : shard.inbox) {
+        while (queue->try_pop(message)) handle_message(shard, message);
+    }
+}
+
+void ShardedRedisServer::handle_message(Shard& shard, ShardMessage& message) {
+    if (message.kind == ShardMessage::Kind::ACCEPT) {
+        accept_connection(shard, message.fd);
+        return;
+    }
+    switch (message.kind) {
+        case ShardMessage::Kind::REPLY:
+            handle_reply(shard, message);
+            break;
+        case ShardMessage::Kind::SCHEDULE:
+            handle_schedule(shard, message);
+            break;
+        case ShardMessage::Kind::EXECUTE:
+            if (message.txid == 0) {
+                run_or_block(shard, std::move(message));
+                break;
+            }
+            if (auto it = shard.scheduled.find(message.txid); it != shard.scheduled.end()) {
+                // A later hop of a transaction that ran here already runs again
+                it->second.commands = std::move(message.commands);
+                it->second.conclude = message.conclude;
+                it->second.execute = true;
+                it->second.executed = false;
+                run_ready(shard);
+            }
+            break;
+        case ShardMessage::Kind::RELEASE:
+            release(shard, message.txid);
+            run_ready(shard);
+            break;
+        case ShardMessage::Kind::SCHEDULED:
+            handle_scheduled(shard, message);
+            break;
+        case ShardMessage::Kind::EXECUTED:
+            handle_executed(shard, message);
+            break;
+        default:
+            run_or_block(shard, std::move(message));
+            break;
+    }
+}
+
+void ShardedRedisServer::handle_reply(Shard& shard, ShardMessage& message) {
+    // The client may have gone, and its fd been reused, while the owner was working
+    Connection* connection = shard.connections.find(message.fd);
+    if (!connection || connection->id != message.client_id) return;
+
+    PendingReply& slot = connection->replies[message.seq - connection->first_seq];
+    if (message.gather) {
+        add_part(slot, message);
+    } else {
+        slot.ready = true;
+        slot.reply = std::move(message.reply);
+    }
+    mark_dirty(shard, *connection);
+}
+
+}  // namespace network
+}  // namespace redis_clone
@@ -0,0 +1,118 @@
+#include "network/signal_events.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#ifdef __linux__
+#include <sys/signalfd.h>
+#endif
+
+namespace redis_clone {
+namespace network {
+
+#ifndef __linux__
+namespace {
+
+int g_signal_pipe = -1;
+
+// Only async-signal-safe work here: forward the number and return
+void forward_signal(int signal) {
+    int saved_errno = errno;
+    unsigned char byte = static_cast<unsigned char>(signal);
+    (void)!write(g_signal_pipe, &byte, 1);
+    errno = saved_errno;
+}
+
+}  // namespace
+#endif
+
+SignalEvents::SignalEvents(std::initializer_list<int> signals) : signals_(signals) {
+    sigset_t mask;
+    sigemptyset(&mask);
+    for (int signal : signals_) {
+        sigaddset(&mask, signal);
+    }
+
+#ifdef __linux__
+    pthread_sigmask(SIG_BLOCK, &mask, &previous_mask_);
+    fd_ = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (fd_ < 0) {
+        pthread_sigmask(SIG_SETMASK, &previous_mask_, nullptr);
+        throw std::runtime_error("Failed to create signalfd: " + std::string(strerror(errno)));
+    }
+#else
+    int fds[2];
+    if (pipe(fds) < 0) {
+        throw std::runtime_error("Failed to create signal pipe: " + std::string(strerror(errno)));
+    }
+    for (int fd : fds) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    fd_ = fds[0];
+    write_fd_ = fds[1];
+    g_signal_pipe = write_fd_;
+
+    // Nothing is blocked, the handler only needs to reach the pipe
+    pthread_sigmask(SIG_SETMASK, nullptr, &previous_mask_);
+    previous_actions_.resize(signals_.size());
+    for (size_t i = 0; i < signals_.size(); ++i) {
+        struct sigaction action {};
+        action.sa_handler = forward_signal;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESTART;
+        sigaction(signals_[i], &action, &previous_actions_[i]);
+    }
+#endif
+}
+
+SignalEvents::~SignalEvents() {
+#ifdef __linux__
+    close(fd_);
+    pthread_sigmask(SIG_SETMASK, &previous_mask_, nullptr);
+#else
+    for (size_t i = 0; i < signals_.size(); ++i) {
+        sigaction(signals_[i], &previous_actions_[i], nullptr);
+    }
+    g_signal_pipe = -1;
+    close(fd_);
+    close(write_fd_);
+#endif
+}
+
+void SignalEvents::release_in_child() {
+#ifndef __linux__
+    for (size_t i = 0; i < signals_.size(); ++i) {
+        sigaction(signals_[i], &previous_actions_[i], nullptr);
+    }
+#endif
+    pthread_sigmask(SIG_SETMASK, &previous_mask_, nullptr);
+}
+
+std::vector<int> SignalEvents::read_pending() {
+    std::vector<int> received;
+#ifdef __linux__
+    signalfd_siginfo info;
+    while (read(fd_, &info, sizeof(info)) == static_cast<ssize_t>(sizeof(info))) {
+        received.push_back(static_cast<int>(info.ssi_signo));
+    }
+#else
+    unsigned char bytes[64];
+    ssize_t count;
+    while ((count = read(fd_, bytes, sizeof(bytes))) > 0) {
+        for (ssize_t i = 0; i < count; ++i) {
+            received.push_back(bytes[i]);
+        }
+    }
+#endif
+    return received;
+}
+
+}  // namespace network
+}  // namespace redis_clone
@@ -0,0 +1,107 @@
+#include "network/task_pool.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <csignal>
+#include <stdexcept>
+
+namespace redis_clone {
+namespace network {
+
+TaskPool::TaskPool(size_t num_threads) {
+    if (pipe(wake_pipe_) < 0) {
+        throw std::runtime_error("Failed to create task pool wake pipe");
+    }
+    for (int fd : wake_pipe_) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+
+    workers_.reserve(num_threads);
+    for (size_t i = 0; i < num_threads; ++i) {
+        workers_.emplace_back(&TaskPool::worker_loop, this);
+    }
+}
+
+TaskPool::~TaskPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_ready_.notify_all();
+
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+    close(wake_pipe_[0]);
+    close(wake_pipe_[1]);
+}
+
+void TaskPool::submit(std::function<void()> work, std::function<void()> completion) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back({std::move(work), std::move(completion)});
+    }
+    ++in_flight_;
+    work_ready_.notify_one();
+}
+
+size_t TaskPool::run_completions() {
+    char drain[64];
+    while (read(wake_pipe_[0], drain, sizeof(drain)) > 0) {
+    }
+
+    std::deque<std::function<void()>> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready.swap(completions_);
+    }
+
+    for (auto& completion : ready) {
+        --in_flight_;
+        completion();
+    }
+    return ready.size();
+}
+
+void TaskPool::worker_loop() {
+    // Signals are handled by the main thread only
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    sigaddset(&set, SIGCHLD);
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_ready_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (stopping_) return;
+
+            job = std::move(queue_.front());
+            queue_.pop_front();
+        }
+
+        job.work();
+
+        bool was_empty;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            was_empty = completions_.empty();
+            completions_.push_back(std::move(job.completion));
+        }
+
+        // One byte per batch is enough to wake the loop
+        if (was_empty) {
+            char byte = 1;
+            (void)!write(wake_pipe_[1], &byte, 1);
+        }
+    }
+}
+
+}  // namespace network
+}  // namespace redis_clone
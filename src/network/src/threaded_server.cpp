@@ -1,6 +1,7 @@
 #include "network/threaded_server.h"
 
 #include <arpa/inet.h>
+#include <fcntl.h>
 #include <netinet/in.h>
 #include <pthread.h>
 #include <sys/socket.h>
@@ -10,10 +11,11 @@
 #include <csignal>
 #include <cstring>
 #include <iostream>
-#include <mutex>
+#include <memory>
 #include <sstream>
 #include <stdexcept>
 #include <thread>
+#include <vector>
 
 #include "network/redis_utils.h"
 
@@ -22,7 +24,30 @@ extern volatile sig_atomic_t g_running;
 namespace redis_clone {
 namespace network {
 
-ThreadedRedisServer::ThreadedRedisServer(int port) : port_(port), server_fd_(-1) {
+namespace {
+
+// Block signals for worker threads (main thread handles them)
+void block_shutdown_signals() {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+}
+
+}  // namespace
+
+ThreadedRedisServer::ThreadedRedisServer(int port, size_t reactor_threads, bool ordered_index)
+    : port_(port), server_fd_(-1), reactor_threads_(reactor_threads) {
+#ifndef REDIS_CLONE_COROUTINES
+    if (reactor_threads_ > 0) {
+        throw std::runtime_error(
+            "Coroutine mode requires a build with -DREDIS_CLONE_ENABLE_COROUTINES=ON");
+    }
+#endif
+    if (ordered_index) {
+        db_.enable_ordered_index();
+    }
     initialize_server();
 }
 
@@ -56,6 +81,13 @@ void ThreadedRedisServer::initialize_server() {
 }
 
 void ThreadedRedisServer::run() {
+#ifdef REDIS_CLONE_COROUTINES
+    if (reactor_threads_ > 0) {
+        run_reactors();
+        return;
+    }
+#endif
+
     while (g_running) {
         int client_fd = accept(server_fd_, nullptr, nullptr);
         if (client_fd < 0) {
@@ -84,12 +116,7 @@ void ThreadedRedisServer::run() {
 }
 
 void ThreadedRedisServer::handle_client(int client_fd) {
-    // Block signals for worker threads (main thread handles them)
-    sigset_t set;
-    sigemptyset(&set);
-    sigaddset(&set, SIGINT);
-    sigaddset(&set, SIGTERM);
-    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+    block_shutdown_signals();
 
     std::string command_buffer;
     constexpr size_t buffer_size = 1024;
@@ -107,74 +134,166 @@ void ThreadedRedisServer::handle_client(int client_fd) {
 
         command_buffer.append(buffer, bytes_read);
 
-        size_t pos = command_buffer.find("\n");
-        if (pos != std::string::npos) {
-            std::string complete_command = command_buffer.substr(0, pos);
-            command_buffer.erase(0, pos + 1);
-
-            if (!complete_command.empty() && complete_command.back() == '\r') {
-                complete_command.pop_back();
+        // Answer every complete (possibly pipelined) command in one reply
+        size_t pos = 0;
+        redis_utils::CommandParts parts;
+        std::string error;
+        std::string responses;
+        redis_utils::ParseStatus status;
+        bool quit = false;
+        while ((status = redis_utils::parse_command(command_buffer, pos, parts, error)) ==
+               redis_utils::ParseStatus::OK) {
+            if (parts.command == "QUIT") {
+                responses += "+OK\r\n";
+                quit = true;
+                break;
             }
+            responses += process_command(parts);
+        }
+        command_buffer.erase(0, pos);
+
+        if (status == redis_utils::ParseStatus::ERROR) {
+            responses += "-ERR " + error + "\r\n";
+            quit = true;
+        }
+
+        if (!responses.empty()) {
+            send_command(client_fd, responses);
+        }
+
+        if (quit) {
+            close(client_fd);
+            return;
+        }
+    }
+}
+
+std::string ThreadedRedisServer::process_command(const redis_utils::CommandParts& parts) {
+    // Thread-safe access happens inside the sharded storage layer
+    return redis_utils::process_command_with_store(parts, db_);
+}
+
+void ThreadedRedisServer::send_command(int client_fd, const std::string& response) {
+    if (send(client_fd, response.c_str(), response.size(), 0) < 0) {
+        std::cerr << "Failed to send response to client: " << std::string(strerror(errno))
+                  << std::endl;
+    }
+}
 
-            if (!complete_command.empty()) {
-                redis_utils::CommandParts parts = redis_utils::extract_command(complete_command);
-                if (parts.command == "QUIT") {
-                    send_command(client_fd, "+OK\r\n");
-                    close(client_fd);
-                    return;
-                }
+#ifdef REDIS_CLONE_COROUTINES
 
-                std::string response = process_command(complete_command);
-                send_command(client_fd, response);
+void ThreadedRedisServer::run_reactors() {
+    std::vector<std::unique_ptr<Reactor>> reactors;
+    std::vector<std::thread> reactor_threads;
+    for (size_t i = 0; i < reactor_threads_; ++i) {
+        reactors.push_back(std::make_unique<Reactor>());
+        reactor_threads.emplace_back([reactor = reactors.back().get()] {
+            block_shutdown_signals();
+            reactor->run();
+        });
+    }
+
+    size_t next_reactor = 0;
+    while (g_running) {
+        int client_fd = accept(server_fd_, nullptr, nullptr);
+        if (client_fd < 0) {
+            if (errno == EINTR) {
+                if (g_running)
+                    continue;
+                else
+                    break;
             }
+            std::cerr << "Failed to accept connection: " << strerror(errno) << std::endl;
+            continue;
         }
+
+        fcntl(client_fd, F_SETFL, fcntl(client_fd, F_GETFL, 0) | O_NONBLOCK);
+
+        // Round-robin connections over reactors; each handler lives on one thread
+        Reactor* reactor = reactors[next_reactor++ % reactors.size()].get();
+        reactor->post([this, client_fd, reactor] { handle_client_async(client_fd, *reactor); });
+    }
+
+    std::cout << "Coroutine server shutting down..." << std::endl;
+    for (auto& reactor : reactors) {
+        reactor->stop();
     }
+    for (auto& thread : reactor_threads) {
+        thread.join();
+    }
+    close(server_fd_);
 }
 
-std::string ThreadedRedisServer::process_command(const std::string& command) {
-    redis_utils::CommandParts parts = redis_utils::extract_command(command);
+DetachedTask ThreadedRedisServer::handle_client_async(int client_fd, Reactor& reactor) {
+#ifdef MSG_NOSIGNAL
+    constexpr int send_flags = MSG_NOSIGNAL;
+#else
+    constexpr int send_flags = 0;
+#endif
+
+    reactor.attach(client_fd);
 
-    // Thread-safe access to database layer
-    std::lock_guard<std::mutex> lock(db_mutex_);
+    std::string read_buffer;
+    std::string write_buffer;
+    char buffer[1024];
+    bool closing = false;
 
-    if (parts.command == "SET") {
-        if (parts.key.empty() || parts.value.empty()) {
-            return "-ERR wrong number of arguments for 'set' command\r\n";
+    while (!closing) {
+        ssize_t bytes_read = recv(client_fd, buffer, sizeof(buffer), 0);
+        if (bytes_read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            co_await reactor.readable(client_fd);
+            continue;
         }
-        db_.set(parts.key, parts.value);
-        return "+OK\r\n";
-    } else if (parts.command == "GET") {
-        if (parts.key.empty()) {
-            return "-ERR wrong number of arguments for 'get' command\r\n";
+        if (bytes_read < 0 && errno == EINTR) {
+            continue;
         }
-        auto result = db_.get(parts.key);
-        if (result.has_value()) {
-            return "$" + std::to_string(result->size()) + "\r\n" + *result + "\r\n";
+        if (bytes_read <= 0) {
+            break;
         }
-        return "$-1\r\n";  // Redis null bulk string
-    } else if (parts.command == "DEL") {
-        if (parts.key.empty()) {
-            return "-ERR wrong number of arguments for 'del' command\r\n";
+
+        read_buffer.append(buffer, bytes_read);
+
+        size_t pos = 0;
+        redis_utils::CommandParts parts;
+        std::string error;
+        redis_utils::ParseStatus status;
+        while ((status = redis_utils::parse_command(read_buffer, pos, parts, error)) ==
+               redis_utils::ParseStatus::OK) {
+            if (parts.command == "QUIT") {
+                write_buffer += "+OK\r\n";
+                closing = true;
+                break;
+            }
+            write_buffer += process_command(parts);
         }
-        return ":" + std::to_string(db_.del(parts.key)) + "\r\n";
-    } else if (parts.command == "EXISTS") {
-        if (parts.key.empty()) {
-            return "-ERR wrong number of arguments for 'exists' command\r\n";
+        read_buffer.erase(0, pos);
+
+        if (status == redis_utils::ParseStatus::ERROR) {
+            write_buffer += "-ERR " + error + "\r\n";
+            closing = true;
+        }
+
+        while (!write_buffer.empty()) {
+            ssize_t bytes_sent =
+                send(client_fd, write_buffer.data(), write_buffer.size(), send_flags);
+            if (bytes_sent > 0) {
+                write_buffer.erase(0, bytes_sent);
+            } else if (bytes_sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                co_await reactor.writable(client_fd);
+            } else if (bytes_sent < 0 && errno == EINTR) {
+                continue;
+            } else {
+                closing = true;
+                break;
+            }
         }
-        return ":" + std::to_string(db_.exists(parts.key)) + "\r\n";
-    } else if (parts.command == "QUIT") {
-        return "+OK\r\n";
     }
 
-    return "-ERR unknown command '" + parts.command + "'\r\n";
+    reactor.detach(client_fd);
+    close(client_fd);
 }
 
-void ThreadedRedisServer::send_command(int client_fd, const std::string& response) {
-    if (send(client_fd, response.c_str(), response.size(), 0) < 0) {
-        std::cerr << "Failed to send response to client: " << std::string(strerror(errno))
-                  << std::endl;
-    }
-}
+#endif  // REDIS_CLONE_COROUTINES
 
 }  // namespace network
 }  // namespace redis_clone
\ No newline at end of file
@@ -0,0 +1,261 @@
+#include "network/upgrade.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+namespace redis_clone {
+namespace network {
+
+namespace {
+
+constexpr const char* kMagic = "REDIS-CLONE-UPGRADE";
+constexpr int kVersion = 1;
+constexpr size_t kMaxFdsPerMessage = 128;  // Well under the kernel's SCM_MAX_FD
+constexpr size_t kMaxPayload = 256;
+
+sockaddr_un unix_address(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Upgrade socket path too long: " + path);
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+bool send_message(int fd, const std::string& payload, const std::vector<int>& fds) {
+    iovec iov{const_cast<char*>(payload.data()), payload.size()};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    std::vector<char> control;
+    if (!fds.empty()) {
+        control.resize(CMSG_SPACE(sizeof(int) * fds.size()));
+        msg.msg_control = control.data();
+        msg.msg_controllen = control.size();
+        cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+        std::memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+    }
+    return sendmsg(fd, &msg, MSG_NOSIGNAL) == static_cast<ssize_t>(payload.size());
+}
+
+// Throws on a short or truncated message; received fds are appended to fds
+std::string receive_message(int fd, std::vector<int>& fds) {
+    char payload[kMaxPayload];
+    iovec iov{payload, sizeof(payload)};
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * kMaxFdsPerMessage));
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+
+    int flags = 0;
+#ifdef __linux__
+    flags |= MSG_CMSG_CLOEXEC;
+#endif
+    ssize_t received = recvmsg(fd, &msg, flags);
+    if (received <= 0) {
+        throw std::runtime_error(std::string("Upgrade handoff interrupted: ") +
+                                 (received < 0 ? strerror(errno) : "connection closed"));
+    }
+
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+        size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        const int* received_fds = reinterpret_cast<const int*>(CMSG_DATA(cmsg));
+        fds.insert(fds.end(), received_fds, received_fds + count);
+    }
+    if (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) {
+        throw std::runtime_error("Upgrade handoff message truncated");
+    }
+    return std::string(payload, received);
+}
+
+bool write_all(int fd, const std::string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = write(fd, data.data() + written, data.size() - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        written += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+}  // namespace
+
+int listen_upgrade_socket(const std::string& path) {
+    sockaddr_un address = unix_address(path);
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("Failed to create upgrade socket: ") +
+                                 strerror(errno));
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    // A socket file left by the process this one took over from, or by a crash
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        listen(fd, 1) < 0) {
+        std::string error = strerror(errno);
+        close(fd);
+        throw std::runtime_error("Failed to listen on upgrade socket " + path + ": " + error);
+    }
+    return fd;
+}
+
+int create_anonymous_file(const std::string& name, const std::string& dir) {
+    int fd = -1;
+#ifdef __linux__
+    fd = memfd_create(name.c_str(), MFD_CLOEXEC);
+    if (fd >= 0) return fd;
+#endif
+    std::string path = dir + "/" + name + ".XXXXXX";
+    fd = mkstemp(path.data());
+    if (fd < 0) return -1;
+    unlink(path.c_str());
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    return fd;
+}
+
+std::string unexecuted_input(const std::deque<redis_utils::CommandParts>& pending,
+                             const std::string& read_buffer) {
+    std::string input;
+    for (const auto& parts : pending) input += redis_utils::format_multibulk_command(parts);
+    return input + read_buffer;
+}
+
+std::string fd_path(int fd) { return "/dev/fd/" + std::to_string(fd); }
+
+bool send_upgrade_state(int conn_fd, const UpgradeState& state, int timeout_ms,
+                        std::string& error) {
+    // Partial commands are too big for a message, so they travel in a file of their own
+    int table_fd = create_anonymous_file("redis-clone-clients", ".");
+    if (table_fd < 0) {
+        error = std::string("cannot create the client table: ") + strerror(errno);
+        return false;
+    }
+    std::string table;
+    for (const auto& client : state.clients) {
+        table += std::to_string(client.id) + " " + std::to_string(client.read_buffer.size()) +
+                 "\n" + client.read_buffer;
+    }
+    bool ok = write_all(table_fd, table);
+
+    std::ostringstream header;
+    header << kMagic << " " << kVersion << " " << state.next_client_id << " "
+           << state.clients.size();
+    ok = ok &&
+         send_message(conn_fd, header.str(), {state.listener_fd, state.keyspace_fd, table_fd});
+    close(table_fd);
+
+    for (size_t i = 0; ok && i < state.clients.size(); i += kMaxFdsPerMessage) {
+        std::vector<int> fds;
+        for (size_t j = i; j < state.clients.size() && j < i + kMaxFdsPerMessage; ++j) {
+            fds.push_back(state.clients[j].fd);
+        }
+        ok = send_message(conn_fd, "CLIENTS " + std::to_string(fds.size()), fds);
+    }
+    if (!ok) {
+        error = std::string("send failed: ") + strerror(errno);
+        return false;
+    }
+
+    pollfd reply{conn_fd, POLLIN, 0};
+    char answer[8] = {};
+    if (poll(&reply, 1, timeout_ms) <= 0 || recv(conn_fd, answer, sizeof(answer) - 1, 0) <= 0 ||
+        std::string(answer) != "OK") {
+        error = "the new process did not confirm the takeover";
+        return false;
+    }
+    return true;
+}
+
+UpgradeState receive_upgrade_state(const std::string& socket_path) {
+    sockaddr_un address = unix_address(socket_path);
+    int conn = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if (conn < 0 || connect(conn, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        std::string error = strerror(errno);
+        if (conn >= 0) close(conn);
+        throw std::runtime_error("Cannot connect to upgrade socket " + socket_path + ": " + error);
+    }
+
+    UpgradeState state;
+    std::vector<int> fds;
+    try {
+        std::istringstream header(receive_message(conn, fds));
+        std::string magic;
+        int version = 0;
+        size_t client_count = 0;
+        header >> magic >> version >> state.next_client_id >> client_count;
+        if (magic != kMagic || version != kVersion || fds.size() != 3) {
+            throw std::runtime_error("Unexpected upgrade handoff header");
+        }
+        state.listener_fd = fds[0];
+        state.keyspace_fd = fds[1];
+        int table_fd = fds[2];
+
+        while (fds.size() < 3 + client_count) {
+            size_t before = fds.size();
+            if (receive_message(conn, fds).rfind("CLIENTS ", 0) != 0 || fds.size() == before) {
+                throw std::runtime_error("Unexpected upgrade handoff message");
+            }
+        }
+
+        // Client table: "<id> <length>\n<partial command>" per client, in fd order
+        struct stat st;
+        std::string table;
+        if (fstat(table_fd, &st) == 0 && st.st_size > 0) {
+            table.resize(static_cast<size_t>(st.st_size));
+            if (pread(table_fd, table.data(), table.size(), 0) !=
+                static_cast<ssize_t>(table.size())) {
+                throw std::runtime_error("Cannot read the upgrade client table");
+            }
+        }
+        close(table_fd);
+
+        size_t pos = 0;
+        for (size_t i = 0; i < client_count; ++i) {
+            UpgradeState::Client client;
+            client.fd = fds[3 + i];
+            size_t newline = table.find('\n', pos);
+            std::istringstream line(table.substr(pos, newline - pos));
+            size_t length = 0;
+            if (newline == std::string::npos || !(line >> client.id >> length) ||
+                newline + 1 + length > table.size()) {
+                throw std::runtime_error("Bad upgrade client table");
+            }
+            client.read_buffer = table.substr(newline + 1, length);
+            pos = newline + 1 + length;
+            state.clients.push_back(std::move(client));
+        }
+    } catch (const std::exception&) {
+        for (int fd : fds) close(fd);
+        close(conn);
+        throw;
+    }
+
+    // From here on the old process stops; the fds are ours
+    send(conn, "OK", 2, MSG_NOSIGNAL);
+    close(conn);
+    return state;
+}
+
+}  // namespace network
+}  // namespace redis_clone
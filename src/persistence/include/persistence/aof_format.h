@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace redis_clone {
+namespace persistence {
+
+/**
+ * AOF record encoding
+ *
+ * Commands are stored as RESP multibulk frames (*<n>\r\n$<len>\r\n...),
+ * so keys and values may hold spaces and newlines. Annotation lines start
+ * with '#'; the only one written is the timestamp marker "#TS:<unix>\r\n",
+ * emitted before the first command of each second when aof-timestamp-enabled
+ * is on. Older files with one inline "SET key value" command per line are
+ * still readable.
+ */
+std::string encode_aof_command(const std::vector<std::string>& tokens);
+std::string encode_aof_timestamp(int64_t unix_seconds);
+
+struct AofRecord {
+    enum class Type { COMMAND, TIMESTAMP, ANNOTATION };
+
+    Type type = Type::COMMAND;
+    std::vector<std::string> tokens;  // COMMAND only, and only when decoding
+    int64_t timestamp = 0;            // TIMESTAMP only
+    uint64_t offset = 0;              // Where the record starts in the file
+};
+
+/**
+ * Sequential reader over a memory-mapped AOF
+ *
+ * Stops at the end of the data, which excludes any preallocated NUL
+ * padding (see AofWriter). A record cut short by a crash, or one that does
+ * not parse, also stops the scan with error() set; offset() is then the
+ * end of the last good record, which is where the file can be truncated.
+ */
+class AofReader {
+   public:
+    explicit AofReader(const std::string& path);
+    ~AofReader();
+
+    AofReader(const AofReader&) = delete;
+    AofReader& operator=(const AofReader&) = delete;
+
+    bool is_open() const { return open_; }
+
+    // With decode false, bulk payloads are skipped by length and tokens stay empty
+    bool next(AofRecord& record, bool decode = true);
+
+    uint64_t offset() const { return pos_; }       // End of the last record read
+    uint64_t data_size() const { return size_; }  // Bytes before the NUL padding
+    const std::string& error() const { return error_; }
+
+   private:
+    bool open_ = false;
+    const char* data_ = nullptr;
+    size_t mapped_size_ = 0;
+    uint64_t size_ = 0;
+    uint64_t pos_ = 0;
+    std::string error_;
+
+    bool read_multibulk(AofRecord& record, bool decode);
+    bool read_line(uint64_t& line_end);
+};
+
+/**
+ * Offset to cut the AOF at to restore the state as of unix_seconds
+ *
+ * That is the start of the first timestamp marker later than unix_seconds,
+ * or the end of the valid data when there is none. Commands before the
+ * first marker are always kept.
+ */
+uint64_t find_aof_cutoff(AofReader& reader, int64_t unix_seconds);
+
+}  // namespace persistence
+}  // namespace redis_clone
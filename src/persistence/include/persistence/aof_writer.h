@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace redis_clone {
+namespace persistence {
+
+/**
+ * How appends reach the disk
+ *
+ * BUFFERED writes through the page cache and relies on sync(). DSYNC opens
+ * the file with O_DSYNC so each append is durable on return. DIRECT adds
+ * O_DIRECT on top and writes whole aligned blocks from an aligned buffer,
+ * falling back to DSYNC where the filesystem refuses O_DIRECT.
+ */
+enum class AofWriteMode { BUFFERED, DSYNC, DIRECT };
+
+struct AofWriterOptions {
+    AofWriteMode mode = AofWriteMode::BUFFERED;
+    size_t preallocate_size = 64 * 1024 * 1024;  // Grow the file in steps of this; 0 disables
+};
+
+/**
+ * Append-only file writer with preallocated space
+ *
+ * Space is reserved ahead of the logical end with fallocate, so appends do
+ * not change the file size and fdatasync has no inode metadata to flush.
+ * The reserved tail reads as NUL bytes. Every AOF record ends with a
+ * newline, so the logical end is simply where the trailing NULs start: it
+ * is found by scanning back on open, readers stop at the first NUL, and a
+ * clean close truncates the padding away.
+ */
+class AofWriter {
+   public:
+    AofWriter(const std::string& path, const AofWriterOptions& options);
+    ~AofWriter();
+
+    AofWriter(const AofWriter&) = delete;
+    AofWriter& operator=(const AofWriter&) = delete;
+
+    bool is_open() const { return fd_ >= 0; }
+    AofWriteMode mode() const { return mode_; }
+
+    bool append(const std::string& data);
+    // fdatasync; a no-op in DSYNC/DIRECT mode where appends are already durable
+    bool sync();
+    // For syncing on another thread: a dup of the fd that stays valid if the writer is
+    // closed meanwhile, to be passed to sync_fd(). -1 when there is nothing to sync
+    int dup_for_sync() const;
+    // fdatasync and close a dup_for_sync() fd
+    static bool sync_fd(int fd);
+    // Truncate the preallocated tail and close
+    bool close();
+
+    uint64_t size() const { return logical_end_; }
+    uint64_t allocated() const { return allocated_; }
+
+    // Length of the data before the NUL padding, without opening a writer
+    static uint64_t logical_size(const std::string& path);
+
+   private:
+    int fd_ = -1;
+    AofWriteMode mode_;
+    AofWriterOptions options_;
+    uint64_t logical_end_ = 0;
+    uint64_t allocated_ = 0;
+
+    // DIRECT mode: the partially filled last block, kept block aligned
+    char* block_buffer_ = nullptr;
+    size_t block_buffer_size_ = 0;
+
+    bool reserve(uint64_t end);
+    bool write_direct(const std::string& data);
+};
+
+}  // namespace persistence
+}  // namespace redis_clone
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace redis_clone {
+namespace persistence {
+
+/**
+ * Knobs for writing large files without page-cache storms
+ */
+struct BackgroundWriterOptions {
+    size_t chunk_size = 1024 * 1024;          // Buffered bytes per write(), multiple of 4KB
+    size_t sync_interval = 4 * 1024 * 1024;   // Start writeback every N bytes; 0 disables
+    size_t max_bytes_per_sec = 0;             // Bandwidth cap; 0 means unlimited
+    bool drop_page_cache = false;             // Evict pages once they are on disk
+};
+
+/**
+ * Buffered writer for snapshots and AOF rewrites
+ *
+ * Writes go out in large aligned chunks. Every sync_interval bytes the new
+ * range is handed to the kernel for writeback with sync_file_range, and the
+ * previous range is waited for, so dirty pages never pile up into one burst
+ * that would stall the foreground AOF fsyncs. Optionally the writer sleeps to
+ * stay under a bandwidth cap and drops written pages from the cache. Outside
+ * Linux the incremental step falls back to fdatasync/fsync.
+ */
+class BackgroundWriter {
+   public:
+    BackgroundWriter(const std::string& path, const BackgroundWriterOptions& options);
+    ~BackgroundWriter();
+
+    BackgroundWriter(const BackgroundWriter&) = delete;
+    BackgroundWriter& operator=(const BackgroundWriter&) = delete;
+
+    bool is_open() const { return fd_ >= 0; }
+    bool good() const { return fd_ >= 0 && !failed_; }
+
+    void write(const char* data, size_t size);
+    void write(const std::string& data) { write(data.data(), data.size()); }
+    BackgroundWriter& operator<<(const std::string& data) {
+        write(data);
+        return *this;
+    }
+
+    // Flush, fsync and close; false if any step failed
+    bool finish();
+
+    uint64_t bytes_written() const { return written_; }
+
+   private:
+    int fd_ = -1;
+    BackgroundWriterOptions options_;
+    std::string buffer_;
+    uint64_t written_ = 0;
+    uint64_t synced_ = 0;         // Start of the range not yet handed to writeback
+    uint64_t pending_start_ = 0;  // Range under writeback, waited for on the next step
+    uint64_t pending_end_ = 0;
+    bool failed_ = false;
+    std::chrono::steady_clock::time_point started_;
+
+    void flush_buffer();
+    void incremental_sync();
+    void throttle();
+};
+
+}  // namespace persistence
+}  // namespace redis_clone
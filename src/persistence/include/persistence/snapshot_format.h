@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "persistence/background_writer.h"
+
+namespace redis_clone {
+namespace persistence {
+
+/**
+ * dump.json layout
+ *
+ *   {
+ *     "metadata": {
+ *       "version": "1.1",
+ *       "timestamp": "2024-01-01T00:00:00Z",
+ *       "epoch": 7,
+ *       "key_count": 2
+ *     },
+ *     "data": {
+ *       "key": "value",
+ *       "other": "line\nbreak"
+ *     },
+ *     "checksum": "crc32:1c291ca3"
+ *   }
+ *
+ * One entry per line, with keys and values JSON-escaped so a line never
+ * holds a raw newline. The CRC-32 covers every byte before the checksum
+ * line. Version 1.0 files have no checksum and no escaping.
+ *
+ * An incremental checkpoint is a delta next to the base file, named
+ * <base>.delta.<epoch>. Its metadata adds "type": "delta" and the
+ * "base_epoch" it applies on top of, and a "deleted" array of keys comes
+ * before "data", which holds only the keys set since the base epoch.
+ */
+uint32_t crc32(const char* data, size_t size, uint32_t crc = 0);
+
+/**
+ * Streams a snapshot through a BackgroundWriter, checksumming on the way
+ */
+class SnapshotWriter {
+   public:
+    SnapshotWriter(const std::string& path, const BackgroundWriterOptions& options);
+
+    bool is_open() const { return out_.is_open(); }
+
+    void begin(uint64_t key_count, uint64_t epoch = 0);
+    // Deleted keys go first; add() then takes the keys changed since base_epoch
+    void begin_delta(uint64_t key_count, uint64_t base_epoch, uint64_t epoch,
+                     const std::vector<std::string>& deleted);
+    void add(const std::string& key, const std::string& value);
+    // Write the checksum and finish the underlying writer; false on any I/O failure
+    bool finish();
+
+   private:
+    BackgroundWriter out_;
+    uint32_t crc_ = 0;
+    bool first_entry_ = true;
+
+    void write(const std::string& data);
+    void write_header(const std::string& fields, uint64_t key_count,
+                      const std::vector<std::string>* deleted);
+};
+
+struct SnapshotMetadata {
+    std::string version;
+    std::string timestamp;
+    uint64_t key_count = 0;
+    uint64_t epoch = 0;  // 0 for files written before incremental checkpoints
+    bool delta = false;
+    uint64_t base_epoch = 0;  // Deltas only
+};
+
+/**
+ * Memory-mapped snapshot reader
+ *
+ * Entries can be read in parts so several threads can decode one file:
+ * part i of n holds the entries whose line starts in the i-th n-th of the
+ * data section.
+ */
+class SnapshotReader {
+   public:
+    enum class ChecksumStatus { OK, MISMATCH, MISSING };
+
+    using EntryFn = std::function<void(std::string&& key, std::string&& value)>;
+    using KeyFn = std::function<void(std::string&& key)>;
+
+    explicit SnapshotReader(const std::string& path);
+    ~SnapshotReader();
+
+    SnapshotReader(const SnapshotReader&) = delete;
+    SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+    // False if the file could not be mapped or has no data section (see error())
+    bool is_open() const { return open_; }
+    const std::string& error() const { return error_; }
+    const SnapshotMetadata& metadata() const { return metadata_; }
+    uint64_t file_size() const { return size_; }
+
+    // Safe to call from several threads at once; false with error set on a bad entry
+    bool for_each(const EntryFn& fn, std::string& error, size_t part = 0,
+                  size_t parts = 1) const;
+
+    // Keys in a delta's "deleted" array
+    bool for_each_deleted(const KeyFn& fn, std::string& error) const;
+
+    ChecksumStatus verify_checksum() const;
+
+   private:
+    bool open_ = false;
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    std::string error_;
+    SnapshotMetadata metadata_;
+
+    size_t deleted_begin_ = 0;  // Lines of the "deleted" array, if any
+    size_t deleted_end_ = 0;
+    size_t entries_begin_ = 0;  // First byte after the "data": { line
+    size_t entries_end_ = 0;    // Start of the closing brace line
+    size_t checksum_line_ = 0;  // Start of the "checksum" line, 0 if absent
+    std::string stored_checksum_;
+};
+
+/**
+ * A base snapshot and the deltas that continue it, in epoch order
+ *
+ * A delta belongs to the chain if its base_epoch is the epoch reached so
+ * far. Everything else next to the base (left over from an older base or a
+ * crash mid-checkpoint) is stale and can only be deleted.
+ */
+struct SnapshotChain {
+    uint64_t epoch = 0;               // Epoch the chain ends at
+    uint64_t latest_epoch = 0;        // Highest epoch of any file, stale ones included
+    std::vector<std::string> deltas;  // Paths to apply, in order
+    std::vector<std::string> stale;
+};
+
+std::string snapshot_delta_path(const std::string& base_path, uint64_t epoch);
+SnapshotChain find_snapshot_chain(const std::string& base_path);
+
+/**
+ * Fold the chain's deltas into a new base, then remove them
+ *
+ * Streams the base and keeps only the deltas' keys in memory, so it needs
+ * no more memory than the deltas are large.
+ */
+bool merge_snapshot_chain(const std::string& base_path, const BackgroundWriterOptions& options,
+                          std::string& error);
+
+}  // namespace persistence
+}  // namespace redis_clone
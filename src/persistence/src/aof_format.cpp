@@ -0,0 +1,197 @@
+#include "persistence/aof_format.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+
+namespace redis_clone {
+namespace persistence {
+
+namespace {
+
+constexpr char kTimestampPrefix[] = "#TS:";
+constexpr size_t kTimestampPrefixLength = sizeof(kTimestampPrefix) - 1;
+
+bool parse_integer(const char* begin, const char* end, long long& out) {
+    auto result = std::from_chars(begin, end, out);
+    return result.ec == std::errc() && result.ptr == end;
+}
+
+}  // namespace
+
+std::string encode_aof_command(const std::vector<std::string>& tokens) {
+    std::string frame = "*" + std::to_string(tokens.size()) + "\r\n";
+    for (const auto& token : tokens) {
+        frame += "$" + std::to_string(token.size()) + "\r\n";
+        frame += token;
+        frame += "\r\n";
+    }
+    return frame;
+}
+
+std::string encode_aof_timestamp(int64_t unix_seconds) {
+    return kTimestampPrefix + std::to_string(unix_seconds) + "\r\n";
+}
+
+AofReader::AofReader(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return;
+    }
+
+    mapped_size_ = static_cast<size_t>(st.st_size);
+    if (mapped_size_ > 0) {
+        void* mapping = mmap(nullptr, mapped_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            close(fd);
+            return;
+        }
+        data_ = static_cast<const char*>(mapping);
+        // One front-to-back pass; let the kernel read ahead aggressively
+        madvise(mapping, mapped_size_, MADV_SEQUENTIAL);
+    }
+    close(fd);  // The mapping keeps the file alive
+
+    size_ = mapped_size_;
+    while (size_ > 0 && data_[size_ - 1] == '\0') --size_;
+    open_ = true;
+}
+
+AofReader::~AofReader() {
+    if (data_ != nullptr) munmap(const_cast<char*>(data_), mapped_size_);
+}
+
+bool AofReader::next(AofRecord& record, bool decode) {
+    while (open_ && error_.empty() && pos_ < size_) {
+        record = AofRecord{};
+        record.offset = pos_;
+
+        if (data_[pos_] == '*') return read_multibulk(record, decode);
+
+        uint64_t line_end = 0;
+        if (!read_line(line_end)) return false;
+
+        const char* begin = data_ + pos_;
+        const char* end = data_ + line_end;
+        if (end > begin && end[-1] == '\r') --end;
+
+        if (begin == end) {
+            pos_ = line_end + 1;
+            continue;
+        }
+
+        if (*begin == '#') {
+            size_t length = static_cast<size_t>(end - begin);
+            if (length > kTimestampPrefixLength &&
+                std::memcmp(begin, kTimestampPrefix, kTimestampPrefixLength) == 0) {
+                long long timestamp = 0;
+                if (!parse_integer(begin + kTimestampPrefixLength, end, timestamp)) {
+                    error_ = "invalid timestamp annotation at offset " + std::to_string(pos_);
+                    return false;
+                }
+                record.type = AofRecord::Type::TIMESTAMP;
+                record.timestamp = timestamp;
+            } else {
+                record.type = AofRecord::Type::ANNOTATION;
+            }
+            pos_ = line_end + 1;
+            return true;
+        }
+
+        // Legacy inline command, whitespace separated
+        if (decode) {
+            const char* token = begin;
+            while (token < end) {
+                while (token < end && std::isspace(static_cast<unsigned char>(*token))) ++token;
+                const char* token_end = token;
+                while (token_end < end && !std::isspace(static_cast<unsigned char>(*token_end))) {
+                    ++token_end;
+                }
+                if (token_end > token) record.tokens.emplace_back(token, token_end);
+                token = token_end;
+            }
+        }
+        pos_ = line_end + 1;
+        return true;
+    }
+    return false;
+}
+
+bool AofReader::read_line(uint64_t& line_end) {
+    const void* newline = std::memchr(data_ + pos_, '\n', static_cast<size_t>(size_ - pos_));
+    if (newline == nullptr) {
+        error_ = "unterminated record at offset " + std::to_string(pos_);
+        return false;
+    }
+    line_end = static_cast<uint64_t>(static_cast<const char*>(newline) - data_);
+    return true;
+}
+
+bool AofReader::read_multibulk(AofRecord& record, bool decode) {
+    uint64_t cursor = pos_;
+
+    // Reads "<prefix><integer>\r\n" at cursor
+    auto read_header = [&](char prefix, long long& value) {
+        if (cursor >= size_ || data_[cursor] != prefix) return false;
+        const void* cr = std::memchr(data_ + cursor, '\r', static_cast<size_t>(size_ - cursor));
+        if (cr == nullptr) return false;
+        const char* number_end = static_cast<const char*>(cr);
+        uint64_t after = static_cast<uint64_t>(number_end - data_) + 2;
+        if (after > size_ || number_end[1] != '\n') return false;
+        if (!parse_integer(data_ + cursor + 1, number_end, value) || value < 0) return false;
+        cursor = after;
+        return true;
+    };
+
+    long long count = 0;
+    bool ok = read_header('*', count);
+    if (ok && decode) record.tokens.reserve(static_cast<size_t>(std::min(count, 1024LL)));
+
+    for (long long i = 0; ok && i < count; ++i) {
+        long long length = 0;
+        ok = read_header('$', length);
+        if (!ok) break;
+
+        uint64_t payload_end = cursor + static_cast<uint64_t>(length);
+        if (payload_end + 2 > size_ || data_[payload_end] != '\r' ||
+            data_[payload_end + 1] != '\n') {
+            ok = false;
+            break;
+        }
+        if (decode) record.tokens.emplace_back(data_ + cursor, static_cast<size_t>(length));
+        cursor = payload_end + 2;
+    }
+
+    if (!ok) {
+        error_ = "truncated or malformed command at offset " + std::to_string(pos_);
+        record.tokens.clear();
+        return false;
+    }
+
+    record.type = AofRecord::Type::COMMAND;
+    pos_ = cursor;
+    return true;
+}
+
+uint64_t find_aof_cutoff(AofReader& reader, int64_t unix_seconds) {
+    AofRecord record;
+    while (reader.next(record, false)) {
+        if (record.type == AofRecord::Type::TIMESTAMP && record.timestamp > unix_seconds) {
+            return record.offset;
+        }
+    }
+    return reader.offset();
+}
+
+}  // namespace persistence
+}  // namespace redis_clone
@@ -0,0 +1,225 @@
+#include "persistence/aof_writer.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace redis_clone {
+namespace persistence {
+
+namespace {
+
+constexpr size_t kBlockSize = 4096;
+
+bool pwrite_all(int fd, const char* data, size_t size, uint64_t offset) {
+    while (size > 0) {
+        ssize_t n = pwrite(fd, data, size, static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+// Scan back from the physical end over the NUL padding
+uint64_t find_logical_end(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) return 0;
+
+    uint64_t end = static_cast<uint64_t>(st.st_size);
+    std::vector<char> chunk(64 * 1024);
+    while (end > 0) {
+        size_t size = static_cast<size_t>(std::min<uint64_t>(chunk.size(), end));
+        uint64_t start = end - size;
+        if (pread(fd, chunk.data(), size, static_cast<off_t>(start)) != static_cast<ssize_t>(size)) {
+            return end;
+        }
+        for (size_t i = size; i > 0; --i) {
+            if (chunk[i - 1] != '\0') return start + i;
+        }
+        end = start;
+    }
+    return 0;
+}
+
+}  // namespace
+
+AofWriter::AofWriter(const std::string& path, const AofWriterOptions& options)
+    : mode_(options.mode), options_(options) {
+    int flags = O_WRONLY | O_CREAT | O_CLOEXEC;
+    if (mode_ != AofWriteMode::BUFFERED) flags |= O_DSYNC;
+
+#ifdef O_DIRECT
+    if (mode_ == AofWriteMode::DIRECT) {
+        fd_ = open(path.c_str(), flags | O_DIRECT, 0644);
+        if (fd_ < 0) mode_ = AofWriteMode::DSYNC;
+    }
+#else
+    if (mode_ == AofWriteMode::DIRECT) mode_ = AofWriteMode::DSYNC;
+#endif
+
+    if (fd_ < 0) {
+        fd_ = open(path.c_str(), flags, 0644);
+        if (fd_ < 0) return;
+    }
+
+    int scan_fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    logical_end_ = scan_fd >= 0 ? find_logical_end(scan_fd) : 0;
+    if (scan_fd >= 0) ::close(scan_fd);
+
+    struct stat st;
+    allocated_ = fstat(fd_, &st) == 0 ? static_cast<uint64_t>(st.st_size) : logical_end_;
+
+    if (mode_ == AofWriteMode::DIRECT) {
+        block_buffer_size_ = 1024 * 1024;
+        void* buffer = nullptr;
+        if (posix_memalign(&buffer, kBlockSize, block_buffer_size_) != 0) {
+            ::close(fd_);
+            fd_ = -1;
+            return;
+        }
+        block_buffer_ = static_cast<char*>(buffer);
+        std::memset(block_buffer_, 0, block_buffer_size_);
+
+        // Load the partial tail block so rewriting it keeps its bytes
+        uint64_t tail_start = logical_end_ / kBlockSize * kBlockSize;
+        size_t tail_size = static_cast<size_t>(logical_end_ - tail_start);
+        if (tail_size > 0) {
+            int read_fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            bool ok = read_fd >= 0 && pread(read_fd, block_buffer_, tail_size,
+                                            static_cast<off_t>(tail_start)) ==
+                                          static_cast<ssize_t>(tail_size);
+            if (read_fd >= 0) ::close(read_fd);
+            if (!ok) {
+                ::close(fd_);
+                fd_ = -1;
+            }
+        }
+    }
+}
+
+AofWriter::~AofWriter() {
+    close();
+    std::free(block_buffer_);
+}
+
+bool AofWriter::reserve(uint64_t end) {
+    if (end <= allocated_ || options_.preallocate_size == 0) return true;
+
+    uint64_t target = std::max(end, allocated_ + options_.preallocate_size);
+    target = (target + kBlockSize - 1) / kBlockSize * kBlockSize;
+#ifdef __linux__
+    // Mode 0 extends the size too, so later appends leave the inode alone
+    if (fallocate(fd_, 0, static_cast<off_t>(allocated_),
+                  static_cast<off_t>(target - allocated_)) != 0) {
+        // Not fatal: this filesystem just does not preallocate
+        if (errno != EOPNOTSUPP) return false;
+        options_.preallocate_size = 0;
+        return true;
+    }
+    allocated_ = target;
+#endif
+    return true;
+}
+
+bool AofWriter::append(const std::string& data) {
+    if (fd_ < 0) return false;
+    if (!reserve(logical_end_ + data.size())) return false;
+
+    if (mode_ == AofWriteMode::DIRECT) {
+        return write_direct(data);
+    }
+
+    if (!pwrite_all(fd_, data.data(), data.size(), logical_end_)) return false;
+    logical_end_ += data.size();
+    allocated_ = std::max(allocated_, logical_end_);
+    return true;
+}
+
+bool AofWriter::write_direct(const std::string& data) {
+    const char* input = data.data();
+    size_t left = data.size();
+
+    while (left > 0) {
+        // The buffer always starts at the block holding the logical end
+        uint64_t block_start = logical_end_ / kBlockSize * kBlockSize;
+        size_t used = static_cast<size_t>(logical_end_ - block_start);
+        size_t take = std::min(left, block_buffer_size_ - used);
+        std::memcpy(block_buffer_ + used, input, take);
+
+        size_t filled = used + take;
+        size_t write_size = (filled + kBlockSize - 1) / kBlockSize * kBlockSize;
+        if (!pwrite_all(fd_, block_buffer_, write_size, block_start)) return false;
+
+        logical_end_ += take;
+        allocated_ = std::max(allocated_, block_start + write_size);
+        input += take;
+        left -= take;
+
+        // Keep only the new partial tail block, zero padded
+        size_t full_blocks = filled / kBlockSize * kBlockSize;
+        size_t tail = filled - full_blocks;
+        std::memmove(block_buffer_, block_buffer_ + full_blocks, tail);
+        std::memset(block_buffer_ + tail, 0, write_size - tail);
+    }
+    return true;
+}
+
+bool AofWriter::sync() {
+    if (fd_ < 0) return false;
+    if (mode_ != AofWriteMode::BUFFERED) return true;
+#ifdef __linux__
+    return fdatasync(fd_) == 0;
+#else
+    return fsync(fd_) == 0;
+#endif
+}
+
+int AofWriter::dup_for_sync() const {
+    if (fd_ < 0 || mode_ != AofWriteMode::BUFFERED) return -1;
+    return fcntl(fd_, F_DUPFD_CLOEXEC, 0);
+}
+
+bool AofWriter::sync_fd(int fd) {
+#ifdef __linux__
+    bool ok = fdatasync(fd) == 0;
+#else
+    bool ok = fsync(fd) == 0;
+#endif
+    ::close(fd);
+    return ok;
+}
+
+bool AofWriter::close() {
+    if (fd_ < 0) return true;
+
+    bool ok = true;
+    if (allocated_ > logical_end_) {
+        ok = ftruncate(fd_, static_cast<off_t>(logical_end_)) == 0;
+    }
+    ok = sync() && ok;
+    ok = ::close(fd_) == 0 && ok;
+    fd_ = -1;
+    return ok;
+}
+
+uint64_t AofWriter::logical_size(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+    uint64_t size = find_logical_end(fd);
+    ::close(fd);
+    return size;
+}
+
+}  // namespace persistence
+}  // namespace redis_clone
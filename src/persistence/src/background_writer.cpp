@@ -0,0 +1,142 @@
+#include "persistence/background_writer.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <thread>
+
+namespace redis_clone {
+namespace persistence {
+
+namespace {
+
+constexpr size_t kAlignment = 4096;
+
+void drop_cached_pages(int fd, uint64_t start, uint64_t end) {
+#ifdef __linux__
+    posix_fadvise(fd, static_cast<off_t>(start), static_cast<off_t>(end - start),
+                  POSIX_FADV_DONTNEED);
+#else
+    (void)fd;
+    (void)start;
+    (void)end;
+#endif
+}
+
+}  // namespace
+
+BackgroundWriter::BackgroundWriter(const std::string& path,
+                                   const BackgroundWriterOptions& options)
+    : options_(options), started_(std::chrono::steady_clock::now()) {
+    fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    // Keep chunks page aligned so writeback ranges line up with pages
+    options_.chunk_size = std::max(kAlignment, options_.chunk_size / kAlignment * kAlignment);
+    buffer_.reserve(options_.chunk_size);
+}
+
+BackgroundWriter::~BackgroundWriter() {
+    if (fd_ >= 0) close(fd_);
+}
+
+void BackgroundWriter::write(const char* data, size_t size) {
+    if (!good()) return;
+
+    while (size > 0) {
+        size_t room = options_.chunk_size - buffer_.size();
+        size_t take = std::min(room, size);
+        buffer_.append(data, take);
+        data += take;
+        size -= take;
+
+        if (buffer_.size() == options_.chunk_size) {
+            flush_buffer();
+            if (!good()) return;
+        }
+    }
+}
+
+void BackgroundWriter::flush_buffer() {
+    const char* data = buffer_.data();
+    size_t left = buffer_.size();
+    while (left > 0) {
+        ssize_t n = ::write(fd_, data, left);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            failed_ = true;
+            return;
+        }
+        data += n;
+        left -= static_cast<size_t>(n);
+        written_ += static_cast<uint64_t>(n);
+    }
+    buffer_.clear();
+
+    if (options_.sync_interval > 0 && written_ - synced_ >= options_.sync_interval) {
+        incremental_sync();
+    }
+    throttle();
+}
+
+void BackgroundWriter::incremental_sync() {
+#ifdef __linux__
+    // Wait for the previous range, then kick off writeback of the new one
+    if (pending_end_ > pending_start_) {
+        sync_file_range(fd_, static_cast<off64_t>(pending_start_),
+                        static_cast<off64_t>(pending_end_ - pending_start_),
+                        SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+                            SYNC_FILE_RANGE_WAIT_AFTER);
+        if (options_.drop_page_cache) {
+            drop_cached_pages(fd_, pending_start_, pending_end_);
+        }
+    }
+    sync_file_range(fd_, static_cast<off64_t>(synced_), static_cast<off64_t>(written_ - synced_),
+                    SYNC_FILE_RANGE_WRITE);
+    pending_start_ = synced_;
+    pending_end_ = written_;
+#else
+    fsync(fd_);
+    if (options_.drop_page_cache) {
+        drop_cached_pages(fd_, synced_, written_);
+    }
+#endif
+    synced_ = written_;
+}
+
+void BackgroundWriter::throttle() {
+    if (options_.max_bytes_per_sec == 0) return;
+
+    // Sleep until the average rate since the start is back under the cap
+    auto expected = std::chrono::duration<double>(static_cast<double>(written_) /
+                                                  static_cast<double>(options_.max_bytes_per_sec));
+    auto elapsed = std::chrono::steady_clock::now() - started_;
+    if (expected > elapsed) {
+        std::this_thread::sleep_for(expected - elapsed);
+    }
+}
+
+bool BackgroundWriter::finish() {
+    if (fd_ < 0) return false;
+
+    if (!failed_ && !buffer_.empty()) {
+        flush_buffer();
+    }
+
+#ifdef __linux__
+    bool synced = fdatasync(fd_) == 0;
+#else
+    bool synced = fsync(fd_) == 0;
+#endif
+    if (options_.drop_page_cache) {
+        drop_cached_pages(fd_, 0, written_);
+    }
+
+    bool closed = close(fd_) == 0;
+    fd_ = -1;
+    return !failed_ && synced && closed;
+}
+
+}  // namespace persistence
+}  // namespace redis_clone
@@ -0,0 +1,583 @@
+#include "persistence/snapshot_format.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+namespace redis_clone {
+namespace persistence {
+
+namespace {
+
+constexpr char kVersion[] = "1.1";
+constexpr char kLegacyVersion[] = "1.0";
+constexpr char kChecksumKey[] = "  \"checksum\": \"crc32:";
+
+std::array<uint32_t, 256> make_crc_table() {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+const std::array<uint32_t, 256> kCrcTable = make_crc_table();
+
+std::string json_escape(const std::string& raw) {
+    std::string out;
+    out.reserve(raw.size() + 2);
+    for (unsigned char c : raw) {
+        switch (c) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if (c < 0x20) {
+                    char escaped[7];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                } else {
+                    out += static_cast<char>(c);
+                }
+        }
+    }
+    return out;
+}
+
+void append_utf8(std::string& out, uint32_t code_point) {
+    if (code_point < 0x80) {
+        out += static_cast<char>(code_point);
+    } else if (code_point < 0x800) {
+        out += static_cast<char>(0xC0 | (code_point >> 6));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else {
+        out += static_cast<char>(0xE0 | (code_point >> 12));
+        out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    }
+}
+
+// Parse a JSON string starting at the opening quote; pos ends past the closing quote
+bool parse_json_string(const char* data, size_t end, size_t& pos, std::string& out) {
+    if (pos >= end || data[pos] != '"') return false;
+    ++pos;
+    out.clear();
+
+    while (pos < end) {
+        char c = data[pos++];
+        if (c == '"') return true;
+        if (c != '\\') {
+            out += c;
+            continue;
+        }
+        if (pos >= end) return false;
+        char escape = data[pos++];
+        switch (escape) {
+            case '"':
+            case '\\':
+            case '/':
+                out += escape;
+                break;
+            case 'b':
+                out += '\b';
+                break;
+            case 'f':
+                out += '\f';
+                break;
+            case 'n':
+                out += '\n';
+                break;
+            case 'r':
+                out += '\r';
+                break;
+            case 't':
+                out += '\t';
+                break;
+            case 'u': {
+                if (end - pos < 4) return false;
+                uint32_t code_point = 0;
+                for (int i = 0; i < 4; ++i) {
+                    char h = data[pos++];
+                    code_point <<= 4;
+                    if (h >= '0' && h <= '9') {
+                        code_point |= static_cast<uint32_t>(h - '0');
+                    } else if (h >= 'a' && h <= 'f') {
+                        code_point |= static_cast<uint32_t>(h - 'a' + 10);
+                    } else if (h >= 'A' && h <= 'F') {
+                        code_point |= static_cast<uint32_t>(h - 'A' + 10);
+                    } else {
+                        return false;
+                    }
+                }
+                append_utf8(out, code_point);
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return false;
+}
+
+// Version 1.0 wrote keys and values between quotes verbatim
+bool parse_legacy_entry(const char* line, size_t length, std::string& key, std::string& value) {
+    std::string text(line, length);
+    size_t key_start = text.find('"');
+    size_t key_end = key_start == std::string::npos ? key_start : text.find('"', key_start + 1);
+    size_t value_start = key_end == std::string::npos ? key_end : text.find('"', key_end + 1);
+    size_t value_end = value_start == std::string::npos ? value_start
+                                                         : text.find('"', value_start + 1);
+    if (value_end == std::string::npos) return false;
+
+    key = text.substr(key_start + 1, key_end - key_start - 1);
+    value = text.substr(value_start + 1, value_end - value_start - 1);
+    return true;
+}
+
+bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+// Text of a "name": "text" or "name": number field in a metadata line, if present
+bool metadata_field(const std::string& line, const std::string& name, std::string& out) {
+    size_t at = line.find("\"" + name + "\":");
+    if (at == std::string::npos) return false;
+    size_t start = at + name.size() + 3;
+    while (start < line.size() && (is_space(line[start]) || line[start] == '"')) ++start;
+    size_t end = start;
+    while (end < line.size() && line[end] != '"' && line[end] != ',' && !is_space(line[end])) {
+        ++end;
+    }
+    out = line.substr(start, end - start);
+    return true;
+}
+
+}  // namespace
+
+uint32_t crc32(const char* data, size_t size, uint32_t crc) {
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = kCrcTable[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+SnapshotWriter::SnapshotWriter(const std::string& path, const BackgroundWriterOptions& options)
+    : out_(path, options) {}
+
+void SnapshotWriter::write(const std::string& data) {
+    crc_ = crc32(data.data(), data.size(), crc_);
+    out_.write(data);
+}
+
+void SnapshotWriter::begin(uint64_t key_count, uint64_t epoch) {
+    write_header("    \"epoch\": " + std::to_string(epoch) + ",\n", key_count, nullptr);
+}
+
+void SnapshotWriter::begin_delta(uint64_t key_count, uint64_t base_epoch, uint64_t epoch,
+                                 const std::vector<std::string>& deleted) {
+    write_header("    \"type\": \"delta\",\n    \"base_epoch\": " + std::to_string(base_epoch) +
+                     ",\n    \"epoch\": " + std::to_string(epoch) + ",\n",
+                 key_count, &deleted);
+}
+
+void SnapshotWriter::write_header(const std::string& fields, uint64_t key_count,
+                                  const std::vector<std::string>* deleted) {
+    std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    std::tm tm = *std::gmtime(&now);
+    char timestamp[32];
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", &tm);
+
+    write(std::string("{\n") + "  \"metadata\": {\n" + "    \"version\": \"" + kVersion +
+          "\",\n" + "    \"timestamp\": \"" + timestamp + "\",\n" + fields +
+          "    \"key_count\": " + std::to_string(key_count) + "\n" + "  },\n");
+
+    if (deleted != nullptr) {
+        std::string array = "  \"deleted\": [\n";
+        for (size_t i = 0; i < deleted->size(); ++i) {
+            if (i > 0) array += ",\n";
+            array += "    \"" + json_escape((*deleted)[i]) + "\"";
+        }
+        write(array + "\n  ],\n");
+    }
+    write("  \"data\": {\n");
+}
+
+void SnapshotWriter::add(const std::string& key, const std::string& value) {
+    std::string line = first_entry_ ? "    \"" : ",\n    \"";
+    line += json_escape(key);
+    line += "\": \"";
+    line += json_escape(value);
+    line += '"';
+    write(line);
+    first_entry_ = false;
+}
+
+bool SnapshotWriter::finish() {
+    write("\n  },\n");
+
+    char checksum[16];
+    std::snprintf(checksum, sizeof(checksum), "%08x", crc_);
+    out_.write(std::string(kChecksumKey) + checksum + "\"\n}\n");
+    return out_.finish();
+}
+
+SnapshotReader::SnapshotReader(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error_ = std::string("cannot open: ") + strerror(errno);
+        return;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        error_ = "empty file";
+        return;
+    }
+
+    size_ = static_cast<size_t>(st.st_size);
+    void* mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        size_ = 0;
+        error_ = std::string("mmap failed: ") + strerror(errno);
+        return;
+    }
+    data_ = static_cast<const char*>(mapping);
+
+    // Header: metadata lines and a delta's "deleted" array, up to "data": {
+    size_t pos = 0;
+    while (pos < size_) {
+        const char* newline = static_cast<const char*>(std::memchr(data_ + pos, '\n', size_ - pos));
+        size_t line_end = newline ? static_cast<size_t>(newline - data_) : size_;
+
+        if (deleted_begin_ != 0 && deleted_end_ == 0) {
+            // Inside the array only its closing line matters here
+            if (line_end - pos >= 3 && std::memcmp(data_ + pos, "  ]", 3) == 0) {
+                deleted_end_ = pos;
+            }
+            pos = line_end + 1;
+            continue;
+        }
+
+        std::string line(data_ + pos, line_end - pos);
+        pos = line_end + 1;
+
+        std::string value;
+        if (metadata_field(line, "version", value)) metadata_.version = value;
+        if (metadata_field(line, "timestamp", value)) metadata_.timestamp = value;
+        if (metadata_field(line, "key_count", value)) {
+            metadata_.key_count = std::strtoull(value.c_str(), nullptr, 10);
+        }
+        if (metadata_field(line, "epoch", value)) {
+            metadata_.epoch = std::strtoull(value.c_str(), nullptr, 10);
+        }
+        if (metadata_field(line, "base_epoch", value)) {
+            metadata_.base_epoch = std::strtoull(value.c_str(), nullptr, 10);
+        }
+        if (metadata_field(line, "type", value)) metadata_.delta = value == "delta";
+        if (line.find("\"deleted\":") != std::string::npos) {
+            deleted_begin_ = std::min(pos, size_);
+            continue;
+        }
+        if (line.find("\"data\":") != std::string::npos) {
+            entries_begin_ = std::min(pos, size_);
+            break;
+        }
+    }
+    if (entries_begin_ == 0 || (deleted_begin_ != 0 && deleted_end_ == 0)) {
+        error_ = "no data section";
+        return;
+    }
+
+    // Trailer, scanning back: "}", an optional checksum line, then the "  }" closing data
+    size_t line_end = size_;
+    while (line_end > entries_begin_) {
+        size_t line_start = line_end;
+        if (data_[line_start - 1] == '\n') --line_start;
+        while (line_start > entries_begin_ && data_[line_start - 1] != '\n') --line_start;
+        std::string line(data_ + line_start, line_end - line_start);
+
+        if (line.compare(0, sizeof(kChecksumKey) - 1, kChecksumKey) == 0) {
+            checksum_line_ = line_start;
+            stored_checksum_ = line.substr(sizeof(kChecksumKey) - 1, 8);
+        } else if (line.compare(0, 3, "  }") == 0) {
+            entries_end_ = line_start;
+            break;
+        }
+        line_end = line_start;
+    }
+    if (entries_end_ == 0) {
+        error_ = "data section is not closed (truncated file?)";
+        return;
+    }
+
+    open_ = true;
+}
+
+SnapshotReader::~SnapshotReader() {
+    if (data_ != nullptr) munmap(const_cast<char*>(data_), size_);
+}
+
+bool SnapshotReader::for_each(const EntryFn& fn, std::string& error, size_t part,
+                              size_t parts) const {
+    if (!open_) {
+        error = error_;
+        return false;
+    }
+
+    // Move a split point to the start of the line it falls in the middle of
+    auto line_start_after = [this](size_t at) {
+        if (at <= entries_begin_) return entries_begin_;
+        if (at >= entries_end_) return entries_end_;
+        if (data_[at - 1] == '\n') return at;
+        const void* newline = std::memchr(data_ + at, '\n', entries_end_ - at);
+        return newline ? static_cast<size_t>(static_cast<const char*>(newline) - data_) + 1
+                       : entries_end_;
+    };
+
+    size_t length = entries_end_ - entries_begin_;
+    size_t pos = line_start_after(entries_begin_ + length * part / parts);
+    size_t end = line_start_after(entries_begin_ + length * (part + 1) / parts);
+    bool legacy = metadata_.version == kLegacyVersion;
+
+    std::string key;
+    std::string value;
+    while (pos < end) {
+        const void* newline = std::memchr(data_ + pos, '\n', entries_end_ - pos);
+        size_t line_end =
+            newline ? static_cast<size_t>(static_cast<const char*>(newline) - data_) : entries_end_;
+        size_t line_start = pos;
+        pos = line_end + 1;
+
+        size_t cursor = line_start;
+        while (cursor < line_end && is_space(data_[cursor])) ++cursor;
+        if (cursor == line_end) continue;
+
+        bool ok;
+        if (legacy) {
+            ok = parse_legacy_entry(data_ + line_start, line_end - line_start, key, value);
+        } else {
+            ok = parse_json_string(data_, line_end, cursor, key);
+            while (ok && cursor < line_end && is_space(data_[cursor])) ++cursor;
+            ok = ok && cursor < line_end && data_[cursor++] == ':';
+            while (ok && cursor < line_end && is_space(data_[cursor])) ++cursor;
+            ok = ok && parse_json_string(data_, line_end, cursor, value);
+            if (ok && cursor < line_end && data_[cursor] == ',') ++cursor;
+            while (ok && cursor < line_end && is_space(data_[cursor])) ++cursor;
+            ok = ok && cursor == line_end;
+        }
+        if (!ok) {
+            error = "malformed entry at offset " + std::to_string(line_start);
+            return false;
+        }
+        fn(std::move(key), std::move(value));
+    }
+    return true;
+}
+
+bool SnapshotReader::for_each_deleted(const KeyFn& fn, std::string& error) const {
+    if (!open_) {
+        error = error_;
+        return false;
+    }
+
+    std::string key;
+    size_t pos = deleted_begin_;
+    while (pos < deleted_end_) {
+        const void* newline = std::memchr(data_ + pos, '\n', deleted_end_ - pos);
+        size_t line_end =
+            newline ? static_cast<size_t>(static_cast<const char*>(newline) - data_) : deleted_end_;
+        size_t cursor = pos;
+        pos = line_end + 1;
+
+        while (cursor < line_end && is_space(data_[cursor])) ++cursor;
+        if (cursor == line_end) continue;
+
+        size_t line_start = cursor;
+        bool ok = parse_json_string(data_, line_end, cursor, key);
+        if (ok && cursor < line_end && data_[cursor] == ',') ++cursor;
+        while (ok && cursor < line_end && is_space(data_[cursor])) ++cursor;
+        if (!ok || cursor != line_end) {
+            error = "malformed deleted key at offset " + std::to_string(line_start);
+            return false;
+        }
+        fn(std::move(key));
+    }
+    return true;
+}
+
+SnapshotReader::ChecksumStatus SnapshotReader::verify_checksum() const {
+    if (!open_ || checksum_line_ == 0) return ChecksumStatus::MISSING;
+
+    char computed[16];
+    std::snprintf(computed, sizeof(computed), "%08x", crc32(data_, checksum_line_));
+    return stored_checksum_ == computed ? ChecksumStatus::OK : ChecksumStatus::MISMATCH;
+}
+
+std::string snapshot_delta_path(const std::string& base_path, uint64_t epoch) {
+    return base_path + ".delta." + std::to_string(epoch);
+}
+
+SnapshotChain find_snapshot_chain(const std::string& base_path) {
+    SnapshotChain chain;
+
+    size_t slash = base_path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : base_path.substr(0, slash);
+    std::string prefix =
+        (slash == std::string::npos ? base_path : base_path.substr(slash + 1)) + ".delta.";
+
+    std::vector<std::pair<uint64_t, std::string>> deltas;
+    if (DIR* handle = opendir(dir.c_str())) {
+        while (dirent* entry = readdir(handle)) {
+            std::string name = entry->d_name;
+            if (name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0) {
+                continue;
+            }
+            std::string suffix = name.substr(prefix.size());
+            if (suffix.find_first_not_of("0123456789") != std::string::npos) continue;
+            deltas.emplace_back(std::strtoull(suffix.c_str(), nullptr, 10),
+                                base_path + ".delta." + suffix);
+        }
+        closedir(handle);
+    }
+    std::sort(deltas.begin(), deltas.end());
+
+    {
+        SnapshotReader base(base_path);
+        if (base.is_open() && !base.metadata().delta) chain.epoch = base.metadata().epoch;
+    }
+    chain.latest_epoch = chain.epoch;
+
+    for (const auto& [epoch, path] : deltas) {
+        chain.latest_epoch = std::max(chain.latest_epoch, epoch);
+        SnapshotReader delta(path);
+        const auto& metadata = delta.metadata();
+        if (chain.epoch > 0 && delta.is_open() && metadata.delta &&
+            metadata.base_epoch == chain.epoch && metadata.epoch == epoch) {
+            chain.deltas.push_back(path);
+            chain.epoch = epoch;
+        } else {
+            chain.stale.push_back(path);
+        }
+    }
+    return chain;
+}
+
+bool merge_snapshot_chain(const std::string& base_path, const BackgroundWriterOptions& options,
+                          std::string& error) {
+    SnapshotChain chain = find_snapshot_chain(base_path);
+    for (const auto& path : chain.stale) std::remove(path.c_str());
+    if (chain.deltas.empty()) return true;
+
+    // Net effect of all deltas per key: a value, or nullopt for deleted
+    struct Change {
+        std::optional<std::string> value;
+        bool in_base = false;
+    };
+    std::unordered_map<std::string, Change> changes;
+    for (const auto& path : chain.deltas) {
+        SnapshotReader delta(path);
+        if (!delta.is_open() || delta.verify_checksum() != SnapshotReader::ChecksumStatus::OK) {
+            error = path + ": " + (delta.is_open() ? "checksum mismatch" : delta.error());
+            return false;
+        }
+        bool ok = delta.for_each_deleted(
+                      [&](std::string&& key) { changes[key].value.reset(); }, error) &&
+                  delta.for_each(
+                      [&](std::string&& key, std::string&& value) {
+                          changes[key].value = std::move(value);
+                      },
+                      error);
+        if (!ok) {
+            error = path + ": " + error;
+            return false;
+        }
+    }
+
+    {
+        SnapshotReader base(base_path);
+        if (!base.is_open()) {
+            error = base_path + ": " + base.error();
+            return false;
+        }
+
+        // First pass only to learn the final key count, which the header needs up front
+        uint64_t key_count = 0;
+        bool ok = base.for_each(
+            [&](std::string&& key, std::string&&) {
+                auto it = changes.find(key);
+                if (it == changes.end()) {
+                    ++key_count;
+                } else {
+                    it->second.in_base = true;
+                }
+            },
+            error);
+        for (const auto& [key, change] : changes) {
+            if (change.value) ++key_count;
+        }
+        if (!ok) return false;
+
+        const std::string temp_path = base_path + ".tmp";
+        SnapshotWriter merged(temp_path, options);
+        if (!merged.is_open()) {
+            error = "cannot create " + temp_path;
+            return false;
+        }
+        merged.begin(key_count, chain.epoch);
+        ok = base.for_each(
+            [&](std::string&& key, std::string&& value) {
+                auto it = changes.find(key);
+                if (it == changes.end()) {
+                    merged.add(key, value);
+                } else if (it->second.value) {
+                    merged.add(key, *it->second.value);
+                }
+            },
+            error);
+        for (const auto& [key, change] : changes) {
+            if (change.value && !change.in_base) merged.add(key, *change.value);
+        }
+        if (!merged.finish() || !ok || std::rename(temp_path.c_str(), base_path.c_str()) != 0) {
+            if (ok) error = "cannot write " + base_path;
+            std::remove(temp_path.c_str());
+            return false;
+        }
+    }
+
+    for (const auto& path : chain.deltas) std::remove(path.c_str());
+    return true;
+}
+
+}  // namespace persistence
+}  // namespace redis_clone
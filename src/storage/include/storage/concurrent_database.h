@@ -0,0 +1,50 @@
+#pragma once
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include "storage/database.h"
+
+namespace redis_clone {
+namespace storage {
+
+/**
+ * Thread-safe wrapper around Database
+ *
+ * Readers share a std::shared_mutex, writers take it exclusively. Good enough
+ * for a handful of threads; ShardedDatabase spreads contention further.
+ */
+class ConcurrentDatabase {
+   public:
+    void set(const std::string& key, const std::string& value);
+    std::optional<std::string> get(const std::string& key) const;
+    bool del(const std::string& key);
+    bool exists(const std::string& key) const;
+    SharedValue get_shared(const std::string& key) const;
+    bool copy(const std::string& source, const std::string& destination, bool replace);
+    // Stores value unless key exists and replace is not set; false if it did not
+    bool put(const std::string& key, SharedValue value, bool replace);
+
+    // fn runs under the shared lock and must not call back into this table
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        db_.for_each(fn);
+    }
+
+    size_t size() const;
+    size_t memory_usage() const;
+
+    void enable_ordered_index();
+    bool has_ordered_index() const;
+    std::vector<std::string> scan_keys(const KeyRange& range, size_t count) const;
+
+   private:
+    Database db_;
+    mutable std::shared_mutex mutex_;
+};
+
+}  // namespace storage
+}  // namespace redis_clone
@@ -0,0 +1,336 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "storage/key_hash.h"
+
+namespace redis_clone {
+namespace storage {
+
+/**
+ * Keyspace hash table that grows one segment at a time
+ *
+ * Extendible hashing in the style of Dragonfly's dashtable: a directory of
+ * 2^global_depth pointers, indexed by the top bits of the key hash, to
+ * fixed-size segments that several directory slots may share. A segment is
+ * an array of cache-line buckets of seven slots (fingerprint byte and entry
+ * pointer); a key lives in its home bucket, the bucket after it, or one of a
+ * few stash buckets. When none has room the segment splits in two on the
+ * next hash bit, and only then does the directory double if it must. So
+ * growing never allocates a second copy of the table, and never stops the
+ * world to rehash it: a split moves about half of one segment.
+ *
+ * Entries are heap nodes whose addresses stay put until erased. The buckets
+ * and directory cost 64 bytes per seven slots plus 8 per directory slot,
+ * about 12-16 bytes per key at the fill a split leaves behind, but each node
+ * is a malloc chunk of its own on top: 48 bytes for a pair<const string, int>
+ * and 80 for the Database's entry. So the real overhead per key is several
+ * times the 12-16, which memory_overhead() reports in full.
+ */
+template <typename V>
+class DashTable {
+    struct Segment;
+
+   public:
+    using value_type = std::pair<const std::string, V>;
+
+    static constexpr size_t kBucketSlots = 7;
+    static constexpr size_t kBuckets = 56;      // Home buckets per segment
+    static constexpr size_t kStashBuckets = 4;  // Overflow, only searched while in use
+    static constexpr size_t kSegmentBuckets = kBuckets + kStashBuckets;
+
+    template <bool Const>
+    class Iterator {
+        using Segments = std::vector<std::unique_ptr<Segment>>;
+
+       public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = DashTable::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+        using reference = std::conditional_t<Const, const value_type&, value_type&>;
+
+        Iterator(const Segments* segments, size_t segment)
+            : segments_(segments), segment_(segment) {
+            skip_empty();
+        }
+
+        reference operator*() const { return *slot(); }
+        pointer operator->() const { return slot(); }
+        Iterator& operator++() {
+            ++position_;
+            skip_empty();
+            return *this;
+        }
+        bool operator==(const Iterator& other) const {
+            return segment_ == other.segment_ && position_ == other.position_;
+        }
+        bool operator!=(const Iterator& other) const { return !(*this == other); }
+
+       private:
+        const Segments* segments_;
+        size_t segment_;
+        size_t position_ = 0;  // Bucket * kBucketSlots + slot
+
+        value_type* slot() const {
+            const Bucket& bucket = (*segments_)[segment_]->buckets[position_ / kBucketSlots];
+            return bucket.slots[position_ % kBucketSlots];
+        }
+        void skip_empty() {
+            for (; segment_ < segments_->size(); ++segment_, position_ = 0) {
+                for (; position_ < kSegmentBuckets * kBucketSlots; ++position_) {
+                    if (slot()) return;
+                }
+            }
+            position_ = 0;
+        }
+    };
+
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    DashTable() {
+        segments_.push_back(std::make_unique<Segment>());
+        directory_.push_back(segments_.back().get());
+    }
+    ~DashTable() {
+        for (auto& segment : segments_) {
+            for (Bucket& bucket : segment->buckets) {
+                for (value_type* node : bucket.slots) delete node;
+            }
+        }
+    }
+
+    DashTable(const DashTable&) = delete;
+    DashTable& operator=(const DashTable&) = delete;
+
+    value_type* find(std::string_view key) { return locate(hash_key(key), key).node(); }
+    const value_type* find(std::string_view key) const {
+        return locate(hash_key(key), key).node();
+    }
+
+    // Default-constructs the value for a new key; the bool says whether it was new
+    std::pair<value_type*, bool> try_emplace(const std::string& key) {
+        uint64_t hash = hash_key(key);
+        if (value_type* node = locate(hash, key).node()) return {node, false};
+
+        auto node = std::make_unique<value_type>(std::piecewise_construct,
+                                                 std::forward_as_tuple(key), std::tuple<>());
+        while (!place(*directory_[directory_index(hash)], hash, node.get())) {
+            split(directory_index(hash));
+        }
+        ++size_;
+        return {node.release(), true};
+    }
+
+    bool erase(std::string_view key) {
+        Position position = locate(hash_key(key), key);
+        if (!position.bucket) return false;
+
+        delete position.node();
+        position.bucket->ctrl[position.slot] = 0;
+        position.bucket->slots[position.slot] = nullptr;
+        --position.bucket->used;
+        if (position.bucket >= position.segment->buckets + kBuckets) --position.segment->stashed;
+        --size_;
+        return true;
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    iterator begin() { return iterator(&segments_, 0); }
+    iterator end() { return iterator(&segments_, segments_.size()); }
+    const_iterator begin() const { return const_iterator(&segments_, 0); }
+    const_iterator end() const { return const_iterator(&segments_, segments_.size()); }
+
+    // Buckets of all segments as one range, for sampling random entries
+    size_t bucket_count() const { return segments_.size() * kSegmentBuckets; }
+    template <typename Fn>
+    void for_each_in_bucket(size_t index, Fn&& fn) {
+        Bucket& bucket = segments_[index / kSegmentBuckets]->buckets[index % kSegmentBuckets];
+        for (value_type* node : bucket.slots) {
+            if (node) fn(*node);
+        }
+    }
+
+    // Cache warm-up for a lookup: the two buckets a key with this hash may sit in
+    void prefetch(uint64_t hash) const {
+        const Segment& segment = *directory_[directory_index(hash)];
+        size_t home = bucket_index(hash);
+        prefetch_line(&segment.buckets[home]);
+        prefetch_line(&segment.buckets[(home + 1) % kBuckets]);
+    }
+    // First entry in the home bucket with the hash's fingerprint, key unchecked
+    const value_type* peek(uint64_t hash) const {
+        const Bucket& bucket = directory_[directory_index(hash)]->buckets[bucket_index(hash)];
+        for (size_t i = 0; i < kBucketSlots; ++i) {
+            if (bucket.ctrl[i] == fingerprint(hash)) return bucket.slots[i];
+        }
+        return nullptr;
+    }
+
+    // Bytes of directory and segments, not counting the entries themselves
+    size_t table_memory() const {
+        return segments_.size() * sizeof(Segment) + directory_.capacity() * sizeof(Segment*) +
+               segments_.capacity() * sizeof(std::unique_ptr<Segment>);
+    }
+    // Table plus every entry's node: all the table costs beyond key bytes too long for the
+    // string's inline buffer and whatever V points to
+    size_t memory_overhead() const { return table_memory() + size_ * node_bytes(); }
+    // One node as glibc malloc lays it out: the pair and an 8-byte chunk header, in 16-byte
+    // steps, 32 at least
+    static constexpr size_t node_bytes() {
+        size_t chunk = (sizeof(value_type) + 8 + 15) / 16 * 16;
+        return chunk < 32 ? 32 : chunk;
+    }
+    size_t segment_count() const { return segments_.size(); }
+    size_t directory_size() const { return directory_.size(); }
+
+   private:
+    struct alignas(64) Bucket {
+        uint8_t ctrl[kBucketSlots] = {};  // 0 when empty, else 0x80 | 7 bits of the hash
+        uint8_t used = 0;
+        value_type* slots[kBucketSlots] = {};
+    };
+
+    struct Segment {
+        Bucket buckets[kSegmentBuckets];
+        size_t local_depth = 0;  // Hash bits all of its keys share
+        size_t stashed = 0;      // Entries in the stash buckets
+    };
+
+    struct Position {
+        Segment* segment = nullptr;
+        Bucket* bucket = nullptr;
+        size_t slot = 0;
+        value_type* node() const { return bucket ? bucket->slots[slot] : nullptr; }
+    };
+
+    static constexpr size_t kMaxDepth = 48;
+
+    std::vector<Segment*> directory_;
+    std::vector<std::unique_ptr<Segment>> segments_;  // Owners, in creation order
+    size_t global_depth_ = 0;
+    size_t size_ = 0;
+
+    static void prefetch_line(const void* address) {
+#if defined(__GNUC__)
+        __builtin_prefetch(address);
+#else
+        (void)address;
+#endif
+    }
+
+    // Top global_depth bits pick the segment, bits 7 and up the bucket, bits 0-6 the fingerprint
+    size_t directory_index(uint64_t hash) const {
+        return global_depth_ == 0 ? 0 : static_cast<size_t>(hash >> (64 - global_depth_));
+    }
+    static size_t bucket_index(uint64_t hash) {
+        return static_cast<size_t>((hash >> 7) % kBuckets);
+    }
+    static uint8_t fingerprint(uint64_t hash) {
+        return static_cast<uint8_t>(0x80 | (hash & 0x7f));
+    }
+
+    Position locate(uint64_t hash, std::string_view key) const {
+        Segment* segment = directory_[directory_index(hash)];
+        uint8_t tag = fingerprint(hash);
+        auto search = [&](size_t index, Position& position) {
+            Bucket& bucket = segment->buckets[index];
+            for (size_t i = 0; i < kBucketSlots; ++i) {
+                if (bucket.ctrl[i] == tag && bucket.slots[i]->first == key) {
+                    position = {segment, &bucket, i};
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        Position position;
+        size_t home = bucket_index(hash);
+        if (search(home, position) || search((home + 1) % kBuckets, position)) return position;
+        for (size_t i = kBuckets; segment->stashed > 0 && i < kSegmentBuckets; ++i) {
+            if (search(i, position)) return position;
+        }
+        return position;
+    }
+
+    // The emptier of home and neighbour, else the stash; false if all are full
+    static bool place(Segment& segment, uint64_t hash, value_type* node) {
+        size_t home = bucket_index(hash);
+        Bucket* target = &segment.buckets[home];
+        Bucket* neighbour = &segment.buckets[(home + 1) % kBuckets];
+        if (neighbour->used < target->used) target = neighbour;
+        for (size_t i = kBuckets; target->used == kBucketSlots && i < kSegmentBuckets; ++i) {
+            target = &segment.buckets[i];
+        }
+        if (target->used == kBucketSlots) return false;
+
+        size_t slot = 0;
+        while (target->slots[slot]) ++slot;
+        target->ctrl[slot] = fingerprint(hash);
+        target->slots[slot] = node;
+        ++target->used;
+        if (target >= segment.buckets + kBuckets) ++segment.stashed;
+        return true;
+    }
+
+    void split(size_t index) {
+        Segment* old = directory_[index];
+        if (old->local_depth == global_depth_) {
+            // The one global step left: the directory, 8 bytes per slot, doubles
+            if (global_depth_ == kMaxDepth) throw std::length_error("DashTable directory is full");
+            std::vector<Segment*> doubled(directory_.size() * 2);
+            for (size_t i = 0; i < directory_.size(); ++i) {
+                doubled[2 * i] = doubled[2 * i + 1] = directory_[i];
+            }
+            directory_.swap(doubled);
+            ++global_depth_;
+            index *= 2;
+        }
+
+        // Keys with the next hash bit set move over, each to the same bucket and slot, which
+        // cannot fail and keeps them where a lookup expects them
+        auto fresh = std::make_unique<Segment>();
+        size_t bit = 63 - old->local_depth;
+        for (size_t b = 0; b < kSegmentBuckets; ++b) {
+            Bucket& from = old->buckets[b];
+            for (size_t i = 0; i < kBucketSlots; ++i) {
+                if (!from.slots[i]) continue;
+                if (((hash_key(from.slots[i]->first) >> bit) & 1) == 0) continue;
+                Bucket& to = fresh->buckets[b];
+                to.ctrl[i] = from.ctrl[i];
+                to.slots[i] = from.slots[i];
+                ++to.used;
+                from.ctrl[i] = 0;
+                from.slots[i] = nullptr;
+                --from.used;
+                if (b >= kBuckets) {
+                    ++fresh->stashed;
+                    --old->stashed;
+                }
+            }
+        }
+        fresh->local_depth = ++old->local_depth;
+
+        // The old segment's directory slots are a run; its upper half now goes to the new one
+        size_t span = size_t{1} << (global_depth_ - old->local_depth + 1);
+        size_t first = index & ~(span - 1);
+        for (size_t i = first + span / 2; i < first + span; ++i) directory_[i] = fresh.get();
+        segments_.push_back(std::move(fresh));
+    }
+};
+
+}  // namespace storage
+}  // namespace redis_clone
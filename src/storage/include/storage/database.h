@@ -1,27 +1,196 @@
 #pragma once
+#include <cstdint>
+#include <memory>
 #include <optional>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "storage/dash_table.h"
+#include "storage/key_hash.h"
+#include "storage/ordered_index.h"
+#include "storage/shared_value.h"
+#include "storage/storage_engine.h"
+#include "storage/value_log.h"
 
 namespace redis_clone {
 namespace storage {
 
+/**
+ * Settings for spilling cold values to the on-disk value log
+ */
+struct TieringOptions {
+    std::string log_path = "data/values.log";
+    size_t max_hot_memory = 0;       // Evict once memory_usage() goes above this
+    size_t min_value_size = 64;      // Smaller values are not worth a disk round trip
+    size_t eviction_samples = 5;     // Candidates compared per eviction, like maxmemory-samples
+    uint64_t compaction_min_size = ValueLog::kDefaultCompactionMinSize;
+};
+
+struct TieringStats {
+    size_t cold_keys = 0;
+    uint64_t evictions = 0;
+    uint64_t promotions = 0;
+    uint64_t log_size = 0;
+    uint64_t log_dead_bytes = 0;
+};
+
 /**
  * Simple key-value database layer
  *
- * Used by the threaded server implementation to demonstrate
- * separation between storage and networking layers.
+ * The default keyspace table, a DashTable so that growing it never needs a
+ * second copy of itself. Not thread-safe on its own: the event-driven
+ * server owns one from its single execution thread, and ConcurrentDatabase
+ * wraps it for shared use. An ordered key index can be switched on for
+ * prefix/range scans; lookups always go through the hash table.
+ *
+ * With tiering enabled, values of rarely used keys are moved to a ValueLog
+ * and only a stub (offset + length) stays in memory. get() still works on
+ * cold keys by reading synchronously; the event loop uses cold_location()
+ * to read them off-thread instead. LFU counters are only maintained when
+ * tiering is on, which is why it is not offered by the concurrent wrappers.
+ *
+ * Values are SharedValues. get_shared() and copy() hand out a reference to
+ * the stored bytes rather than a copy, and set() replaces the pointer.
+ * memory_usage() counts a value once per key that refers to it.
+ *
+ * For incremental checkpoints every set() stamps the entry with the current
+ * epoch, and with change tracking on del() leaves a tombstone stamped the
+ * same way. A checkpoint closes the epoch and writes only what is stamped
+ * after the previous checkpoint's epoch.
  */
 class Database {
    public:
     void set(const std::string& key, const std::string& value);
+    void set(const std::string& key, SharedValue value);
     std::optional<std::string> get(const std::string& key) const;
+    // The stored value itself, no copy; null if the key does not exist
+    SharedValue get_shared(const std::string& key) const;
     bool del(const std::string& key);
     bool exists(const std::string& key) const;
+    // Points destination at source's value; false if source is missing, or destination
+    // exists and replace is not set
+    bool copy(const std::string& source, const std::string& destination, bool replace);
+
+    // Cache warm-up ahead of a batch of lookups, e.g. a pipelined run of GETs
+    void prefetch(const std::vector<const std::string*>& keys) const;
+
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+        for (const auto& [key, entry] : data_) {
+            if (entry.cold) {
+                auto value = read_cold(entry);
+                if (value) fn(key, *value);
+            } else {
+                fn(key, *entry.value);
+            }
+        }
+    }
+
+    // Keys and references to their values as of now, for a checkpoint written off this
+    // thread while writes go on: a key copy per entry, never a value copy
+    struct PinnedKeyspace {
+        std::vector<std::pair<std::string, SharedValue>> entries;
+        std::vector<std::string> deleted;  // Tombstones, for a delta
+    };
+    PinnedKeyspace pin_all() const;
+    PinnedKeyspace pin_changed_since(uint32_t epoch) const;
+
+    // Change tracking for incremental checkpoints
+    void enable_change_tracking() { track_deletions_ = true; }
+    bool change_tracking_enabled() const { return track_deletions_; }
+    uint32_t current_epoch() const { return epoch_; }
+    void set_epoch(uint32_t epoch) { epoch_ = epoch; }
+    // Close the current epoch and return it; later changes are stamped with the next one
+    uint32_t advance_epoch() { return epoch_++; }
+    size_t count_changed_since(uint32_t epoch) const;
+    size_t deletions_tracked() const { return deleted_.size(); }
+    // Drop tombstones a checkpoint through this epoch has persisted
+    void forget_deletions_through(uint32_t epoch);
+
+    template <typename Fn>
+    void for_each_changed_since(uint32_t epoch, Fn&& fn) const {
+        for (const auto& [key, entry] : data_) {
+            if (entry.epoch <= epoch) continue;
+            if (entry.cold) {
+                auto value = read_cold(entry);
+                if (value) fn(key, *value);
+            } else {
+                fn(key, *entry.value);
+            }
+        }
+    }
+
+    template <typename Fn>
+    void for_each_deleted_since(uint32_t epoch, Fn&& fn) const {
+        for (const auto& [key, deleted_in] : deleted_) {
+            if (deleted_in > epoch) fn(key);
+        }
+    }
+
+    size_t size() const { return data_.size(); }
+    // Bytes the keyspace table takes: buckets, directory and entry nodes, see DashTable
+    size_t table_overhead() const { return data_.memory_overhead(); }
+    size_t memory_usage() const {
+        return memory_usage_ + (index_ ? index_->memory_usage() : 0);
+    }
+
+    // Builds the index from the current keys and keeps it updated on set/del
+    void enable_ordered_index();
+    bool has_ordered_index() const { return index_ != nullptr; }
+    std::vector<std::string> scan_keys(const KeyRange& range, size_t count) const;
+
+    // Tiered storage, see TieringOptions. Throws if the log cannot be opened
+    void enable_tiering(const TieringOptions& options);
+    bool tiering_enabled() const { return log_ != nullptr; }
+    void set_max_hot_memory(size_t bytes) { tiering_.max_hot_memory = bytes; }
+    std::optional<ValueLog::Location> cold_location(const std::string& key) const;
+    // Bring a value read off-thread back into memory if the key is still that cold record
+    bool promote(const std::string& key, const ValueLog::Location& location, std::string value);
+    // Spill least frequently used values until under the limit; returns how many moved
+    size_t evict_cold_values(size_t max_evictions);
+    // Starts a log compaction when enough of it is dead; nullptr otherwise
+    std::shared_ptr<ValueLog::Compaction> prepare_compaction();
+    void finish_compaction(ValueLog::Compaction& job);
+    TieringStats tiering_stats() const;
 
    private:
-    std::unordered_map<std::string, std::string> data_;
+    struct Entry {
+        SharedValue value;  // Null while cold
+        uint64_t log_offset = 0;
+        uint32_t log_length = 0;
+        bool cold = false;
+        // Redis-style LFU: logarithmic counter decayed per idle minute
+        mutable uint8_t lfu_counter = kLfuInitValue;
+        mutable uint16_t lfu_minutes = 0;
+        uint32_t epoch = 0;  // Checkpoint epoch of the last set()
+
+        size_t value_size() const { return value ? value->size() : 0; }
+    };
+
+    static constexpr uint8_t kLfuInitValue = 5;
+
+    DashTable<Entry> data_;
+    size_t memory_usage_ = 0;
+    std::unique_ptr<OrderedIndex> index_;
+
+    TieringOptions tiering_;
+    std::unique_ptr<ValueLog> log_;
+    size_t cold_keys_ = 0;
+    uint64_t evictions_ = 0;
+    uint64_t promotions_ = 0;
+
+    uint32_t epoch_ = 1;
+    bool track_deletions_ = false;
+    // Tombstones: key -> epoch of del()
+    std::unordered_map<std::string, uint32_t, KeyHash> deleted_;
+
+    std::optional<std::string> read_cold(const Entry& entry) const;
+    void release_cold(const std::string& key, Entry& entry);
+    void touch(const Entry& entry) const;
+    static uint8_t decayed_counter(const Entry& entry, uint16_t now);
 };
 
 }  // namespace storage
-}  // namespace redis_clone
\ No newline at end of file
+}  // namespace redis_clone
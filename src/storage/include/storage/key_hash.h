@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace redis_clone {
+namespace storage {
+
+/**
+ * Keyspace hash functions
+ *
+ * std::hash<std::string> is unseeded on libstdc++, so a client can send keys
+ * that all land in one bucket and turn every lookup into a list walk. The
+ * keyspace instead hashes with a key drawn at random once per process:
+ * SipHash-1-3 by default (what Redis uses for its dict), or wyhash, which is
+ * faster on short keys but offers no cryptographic guarantee about the seed.
+ * The choice is made at build time with -DREDIS_CLONE_KEY_HASH=siphash|wyhash.
+ */
+struct KeyHashSeed {
+    uint64_t k0;
+    uint64_t k1;
+};
+
+// Random per process, fixed for its lifetime
+const KeyHashSeed& key_hash_seed();
+
+uint64_t siphash13(const void* data, size_t len, const KeyHashSeed& seed);
+uint64_t siphash24(const void* data, size_t len, const KeyHashSeed& seed);
+uint64_t wyhash(const void* data, size_t len, uint64_t seed);
+
+// The build's keyspace hash with the process seed
+uint64_t hash_key(std::string_view key);
+const char* key_hash_name();
+
+// Owner of key among shards, from bits 32-63. A shard's DashTable reads the top
+// global_depth bits for the segment, bits 7 and up for the bucket and bits 0-6 for the
+// fingerprint. With 2^n shards only bits 32 to 32+n-1 are fixed, which the directory
+// reaches only at 2^(33-n) slots, so all three still spread a shard's keys.
+// Other counts fix (hash >> 32) % shards, which leaves bits 0-31 and the top bits even
+inline size_t key_shard(std::string_view key, size_t shards) {
+    return static_cast<size_t>(hash_key(key) >> 32) % shards;
+}
+
+/** Hasher for keyspace containers */
+struct KeyHash {
+    size_t operator()(const std::string& key) const noexcept {
+        return static_cast<size_t>(hash_key(key));
+    }
+};
+
+}  // namespace storage
+}  // namespace redis_clone
@@ -0,0 +1,111 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace redis_clone {
+namespace storage {
+
+/**
+ * Bounds for an ordered key scan
+ *
+ * Unbounded sides ignore their key. Used by SCANPREFIX/SCANRANGE.
+ */
+struct KeyRange {
+    std::string start;
+    bool start_inclusive = true;
+    bool start_unbounded = true;
+
+    std::string end;
+    bool end_inclusive = true;
+    bool end_unbounded = true;
+
+    // True once key has moved past the end bound
+    bool past_end(const std::string& key) const {
+        if (end_unbounded) return false;
+        int cmp = key.compare(end);
+        return cmp > 0 || (cmp == 0 && !end_inclusive);
+    }
+
+    // Range covering every key that starts with prefix
+    static KeyRange for_prefix(const std::string& prefix);
+};
+
+/**
+ * Ordered secondary index over the keyspace (B+-tree of keys)
+ *
+ * The hash table stays the primary lookup structure; this index only exists
+ * so keys can be listed in lexicographic order for prefix and range scans.
+ * Leaves are linked for cheap in-order iteration. Deletes drop empty nodes
+ * but do not merge underfull siblings, which keeps erase simple at the cost
+ * of some slack after heavy churn.
+ */
+class OrderedIndex {
+   public:
+    static constexpr size_t kMaxKeysPerNode = 64;
+
+   private:
+    struct Node {
+        bool leaf = true;
+        std::vector<std::string> keys;
+        std::vector<std::unique_ptr<Node>> children;  // Internal nodes only
+        Node* prev = nullptr;                         // Leaf siblings
+        Node* next = nullptr;
+    };
+
+   public:
+    /**
+     * Forward iterator over keys in ascending order
+     */
+    class Iterator {
+       public:
+        bool valid() const { return leaf_ != nullptr; }
+        const std::string& key() const { return leaf_->keys[index_]; }
+        void next();
+
+       private:
+        friend class OrderedIndex;
+        Iterator(const Node* leaf, size_t index);
+
+        const Node* leaf_;
+        size_t index_;
+    };
+
+    OrderedIndex();
+    ~OrderedIndex();
+
+    OrderedIndex(const OrderedIndex&) = delete;
+    OrderedIndex& operator=(const OrderedIndex&) = delete;
+
+    bool insert(const std::string& key);
+    bool erase(const std::string& key);
+    bool contains(const std::string& key) const;
+
+    Iterator begin() const;
+    Iterator lower_bound(const std::string& key) const;  // First key >= key
+    Iterator upper_bound(const std::string& key) const;  // First key > key
+
+    // Up to count keys inside range, in order
+    std::vector<std::string> scan(const KeyRange& range, size_t count) const;
+
+    size_t size() const { return size_; }
+    size_t memory_usage() const {
+        return key_bytes_ + size_ * sizeof(std::string) + node_count_ * sizeof(Node);
+    }
+
+   private:
+    std::unique_ptr<Node> root_;
+    size_t size_ = 0;
+    size_t key_bytes_ = 0;
+    size_t node_count_ = 1;
+
+    const Node* find_leaf(const std::string& key) const;
+    std::unique_ptr<Node> insert_into(Node* node, const std::string& key, std::string& separator,
+                                      bool& inserted);
+    bool erase_from(Node* node, const std::string& key);
+    void unlink_leaf(Node* leaf);
+};
+
+}  // namespace storage
+}  // namespace redis_clone
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "storage/concurrent_database.h"
+
+namespace redis_clone {
+namespace storage {
+
+/**
+ * Keyspace split over independently locked ConcurrentDatabase shards
+ *
+ * Keys are routed by hash, so threads working on different keys rarely touch
+ * the same lock. Iteration visits one shard at a time and is therefore not an
+ * atomic snapshot of the whole keyspace.
+ */
+class ShardedDatabase {
+   public:
+    explicit ShardedDatabase(size_t num_shards = 16);
+
+    void set(const std::string& key, const std::string& value);
+    std::optional<std::string> get(const std::string& key) const;
+    bool del(const std::string& key);
+    bool exists(const std::string& key) const;
+    SharedValue get_shared(const std::string& key) const;
+    // Keys on different shards are locked one after the other, not together
+    bool copy(const std::string& source, const std::string& destination, bool replace);
+
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+        for (const auto& shard : shards_) {
+            shard.for_each(fn);
+        }
+    }
+
+    size_t size() const;
+    size_t memory_usage() const;
+
+    // Ordered scans merge the per-shard indexes
+    void enable_ordered_index();
+    bool has_ordered_index() const;
+    std::vector<std::string> scan_keys(const KeyRange& range, size_t count) const;
+
+    size_t shard_count() const { return shards_.size(); }
+    size_t shard_for(const std::string& key) const;
+
+   private:
+    std::vector<ConcurrentDatabase> shards_;
+};
+
+}  // namespace storage
+}  // namespace redis_clone
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace redis_clone {
+namespace storage {
+
+/**
+ * A value's bytes, immutable and reference counted
+ *
+ * The keyspace holds every value through one of these, so handing a value
+ * out costs a reference instead of a copy: a large GET reply goes to the
+ * socket straight from it, COPY points a second key at it, and a fork-less
+ * checkpoint pins it while a thread writes it out. Nothing modifies a value
+ * in place. A write builds a new one and swaps the pointer, so a holder keeps
+ * the bytes it took. The count is atomic, so holders may live on any thread.
+ */
+using SharedValue = std::shared_ptr<const std::string>;
+
+inline SharedValue make_shared_value(std::string value) {
+    return std::make_shared<const std::string>(std::move(value));
+}
+
+}  // namespace storage
+}  // namespace redis_clone
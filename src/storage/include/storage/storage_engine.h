@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "storage/ordered_index.h"
+
+namespace redis_clone {
+namespace storage {
+
+/**
+ * Storage engine concept
+ *
+ * Command handlers are templates over the keyspace type, so any class that
+ * provides the members below can back a server without virtual dispatch:
+ *
+ *   std::optional<std::string> get(const std::string& key) const;
+ *   void set(const std::string& key, const std::string& value);
+ *   bool del(const std::string& key);               // true if the key existed
+ *   bool exists(const std::string& key) const;
+ *   void for_each(Fn&& fn) const;                   // fn(key, value) per entry
+ *   size_t size() const;                            // number of keys
+ *   size_t memory_usage() const;                    // approximate bytes used
+ *
+ * Engines decide their own thread-safety: Database is single-threaded,
+ * ConcurrentDatabase and ShardedDatabase can be shared between threads.
+ *
+ * Optional capabilities, detected separately with supports_ordered_scan:
+ *
+ *   bool has_ordered_index() const;
+ *   std::vector<std::string> scan_keys(const KeyRange& range, size_t count) const;
+ *
+ * and with supports_copy:
+ *
+ *   bool copy(const std::string& source, const std::string& destination, bool replace);
+ */
+template <typename T, typename = void>
+struct is_storage_engine : std::false_type {};
+
+template <typename T>
+struct is_storage_engine<
+    T, std::void_t<
+           decltype(std::declval<const T&>().get(std::declval<const std::string&>())),
+           decltype(std::declval<T&>().set(std::declval<const std::string&>(),
+                                           std::declval<const std::string&>())),
+           decltype(std::declval<T&>().del(std::declval<const std::string&>())),
+           decltype(std::declval<const T&>().exists(std::declval<const std::string&>())),
+           decltype(std::declval<const T&>().for_each(
+               std::declval<void (*)(const std::string&, const std::string&)>())),
+           decltype(std::declval<const T&>().size()),
+           decltype(std::declval<const T&>().memory_usage())>>
+    : std::bool_constant<
+          std::is_same_v<decltype(std::declval<const T&>().get(
+                             std::declval<const std::string&>())),
+                         std::optional<std::string>> &&
+          std::is_convertible_v<decltype(std::declval<T&>().del(
+                                    std::declval<const std::string&>())),
+                                bool> &&
+          std::is_convertible_v<decltype(std::declval<const T&>().exists(
+                                    std::declval<const std::string&>())),
+                                bool> &&
+          std::is_convertible_v<decltype(std::declval<const T&>().size()), size_t>> {};
+
+template <typename T>
+inline constexpr bool is_storage_engine_v = is_storage_engine<T>::value;
+
+template <typename T, typename = void>
+struct supports_ordered_scan : std::false_type {};
+
+template <typename T>
+struct supports_ordered_scan<
+    T, std::void_t<decltype(std::declval<const T&>().has_ordered_index()),
+                   decltype(std::declval<const T&>().scan_keys(std::declval<const KeyRange&>(),
+                                                               size_t{}))>> : std::true_type {};
+
+template <typename T>
+inline constexpr bool supports_ordered_scan_v = supports_ordered_scan<T>::value;
+
+template <typename T, typename = void>
+struct supports_copy : std::false_type {};
+
+template <typename T>
+struct supports_copy<T, std::void_t<decltype(std::declval<T&>().copy(
+                            std::declval<const std::string&>(),
+                            std::declval<const std::string&>(), bool{}))>> : std::true_type {};
+
+template <typename T>
+inline constexpr bool supports_copy_v = supports_copy<T>::value;
+
+/**
+ * Rough per-entry bookkeeping cost (hash node, bucket slot, string headers)
+ */
+constexpr size_t kEntryOverhead = 64;
+
+}  // namespace storage
+}  // namespace redis_clone
@@ -0,0 +1,102 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace redis_clone {
+namespace storage {
+
+/**
+ * Append-only on-disk log holding values of cold keys
+ *
+ * Record layout: [u32 key length][u32 value length][key][value]. The
+ * in-memory entry keeps only the value offset and length, so a cold value
+ * costs a stub instead of its bytes. The log is a spill area, not a
+ * durability mechanism: it is truncated at startup and never fsynced.
+ *
+ * Only append/mark_dead/install_compaction are single-threaded; reading a
+ * Location is thread-safe and keeps the backing file open even if a
+ * compaction replaces it meanwhile.
+ */
+class ValueLog {
+   public:
+    struct File {
+        File(int fd, std::string path) : fd(fd), path(std::move(path)) {}
+        ~File();
+        File(const File&) = delete;
+        File& operator=(const File&) = delete;
+
+        int fd;
+        std::string path;
+    };
+
+    struct Location {
+        std::shared_ptr<const File> file;
+        uint64_t offset;
+        uint32_t length;
+    };
+
+    /**
+     * Rewrites live records into a fresh file; run() is safe off the main thread
+     */
+    struct Compaction {
+        struct Record {
+            std::string key;
+            uint64_t old_offset;
+            uint32_t length;
+            uint64_t new_offset = 0;
+        };
+
+        std::shared_ptr<const File> source;
+        std::string target_path;
+        std::vector<Record> records;
+        uint64_t new_size = 0;
+        bool ok = false;
+
+        void run();
+    };
+
+    explicit ValueLog(std::string path, uint64_t compaction_min_size = kDefaultCompactionMinSize);
+
+    ValueLog(const ValueLog&) = delete;
+    ValueLog& operator=(const ValueLog&) = delete;
+
+    // Returns the offset of the value bytes, or nullopt on I/O failure
+    std::optional<uint64_t> append(const std::string& key, const std::string& value);
+
+    Location locate(uint64_t offset, uint32_t length) const { return {file_, offset, length}; }
+    static std::optional<std::string> read(const Location& location);
+    // False for locations handed out before the last compaction
+    bool is_current(const Location& location) const { return location.file == file_; }
+
+    // A record stopped being referenced (overwrite, delete or promotion)
+    void mark_dead(size_t key_length, size_t value_length);
+
+    bool needs_compaction() const;
+    bool compaction_running() const { return compaction_running_; }
+    std::shared_ptr<Compaction> begin_compaction(std::vector<Compaction::Record> live);
+    // Swap in the compacted file; false if the job failed and the old log stays
+    bool install_compaction(Compaction& job);
+
+    uint64_t size_bytes() const { return size_; }
+    uint64_t dead_bytes() const { return dead_; }
+
+    static constexpr size_t kRecordHeaderSize = 8;
+    static constexpr uint64_t kDefaultCompactionMinSize = 16 * 1024 * 1024;
+
+   private:
+    std::string path_;
+    uint64_t compaction_min_size_;
+    std::shared_ptr<const File> file_;
+    uint64_t size_ = 0;
+    uint64_t dead_ = 0;
+    bool compaction_running_ = false;
+
+    static std::shared_ptr<const File> open_file(const std::string& path);
+};
+
+}  // namespace storage
+}  // namespace redis_clone
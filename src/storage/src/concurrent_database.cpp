@@ -0,0 +1,72 @@
+#include "storage/concurrent_database.h"
+
+#include <utility>
+
+namespace redis_clone {
+namespace storage {
+
+void ConcurrentDatabase::set(const std::string& key, const std::string& value) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    db_.set(key, value);
+}
+
+std::optional<std::string> ConcurrentDatabase::get(const std::string& key) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return db_.get(key);
+}
+
+bool ConcurrentDatabase::del(const std::string& key) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    return db_.del(key);
+}
+
+bool ConcurrentDatabase::exists(const std::string& key) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return db_.exists(key);
+}
+
+SharedValue ConcurrentDatabase::get_shared(const std::string& key) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return db_.get_shared(key);
+}
+
+bool ConcurrentDatabase::copy(const std::string& source, const std::string& destination,
+                              bool replace) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    return db_.copy(source, destination, replace);
+}
+
+bool ConcurrentDatabase::put(const std::string& key, SharedValue value, bool replace) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (!replace && db_.exists(key)) return false;
+    db_.set(key, std::move(value));
+    return true;
+}
+
+size_t ConcurrentDatabase::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return db_.size();
+}
+
+size_t ConcurrentDatabase::memory_usage() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return db_.memory_usage();
+}
+
+void ConcurrentDatabase::enable_ordered_index() {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    db_.enable_ordered_index();
+}
+
+bool ConcurrentDatabase::has_ordered_index() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return db_.has_ordered_index();
+}
+
+std::vector<std::string> ConcurrentDatabase::scan_keys(const KeyRange& range, size_t count) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return db_.scan_keys(range, count);
+}
+
+}  // namespace storage
+}  // namespace redis_clone
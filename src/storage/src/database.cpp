@@ -1,21 +1,410 @@
 #include "storage/database.h"
 
+#include <chrono>
+#include <random>
+
 namespace redis_clone {
 namespace storage {
 
-void Database::set(const std::string& key, const std::string& value) { data_[key] = value; }
+namespace {
+
+constexpr double kLfuLogFactor = 10.0;
+constexpr size_t kMaxSampleProbes = 64;
+
+std::mt19937& rng() {
+    static thread_local std::mt19937 generator{std::random_device{}()};
+    return generator;
+}
+
+inline void prefetch_line(const void* address) {
+#if defined(__GNUC__)
+    __builtin_prefetch(address);
+#else
+    (void)address;
+#endif
+}
+
+// Minute resolution is enough for decay and fits the 16 bits kept per entry
+uint16_t lfu_clock() {
+    auto minutes = std::chrono::duration_cast<std::chrono::minutes>(
+        std::chrono::steady_clock::now().time_since_epoch());
+    return static_cast<uint16_t>(minutes.count() & 0xffff);
+}
+
+}  // namespace
+
+void Database::set(const std::string& key, const std::string& value) {
+    set(key, make_shared_value(value));
+}
+
+void Database::set(const std::string& key, SharedValue value) {
+    auto [node, inserted] = data_.try_emplace(key);
+    Entry& entry = node->second;
+    if (inserted) {
+        memory_usage_ += key.size() + kEntryOverhead;
+        if (index_) index_->insert(key);
+    } else if (entry.cold) {
+        release_cold(key, entry);
+    } else {
+        memory_usage_ -= entry.value_size();
+    }
+    memory_usage_ += value->size();
+    entry.value = std::move(value);
+    entry.epoch = epoch_;
+    if (log_) touch(entry);
+
+    if (!deleted_.empty()) {
+        auto tombstone = deleted_.find(key);
+        if (tombstone != deleted_.end()) {
+            memory_usage_ -= key.size() + kEntryOverhead;
+            deleted_.erase(tombstone);
+        }
+    }
+}
 
 std::optional<std::string> Database::get(const std::string& key) const {
-    auto it = data_.find(key);
-    if (it != data_.end()) {
-        return it->second;
+    const auto* node = data_.find(key);
+    if (!node) {
+        return std::nullopt;
+    }
+
+    const Entry& entry = node->second;
+    if (log_) touch(entry);
+    if (entry.cold) {
+        return read_cold(entry);
+    }
+    return *entry.value;
+}
+
+SharedValue Database::get_shared(const std::string& key) const {
+    const auto* node = data_.find(key);
+    if (!node) {
+        return nullptr;
+    }
+
+    const Entry& entry = node->second;
+    if (log_) touch(entry);
+    if (entry.cold) {
+        auto value = read_cold(entry);
+        return value ? make_shared_value(std::move(*value)) : nullptr;
+    }
+    return entry.value;
+}
+
+bool Database::del(const std::string& key) {
+    auto* node = data_.find(key);
+    if (!node) {
+        return false;
+    }
+
+    Entry& entry = node->second;
+    if (entry.cold) {
+        release_cold(key, entry);
+    }
+    memory_usage_ -= key.size() + entry.value_size() + kEntryOverhead;
+    if (index_) index_->erase(key);
+    data_.erase(key);
+
+    if (track_deletions_) {
+        auto [tombstone, inserted] = deleted_.try_emplace(key, epoch_);
+        if (inserted) {
+            memory_usage_ += key.size() + kEntryOverhead;
+        } else {
+            tombstone->second = epoch_;
+        }
+    }
+    return true;
+}
+
+size_t Database::count_changed_since(uint32_t epoch) const {
+    size_t count = 0;
+    for (const auto& [key, entry] : data_) {
+        if (entry.epoch > epoch) ++count;
+    }
+    return count;
+}
+
+void Database::forget_deletions_through(uint32_t epoch) {
+    for (auto it = deleted_.begin(); it != deleted_.end();) {
+        if (it->second <= epoch) {
+            memory_usage_ -= it->first.size() + kEntryOverhead;
+            it = deleted_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool Database::exists(const std::string& key) const { return data_.find(key) != nullptr; }
+
+bool Database::copy(const std::string& source, const std::string& destination, bool replace) {
+    SharedValue value = get_shared(source);
+    if (!value || (!replace && exists(destination))) {
+        return false;
+    }
+    if (source != destination) set(destination, std::move(value));
+    return true;
+}
+
+Database::PinnedKeyspace Database::pin_all() const {
+    PinnedKeyspace pinned;
+    pinned.entries.reserve(data_.size());
+    for (const auto& [key, entry] : data_) {
+        if (entry.cold) {
+            auto value = read_cold(entry);
+            if (value) pinned.entries.emplace_back(key, make_shared_value(std::move(*value)));
+        } else {
+            pinned.entries.emplace_back(key, entry.value);
+        }
+    }
+    return pinned;
+}
+
+Database::PinnedKeyspace Database::pin_changed_since(uint32_t epoch) const {
+    PinnedKeyspace pinned;
+    for_each_deleted_since(epoch, [&](const std::string& key) { pinned.deleted.push_back(key); });
+    for (const auto& [key, entry] : data_) {
+        if (entry.epoch <= epoch) continue;
+        if (entry.cold) {
+            auto value = read_cold(entry);
+            if (value) pinned.entries.emplace_back(key, make_shared_value(std::move(*value)));
+        } else {
+            pinned.entries.emplace_back(key, entry.value);
+        }
+    }
+    return pinned;
+}
+
+void Database::prefetch(const std::vector<const std::string*>& keys) const {
+    if (data_.empty()) return;
+
+    // Hash everything up front, so the table loads below follow each other with no work between
+    std::vector<uint64_t> hashes;
+    hashes.reserve(keys.size());
+    for (const std::string* key : keys) hashes.push_back(hash_key(*key));
+
+    // Independent loads: the CPU keeps all of these misses in flight at once, where
+    // one lookup at a time would wait out each in turn
+    for (uint64_t hash : hashes) data_.prefetch(hash);
+
+    // Then the entries the fingerprints point at, and their keys and values (short ones are
+    // inside the string)
+    std::vector<const DashTable<Entry>::value_type*> nodes;
+    nodes.reserve(hashes.size());
+    for (uint64_t hash : hashes) {
+        const auto* node = data_.peek(hash);
+        if (!node) continue;
+        nodes.push_back(node);
+        prefetch_line(node);
+    }
+    for (const auto* node : nodes) {
+        prefetch_line(node->first.data());
+        if (node->second.value) prefetch_line(node->second.value.get());
     }
-    return std::nullopt;
 }
 
-bool Database::del(const std::string& key) { return data_.erase(key) > 0; }
+void Database::enable_ordered_index() {
+    if (index_) return;
+
+    index_ = std::make_unique<OrderedIndex>();
+    for (const auto& [key, entry] : data_) {
+        index_->insert(key);
+    }
+}
 
-bool Database::exists(const std::string& key) const { return data_.find(key) != data_.end(); }
+std::vector<std::string> Database::scan_keys(const KeyRange& range, size_t count) const {
+    if (!index_) return {};
+    return index_->scan(range, count);
+}
+
+void Database::enable_tiering(const TieringOptions& options) {
+    if (log_) return;
+
+    log_ = std::make_unique<ValueLog>(options.log_path, options.compaction_min_size);
+    tiering_ = options;
+
+    uint16_t now = lfu_clock();
+    for (auto& [key, entry] : data_) {
+        entry.lfu_minutes = now;
+    }
+}
+
+std::optional<ValueLog::Location> Database::cold_location(const std::string& key) const {
+    if (!log_) return std::nullopt;
+
+    const auto* node = data_.find(key);
+    if (!node || !node->second.cold) {
+        return std::nullopt;
+    }
+    return log_->locate(node->second.log_offset, node->second.log_length);
+}
+
+bool Database::promote(const std::string& key, const ValueLog::Location& location,
+                       std::string value) {
+    auto* node = data_.find(key);
+    if (!node || !log_ || !log_->is_current(location)) {
+        return false;
+    }
+
+    // The key may have been overwritten or re-spilled while the read was in flight
+    Entry& entry = node->second;
+    if (!entry.cold || entry.log_offset != location.offset) {
+        return false;
+    }
+
+    release_cold(key, entry);
+    memory_usage_ += value.size();
+    entry.value = make_shared_value(std::move(value));
+    touch(entry);
+    ++promotions_;
+    return true;
+}
+
+size_t Database::evict_cold_values(size_t max_evictions) {
+    // Offsets must stay stable while a compaction is copying the log
+    if (!log_ || log_->compaction_running() || data_.empty()) {
+        return 0;
+    }
+
+    uint16_t now = lfu_clock();
+    std::uniform_int_distribution<size_t> pick_bucket(0, data_.bucket_count() - 1);
+    size_t evicted = 0;
+
+    while (evicted < max_evictions && memory_usage() > tiering_.max_hot_memory) {
+        // Random buckets give a cheap approximation of random key sampling
+        const std::string* victim_key = nullptr;
+        Entry* victim = nullptr;
+        uint8_t victim_counter = 0;
+        size_t sampled = 0;
+
+        auto sample_bucket = [&](size_t bucket) {
+            data_.for_each_in_bucket(bucket, [&](auto& node) {
+                Entry& entry = node.second;
+                if (sampled == tiering_.eviction_samples || entry.cold ||
+                    entry.value_size() < tiering_.min_value_size) {
+                    return;
+                }
+
+                ++sampled;
+                uint8_t counter = decayed_counter(entry, now);
+                if (!victim || counter < victim_counter) {
+                    victim_key = &node.first;
+                    victim = &entry;
+                    victim_counter = counter;
+                }
+            });
+        };
+
+        for (size_t probe = 0; probe < kMaxSampleProbes && sampled < tiering_.eviction_samples;
+             ++probe) {
+            sample_bucket(pick_bucket(rng()));
+        }
+
+        // Few hot candidates left: walk the table rather than give up early
+        if (sampled == 0) {
+            size_t start = pick_bucket(rng());
+            for (size_t i = 0; i < data_.bucket_count() && sampled == 0; ++i) {
+                sample_bucket((start + i) % data_.bucket_count());
+            }
+        }
+
+        if (!victim) break;
+
+        auto offset = log_->append(*victim_key, *victim->value);
+        if (!offset) break;
+
+        // Whoever else holds the value (a reply, a checkpoint) keeps it alive until done
+        memory_usage_ -= victim->value_size();
+        victim->log_offset = *offset;
+        victim->log_length = static_cast<uint32_t>(victim->value_size());
+        victim->cold = true;
+        victim->value.reset();
+
+        ++cold_keys_;
+        ++evictions_;
+        ++evicted;
+    }
+
+    return evicted;
+}
+
+std::shared_ptr<ValueLog::Compaction> Database::prepare_compaction() {
+    if (!log_ || !log_->needs_compaction()) {
+        return nullptr;
+    }
+
+    std::vector<ValueLog::Compaction::Record> live;
+    live.reserve(cold_keys_);
+    for (const auto& [key, entry] : data_) {
+        if (entry.cold) {
+            live.push_back({key, entry.log_offset, entry.log_length});
+        }
+    }
+    return log_->begin_compaction(std::move(live));
+}
+
+void Database::finish_compaction(ValueLog::Compaction& job) {
+    if (!log_->install_compaction(job)) {
+        return;
+    }
+
+    for (const auto& record : job.records) {
+        auto* node = data_.find(record.key);
+        if (node && node->second.cold && node->second.log_offset == record.old_offset) {
+            node->second.log_offset = record.new_offset;
+        } else {
+            // Overwritten, deleted or promoted while the copy was running
+            log_->mark_dead(record.key.size(), record.length);
+        }
+    }
+}
+
+TieringStats Database::tiering_stats() const {
+    TieringStats stats;
+    stats.cold_keys = cold_keys_;
+    stats.evictions = evictions_;
+    stats.promotions = promotions_;
+    if (log_) {
+        stats.log_size = log_->size_bytes();
+        stats.log_dead_bytes = log_->dead_bytes();
+    }
+    return stats;
+}
+
+std::optional<std::string> Database::read_cold(const Entry& entry) const {
+    return ValueLog::read(log_->locate(entry.log_offset, entry.log_length));
+}
+
+void Database::release_cold(const std::string& key, Entry& entry) {
+    log_->mark_dead(key.size(), entry.log_length);
+    entry.cold = false;
+    entry.log_offset = 0;
+    entry.log_length = 0;
+    --cold_keys_;
+}
+
+uint8_t Database::decayed_counter(const Entry& entry, uint16_t now) {
+    uint16_t idle_minutes = static_cast<uint16_t>(now - entry.lfu_minutes);
+    return idle_minutes >= entry.lfu_counter ? 0
+                                             : static_cast<uint8_t>(entry.lfu_counter - idle_minutes);
+}
+
+void Database::touch(const Entry& entry) const {
+    uint16_t now = lfu_clock();
+    uint8_t counter = decayed_counter(entry, now);
+
+    // Logarithmic increment: hot keys need exponentially more hits to climb
+    if (counter < 255) {
+        double base = counter > kLfuInitValue ? counter - kLfuInitValue : 0;
+        std::uniform_real_distribution<double> chance(0.0, 1.0);
+        if (chance(rng()) < 1.0 / (base * kLfuLogFactor + 1.0)) {
+            ++counter;
+        }
+    }
+
+    entry.lfu_counter = counter;
+    entry.lfu_minutes = now;
+}
 
 }  // namespace storage
-}  // namespace redis_clone
\ No newline at end of file
+}  // namespace redis_clone
@@ -0,0 +1,189 @@
+#include "storage/key_hash.h"
+
+#include <cstring>
+#include <random>
+
+namespace redis_clone {
+namespace storage {
+
+namespace {
+
+inline uint64_t rotl(uint64_t x, int b) { return (x << b) | (x >> (64 - b)); }
+
+// Little-endian loads, whatever the host order
+inline uint64_t load64(const uint8_t* p) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+#else
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i) v = (v << 8) | p[i];
+    return v;
+#endif
+}
+
+inline uint64_t load32(const uint8_t* p) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+#else
+    return static_cast<uint64_t>(p[0]) | static_cast<uint64_t>(p[1]) << 8 |
+           static_cast<uint64_t>(p[2]) << 16 | static_cast<uint64_t>(p[3]) << 24;
+#endif
+}
+
+struct SipState {
+    uint64_t v0, v1, v2, v3;
+
+    void round() {
+        v0 += v1;
+        v1 = rotl(v1, 13);
+        v1 ^= v0;
+        v0 = rotl(v0, 32);
+        v2 += v3;
+        v3 = rotl(v3, 16);
+        v3 ^= v2;
+        v0 += v3;
+        v3 = rotl(v3, 21);
+        v3 ^= v0;
+        v2 += v1;
+        v1 = rotl(v1, 17);
+        v1 ^= v2;
+        v2 = rotl(v2, 32);
+    }
+};
+
+template <int CompressionRounds, int FinalizationRounds>
+uint64_t siphash(const void* data, size_t len, const KeyHashSeed& seed) {
+    SipState s{seed.k0 ^ 0x736f6d6570736575ULL, seed.k1 ^ 0x646f72616e646f6dULL,
+               seed.k0 ^ 0x6c7967656e657261ULL, seed.k1 ^ 0x7465646279746573ULL};
+    auto compress = [&s](uint64_t m) {
+        s.v3 ^= m;
+        for (int i = 0; i < CompressionRounds; ++i) s.round();
+        s.v0 ^= m;
+    };
+
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    const uint8_t* end = p + (len & ~size_t{7});
+    for (; p != end; p += 8) compress(load64(p));
+
+    // Last block: the remaining bytes with the length in the top byte
+    uint64_t last = static_cast<uint64_t>(len) << 56;
+    for (size_t i = 0; i < (len & 7); ++i) last |= static_cast<uint64_t>(p[i]) << (8 * i);
+    compress(last);
+
+    s.v2 ^= 0xff;
+    for (int i = 0; i < FinalizationRounds; ++i) s.round();
+    return s.v0 ^ s.v1 ^ s.v2 ^ s.v3;
+}
+
+// 64x64 -> 128 bit multiply, returned as low and high halves
+inline void multiply(uint64_t& a, uint64_t& b) {
+#ifdef __SIZEOF_INT128__
+    __uint128_t r = static_cast<__uint128_t>(a) * b;
+    a = static_cast<uint64_t>(r);
+    b = static_cast<uint64_t>(r >> 64);
+#else
+    uint64_t ha = a >> 32, hb = b >> 32, la = static_cast<uint32_t>(a),
+             lb = static_cast<uint32_t>(b);
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t carry = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    carry += lo < t;
+    a = lo;
+    b = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+#endif
+}
+
+inline uint64_t mix(uint64_t a, uint64_t b) {
+    multiply(a, b);
+    return a ^ b;
+}
+
+constexpr uint64_t kWyP[4] = {0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL,
+                              0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL};
+
+KeyHashSeed random_seed() {
+    std::random_device device;
+    auto next = [&device] {
+        return static_cast<uint64_t>(device()) << 32 | static_cast<uint32_t>(device());
+    };
+    return {next(), next()};
+}
+
+}  // namespace
+
+const KeyHashSeed& key_hash_seed() {
+    static const KeyHashSeed seed = random_seed();
+    return seed;
+}
+
+uint64_t siphash13(const void* data, size_t len, const KeyHashSeed& seed) {
+    return siphash<1, 3>(data, len, seed);
+}
+
+uint64_t siphash24(const void* data, size_t len, const KeyHashSeed& seed) {
+    return siphash<2, 4>(data, len, seed);
+}
+
+uint64_t wyhash(const void* data, size_t len, uint64_t seed) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    seed ^= mix(seed ^ kWyP[0], kWyP[1]);
+    uint64_t a = 0, b = 0;
+    if (len <= 16) {
+        if (len >= 4) {
+            size_t shift = (len >> 3) << 2;
+            a = load32(p) << 32 | load32(p + shift);
+            b = load32(p + len - 4) << 32 | load32(p + len - 4 - shift);
+        } else if (len > 0) {
+            a = static_cast<uint64_t>(p[0]) << 16 | static_cast<uint64_t>(p[len >> 1]) << 8 |
+                p[len - 1];
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = mix(load64(p) ^ kWyP[1], load64(p + 8) ^ seed);
+                see1 = mix(load64(p + 16) ^ kWyP[2], load64(p + 24) ^ see1);
+                see2 = mix(load64(p + 32) ^ kWyP[3], load64(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = mix(load64(p) ^ kWyP[1], load64(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = load64(p + i - 16);
+        b = load64(p + i - 8);
+    }
+    a ^= kWyP[1];
+    b ^= seed;
+    multiply(a, b);
+    return mix(a ^ kWyP[0] ^ len, b ^ kWyP[1]);
+}
+
+uint64_t hash_key(std::string_view key) {
+#if defined(REDIS_CLONE_KEY_HASH_WYHASH)
+    return wyhash(key.data(), key.size(), key_hash_seed().k0);
+#else
+    return siphash13(key.data(), key.size(), key_hash_seed());
+#endif
+}
+
+const char* key_hash_name() {
+#if defined(REDIS_CLONE_KEY_HASH_WYHASH)
+    return "wyhash";
+#else
+    return "siphash-1-3";
+#endif
+}
+
+}  // namespace storage
+}  // namespace redis_clone
@@ -0,0 +1,235 @@
+#include "storage/ordered_index.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace redis_clone {
+namespace storage {
+
+KeyRange KeyRange::for_prefix(const std::string& prefix) {
+    KeyRange range;
+    if (prefix.empty()) return range;
+
+    range.start = prefix;
+    range.start_unbounded = false;
+
+    // Smallest string greater than every key with this prefix
+    std::string successor = prefix;
+    while (!successor.empty() && static_cast<unsigned char>(successor.back()) == 0xff) {
+        successor.pop_back();
+    }
+    if (!successor.empty()) {
+        successor.back() = static_cast<char>(static_cast<unsigned char>(successor.back()) + 1);
+        range.end = std::move(successor);
+        range.end_inclusive = false;
+        range.end_unbounded = false;
+    }
+    return range;
+}
+
+OrderedIndex::Iterator::Iterator(const Node* leaf, size_t index) : leaf_(leaf), index_(index) {
+    // Step over the end of a leaf (or an empty root) to the next real key
+    while (leaf_ != nullptr && index_ >= leaf_->keys.size()) {
+        leaf_ = leaf_->next;
+        index_ = 0;
+    }
+}
+
+void OrderedIndex::Iterator::next() { *this = Iterator(leaf_, index_ + 1); }
+
+OrderedIndex::OrderedIndex() : root_(std::make_unique<Node>()) {}
+
+OrderedIndex::~OrderedIndex() = default;
+
+const OrderedIndex::Node* OrderedIndex::find_leaf(const std::string& key) const {
+    const Node* node = root_.get();
+    while (!node->leaf) {
+        size_t child = std::upper_bound(node->keys.begin(), node->keys.end(), key) -
+                       node->keys.begin();
+        node = node->children[child].get();
+    }
+    return node;
+}
+
+bool OrderedIndex::contains(const std::string& key) const {
+    const Node* leaf = find_leaf(key);
+    return std::binary_search(leaf->keys.begin(), leaf->keys.end(), key);
+}
+
+OrderedIndex::Iterator OrderedIndex::begin() const {
+    const Node* node = root_.get();
+    while (!node->leaf) {
+        node = node->children.front().get();
+    }
+    return Iterator(node, 0);
+}
+
+OrderedIndex::Iterator OrderedIndex::lower_bound(const std::string& key) const {
+    const Node* leaf = find_leaf(key);
+    return Iterator(leaf, std::lower_bound(leaf->keys.begin(), leaf->keys.end(), key) -
+                              leaf->keys.begin());
+}
+
+OrderedIndex::Iterator OrderedIndex::upper_bound(const std::string& key) const {
+    const Node* leaf = find_leaf(key);
+    return Iterator(leaf, std::upper_bound(leaf->keys.begin(), leaf->keys.end(), key) -
+                              leaf->keys.begin());
+}
+
+std::vector<std::string> OrderedIndex::scan(const KeyRange& range, size_t count) const {
+    std::vector<std::string> keys;
+
+    Iterator it = range.start_unbounded ? begin()
+                  : range.start_inclusive ? lower_bound(range.start)
+                                          : upper_bound(range.start);
+    for (; it.valid() && keys.size() < count; it.next()) {
+        if (range.past_end(it.key())) break;
+        keys.push_back(it.key());
+    }
+    return keys;
+}
+
+bool OrderedIndex::insert(const std::string& key) {
+    std::string separator;
+    bool inserted = false;
+    std::unique_ptr<Node> right = insert_into(root_.get(), key, separator, inserted);
+
+    // Root split: grow the tree by one level
+    if (right) {
+        auto new_root = std::make_unique<Node>();
+        new_root->leaf = false;
+        new_root->keys.push_back(std::move(separator));
+        new_root->children.push_back(std::move(root_));
+        new_root->children.push_back(std::move(right));
+        root_ = std::move(new_root);
+        ++node_count_;
+    }
+
+    if (inserted) {
+        ++size_;
+        key_bytes_ += key.size();
+    }
+    return inserted;
+}
+
+std::unique_ptr<OrderedIndex::Node> OrderedIndex::insert_into(Node* node, const std::string& key,
+                                                              std::string& separator,
+                                                              bool& inserted) {
+    if (node->leaf) {
+        auto pos = std::lower_bound(node->keys.begin(), node->keys.end(), key);
+        if (pos != node->keys.end() && *pos == key) {
+            return nullptr;
+        }
+        node->keys.insert(pos, key);
+        inserted = true;
+
+        if (node->keys.size() <= kMaxKeysPerNode) {
+            return nullptr;
+        }
+
+        // Split the leaf and splice the new half into the leaf chain
+        auto right = std::make_unique<Node>();
+        size_t mid = node->keys.size() / 2;
+        right->keys.assign(std::make_move_iterator(node->keys.begin() + mid),
+                           std::make_move_iterator(node->keys.end()));
+        node->keys.resize(mid);
+
+        right->next = node->next;
+        right->prev = node;
+        if (node->next) node->next->prev = right.get();
+        node->next = right.get();
+
+        separator = right->keys.front();
+        ++node_count_;
+        return right;
+    }
+
+    size_t child = std::upper_bound(node->keys.begin(), node->keys.end(), key) - node->keys.begin();
+    std::string child_separator;
+    std::unique_ptr<Node> split =
+        insert_into(node->children[child].get(), key, child_separator, inserted);
+    if (!split) {
+        return nullptr;
+    }
+
+    node->keys.insert(node->keys.begin() + child, std::move(child_separator));
+    node->children.insert(node->children.begin() + child + 1, std::move(split));
+
+    if (node->keys.size() <= kMaxKeysPerNode) {
+        return nullptr;
+    }
+
+    // Split the internal node, promoting the middle separator
+    auto right = std::make_unique<Node>();
+    right->leaf = false;
+    size_t mid = node->keys.size() / 2;
+    separator = std::move(node->keys[mid]);
+    right->keys.assign(std::make_move_iterator(node->keys.begin() + mid + 1),
+                       std::make_move_iterator(node->keys.end()));
+    right->children.assign(std::make_move_iterator(node->children.begin() + mid + 1),
+                           std::make_move_iterator(node->children.end()));
+    node->keys.resize(mid);
+    node->children.resize(mid + 1);
+
+    ++node_count_;
+    return right;
+}
+
+bool OrderedIndex::erase(const std::string& key) {
+    if (!erase_from(root_.get(), key)) {
+        return false;
+    }
+
+    --size_;
+    key_bytes_ -= key.size();
+
+    // Shrink the tree while the root is just a pass-through
+    while (!root_->leaf && root_->children.size() == 1) {
+        std::unique_ptr<Node> child = std::move(root_->children.front());
+        root_ = std::move(child);
+        --node_count_;
+    }
+    if (!root_->leaf && root_->children.empty()) {
+        root_ = std::make_unique<Node>();
+    }
+    return true;
+}
+
+bool OrderedIndex::erase_from(Node* node, const std::string& key) {
+    if (node->leaf) {
+        auto pos = std::lower_bound(node->keys.begin(), node->keys.end(), key);
+        if (pos == node->keys.end() || *pos != key) {
+            return false;
+        }
+        node->keys.erase(pos);
+        return true;
+    }
+
+    size_t child = std::upper_bound(node->keys.begin(), node->keys.end(), key) - node->keys.begin();
+    Node* child_node = node->children[child].get();
+    if (!erase_from(child_node, key)) {
+        return false;
+    }
+
+    // Drop children that became empty; separators stay valid as bounds
+    bool empty = child_node->leaf ? child_node->keys.empty() : child_node->children.empty();
+    if (empty) {
+        if (child_node->leaf) unlink_leaf(child_node);
+        node->children.erase(node->children.begin() + child);
+        if (!node->keys.empty()) {
+            node->keys.erase(node->keys.begin() + (child > 0 ? child - 1 : 0));
+        }
+        --node_count_;
+    }
+    return true;
+}
+
+void OrderedIndex::unlink_leaf(Node* leaf) {
+    if (leaf->prev) leaf->prev->next = leaf->next;
+    if (leaf->next) leaf->next->prev = leaf->prev;
+    leaf->prev = leaf->next = nullptr;
+}
+
+}  // namespace storage
+}  // namespace redis_clone
@@ -0,0 +1,88 @@
+#include "storage/sharded_database.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "storage/key_hash.h"
+
+namespace redis_clone {
+namespace storage {
+
+ShardedDatabase::ShardedDatabase(size_t num_shards) : shards_(num_shards > 0 ? num_shards : 1) {}
+
+size_t ShardedDatabase::shard_for(const std::string& key) const {
+    return key_shard(key, shards_.size());
+}
+
+void ShardedDatabase::set(const std::string& key, const std::string& value) {
+    shards_[shard_for(key)].set(key, value);
+}
+
+std::optional<std::string> ShardedDatabase::get(const std::string& key) const {
+    return shards_[shard_for(key)].get(key);
+}
+
+bool ShardedDatabase::del(const std::string& key) { return shards_[shard_for(key)].del(key); }
+
+bool ShardedDatabase::exists(const std::string& key) const {
+    return shards_[shard_for(key)].exists(key);
+}
+
+SharedValue ShardedDatabase::get_shared(const std::string& key) const {
+    return shards_[shard_for(key)].get_shared(key);
+}
+
+bool ShardedDatabase::copy(const std::string& source, const std::string& destination,
+                           bool replace) {
+    size_t from = shard_for(source);
+    size_t to = shard_for(destination);
+    if (from == to) return shards_[from].copy(source, destination, replace);
+
+    // The value as of the read; the reference crosses shards, the bytes stay put
+    SharedValue value = shards_[from].get_shared(source);
+    return value && shards_[to].put(destination, std::move(value), replace);
+}
+
+size_t ShardedDatabase::size() const {
+    size_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard.size();
+    }
+    return total;
+}
+
+size_t ShardedDatabase::memory_usage() const {
+    size_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard.memory_usage();
+    }
+    return total;
+}
+
+void ShardedDatabase::enable_ordered_index() {
+    for (auto& shard : shards_) {
+        shard.enable_ordered_index();
+    }
+}
+
+bool ShardedDatabase::has_ordered_index() const { return shards_.front().has_ordered_index(); }
+
+std::vector<std::string> ShardedDatabase::scan_keys(const KeyRange& range, size_t count) const {
+    // Each shard contributes at most count keys; the smallest count overall win
+    std::vector<std::string> merged;
+    for (const auto& shard : shards_) {
+        std::vector<std::string> keys = shard.scan_keys(range, count);
+        std::vector<std::string> next;
+        next.reserve(std::min(merged.size() + keys.size(), count));
+        std::merge(std::make_move_iterator(merged.begin()), std::make_move_iterator(merged.end()),
+                   std::make_move_iterator(keys.begin()), std::make_move_iterator(keys.end()),
+                   std::back_inserter(next));
+        if (next.size() > count) next.resize(count);
+        merged = std::move(next);
+    }
+    return merged;
+}
+
+}  // namespace storage
+}  // namespace redis_clone
@@ -0,0 +1,179 @@
+#include "storage/value_log.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace redis_clone {
+namespace storage {
+
+namespace {
+
+void put_u32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out += static_cast<char>((value >> (8 * i)) & 0xff);
+    }
+}
+
+bool write_all(int fd, const char* data, size_t size, uint64_t offset) {
+    while (size > 0) {
+        ssize_t written = pwrite(fd, data, size, static_cast<off_t>(offset));
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+    return true;
+}
+
+bool read_all(int fd, char* data, size_t size, uint64_t offset) {
+    while (size > 0) {
+        ssize_t got = pread(fd, data, size, static_cast<off_t>(offset));
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        data += got;
+        size -= static_cast<size_t>(got);
+        offset += static_cast<uint64_t>(got);
+    }
+    return true;
+}
+
+}  // namespace
+
+ValueLog::File::~File() { close(fd); }
+
+std::shared_ptr<const ValueLog::File> ValueLog::open_file(const std::string& path) {
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return nullptr;
+    }
+    return std::make_shared<const File>(fd, path);
+}
+
+ValueLog::ValueLog(std::string path, uint64_t compaction_min_size)
+    : path_(std::move(path)), compaction_min_size_(compaction_min_size), file_(open_file(path_)) {
+    if (!file_) {
+        throw std::runtime_error("Failed to open value log " + path_ + ": " +
+                                 std::string(strerror(errno)));
+    }
+}
+
+std::optional<uint64_t> ValueLog::append(const std::string& key, const std::string& value) {
+    std::string record;
+    record.reserve(kRecordHeaderSize + key.size() + value.size());
+    put_u32(record, static_cast<uint32_t>(key.size()));
+    put_u32(record, static_cast<uint32_t>(value.size()));
+    record += key;
+    record += value;
+
+    if (!write_all(file_->fd, record.data(), record.size(), size_)) {
+        return std::nullopt;
+    }
+
+    uint64_t value_offset = size_ + kRecordHeaderSize + key.size();
+    size_ += record.size();
+    return value_offset;
+}
+
+std::optional<std::string> ValueLog::read(const Location& location) {
+    std::string value(location.length, '\0');
+    if (!read_all(location.file->fd, value.data(), value.size(), location.offset)) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+void ValueLog::mark_dead(size_t key_length, size_t value_length) {
+    dead_ += kRecordHeaderSize + key_length + value_length;
+}
+
+bool ValueLog::needs_compaction() const {
+    return !compaction_running_ && size_ >= compaction_min_size_ && dead_ * 2 >= size_;
+}
+
+std::shared_ptr<ValueLog::Compaction> ValueLog::begin_compaction(
+    std::vector<Compaction::Record> live) {
+    auto job = std::make_shared<Compaction>();
+    job->source = file_;
+    job->target_path = path_ + ".compact";
+    job->records = std::move(live);
+    compaction_running_ = true;
+    return job;
+}
+
+void ValueLog::Compaction::run() {
+    int fd = open(target_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return;
+    }
+
+    // Batch records into large sequential writes
+    constexpr size_t kFlushThreshold = 1024 * 1024;
+    std::string buffer;
+    uint64_t offset = 0;
+    ok = true;
+
+    for (auto& record : records) {
+        auto value = ValueLog::read({source, record.old_offset, record.length});
+        if (!value) {
+            ok = false;
+            break;
+        }
+
+        put_u32(buffer, static_cast<uint32_t>(record.key.size()));
+        put_u32(buffer, record.length);
+        buffer += record.key;
+        record.new_offset = new_size + buffer.size();
+        buffer += *value;
+
+        if (buffer.size() >= kFlushThreshold) {
+            if (!write_all(fd, buffer.data(), buffer.size(), offset)) {
+                ok = false;
+                break;
+            }
+            offset += buffer.size();
+            new_size += buffer.size();
+            buffer.clear();
+        }
+    }
+
+    if (ok && !buffer.empty()) {
+        ok = write_all(fd, buffer.data(), buffer.size(), offset);
+        new_size += buffer.size();
+    }
+
+    close(fd);
+    if (!ok) {
+        std::remove(target_path.c_str());
+    }
+}
+
+bool ValueLog::install_compaction(Compaction& job) {
+    compaction_running_ = false;
+    if (!job.ok) {
+        return false;
+    }
+
+    // Reopen without truncating; in-flight readers keep the old file alive
+    int fd = open(job.target_path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0 || std::rename(job.target_path.c_str(), path_.c_str()) != 0) {
+        if (fd >= 0) close(fd);
+        std::remove(job.target_path.c_str());
+        return false;
+    }
+
+    file_ = std::make_shared<const File>(fd, path_);
+    size_ = job.new_size;
+    dead_ = 0;
+    return true;
+}
+
+}  // namespace storage
+}  // namespace redis_clone
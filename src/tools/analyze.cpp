@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "persistence/snapshot_format.h"
+#include "storage/storage_engine.h"
+#include "tools.h"
+
+namespace redis_clone {
+namespace tools {
+
+namespace {
+
+// Below this a single thread is faster than starting more
+constexpr uint64_t kParallelScanMinSize = 16 * 1024 * 1024;
+constexpr size_t kTopPrefixes = 20;
+
+struct PrefixStats {
+    uint64_t keys = 0;
+    uint64_t memory = 0;
+};
+
+/**
+ * Per-thread accumulator, merged once every scan thread is done
+ */
+class KeyStats {
+   public:
+    KeyStats(size_t top, char delimiter) : top_(top), delimiter_(delimiter) {}
+
+    void add(const std::string& key, const std::string& value) {
+        uint64_t memory = key.size() + value.size() + storage::kEntryOverhead;
+        ++keys_;
+        key_bytes_ += key.size();
+        value_bytes_ += value.size();
+        memory_ += memory;
+
+        size_t split = key.find(delimiter_);
+        PrefixStats& prefix = prefixes_[split == std::string::npos ? "" : key.substr(0, split)];
+        ++prefix.keys;
+        prefix.memory += memory;
+
+        offer(memory, key);
+    }
+
+    void merge(KeyStats&& other) {
+        keys_ += other.keys_;
+        key_bytes_ += other.key_bytes_;
+        value_bytes_ += other.value_bytes_;
+        memory_ += other.memory_;
+        for (auto& [prefix, stats] : other.prefixes_) {
+            prefixes_[prefix].keys += stats.keys;
+            prefixes_[prefix].memory += stats.memory;
+        }
+        while (!other.biggest_.empty()) {
+            offer(other.biggest_.top().first, other.biggest_.top().second);
+            other.biggest_.pop();
+        }
+    }
+
+    void print() {
+        std::printf("Keys:            %llu\n", static_cast<unsigned long long>(keys_));
+        std::printf("Key bytes:       %llu\n", static_cast<unsigned long long>(key_bytes_));
+        std::printf("Value bytes:     %llu\n", static_cast<unsigned long long>(value_bytes_));
+        std::printf("Memory estimate: %llu (keys + values + %zu bytes per entry)\n",
+                    static_cast<unsigned long long>(memory_), storage::kEntryOverhead);
+
+        std::vector<std::pair<std::string, PrefixStats>> prefixes(prefixes_.begin(),
+                                                                  prefixes_.end());
+        std::sort(prefixes.begin(), prefixes.end(),
+                  [](const auto& a, const auto& b) { return a.second.memory > b.second.memory; });
+        std::printf("\nMemory by prefix (before '%c'):\n", delimiter_);
+        std::printf("  %-30s %12s %14s %7s\n", "prefix", "keys", "memory", "share");
+        for (size_t i = 0; i < prefixes.size() && i < kTopPrefixes; ++i) {
+            const auto& [prefix, stats] = prefixes[i];
+            std::printf("  %-30s %12llu %14llu %6.1f%%\n",
+                        prefix.empty() ? "(none)" : prefix.c_str(),
+                        static_cast<unsigned long long>(stats.keys),
+                        static_cast<unsigned long long>(stats.memory),
+                        memory_ ? 100.0 * stats.memory / memory_ : 0.0);
+        }
+        if (prefixes.size() > kTopPrefixes) {
+            std::printf("  ... %zu more prefixes\n", prefixes.size() - kTopPrefixes);
+        }
+
+        std::vector<std::pair<uint64_t, std::string>> biggest;
+        while (!biggest_.empty()) {
+            biggest.push_back(biggest_.top());
+            biggest_.pop();
+        }
+        std::printf("\nBiggest keys:\n");
+        for (auto it = biggest.rbegin(); it != biggest.rend(); ++it) {
+            std::printf("  %14llu  %s\n", static_cast<unsigned long long>(it->first),
+                        it->second.c_str());
+        }
+    }
+
+   private:
+    using Sized = std::pair<uint64_t, std::string>;
+
+    size_t top_;
+    char delimiter_;
+    uint64_t keys_ = 0;
+    uint64_t key_bytes_ = 0;
+    uint64_t value_bytes_ = 0;
+    uint64_t memory_ = 0;
+    std::unordered_map<std::string, PrefixStats> prefixes_;
+    // Min-heap of the top_ biggest keys seen so far
+    std::priority_queue<Sized, std::vector<Sized>, std::greater<Sized>> biggest_;
+
+    void offer(uint64_t memory, const std::string& key) {
+        if (top_ == 0) return;
+        if (biggest_.size() < top_) {
+            biggest_.emplace(memory, key);
+        } else if (memory > biggest_.top().first) {
+            biggest_.pop();
+            biggest_.emplace(memory, key);
+        }
+    }
+};
+
+bool parse_option(const std::string& arg, const std::string& name, std::string& value) {
+    if (arg.rfind(name, 0) != 0) return false;
+    value = arg.substr(name.size());
+    return true;
+}
+
+}  // namespace
+
+int analyze(const std::vector<std::string>& args) {
+    std::string path;
+    size_t threads = 0;
+    size_t top = 10;
+    char delimiter = ':';
+
+    for (const auto& arg : args) {
+        std::string value;
+        try {
+            if (parse_option(arg, "--threads=", value)) {
+                threads = std::stoul(value);
+            } else if (parse_option(arg, "--top=", value)) {
+                top = std::stoul(value);
+            } else if (parse_option(arg, "--delimiter=", value) && value.size() == 1) {
+                delimiter = value[0];
+            } else if (path.empty() && arg.rfind("--", 0) != 0) {
+                path = arg;
+            } else {
+                throw std::invalid_argument(arg);
+            }
+        } catch (const std::exception&) {
+            path.clear();
+            break;
+        }
+    }
+    if (path.empty()) {
+        std::cerr << "Usage: analyze <dump.json|aof> [--threads=N] [--top=N] [--delimiter=C]\n";
+        return 1;
+    }
+
+    KeyStats stats(top, delimiter);
+
+    if (!is_snapshot_file(path)) {
+        // Later commands override earlier ones, so an AOF has to be replayed in order
+        storage::Database db;
+        std::string error;
+        if (!replay_aof(path, db, error)) {
+            std::cerr << "Warning: " << error << "; analyzing the readable prefix\n";
+        }
+        db.for_each([&](const std::string& key, const std::string& value) {
+            stats.add(key, value);
+        });
+        std::printf("AOF %s\n\n", path.c_str());
+        stats.print();
+        return 0;
+    }
+
+    persistence::SnapshotReader snapshot(path);
+    if (!snapshot.is_open()) {
+        std::cerr << "Cannot read " << path << ": " << snapshot.error() << "\n";
+        return 1;
+    }
+    if (threads == 0) {
+        threads = snapshot.file_size() < kParallelScanMinSize
+                      ? 1
+                      : std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Each thread decodes its own slice of the data section into its own stats
+    std::vector<KeyStats> partial(threads, KeyStats(top, delimiter));
+    std::vector<std::string> errors(threads);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back([&, i] {
+            snapshot.for_each(
+                [&](std::string&& key, std::string&& value) { partial[i].add(key, value); },
+                errors[i], i, threads);
+        });
+    }
+    for (auto& worker : workers) worker.join();
+
+    for (size_t i = 0; i < threads; ++i) {
+        if (!errors[i].empty()) {
+            std::cerr << "Warning: " << errors[i] << "; skipped the rest of that slice\n";
+        }
+        stats.merge(std::move(partial[i]));
+    }
+
+    std::printf("Snapshot %s (%zu scan threads)\n\n", path.c_str(), threads);
+    stats.print();
+    return 0;
+}
+
+}  // namespace tools
+}  // namespace redis_clone
@@ -0,0 +1,166 @@
+#include <unistd.h>
+
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "persistence/aof_format.h"
+#include "tools.h"
+
+namespace redis_clone {
+namespace tools {
+
+using persistence::AofReader;
+using persistence::AofRecord;
+
+namespace {
+
+bool truncate_file(const std::string& path, uint64_t size) {
+    if (truncate(path.c_str(), static_cast<off_t>(size)) != 0) {
+        std::cerr << "Failed to truncate " << path << ": " << strerror(errno) << "\n";
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+bool replay_aof(const std::string& path, storage::Database& db, std::string& error) {
+    AofReader reader(path);
+    if (!reader.is_open()) {
+        error = std::string("cannot open: ") + strerror(errno);
+        return false;
+    }
+
+    AofRecord record;
+    while (reader.next(record)) {
+        if (record.type != AofRecord::Type::COMMAND || record.tokens.empty()) continue;
+
+        std::string command = record.tokens[0];
+        for (char& c : command) {
+            c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        }
+
+        if (command == "SET" && record.tokens.size() >= 3) {
+            db.set(record.tokens[1], record.tokens[2]);
+        } else if (command == "DEL") {
+            for (size_t i = 1; i < record.tokens.size(); ++i) db.del(record.tokens[i]);
+        }
+    }
+
+    error = reader.error();
+    return error.empty();
+}
+
+int trim_aof(const std::vector<std::string>& args) {
+    if (args.size() < 2 || args.size() > 3 || (args.size() == 3 && args[2] != "--dry-run")) {
+        std::cerr << "Usage: trim-aof <aof> <unix time> [--dry-run]\n";
+        return 1;
+    }
+    const std::string& path = args[0];
+    bool dry_run = args.size() == 3;
+
+    int64_t timestamp = 0;
+    try {
+        timestamp = std::stoll(args[1]);
+    } catch (const std::exception&) {
+        std::cerr << "Invalid unix time: " << args[1] << "\n";
+        return 1;
+    }
+
+    uint64_t cutoff = 0;
+    uint64_t data_size = 0;
+    {
+        AofReader reader(path);
+        if (!reader.is_open()) {
+            std::cerr << "Cannot open " << path << ": " << strerror(errno) << "\n";
+            return 1;
+        }
+        cutoff = persistence::find_aof_cutoff(reader, timestamp);
+        data_size = reader.data_size();
+        if (!reader.error().empty() && cutoff == reader.offset()) {
+            std::cout << "No marker after " << timestamp << " before a bad record ("
+                      << reader.error() << "); the bad tail is cut as well\n";
+        }
+    }
+
+    if (cutoff == data_size) {
+        std::cout << "Nothing after " << timestamp << " in " << path << "\n";
+        return 0;
+    }
+
+    std::cout << (dry_run ? "Would cut " : "Cutting ") << path << " at offset " << cutoff << ": "
+              << cutoff << " bytes kept, " << data_size - cutoff << " bytes dropped\n";
+    if (dry_run) return 0;
+    return truncate_file(path, cutoff) ? 0 : 1;
+}
+
+int check_aof(const std::vector<std::string>& args) {
+    if (args.empty() || args.size() > 2 || (args.size() == 2 && args[1] != "--fix")) {
+        std::cerr << "Usage: check-aof <aof> [--fix]\n";
+        return 1;
+    }
+    const std::string& path = args[0];
+    bool fix = args.size() == 2;
+
+    uint64_t commands = 0;
+    uint64_t markers = 0;
+    uint64_t unknown = 0;
+    uint64_t good_end = 0;
+    uint64_t data_size = 0;
+    std::string error;
+    {
+        AofReader reader(path);
+        if (!reader.is_open()) {
+            std::cerr << "Cannot open " << path << ": " << strerror(errno) << "\n";
+            return 1;
+        }
+
+        AofRecord record;
+        while (reader.next(record)) {
+            if (record.type == AofRecord::Type::TIMESTAMP) ++markers;
+            if (record.type != AofRecord::Type::COMMAND) continue;
+
+            ++commands;
+            std::string command = record.tokens.empty() ? "" : record.tokens[0];
+            for (char& c : command) {
+                c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+            }
+            bool known = (command == "SET" && record.tokens.size() == 3) ||
+                         (command == "DEL" && record.tokens.size() >= 2);
+            if (!known) ++unknown;
+        }
+        good_end = reader.offset();
+        data_size = reader.data_size();
+        error = reader.error();
+    }
+
+    std::cout << path << ": " << commands << " commands, " << markers << " timestamp markers, "
+              << data_size << " bytes of data\n";
+    if (unknown > 0) {
+        std::cout << "Warning: " << unknown << " commands are not SET/DEL with a valid arity\n";
+    }
+
+    if (error.empty()) {
+        std::cout << "AOF is valid\n";
+        return 0;
+    }
+
+    std::cout << "AOF is not valid: " << error << "\n"
+              << "The first " << good_end << " bytes are readable, " << data_size - good_end
+              << " bytes after them are not\n";
+    if (!fix) {
+        std::cout << "Run with --fix to truncate the AOF to its readable prefix\n";
+        return 1;
+    }
+    if (!truncate_file(path, good_end)) return 1;
+    std::cout << "Truncated " << path << " to " << good_end << " bytes\n";
+    return 0;
+}
+
+}  // namespace tools
+}  // namespace redis_clone
@@ -0,0 +1,56 @@
+/**
+ * Offline tools for redis-clone persistence files
+ *
+ * Run them against files the server is not writing to.
+ */
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "tools.h"
+
+namespace {
+
+void print_usage(const char* program_name) {
+    std::cout
+        << "Usage: " << program_name << " <command> [args]\n"
+        << "Commands:\n"
+        << "  check-aof <aof> [--fix]\n"
+        << "      Validate every record; --fix truncates a corrupt or torn tail\n"
+        << "  check-snapshot <dump.json>\n"
+        << "      Verify the checksum, every entry and the declared key count\n"
+        << "  merge-snapshot <dump.json>\n"
+        << "      Fold the incremental checkpoints next to a base into a new base\n"
+        << "  convert <input> <output>\n"
+        << "      AOF to snapshot or snapshot to AOF, by the input's format\n"
+        << "  analyze <dump.json|aof> [--threads=N] [--top=N] [--delimiter=C]\n"
+        << "      Key count, memory by key prefix and the biggest keys; large\n"
+        << "      snapshots are scanned by several threads\n"
+        << "  trim-aof <aof> <unix time> [--dry-run]\n"
+        << "      Cut the AOF at the first #TS marker later than the given time, so a\n"
+        << "      restart restores the dataset as it was then\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help") {
+        print_usage(argv[0]);
+        return argc < 2 ? 1 : 0;
+    }
+
+    std::string command = argv[1];
+    std::vector<std::string> args(argv + 2, argv + argc);
+
+    using namespace redis_clone::tools;
+    if (command == "check-aof") return check_aof(args);
+    if (command == "check-snapshot") return check_snapshot(args);
+    if (command == "merge-snapshot") return merge_snapshot(args);
+    if (command == "convert") return convert(args);
+    if (command == "analyze") return analyze(args);
+    if (command == "trim-aof") return trim_aof(args);
+
+    std::cerr << "Unknown command: " << command << "\n";
+    print_usage(argv[0]);
+    return 1;
+}
@@ -0,0 +1,167 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "persistence/aof_format.h"
+#include "persistence/background_writer.h"
+#include "persistence/snapshot_format.h"
+#include "tools.h"
+
+namespace redis_clone {
+namespace tools {
+
+using persistence::SnapshotReader;
+
+bool is_snapshot_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    char first = 0;
+    while (file.get(first)) {
+        if (first != ' ' && first != '\n' && first != '\r' && first != '\t') return first == '{';
+    }
+    return false;
+}
+
+int check_snapshot(const std::vector<std::string>& args) {
+    if (args.size() != 1) {
+        std::cerr << "Usage: check-snapshot <dump.json>\n";
+        return 1;
+    }
+    const std::string& path = args[0];
+
+    SnapshotReader snapshot(path);
+    if (!snapshot.is_open()) {
+        std::cout << "Snapshot is not valid: " << snapshot.error() << "\n";
+        return 1;
+    }
+
+    const auto& metadata = snapshot.metadata();
+    std::cout << path << ": version " << metadata.version << ", written " << metadata.timestamp
+              << ", " << metadata.key_count << " keys declared\n";
+    if (metadata.delta) {
+        std::cout << "Delta from epoch " << metadata.base_epoch << " to " << metadata.epoch << "\n";
+    } else if (metadata.epoch > 0) {
+        std::cout << "Base at epoch " << metadata.epoch << "\n";
+    }
+
+    bool valid = true;
+    switch (snapshot.verify_checksum()) {
+        case SnapshotReader::ChecksumStatus::OK:
+            std::cout << "Checksum OK\n";
+            break;
+        case SnapshotReader::ChecksumStatus::MISSING:
+            std::cout << "No checksum (written before version 1.1)\n";
+            break;
+        case SnapshotReader::ChecksumStatus::MISMATCH:
+            std::cout << "Checksum mismatch\n";
+            valid = false;
+            break;
+    }
+
+    uint64_t entries = 0;
+    std::string error;
+    uint64_t deleted = 0;
+    if (metadata.delta) {
+        if (snapshot.for_each_deleted([&](std::string&&) { ++deleted; }, error)) {
+            std::cout << deleted << " deleted keys\n";
+        } else {
+            std::cout << "Bad deleted key: " << error << "\n";
+            valid = false;
+        }
+    }
+    if (!snapshot.for_each([&](std::string&&, std::string&&) { ++entries; }, error)) {
+        std::cout << "Bad entry: " << error << " (" << entries << " entries read before it)\n";
+        valid = false;
+    } else if (entries != metadata.key_count) {
+        std::cout << "Entry count " << entries << " does not match key_count\n";
+        valid = false;
+    }
+
+    std::cout << (valid ? "Snapshot is valid\n" : "Snapshot is not valid\n");
+    return valid ? 0 : 1;
+}
+
+int merge_snapshot(const std::vector<std::string>& args) {
+    if (args.size() != 1) {
+        std::cerr << "Usage: merge-snapshot <dump.json>\n";
+        return 1;
+    }
+    const std::string& path = args[0];
+
+    persistence::SnapshotChain chain = persistence::find_snapshot_chain(path);
+    std::cout << path << ": " << chain.deltas.size() << " deltas up to epoch " << chain.epoch
+              << ", " << chain.stale.size() << " stale\n";
+
+    std::string error;
+    if (!persistence::merge_snapshot_chain(path, persistence::BackgroundWriterOptions(), error)) {
+        std::cout << "Merge failed: " << error << "\n";
+        return 1;
+    }
+    std::cout << (chain.deltas.empty() ? "Nothing to merge" : "Merged into " + path)
+              << (chain.stale.empty() ? "" : ", stale deltas removed") << "\n";
+    return 0;
+}
+
+int convert(const std::vector<std::string>& args) {
+    if (args.size() != 2) {
+        std::cerr << "Usage: convert <input> <output>\n";
+        return 1;
+    }
+    const std::string& input = args[0];
+    const std::string& output = args[1];
+    persistence::BackgroundWriterOptions options;
+
+    if (is_snapshot_file(input)) {
+        SnapshotReader snapshot(input);
+        persistence::BackgroundWriter aof(output, options);
+        if (!snapshot.is_open() || !aof.is_open()) {
+            std::cerr << "Cannot convert " << input << ": "
+                      << (snapshot.is_open() ? "cannot create " + output : snapshot.error())
+                      << "\n";
+            return 1;
+        }
+
+        uint64_t keys = 0;
+        std::string error;
+        bool ok = snapshot.for_each(
+            [&](std::string&& key, std::string&& value) {
+                aof << persistence::encode_aof_command({"SET", key, value});
+                ++keys;
+            },
+            error);
+        if (!aof.finish() || !ok) {
+            std::cerr << "Conversion failed: " << (ok ? "write error" : error) << "\n";
+            return 1;
+        }
+        std::cout << "Wrote " << keys << " keys from snapshot " << input << " to AOF " << output
+                  << "\n";
+        return 0;
+    }
+
+    storage::Database db;
+    std::string error;
+    if (!replay_aof(input, db, error)) {
+        std::cerr << "Cannot convert " << input << ": " << error
+                  << " (check-aof --fix drops a bad tail)\n";
+        return 1;
+    }
+
+    persistence::SnapshotWriter snapshot(output, options);
+    if (!snapshot.is_open()) {
+        std::cerr << "Cannot create " << output << "\n";
+        return 1;
+    }
+    snapshot.begin(db.size());
+    db.for_each(
+        [&](const std::string& key, const std::string& value) { snapshot.add(key, value); });
+    if (!snapshot.finish()) {
+        std::cerr << "Conversion failed: write error\n";
+        return 1;
+    }
+    std::cout << "Wrote " << db.size() << " keys from AOF " << input << " to snapshot " << output
+              << "\n";
+    return 0;
+}
+
+}  // namespace tools
+}  // namespace redis_clone
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "storage/database.h"
+
+namespace redis_clone {
+namespace tools {
+
+/**
+ * redis-clone-tools subcommands
+ *
+ * Each takes the arguments after the command name and returns the process
+ * exit code: 0 when the file is fine (or was fixed), 1 otherwise.
+ */
+int trim_aof(const std::vector<std::string>& args);
+int check_aof(const std::vector<std::string>& args);
+int check_snapshot(const std::vector<std::string>& args);
+int merge_snapshot(const std::vector<std::string>& args);
+int convert(const std::vector<std::string>& args);
+int analyze(const std::vector<std::string>& args);
+
+/**
+ * Replay the SET/DEL commands of an AOF into db, in order
+ *
+ * Returns false with error set if the file cannot be read or has a bad
+ * record; everything before the bad record has been applied.
+ */
+bool replay_aof(const std::string& path, storage::Database& db, std::string& error);
+
+// A dump.json starts with '{'; anything else is treated as an AOF
+bool is_snapshot_file(const std::string& path);
+
+}  // namespace tools
+}  // namespace redis_clone
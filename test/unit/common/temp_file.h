@@ -0,0 +1,43 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace redis_clone {
+namespace test {
+
+/**
+ * A file name in the working directory for one test, removed when it goes
+ *
+ * ctest runs the suites in parallel from the same directory, so the name
+ * carries the pid. Nothing is created until the test writes to path().
+ */
+class TempFile {
+   public:
+    explicit TempFile(const std::string& name, const std::string& extension = "")
+        : path_(name + "_" + std::to_string(getpid()) + extension) {}
+    ~TempFile() { std::remove(path_.c_str()); }
+
+    TempFile(const TempFile&) = delete;
+    TempFile& operator=(const TempFile&) = delete;
+
+    const std::string& path() const { return path_; }
+
+    // Everything in the file, empty if it does not exist
+    std::string contents() const {
+        std::ifstream file(path_, std::ios::binary);
+        std::stringstream contents;
+        contents << file.rdbuf();
+        return contents.str();
+    }
+
+   private:
+    std::string path_;
+};
+
+}  // namespace test
+}  // namespace redis_clone
@@ -0,0 +1,138 @@
+#include "config/config.h"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <string>
+
+#include "common/temp_file.h"
+
+using redis_clone::config::AppendFsync;
+using redis_clone::config::Config;
+using redis_clone::config::MaxmemoryPolicy;
+
+class ConfigTest : public ::testing::Test {
+   protected:
+    void write_file(const std::string& contents) {
+        std::ofstream file(file_.path());
+        file << contents;
+    }
+
+    redis_clone::test::TempFile file_{"config_test", ".conf"};
+};
+
+TEST_F(ConfigTest, DefaultsMatchRedis) {
+    Config config;
+    const auto& settings = config.snapshot();
+    ASSERT_EQ(settings.save_points.size(), 3u);
+    EXPECT_EQ(settings.save_points[0].seconds, 900);
+    EXPECT_EQ(settings.appendfsync, AppendFsync::EVERYSEC);
+    EXPECT_EQ(settings.auto_aof_rewrite_percentage, 100u);
+    EXPECT_EQ(settings.auto_aof_rewrite_min_size, 64u * 1024 * 1024);
+    EXPECT_TRUE(settings.client_priority_lane);
+}
+
+TEST_F(ConfigTest, LoadFile) {
+    write_file(
+        "# tuning for write-heavy load\n"
+        "save 60 1000\n"
+        "save 10 100000\n"
+        "appendfsync always\n"
+        "maxmemory 2gb\n"
+        "maxmemory-policy tiered\n");
+
+    Config config;
+    config.load_file(file_.path());
+    const auto& settings = config.snapshot();
+    ASSERT_EQ(settings.save_points.size(), 2u);
+    EXPECT_EQ(settings.save_points[1].changes, 100000);
+    EXPECT_EQ(settings.appendfsync, AppendFsync::ALWAYS);
+    EXPECT_EQ(settings.maxmemory, 2ull * 1024 * 1024 * 1024);
+    EXPECT_EQ(settings.maxmemory_policy, MaxmemoryPolicy::TIERED);
+}
+
+TEST_F(ConfigTest, LoadFileRejectsBadLines) {
+    write_file("appendfsync sometimes\n");
+    Config config;
+    EXPECT_THROW(config.load_file(file_.path()), std::runtime_error);
+
+    write_file("no-such-option 1\n");
+    EXPECT_THROW(config.load_file(file_.path()), std::runtime_error);
+}
+
+TEST_F(ConfigTest, SetPublishesNewSnapshot) {
+    Config config;
+    const auto& before = config.snapshot();
+
+    EXPECT_EQ(config.set("auto-aof-rewrite-percentage", "50"), "");
+    EXPECT_EQ(config.snapshot().auto_aof_rewrite_percentage, 50u);
+    // Readers holding the old version still see consistent values
+    EXPECT_EQ(before.auto_aof_rewrite_percentage, 100u);
+
+    EXPECT_EQ(config.set("save", ""), "");
+    EXPECT_TRUE(config.snapshot().save_points.empty());
+}
+
+TEST_F(ConfigTest, ReclaimKeepsOnlyTheCurrentVersion) {
+    Config config;
+    for (int i = 1; i <= 1000; ++i) config.set("maxmemory", std::to_string(i));
+    EXPECT_EQ(config.version_count(), 1001u);
+
+    config.reclaim();
+    EXPECT_EQ(config.version_count(), 1u);
+    EXPECT_EQ(config.snapshot().maxmemory, 1000u);
+    config.set("maxmemory", "5");
+    EXPECT_EQ(config.snapshot().maxmemory, 5u);
+}
+
+TEST_F(ConfigTest, SetRejectsInvalidAndImmutable) {
+    Config config;
+    EXPECT_NE(config.set("maxmemory", "lots"), "");
+    EXPECT_NE(config.set("save", "60"), "");
+    EXPECT_NE(config.set("unknown", "1"), "");
+    EXPECT_NE(config.set("appendonly", "no"), "");
+    EXPECT_EQ(config.set("appendonly", "no", true), "");
+    EXPECT_NE(config.set("client-priority-lane", "maybe"), "");
+    EXPECT_EQ(config.set("client-priority-lane", "no"), "");
+    EXPECT_FALSE(config.snapshot().client_priority_lane);
+    EXPECT_FALSE(config.snapshot().appendonly);
+}
+
+TEST_F(ConfigTest, GetMatchesGlob) {
+    Config config;
+    auto all = config.get("*");
+    EXPECT_GE(all.size(), 9u);
+
+    auto aof = config.get("auto-aof-*");
+    ASSERT_EQ(aof.size(), 2u);
+    EXPECT_EQ(aof[0].first, "auto-aof-rewrite-percentage");
+    EXPECT_EQ(aof[0].second, "100");
+
+    auto save = config.get("SAVE");
+    ASSERT_EQ(save.size(), 1u);
+    EXPECT_EQ(save[0].second, "900 1 300 10 60 10000");
+}
+
+TEST_F(ConfigTest, RewriteKeepsCommentsAndUpdatesValues) {
+    write_file("# main settings\nappendfsync everysec\nsave 900 1\nsave 300 10\n");
+    Config config;
+    config.load_file(file_.path());
+
+    config.set("appendfsync", "no");
+    config.set("save", "120 5");
+    config.set("maxmemory", "1mb");
+    ASSERT_EQ(config.rewrite(), "");
+
+    EXPECT_EQ(file_.contents(),
+              "# main settings\nappendfsync no\nsave 120 5\nmaxmemory 1048576\n");
+
+    Config reloaded;
+    reloaded.load_file(file_.path());
+    EXPECT_EQ(reloaded.snapshot().maxmemory, 1024u * 1024);
+    EXPECT_EQ(reloaded.snapshot().appendfsync, AppendFsync::NO);
+}
+
+TEST_F(ConfigTest, RewriteWithoutFileFails) {
+    Config config;
+    EXPECT_NE(config.rewrite(), "");
+}
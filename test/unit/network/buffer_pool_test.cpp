@@ -0,0 +1,58 @@
+#include "network/buffer_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+using redis_clone::network::BufferPool;
+
+TEST(BufferPoolTest, SmallBuffersAreLeftAlone) {
+    BufferPool pool(1024 * 1024);
+    std::string buffer(1000, 'x');
+    pool.reserve(buffer, 1000);
+    buffer.clear();
+    EXPECT_FALSE(pool.reclaim(buffer));
+    EXPECT_EQ(pool.pooled_buffers(), 0u);
+}
+
+TEST(BufferPoolTest, ReclaimedStorageIsLentToTheNextLargeBuffer) {
+    BufferPool pool(16 * 1024 * 1024);
+    const size_t large = 4 * BufferPool::kSmallBuffer;
+
+    std::string burst = "partial";
+    pool.reserve(burst, large);
+    EXPECT_EQ(burst, "partial");
+    EXPECT_GE(burst.capacity(), large + 7);
+    const char* storage = burst.data();
+
+    // A large buffer still holding data stays with its client
+    EXPECT_FALSE(pool.reclaim(burst));
+    burst.clear();
+    EXPECT_TRUE(pool.reclaim(burst));
+    EXPECT_EQ(burst.capacity(), std::string().capacity());
+    EXPECT_EQ(pool.pooled_buffers(), 1u);
+    EXPECT_GE(pool.pooled_bytes(), large);
+
+    // Another connection's burst gets the same storage back, with its data carried over
+    std::string other(100, 'y');
+    pool.reserve(other, large / 2);
+    EXPECT_EQ(other.data(), storage);
+    EXPECT_EQ(other, std::string(100, 'y'));
+    EXPECT_EQ(pool.pooled_buffers(), 0u);
+    EXPECT_EQ(pool.pooled_bytes(), 0u);
+}
+
+TEST(BufferPoolTest, KeepsNoMoreThanMaxBytes) {
+    BufferPool pool(3 * BufferPool::kSmallBuffer);
+    for (int i = 0; i < 3; ++i) {
+        std::string buffer;
+        pool.reserve(buffer, 2 * BufferPool::kSmallBuffer);
+        pool.reclaim(buffer);
+    }
+    EXPECT_EQ(pool.pooled_buffers(), 1u);
+    EXPECT_LE(pool.pooled_bytes(), 3 * BufferPool::kSmallBuffer);
+
+    pool.set_max_bytes(0);
+    EXPECT_EQ(pool.pooled_buffers(), 0u);
+    EXPECT_EQ(pool.pooled_bytes(), 0u);
+}
@@ -0,0 +1,69 @@
+#include "network/connection_slab.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using redis_clone::network::ConnectionSlab;
+
+namespace {
+
+struct Connection {
+    int fd = -1;
+    std::string buffer;
+};
+
+std::vector<int> live_fds(const ConnectionSlab<Connection>& slab) {
+    std::vector<int> fds;
+    for (const Connection* connection : slab) fds.push_back(connection->fd);
+    std::sort(fds.begin(), fds.end());
+    return fds;
+}
+
+}  // namespace
+
+TEST(ConnectionSlabTest, FindsByFdAndKeepsPointersStable) {
+    ConnectionSlab<Connection> slab;
+    Connection& first = slab.insert(5);
+    first.fd = 5;
+
+    // Growing the fd table must not move existing entries
+    for (int fd = 6; fd < 200; ++fd) slab.insert(fd).fd = fd;
+    EXPECT_EQ(slab.find(5), &first);
+    EXPECT_EQ(slab.find(150)->fd, 150);
+    EXPECT_EQ(slab.find(4), nullptr);
+    EXPECT_EQ(slab.find(1000), nullptr);
+    EXPECT_EQ(slab.find(-1), nullptr);
+    EXPECT_EQ(slab.size(), 195u);
+}
+
+TEST(ConnectionSlabTest, EraseKeepsTheLiveListDense) {
+    ConnectionSlab<Connection> slab;
+    for (int fd : {3, 4, 5, 6}) slab.insert(fd).fd = fd;
+
+    slab.erase(3);  // Swapped with the last live entry
+    slab.erase(9);  // Never inserted
+    EXPECT_EQ(live_fds(slab), (std::vector<int>{4, 5, 6}));
+    EXPECT_EQ(slab.find(3), nullptr);
+
+    slab.erase(6);
+    slab.erase(4);
+    EXPECT_EQ(live_fds(slab), (std::vector<int>{5}));
+    EXPECT_EQ(slab.find(5)->fd, 5);
+}
+
+TEST(ConnectionSlabTest, ReusedEntriesStartFresh) {
+    ConnectionSlab<Connection> slab;
+    Connection& old = slab.insert(7);
+    old.fd = 7;
+    old.buffer = std::string(4096, 'x');
+    slab.erase(7);
+
+    // The same fd number comes back for a new connection, with none of the old state
+    Connection& reused = slab.insert(7);
+    EXPECT_EQ(reused.fd, -1);
+    EXPECT_TRUE(reused.buffer.empty());
+    EXPECT_EQ(slab.size(), 1u);
+}
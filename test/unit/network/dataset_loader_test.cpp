@@ -0,0 +1,107 @@
+#include "network/dataset_loader.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <string>
+
+#include "common/temp_file.h"
+
+using redis_clone::network::DatasetLoader;
+using redis_clone::persistence::BackgroundWriterOptions;
+using redis_clone::persistence::encode_aof_command;
+using redis_clone::persistence::encode_aof_timestamp;
+using redis_clone::persistence::SnapshotWriter;
+
+class DatasetLoaderTest : public ::testing::Test {
+   protected:
+    void TearDown() override {
+        std::remove(redis_clone::persistence::snapshot_delta_path(file_.path(), 2).c_str());
+    }
+
+    // Apply every batch the way the server does, checking progress along the way
+    std::map<std::string, std::string> load_all(DatasetLoader& loader) {
+        std::map<std::string, std::string> data;
+        uint64_t bytes_done = 0;
+        for (int batches = 0; batches < 1000; ++batches) {
+            DatasetLoader::Batch batch = loader.next_batch();
+            EXPECT_TRUE(batch.error.empty()) << batch.error;
+            EXPECT_GE(batch.bytes_done, bytes_done);
+            bytes_done = batch.bytes_done;
+            for (auto& op : batch.ops) {
+                if (op.value) {
+                    data[op.key] = *op.value;
+                } else {
+                    data.erase(op.key);
+                }
+            }
+            if (batch.last || !batch.error.empty()) break;
+        }
+        EXPECT_EQ(bytes_done, loader.total_bytes());
+        return data;
+    }
+
+    redis_clone::test::TempFile file_{"dataset_loader_test"};
+};
+
+TEST_F(DatasetLoaderTest, ReplaysAofInBatchesUpToTheCutoff) {
+    std::string value(1000, 'v');
+    std::ofstream file(file_.path(), std::ios::binary);
+    for (int i = 0; i < 3000; ++i) {
+        file << encode_aof_command({"SET", "key:" + std::to_string(i), value});
+    }
+    file << encode_aof_command({"DEL", "key:0", "key:1", "missing"}) << encode_aof_timestamp(100)
+         << encode_aof_command({"SET", "late", "1"}) << encode_aof_timestamp(200)
+         << encode_aof_command({"SET", "later", "2"});
+    file.close();
+
+    DatasetLoader loader(file_.path(), 150);
+    auto data = load_all(loader);
+    EXPECT_EQ(data.size(), 2999u);
+    EXPECT_EQ(data.count("key:0"), 0u);
+    EXPECT_EQ(data.count("key:1"), 0u);
+    EXPECT_EQ(data["late"], "1");
+    EXPECT_EQ(data.count("later"), 0u);
+    EXPECT_LT(loader.aof_replay_end(), loader.aof_data_size());
+    EXPECT_TRUE(loader.aof_error().empty());
+}
+
+TEST_F(DatasetLoaderTest, ReportsTornAofTail) {
+    std::string frame = encode_aof_command({"SET", "b", "2"});
+    std::ofstream(file_.path(), std::ios::binary)
+        << encode_aof_command({"SET", "a", "1"}) << frame.substr(0, frame.size() - 3);
+
+    DatasetLoader loader(file_.path(), 0);
+    EXPECT_EQ(load_all(loader), (std::map<std::string, std::string>{{"a", "1"}}));
+    EXPECT_FALSE(loader.aof_error().empty());
+    EXPECT_EQ(loader.aof_replay_end(), encode_aof_command({"SET", "a", "1"}).size());
+}
+
+TEST_F(DatasetLoaderTest, LoadsSnapshotBaseThenDeltas) {
+    {
+        SnapshotWriter base(file_.path(), BackgroundWriterOptions());
+        base.begin(2, 1);
+        base.add("a", "1");
+        base.add("b", "2");
+        ASSERT_TRUE(base.finish());
+
+        SnapshotWriter delta(redis_clone::persistence::snapshot_delta_path(file_.path(), 2),
+                             BackgroundWriterOptions());
+        delta.begin_delta(1, 1, 2, {"a"});
+        delta.add("c", "3");
+        ASSERT_TRUE(delta.finish());
+    }
+
+    DatasetLoader loader(file_.path(), redis_clone::persistence::find_snapshot_chain(file_.path()));
+    EXPECT_EQ(load_all(loader), (std::map<std::string, std::string>{{"b", "2"}, {"c", "3"}}));
+}
+
+TEST_F(DatasetLoaderTest, FailsOnCorruptSnapshot) {
+    std::ofstream(file_.path()) << "{\n  \"metadata\": {\n";
+
+    DatasetLoader loader(file_.path(), redis_clone::persistence::SnapshotChain());
+    DatasetLoader::Batch batch = loader.next_batch();
+    EXPECT_NE(batch.error.find("Bad snapshot"), std::string::npos);
+}
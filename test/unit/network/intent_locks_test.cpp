@@ -0,0 +1,80 @@
+#include "network/intent_locks.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using redis_clone::network::IntentLocks;
+
+TEST(IntentLocksTest, OldestHolderGoesFirst) {
+    IntentLocks locks;
+    EXPECT_TRUE(locks.acquire(1, {"a", "b"}));
+    EXPECT_TRUE(locks.acquire(2, {"b", "c"}));
+    EXPECT_TRUE(locks.acquire(3, {"d"}));
+
+    EXPECT_TRUE(locks.first_in_line(1, {"a", "b"}));
+    EXPECT_FALSE(locks.first_in_line(2, {"b", "c"}));  // Behind 1 on b
+    EXPECT_TRUE(locks.first_in_line(3, {"d"}));         // No conflict, no wait
+
+    locks.release(1, {"a", "b"});
+    EXPECT_TRUE(locks.first_in_line(2, {"b", "c"}));
+    EXPECT_FALSE(locks.locked("a"));
+    EXPECT_TRUE(locks.locked("b"));
+}
+
+TEST(IntentLocksTest, RefusesToJumpAheadOfALaterTransaction) {
+    IntentLocks locks;
+    EXPECT_TRUE(locks.acquire(5, {"a"}));
+
+    // Another shard may already have let 4 in ahead of 5; taking it here too would deadlock
+    EXPECT_FALSE(locks.acquire(4, {"b", "a"}));
+    EXPECT_FALSE(locks.locked("b"));  // All or nothing
+    EXPECT_TRUE(locks.acquire(4, {"b"}));
+    EXPECT_TRUE(locks.acquire(6, {"a", "b"}));
+
+    locks.release(4, {"b"});
+    locks.release(5, {"a"});
+    locks.release(6, {"a", "b"});
+    EXPECT_TRUE(locks.empty());
+}
+
+TEST(IntentLocksTest, RefusesTransactionsOlderThanOneAlreadyRun) {
+    IntentLocks locks;
+    EXPECT_TRUE(locks.acquire(7, {"a"}));
+    locks.mark_run(7, {"a"});
+    locks.release(7, {"a"});
+
+    // Nothing holds "a" any more, but 7 went first here, so 6 must not come after it
+    EXPECT_FALSE(locks.acquire(6, {"a"}));
+    EXPECT_TRUE(locks.acquire(8, {"a"}));
+}
+
+TEST(IntentLocksTest, OlderTransactionsOnOtherKeysStillGoAhead) {
+    IntentLocks locks;
+    EXPECT_TRUE(locks.acquire(7, {"a"}));
+    locks.mark_run(7, {"a"});
+    locks.release(7, {"a"});
+
+    // Disjoint from 7, so no order between them to keep
+    EXPECT_TRUE(locks.acquire(6, {"b"}));
+    EXPECT_FALSE(locks.acquire(5, {"b", "a"}));
+    EXPECT_FALSE(locks.locked("a"));
+}
+
+TEST(IntentLocksTest, ForgottenRunsStillRefuseOlderTransactions) {
+    IntentLocks locks(2);
+    for (uint64_t txid : {1, 2, 3}) {
+        std::string key = "k" + std::to_string(txid);
+        EXPECT_TRUE(locks.acquire(txid, {key}));
+        locks.mark_run(txid, {key});
+        locks.release(txid, {key});
+    }
+
+    // k1's entry is gone, so the floor it left behind applies to every key
+    EXPECT_FALSE(locks.acquire(0, {"k1"}));
+    EXPECT_FALSE(locks.acquire(0, {"other"}));
+    EXPECT_FALSE(locks.acquire(1, {"k3"}));
+    EXPECT_TRUE(locks.acquire(1, {"other"}));
+    EXPECT_TRUE(locks.acquire(4, {"k1", "k2", "k3"}));
+}
@@ -0,0 +1,79 @@
+#include "network/poller.h"
+
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <vector>
+
+using redis_clone::network::Poller;
+
+namespace {
+
+class PollerTest : public ::testing::Test {
+   protected:
+    void SetUp() override { ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds_), 0); }
+    void TearDown() override {
+        close(fds_[0]);
+        close(fds_[1]);
+    }
+
+    int fds_[2];
+    Poller poller_;
+    std::vector<Poller::Event> events_;
+};
+
+}  // namespace
+
+TEST_F(PollerTest, ReportsReadinessWithItsUserPointer) {
+    int tag = 0;
+    poller_.add(fds_[0], Poller::READABLE, &tag);
+
+    EXPECT_EQ(poller_.wait(events_, 0), 0);
+
+    ASSERT_EQ(write(fds_[1], "x", 1), 1);
+    ASSERT_EQ(poller_.wait(events_, 1000), 1);
+    EXPECT_EQ(events_[0].data, &tag);
+    EXPECT_TRUE(events_[0].readable);
+    EXPECT_FALSE(events_[0].writable);
+
+    // Level-triggered: still reported until the byte is read
+    ASSERT_EQ(poller_.wait(events_, 0), 1);
+    char byte;
+    ASSERT_EQ(read(fds_[0], &byte, 1), 1);
+    EXPECT_EQ(poller_.wait(events_, 0), 0);
+}
+
+TEST_F(PollerTest, ModifyChangesInterest) {
+    int tag = 0;
+    poller_.add(fds_[0], Poller::READABLE, &tag);
+    EXPECT_EQ(poller_.wait(events_, 0), 0);
+
+    // An empty socket buffer is writable at once
+    poller_.modify(fds_[0], Poller::READABLE | Poller::WRITABLE, &tag);
+    ASSERT_EQ(poller_.wait(events_, 1000), 1);
+    EXPECT_TRUE(events_[0].writable);
+    EXPECT_FALSE(events_[0].readable);
+
+    poller_.modify(fds_[0], Poller::READABLE, &tag);
+    EXPECT_EQ(poller_.wait(events_, 0), 0);
+}
+
+TEST_F(PollerTest, RemovedFdIsNoLongerReported) {
+    int tag = 0;
+    poller_.add(fds_[0], Poller::READABLE, &tag);
+    ASSERT_EQ(write(fds_[1], "x", 1), 1);
+    ASSERT_EQ(poller_.wait(events_, 1000), 1);
+
+    poller_.remove(fds_[0]);
+    EXPECT_EQ(poller_.wait(events_, 0), 0);
+}
+
+TEST_F(PollerTest, PeerCloseIsReportedAsHangup) {
+    int tag = 0;
+    poller_.add(fds_[0], Poller::READABLE, &tag);
+    shutdown(fds_[1], SHUT_RDWR);
+
+    ASSERT_EQ(poller_.wait(events_, 1000), 1);
+    EXPECT_TRUE(events_[0].hangup || events_[0].readable);
+}
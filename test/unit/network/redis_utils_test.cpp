@@ -0,0 +1,182 @@
+#include "network/redis_utils.h"
+
+#include "gtest/gtest.h"
+#include "storage/database.h"
+#include "storage/sharded_database.h"
+
+namespace {
+
+using redis_clone::network::redis_utils::CommandParts;
+using redis_clone::network::redis_utils::format_multibulk_command;
+using redis_clone::network::redis_utils::extract_command;
+using redis_clone::network::redis_utils::process_command_with_store;
+using redis_clone::network::redis_utils::parse_command;
+using redis_clone::network::redis_utils::ParseStatus;
+
+TEST(RedisUtilsTest, ParsesInlineCommand) {
+    std::string buffer = "set user:1 alice\r\n";
+    size_t pos = 0;
+    CommandParts parts;
+    std::string error;
+
+    ASSERT_EQ(parse_command(buffer, pos, parts, error), ParseStatus::OK);
+    EXPECT_EQ(parts.command, "SET");
+    EXPECT_EQ(parts.key, "user:1");
+    EXPECT_EQ(parts.value, "alice");
+    EXPECT_EQ(pos, buffer.size());
+}
+
+TEST(RedisUtilsTest, ParsesMultibulkCommand) {
+    std::string buffer = "*3\r\n$3\r\nSET\r\n$3\r\nkey\r\n$11\r\nhello world\r\n";
+    size_t pos = 0;
+    CommandParts parts;
+    std::string error;
+
+    ASSERT_EQ(parse_command(buffer, pos, parts, error), ParseStatus::OK);
+    EXPECT_EQ(parts.command, "SET");
+    EXPECT_EQ(parts.key, "key");
+    EXPECT_EQ(parts.value, "hello world");
+    ASSERT_EQ(parts.args.size(), 2u);
+    EXPECT_EQ(pos, buffer.size());
+}
+
+TEST(RedisUtilsTest, IncompleteMultibulkKeepsPosition) {
+    std::string buffer = "*2\r\n$3\r\nGET\r\n$3\r\nke";
+    size_t pos = 0;
+    CommandParts parts;
+    std::string error;
+
+    EXPECT_EQ(parse_command(buffer, pos, parts, error), ParseStatus::INCOMPLETE);
+    EXPECT_EQ(pos, 0u);
+
+    buffer += "y\r\n";
+    ASSERT_EQ(parse_command(buffer, pos, parts, error), ParseStatus::OK);
+    EXPECT_EQ(parts.command, "GET");
+    EXPECT_EQ(parts.key, "key");
+}
+
+TEST(RedisUtilsTest, ParsesPipelinedCommands) {
+    std::string buffer = "SET a 1\r\n\r\n*2\r\n$3\r\nGET\r\n$1\r\na\r\nDEL a\n";
+    size_t pos = 0;
+    CommandParts parts;
+    std::string error;
+    std::vector<std::string> commands;
+
+    while (parse_command(buffer, pos, parts, error) == ParseStatus::OK) {
+        commands.push_back(parts.command);
+    }
+
+    EXPECT_EQ(commands, (std::vector<std::string>{"SET", "GET", "DEL"}));
+    EXPECT_EQ(pos, buffer.size());
+}
+
+TEST(RedisUtilsTest, MultibulkFormatRoundTripsAnyValue) {
+    std::string value = "two words \"quoted\"\r\nSET evil 1";
+    std::string buffer = format_multibulk_command({"SET", "key", value, {"key", value}});
+    size_t pos = 0;
+    CommandParts parts;
+    std::string error;
+
+    ASSERT_EQ(parse_command(buffer, pos, parts, error), ParseStatus::OK);
+    EXPECT_EQ(parts.command, "SET");
+    EXPECT_EQ(parts.key, "key");
+    EXPECT_EQ(parts.value, value);
+    EXPECT_EQ(pos, buffer.size());
+}
+
+TEST(RedisUtilsTest, RejectsMalformedMultibulk) {
+    std::string buffer = "*1\r\n+PING\r\n";
+    size_t pos = 0;
+    CommandParts parts;
+    std::string error;
+
+    EXPECT_EQ(parse_command(buffer, pos, parts, error), ParseStatus::ERROR);
+    EXPECT_FALSE(error.empty());
+}
+
+template <typename Engine>
+class CommandHandlerTest : public ::testing::Test {
+   protected:
+    std::string run(const std::string& command) {
+        return process_command_with_store(extract_command(command), engine_);
+    }
+
+    Engine engine_;
+};
+
+using Engines = ::testing::Types<redis_clone::storage::Database,
+                                 redis_clone::storage::ConcurrentDatabase,
+                                 redis_clone::storage::ShardedDatabase>;
+TYPED_TEST_SUITE(CommandHandlerTest, Engines);
+
+TYPED_TEST(CommandHandlerTest, EmptyValueIsStored) {
+    // SET k "" only arrives as multibulk; the inline form has no way to say it
+    CommandParts parts = redis_clone::network::redis_utils::command_from_tokens({"SET", "k", ""});
+    EXPECT_EQ(process_command_with_store(parts, this->engine_), "+OK\r\n");
+    EXPECT_EQ(this->run("GET k"), "$0\r\n\r\n");
+    EXPECT_EQ(this->run("EXISTS k"), ":1\r\n");
+}
+
+TYPED_TEST(CommandHandlerTest, SameRepliesOnEveryBackend) {
+    EXPECT_EQ(this->run("SET user:1 alice"), "+OK\r\n");
+    EXPECT_EQ(this->run("GET user:1"), "$5\r\nalice\r\n");
+    EXPECT_EQ(this->run("EXISTS user:1"), ":1\r\n");
+    EXPECT_EQ(this->run("DBSIZE"), ":1\r\n");
+    EXPECT_EQ(this->run("DEL user:1"), ":1\r\n");
+    EXPECT_EQ(this->run("DEL user:1"), ":0\r\n");
+    EXPECT_EQ(this->run("GET user:1"), "$-1\r\n");
+    EXPECT_EQ(this->run("SET key"), "-ERR wrong number of arguments for 'set' command\r\n");
+    EXPECT_EQ(this->run("SET key a b"), "-ERR syntax error\r\n");
+    EXPECT_EQ(this->run("GET"), "-ERR wrong number of arguments for 'get' command\r\n");
+    EXPECT_EQ(this->run("NOPE"), "-ERR unknown command 'NOPE'\r\n");
+    EXPECT_EQ(this->run("PING"), "+PONG\r\n");
+    EXPECT_EQ(this->run("PING hello"), "$5\r\nhello\r\n");
+}
+
+TYPED_TEST(CommandHandlerTest, DelAndExistsCountEveryKey) {
+    this->run("SET a 1");
+    this->run("SET b 2");
+    EXPECT_EQ(this->run("EXISTS a b missing a"), ":3\r\n");  // Repeats count, like in Redis
+    EXPECT_EQ(this->run("DEL a missing b"), ":2\r\n");
+    EXPECT_EQ(this->run("EXISTS a b"), ":0\r\n");
+    EXPECT_EQ(this->run("DEL"), "-ERR wrong number of arguments for 'del' command\r\n");
+    EXPECT_EQ(this->run("EXISTS"), "-ERR wrong number of arguments for 'exists' command\r\n");
+}
+
+TYPED_TEST(CommandHandlerTest, CopyFollowsRedisReplies) {
+    this->run("SET src alice");
+    EXPECT_EQ(this->run("COPY src dst"), ":1\r\n");
+    EXPECT_EQ(this->run("GET dst"), "$5\r\nalice\r\n");
+    EXPECT_EQ(this->run("COPY src dst"), ":0\r\n");
+    EXPECT_EQ(this->run("COPY missing dst REPLACE"), ":0\r\n");
+    this->run("SET src bob");
+    EXPECT_EQ(this->run("COPY src dst db 0 replace"), ":1\r\n");
+    EXPECT_EQ(this->run("GET dst"), "$3\r\nbob\r\n");
+
+    EXPECT_EQ(this->run("COPY src"), "-ERR wrong number of arguments for 'copy' command\r\n");
+    EXPECT_EQ(this->run("COPY src src"), "-ERR source and destination objects are the same\r\n");
+    EXPECT_EQ(this->run("COPY src other DB 1"), "-ERR DB index is out of range\r\n");
+    EXPECT_EQ(this->run("COPY src other DB one"),
+              "-ERR value is not an integer or out of range\r\n");
+    EXPECT_EQ(this->run("COPY src other NOW"), "-ERR syntax error\r\n");
+}
+
+TYPED_TEST(CommandHandlerTest, ScanPrefixPaginatesWithCursor) {
+    EXPECT_EQ(this->run("SCANPREFIX user: 0"),
+              "-ERR ordered index is disabled (start the server with --ordered-index)\r\n");
+
+    this->engine_.enable_ordered_index();
+    for (const char* key : {"user:1", "user:2", "user:3", "session:1"}) {
+        this->run(std::string("SET ") + key + " v");
+    }
+
+    // "user:2" hex-encoded is the cursor for the second page
+    EXPECT_EQ(this->run("SCANPREFIX user: 0 COUNT 2"),
+              "*2\r\n$12\r\n757365723a32\r\n*2\r\n$6\r\nuser:1\r\n$6\r\nuser:2\r\n");
+    EXPECT_EQ(this->run("SCANPREFIX user: 757365723a32 COUNT 2"),
+              "*2\r\n$1\r\n0\r\n*1\r\n$6\r\nuser:3\r\n");
+    EXPECT_EQ(this->run("SCANRANGE (session:1 + 0"),
+              "*2\r\n$1\r\n0\r\n*3\r\n$6\r\nuser:1\r\n$6\r\nuser:2\r\n$6\r\nuser:3\r\n");
+}
+
+}  // namespace
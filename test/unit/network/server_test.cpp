@@ -2,16 +2,23 @@
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
+#include <chrono>
 #include <csignal>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <string>
 
 // Define the global running flag for tests
 volatile sig_atomic_t g_running = 1;
 
 #include <thread>
 
+#include "config/config.h"
 #include "gtest/gtest.h"
 
 namespace {
@@ -19,8 +26,18 @@ namespace {
 class RedisServerTest : public ::testing::Test {
    protected:
     void SetUp() override {
+        // A fresh working directory, so no dataset from another run is loaded (or answered
+        // with -LOADING while it is)
+        char dir[] = "/tmp/redis_server_test_XXXXXX";
+        ASSERT_NE(mkdtemp(dir), nullptr);
+        work_dir_ = dir;
+        previous_dir_ = std::filesystem::current_path();
+        std::filesystem::create_directory(work_dir_ / "data");
+        std::filesystem::current_path(work_dir_);
+
         // Start server in a separate thread
-        server_thread_ = std::thread([this]() { server_.run(); });
+        server_ = std::make_unique<redis_clone::network::RedisServer>(test_port_, options());
+        server_thread_ = std::thread([this]() { server_->run(); });
     }
 
     void TearDown() override {
@@ -41,8 +58,15 @@ class RedisServerTest : public ::testing::Test {
             server_thread_.join();
         }
         g_running = 1;  // Reset for next test
+        server_.reset();
+
+        std::filesystem::current_path(previous_dir_);
+        std::filesystem::remove_all(work_dir_);
     }
 
+    // What the server under test is started with; fixtures below override it
+    virtual redis_clone::network::ServerOptions options() const { return {}; }
+
     // Helper function to send command and get response
     std::string send_command(const std::string& command) {
         int sock = socket(AF_INET, SOCK_STREAM, 0);
@@ -55,7 +79,9 @@ class RedisServerTest : public ::testing::Test {
 
         EXPECT_EQ(connect(sock, (struct sockaddr*)&addr, sizeof(addr)), 0) << "Failed to connect";
 
-        send(sock, command.c_str(), command.length(), 0);
+        // Inline commands end at a newline; without one the server keeps waiting for the rest
+        std::string request = command + "\r\n";
+        send(sock, request.c_str(), request.length(), 0);
 
         char buffer[1024] = {0};
         ssize_t bytes_read = recv(sock, buffer, sizeof(buffer) - 1, 0);
@@ -65,9 +91,47 @@ class RedisServerTest : public ::testing::Test {
         return std::string(buffer, bytes_read);
     }
 
+    // A connection of its own, for commands that depend on connection state
+    int open_connection() {
+        int sock = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(test_port_);
+        addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+        EXPECT_EQ(connect(sock, (struct sockaddr*)&addr, sizeof(addr)), 0) << "Failed to connect";
+        return sock;
+    }
+
+    std::string call(int sock, const std::string& command, int timeout_ms = 1000) {
+        std::string request = command + "\r\n";
+        send(sock, request.c_str(), request.length(), 0);
+        return read_reply(sock, timeout_ms);
+    }
+
+    // Empty if nothing arrived within timeout_ms or the server closed the connection
+    std::string read_reply(int sock, int timeout_ms) {
+        pollfd pfd{sock, POLLIN, 0};
+        if (poll(&pfd, 1, timeout_ms) != 1) return "";
+        char buffer[4096];
+        ssize_t bytes_read = recv(sock, buffer, sizeof(buffer), 0);
+        return bytes_read > 0 ? std::string(buffer, bytes_read) : "";
+    }
+
+    // The value of one field of a CLIENT INFO/LIST line, e.g. "addr"
+    static std::string field(const std::string& info, const std::string& name) {
+        size_t start = info.find(" " + name + "=");
+        if (start == std::string::npos) start = info.find(name + "=");
+        else ++start;
+        if (start == std::string::npos) return "";
+        start += name.size() + 1;
+        return info.substr(start, info.find_first_of(" \n", start) - start);
+    }
+
     const int test_port_ = 6380;  // Use different port than main server
-    redis_clone::network::RedisServer server_{test_port_};
+    std::unique_ptr<redis_clone::network::RedisServer> server_;
     std::thread server_thread_;
+    std::filesystem::path work_dir_;
+    std::filesystem::path previous_dir_;
 };
 
 TEST_F(RedisServerTest, SetAndGetCommand) {
@@ -111,6 +175,14 @@ TEST_F(RedisServerTest, ExistsCommand) {
     EXPECT_EQ(exists, ":1\r\n");
 }
 
+TEST_F(RedisServerTest, DelAndExistsTakeSeveralKeys) {
+    send_command("SET multi_a 1");
+    send_command("SET multi_b 2");
+    EXPECT_EQ(send_command("EXISTS multi_a multi_b missing_key"), ":2\r\n");
+    EXPECT_EQ(send_command("DEL multi_a multi_b missing_key"), ":2\r\n");
+    EXPECT_EQ(send_command("GET multi_b"), "$-1\r\n");
+}
+
 TEST_F(RedisServerTest, InvalidCommand) {
     auto response = send_command("INVALID_CMD");
     EXPECT_EQ(response, "-ERR unknown command 'INVALID_CMD'\r\n");
@@ -126,4 +198,245 @@ TEST_F(RedisServerTest, GetWithMissingKey) {
     EXPECT_EQ(response, "-ERR wrong number of arguments for 'get' command\r\n");
 }
 
-}  // namespace
\ No newline at end of file
+TEST_F(RedisServerTest, CopyCommand) {
+    EXPECT_EQ(send_command("SET copy_source value"), "+OK\r\n");
+    EXPECT_EQ(send_command("COPY copy_source copy_target"), ":1\r\n");
+    EXPECT_EQ(send_command("GET copy_target"), "$5\r\nvalue\r\n");
+    EXPECT_EQ(send_command("COPY copy_source copy_target"), ":0\r\n");
+}
+
+TEST_F(RedisServerTest, ClientNames) {
+    int sock = open_connection();
+    EXPECT_EQ(call(sock, "CLIENT GETNAME"), "$-1\r\n");
+    EXPECT_EQ(call(sock, "CLIENT SETNAME worker-1"), "+OK\r\n");
+    EXPECT_EQ(call(sock, "CLIENT GETNAME"), "$8\r\nworker-1\r\n");
+    EXPECT_EQ(call(sock, "client setname bad\x01name"),
+              "-ERR Client names cannot contain spaces, newlines or special characters.\r\n");
+    EXPECT_EQ(call(sock, "CLIENT SETNAME"),
+              "-ERR wrong number of arguments for 'client|setname' command\r\n");
+    EXPECT_EQ(call(sock, "CLIENT GETNAME extra"),
+              "-ERR wrong number of arguments for 'client|getname' command\r\n");
+    EXPECT_EQ(call(sock, "CLIENT NOPE"),
+              "-ERR unknown subcommand 'NOPE'. Try CLIENT ID, SETNAME, GETNAME, INFO, LIST, KILL, "
+              "PAUSE or UNPAUSE.\r\n");
+    close(sock);
+}
+
+TEST_F(RedisServerTest, ClientListAndInfo) {
+    int first = open_connection();
+    int second = open_connection();
+    call(first, "CLIENT SETNAME first");
+    call(second, "CLIENT SETNAME second");
+    std::string first_id = call(first, "CLIENT ID").substr(1);
+    first_id.resize(first_id.size() - 2);  // ":<id>\r\n"
+
+    std::string info = call(first, "CLIENT INFO");
+    EXPECT_EQ(field(info, "id"), first_id);
+    EXPECT_EQ(field(info, "name"), "first");
+    EXPECT_EQ(field(info, "cmd"), "client");
+    EXPECT_EQ(field(info, "tot-cmds"), "3");  // Not counting the CLIENT INFO running
+
+    std::string list = call(second, "CLIENT LIST");
+    EXPECT_NE(list.find("name=first"), std::string::npos);
+    EXPECT_NE(list.find("name=second"), std::string::npos);
+
+    std::string only_first = call(second, "CLIENT LIST ID " + first_id + " 999999");
+    EXPECT_NE(only_first.find("name=first"), std::string::npos);
+    EXPECT_EQ(only_first.find("name=second"), std::string::npos);
+    EXPECT_EQ(call(second, "CLIENT LIST TYPE normal"),
+              "-ERR wrong number of arguments for 'client|list' command\r\n");
+    close(first);
+    close(second);
+}
+
+TEST_F(RedisServerTest, ClientKill) {
+    int killer = open_connection();
+    int victim = open_connection();
+    std::string victim_addr = field(call(victim, "CLIENT INFO"), "addr");
+    std::string own_addr = field(call(killer, "CLIENT INFO"), "addr");
+
+    // Old form: by address, +OK or an error
+    EXPECT_EQ(call(killer, "CLIENT KILL 10.0.0.1:1"), "-ERR No such client\r\n");
+    EXPECT_EQ(call(killer, "CLIENT KILL " + victim_addr), "+OK\r\n");
+    char byte;
+    EXPECT_EQ(recv(victim, &byte, 1, 0), 0);  // Closed
+    close(victim);
+
+    // Filters: the count killed, the caller spared unless SKIPME no
+    victim = open_connection();
+    std::string victim_id = call(victim, "CLIENT ID").substr(1);
+    victim_id.resize(victim_id.size() - 2);
+    EXPECT_EQ(call(killer, "CLIENT KILL ID 0"), "-ERR client-id should be greater than 0\r\n");
+    EXPECT_EQ(call(killer, "CLIENT KILL ID " + victim_id + " SKIPME"), "-ERR syntax error\r\n");
+    EXPECT_EQ(call(killer, "CLIENT KILL ID 1 SKIPME maybe"), "-ERR syntax error\r\n");
+    EXPECT_EQ(call(killer, "CLIENT KILL USER default"), "-ERR syntax error\r\n");
+    EXPECT_EQ(call(killer, "CLIENT KILL ID " + victim_id), ":1\r\n");
+    EXPECT_EQ(recv(victim, &byte, 1, 0), 0);
+    close(victim);
+
+    EXPECT_EQ(call(killer, "CLIENT KILL ADDR " + own_addr), ":0\r\n");
+    EXPECT_EQ(call(killer, "CLIENT KILL ADDR " + own_addr + " SKIPME no"), ":1\r\n");
+    EXPECT_EQ(recv(killer, &byte, 1, 0), 0);
+    close(killer);
+}
+
+TEST_F(RedisServerTest, ClientPauseWriteHoldsOnlyWrites) {
+    int admin = open_connection();
+    int client = open_connection();
+    EXPECT_EQ(call(admin, "CLIENT PAUSE abc"),
+              "-ERR timeout is not an integer or out of range\r\n");
+    EXPECT_EQ(call(admin, "CLIENT PAUSE 100 SOME"), "-ERR syntax error\r\n");
+
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(call(admin, "CLIENT PAUSE 300 WRITE"), "+OK\r\n");
+    EXPECT_EQ(call(client, "GET paused_key"), "$-1\r\n");
+
+    // Queued, not refused: the reply comes once the pause is over
+    EXPECT_EQ(call(client, "SET paused_key value", 100), "");
+    EXPECT_EQ(read_reply(client, 2000), "+OK\r\n");
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(250));
+    EXPECT_EQ(call(client, "GET paused_key"), "$5\r\nvalue\r\n");
+    close(admin);
+    close(client);
+}
+
+TEST_F(RedisServerTest, ClientPauseAllHoldsReadsUntilUnpause) {
+    int admin = open_connection();
+    int client = open_connection();
+    EXPECT_EQ(call(admin, "CLIENT PAUSE 10000 ALL"), "+OK\r\n");
+
+    // Everything but CLIENT waits, in order
+    EXPECT_EQ(call(client, "SET held value", 100), "");
+    EXPECT_EQ(call(client, "GET held", 100), "");
+    EXPECT_NE(call(admin, "CLIENT LIST"), "");
+
+    EXPECT_EQ(call(admin, "CLIENT UNPAUSE"), "+OK\r\n");
+    std::string replies;
+    while (replies.size() < 16) {
+        std::string more = read_reply(client, 2000);
+        if (more.empty()) break;
+        replies += more;
+    }
+    EXPECT_EQ(replies, "+OK\r\n$5\r\nvalue\r\n");
+    close(admin);
+    close(client);
+}
+
+TEST_F(RedisServerTest, CommandBudgetLetsOtherClientsIn) {
+    int heavy = open_connection();
+    int light = open_connection();
+    EXPECT_EQ(call(light, "CONFIG SET client-command-budget 4"), "+OK\r\n");
+    std::string heavy_id = call(heavy, "CLIENT ID").substr(1);
+    heavy_id.resize(heavy_id.size() - 2);
+
+    // Queued whole behind the paused SET, so one iteration could run all of it. PING is in the
+    // priority lane, which orders clients but still spends the budget
+    constexpr int kPings = 50000;
+    std::string pipeline = "SET first 1\r\n";
+    std::string expected = "+OK\r\n";
+    for (int i = 0; i < kPings; ++i) {
+        std::string n = std::to_string(i);
+        pipeline += "PING " + n + "\r\n";
+        expected += "$" + std::to_string(n.size()) + "\r\n" + n + "\r\n";
+    }
+    EXPECT_EQ(call(light, "CLIENT PAUSE 10000 WRITE"), "+OK\r\n");
+    std::thread sender([&] { send(heavy, pipeline.data(), pipeline.size(), 0); });
+    sender.join();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));  // The rest read and parsed
+
+    EXPECT_EQ(call(light, "CLIENT UNPAUSE"), "+OK\r\n");
+    EXPECT_EQ(call(light, "GET missing"), "$-1\r\n");
+    long long heavy_commands =
+        std::stoll(field(call(light, "CLIENT LIST ID " + heavy_id), "tot-cmds"));
+    EXPECT_LT(heavy_commands, kPings);  // Answered with the heavy queue far from drained
+
+    std::string replies;
+    while (replies.size() < expected.size()) {
+        std::string more = read_reply(heavy, 5000);
+        if (more.empty()) break;
+        replies += more;
+    }
+    EXPECT_TRUE(replies == expected) << "replies out of order or missing";
+    close(heavy);
+    close(light);
+}
+
+TEST_F(RedisServerTest, AofBackpressureHoldsWritesButNotReads) {
+    int writer = open_connection();
+    int held = open_connection();
+    int reader = open_connection();
+    EXPECT_EQ(call(reader, "CONFIG SET aof-max-unsynced-bytes 1"), "+OK\r\n");
+    EXPECT_EQ(call(reader, "SET present value"), "+OK\r\n");
+
+    // A large write leaves a slow fsync in flight; the hold lasts only that long, so a fast
+    // disk may need another try to catch it
+    std::string big(32 << 20, 'v');
+    std::string request = "*3\r\n$3\r\nSET\r\n$3\r\nbig\r\n$" + std::to_string(big.size()) +
+                          "\r\n" + big + "\r\n";
+    bool seen_held = false;
+    for (int attempt = 0; attempt < 5 && !seen_held; ++attempt) {
+        for (size_t sent = 0; sent < request.size();) {
+            ssize_t n = send(writer, request.data() + sent, request.size() - sent, 0);
+            ASSERT_GT(n, 0);
+            sent += static_cast<size_t>(n);
+        }
+        ASSERT_EQ(read_reply(writer, 5000), "+OK\r\n");
+
+        std::string small = "SET small " + std::to_string(attempt) + "\r\n";
+        send(held, small.data(), small.size(), 0);
+        EXPECT_EQ(call(reader, "GET present"), "$5\r\nvalue\r\n");  // Reads go through
+        std::string early = read_reply(held, 0);
+        std::string info = call(reader, "INFO persistence");
+
+        // Released once the fsync catches up
+        EXPECT_EQ(early.empty() ? read_reply(held, 5000) : early, "+OK\r\n");
+        seen_held =
+            early.empty() && info.find("aof_backpressure_held_clients:1") != std::string::npos;
+    }
+    EXPECT_TRUE(seen_held);
+    EXPECT_NE(call(reader, "GET small"), "$-1\r\n");
+    close(writer);
+    close(held);
+    close(reader);
+}
+
+// Every value spills to disk as soon as the tiering cron runs
+class TieredServerTest : public RedisServerTest {
+   protected:
+    redis_clone::network::ServerOptions options() const override {
+        redis_clone::network::ServerOptions options;
+        options.config = std::make_shared<redis_clone::config::Config>();
+        options.config->set("maxmemory", "1", true);
+        options.config->set("maxmemory-policy", "tiered", true);
+        return options;
+    }
+
+    // An INFO memory field, e.g. "tiered_cold_keys"
+    std::string info_field(int sock, const std::string& name) {
+        std::string info = call(sock, "INFO memory");
+        size_t start = info.find(name + ":");
+        if (start == std::string::npos) return "";
+        start += name.size() + 1;
+        return info.substr(start, info.find("\r\n", start) - start);
+    }
+};
+
+TEST_F(TieredServerTest, CopyReadsAColdSourceOffTheLoop) {
+    int sock = open_connection();
+    std::string value(100, 'c');
+    EXPECT_EQ(call(sock, "SET source " + value), "+OK\r\n");
+    for (int i = 0; i < 200 && info_field(sock, "tiered_cold_keys") != "1"; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(info_field(sock, "tiered_cold_keys"), "1");
+
+    // Only the async read promotes, so a synchronous read on the loop would leave this at 0
+    EXPECT_EQ(call(sock, "COPY source destination"), ":1\r\n");
+    EXPECT_EQ(info_field(sock, "tiered_promotions"), "1");
+    EXPECT_EQ(call(sock, "GET destination"), "$100\r\n" + value + "\r\n");
+    EXPECT_EQ(call(sock, "GET source"), "$100\r\n" + value + "\r\n");
+    EXPECT_EQ(call(sock, "COPY missing destination REPLACE"), ":0\r\n");
+    close(sock);
+}
+
+}  // namespace
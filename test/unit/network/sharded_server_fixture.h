@@ -0,0 +1,110 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <csignal>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "network/sharded_server.h"
+#include "storage/key_hash.h"
+
+// Defined in server_test.cpp; both servers stop when it goes to 0
+extern volatile sig_atomic_t g_running;
+
+namespace sharded_test {
+
+using redis_clone::network::ShardedRedisServer;
+
+constexpr size_t kShards = 4;
+
+// Where the RESP reply starting at pos ends, or npos if it has not all arrived
+inline size_t reply_end(const std::string& buffer, size_t pos) {
+    size_t line_end = buffer.find("\r\n", pos);
+    if (line_end == std::string::npos) return std::string::npos;
+    long long length = buffer[pos] == '$' || buffer[pos] == '*'
+                           ? std::stoll(buffer.substr(pos + 1, line_end - pos - 1))
+                           : 0;
+    size_t next = line_end + 2;
+    if (buffer[pos] == '$' && length >= 0) {
+        next += static_cast<size_t>(length) + 2;
+        return next <= buffer.size() ? next : std::string::npos;
+    }
+    if (buffer[pos] == '*') {
+        for (long long i = 0; i < length && next != std::string::npos; ++i) {
+            next = next < buffer.size() ? reply_end(buffer, next) : std::string::npos;
+        }
+    }
+    return next;
+}
+
+// One connection, one command and its whole reply at a time
+class Client {
+   public:
+    explicit Client(int port) : fd_(socket(AF_INET, SOCK_STREAM, 0)) {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+        EXPECT_EQ(connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    }
+    ~Client() { close(fd_); }
+
+    // Empty if the reply does not arrive within two seconds
+    std::string call(const std::string& command) {
+        std::string request = command + "\r\n";
+        send(fd_, request.data(), request.size(), 0);
+        size_t end;
+        while ((end = reply_end(buffer_, 0)) == std::string::npos) {
+            pollfd pfd{fd_, POLLIN, 0};
+            char chunk[4096];
+            ssize_t bytes_read = poll(&pfd, 1, 2000) == 1 ? recv(fd_, chunk, sizeof(chunk), 0) : 0;
+            if (bytes_read <= 0) return "";
+            buffer_.append(chunk, static_cast<size_t>(bytes_read));
+        }
+        std::string reply = buffer_.substr(0, end);
+        buffer_.erase(0, end);
+        return reply;
+    }
+
+   private:
+    int fd_;
+    std::string buffer_;
+};
+
+class ShardedServerTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        server_ = std::make_unique<ShardedRedisServer>(test_port_, kShards);
+        server_thread_ = std::thread([this]() { server_->run(); });
+    }
+
+    void TearDown() override {
+        // The acceptor checks g_running once the next connection wakes it
+        g_running = 0;
+        { Client wake(test_port_); }
+        server_thread_.join();
+        g_running = 1;
+        server_.reset();
+    }
+
+    // A key owned by the given shard, so a test can pick which shards a command spans
+    static std::string key_on(size_t shard, const std::string& prefix) {
+        for (int i = 0;; ++i) {
+            std::string key = prefix + std::to_string(i);
+            if (redis_clone::storage::key_shard(key, kShards) == shard) return key;
+        }
+    }
+
+    const int test_port_ = 6381;
+    std::unique_ptr<ShardedRedisServer> server_;
+    std::thread server_thread_;
+};
+
+}  // namespace sharded_test
@@ -0,0 +1,46 @@
+#include "network/sharded_server.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "sharded_server_fixture.h"
+
+namespace {
+
+using sharded_test::Client;
+using sharded_test::kShards;
+using sharded_test::ShardedServerTest;
+
+TEST_F(ShardedServerTest, SingleKeyCommandsReachTheirOwner) {
+    Client client(test_port_);
+    for (size_t shard = 0; shard < kShards; ++shard) {
+        std::string key = key_on(shard, "owned:");
+        EXPECT_EQ(client.call("SET " + key + " v" + std::to_string(shard)), "+OK\r\n");
+        EXPECT_EQ(client.call("GET " + key), "$2\r\nv" + std::to_string(shard) + "\r\n");
+    }
+    EXPECT_EQ(client.call("DBSIZE"), ":4\r\n");
+}
+
+TEST_F(ShardedServerTest, MultiKeyDelAndExistsSpanShards) {
+    Client client(test_port_);
+    std::string a = key_on(0, "a"), b = key_on(1, "b"), c = key_on(2, "c");
+    client.call("SET " + a + " 1");
+    client.call("SET " + b + " 2");
+    client.call("SET " + c + " 3");
+
+    EXPECT_EQ(client.call("EXISTS " + a + " " + b + " " + c + " missing " + a), ":4\r\n");
+    EXPECT_EQ(client.call("DEL " + a + " " + b + " missing"), ":2\r\n");
+    EXPECT_EQ(client.call("EXISTS " + a + " " + b + " " + c), ":1\r\n");
+    EXPECT_EQ(client.call("GET " + c), "$1\r\n3\r\n");
+    EXPECT_EQ(client.call("DEL"), "-ERR wrong number of arguments for 'del' command\r\n");
+}
+
+TEST_F(ShardedServerTest, UnsupportedCommandsSaySo) {
+    Client client(test_port_);
+    EXPECT_EQ(client.call("BGSAVE"),
+              "-ERR BGSAVE is not supported in sharded mode, which has no persistence\r\n");
+    EXPECT_EQ(client.call("INFO"), "-ERR unknown command 'INFO'\r\n");
+    EXPECT_EQ(client.call("CLIENT ID"), "-ERR unknown command 'CLIENT'\r\n");
+}
+
+}  // namespace
@@ -0,0 +1,116 @@
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "sharded_server_fixture.h"
+
+namespace {
+
+using sharded_test::Client;
+using sharded_test::reply_end;
+using sharded_test::ShardedServerTest;
+
+TEST_F(ShardedServerTest, MsetWritesEveryOwner) {
+    Client client(test_port_);
+    std::string a = key_on(0, "a"), b = key_on(3, "b"), c = key_on(3, "c");
+    EXPECT_EQ(client.call("MSET " + a + " 1 " + b + " 2 " + c + " 3"), "+OK\r\n");
+    EXPECT_EQ(client.call("GET " + a), "$1\r\n1\r\n");
+    EXPECT_EQ(client.call("GET " + b), "$1\r\n2\r\n");
+    EXPECT_EQ(client.call("GET " + c), "$1\r\n3\r\n");
+    EXPECT_EQ(client.call("MSET " + a + " 1 " + b),
+              "-ERR wrong number of arguments for 'mset' command\r\n");
+}
+
+TEST_F(ShardedServerTest, RenameAndCopyHopAcrossShards) {
+    Client client(test_port_);
+    std::string source = key_on(0, "src"), target = key_on(1, "dst"), copy = key_on(2, "copy");
+    client.call("SET " + source + " value");
+
+    EXPECT_EQ(client.call("RENAME " + source + " " + target), "+OK\r\n");
+    EXPECT_EQ(client.call("GET " + source), "$-1\r\n");
+    EXPECT_EQ(client.call("GET " + target), "$5\r\nvalue\r\n");
+    EXPECT_EQ(client.call("RENAME " + source + " " + target), "-ERR no such key\r\n");
+
+    EXPECT_EQ(client.call("COPY " + target + " " + copy), ":1\r\n");
+    EXPECT_EQ(client.call("GET " + copy), "$5\r\nvalue\r\n");
+    EXPECT_EQ(client.call("GET " + target), "$5\r\nvalue\r\n");
+    client.call("SET " + target + " newer");
+    EXPECT_EQ(client.call("COPY " + target + " " + copy), ":0\r\n");  // Taken, no REPLACE
+    EXPECT_EQ(client.call("COPY " + target + " " + copy + " REPLACE"), ":1\r\n");
+    EXPECT_EQ(client.call("GET " + copy), "$5\r\nnewer\r\n");
+    EXPECT_EQ(client.call("COPY missing " + copy + " REPLACE"), ":0\r\n");
+}
+
+TEST_F(ShardedServerTest, MultiExecRunsOnEveryOwner) {
+    Client client(test_port_);
+    std::string a = key_on(0, "a"), b = key_on(1, "b");
+    EXPECT_EQ(client.call("MULTI"), "+OK\r\n");
+    EXPECT_EQ(client.call("SET " + a + " 1"), "+QUEUED\r\n");
+    EXPECT_EQ(client.call("SET " + b + " 2"), "+QUEUED\r\n");
+    EXPECT_EQ(client.call("GET " + a), "+QUEUED\r\n");
+    EXPECT_EQ(client.call("PING"), "+QUEUED\r\n");
+    EXPECT_EQ(client.call("EXEC"), "*4\r\n+OK\r\n+OK\r\n$1\r\n1\r\n+PONG\r\n");
+
+    // A command needing two shards on its own fails the whole MULTI
+    EXPECT_EQ(client.call("MULTI"), "+OK\r\n");
+    EXPECT_EQ(client.call("SET " + a + " 3"), "+QUEUED\r\n");
+    EXPECT_EQ(client.call("DEL " + a + " " + b),
+              "-ERR DEL is not supported inside MULTI in sharded mode\r\n");
+    EXPECT_EQ(client.call("EXEC"),
+              "-EXECABORT Transaction discarded because of previous errors.\r\n");
+    EXPECT_EQ(client.call("GET " + a), "$1\r\n1\r\n");
+    EXPECT_EQ(client.call("DISCARD"), "-ERR DISCARD without MULTI\r\n");
+}
+
+TEST_F(ShardedServerTest, ReadersNeverSeeHalfAnMset) {
+    std::string a = key_on(0, "a"), b = key_on(1, "b");
+    std::atomic<bool> done{false};
+    std::thread writer([&] {
+        Client client(test_port_);
+        for (int i = 0; i < 2000; ++i) {
+            std::string value = std::to_string(i);
+            EXPECT_EQ(client.call("MSET " + a + " " + value + " " + b + " " + value), "+OK\r\n");
+        }
+        done = true;
+    });
+
+    Client reader(test_port_);
+    int torn = 0;
+    while (!done) {
+        reader.call("MULTI");
+        reader.call("GET " + a);
+        reader.call("GET " + b);
+        std::string reply = reader.call("EXEC");
+        ASSERT_EQ(reply.compare(0, 4, "*2\r\n"), 0) << reply;
+        size_t first_end = reply_end(reply, 4);
+        torn += reply.substr(4, first_end - 4) != reply.substr(first_end);
+    }
+    writer.join();
+    EXPECT_EQ(torn, 0);
+    EXPECT_EQ(reader.call("GET " + b), "$4\r\n1999\r\n");
+}
+
+TEST_F(ShardedServerTest, RenameNeverShowsBothKeysOrNeither) {
+    std::string x = key_on(2, "x"), y = key_on(3, "y");
+    Client setup(test_port_);
+    setup.call("SET " + x + " value");
+
+    std::atomic<bool> done{false};
+    std::thread mover([&] {
+        Client client(test_port_);
+        for (int i = 0; i < 1000; ++i) {
+            EXPECT_EQ(client.call(i % 2 == 0 ? "RENAME " + x + " " + y : "RENAME " + y + " " + x),
+                      "+OK\r\n");
+        }
+        done = true;
+    });
+
+    int wrong = 0;
+    while (!done) wrong += setup.call("EXISTS " + x + " " + y) != ":1\r\n";
+    mover.join();
+    EXPECT_EQ(wrong, 0);
+    EXPECT_EQ(setup.call("GET " + x), "$5\r\nvalue\r\n");
+}
+
+}  // namespace
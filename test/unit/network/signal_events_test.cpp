@@ -0,0 +1,32 @@
+#include "network/signal_events.h"
+
+#include <gtest/gtest.h>
+#include <poll.h>
+
+#include <csignal>
+
+using redis_clone::network::SignalEvents;
+
+namespace {
+
+bool wait_readable(int fd) {
+    pollfd pfd{fd, POLLIN, 0};
+    return poll(&pfd, 1, 1000) == 1;
+}
+
+}  // namespace
+
+TEST(SignalEventsTest, DeliversSignalsAsEvents) {
+    SignalEvents events({SIGUSR1, SIGUSR2});
+
+    raise(SIGUSR1);
+    raise(SIGUSR2);
+
+    ASSERT_TRUE(wait_readable(events.fd()));
+    std::vector<int> received = events.read_pending();
+    ASSERT_EQ(received.size(), 2u);
+    EXPECT_EQ(received[0], SIGUSR1);
+    EXPECT_EQ(received[1], SIGUSR2);
+
+    EXPECT_TRUE(events.read_pending().empty());
+}
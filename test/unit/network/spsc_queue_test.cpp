@@ -0,0 +1,50 @@
+#include "network/spsc_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+
+using redis_clone::network::SpscQueue;
+
+TEST(SpscQueueTest, FifoUntilFull) {
+    SpscQueue<std::string> queue(3);
+    EXPECT_EQ(queue.capacity(), 4u);
+
+    for (int i = 0; i < 4; ++i) {
+        std::string item = "item" + std::to_string(i);
+        EXPECT_TRUE(queue.try_push(std::move(item)));
+    }
+    std::string extra = "extra";
+    EXPECT_FALSE(queue.try_push(std::move(extra)));
+    EXPECT_EQ(extra, "extra");  // A failed push leaves the item with the caller
+
+    std::string item;
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(queue.try_pop(item));
+        EXPECT_EQ(item, "item" + std::to_string(i));
+    }
+    EXPECT_FALSE(queue.try_pop(item));
+    EXPECT_TRUE(queue.try_push(std::move(extra)));  // Wraps around
+}
+
+TEST(SpscQueueTest, HandsEveryItemAcrossThreadsInOrder) {
+    SpscQueue<size_t> queue(64);
+    constexpr size_t kItems = 200000;
+
+    std::thread producer([&] {
+        for (size_t i = 0; i < kItems; ++i) {
+            size_t item = i;
+            while (!queue.try_push(std::move(item))) std::this_thread::yield();
+        }
+    });
+
+    size_t expected = 0;
+    size_t item = 0;
+    while (expected < kItems) {
+        if (!queue.try_pop(item)) continue;
+        ASSERT_EQ(item, expected);
+        ++expected;
+    }
+    producer.join();
+}
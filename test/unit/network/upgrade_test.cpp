@@ -0,0 +1,117 @@
+#include "network/upgrade.h"
+
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+
+using redis_clone::network::UpgradeState;
+namespace redis_utils = redis_clone::network::redis_utils;
+
+TEST(UpgradeTest, HandsOverSocketsAndPartialCommands) {
+    std::string path = "upgrade_test_" + std::to_string(getpid()) + ".sock";
+    int listen_fd = redis_clone::network::listen_upgrade_socket(path);
+
+    // Stand-ins for the listener, the keyspace and 200 clients (more than one message's worth)
+    std::vector<int> peers;
+    UpgradeState sent;
+    int keyspace[2];
+    ASSERT_EQ(pipe(keyspace), 0);
+    sent.listener_fd = keyspace[0];
+    sent.keyspace_fd = keyspace[0];
+    sent.next_client_id = 1234;
+    for (int i = 0; i < 200; ++i) {
+        int fds[2];
+        ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+        peers.push_back(fds[0]);
+        peers.push_back(fds[1]);
+        sent.clients.push_back({fds[0], static_cast<uint64_t>(i + 1),
+                                i % 2 ? "*2\r\n$3\r\nGET\r\n$1" : ""});
+    }
+
+    bool sent_ok = false;
+    std::string error;
+    std::thread old_process([&] {
+        int conn = accept(listen_fd, nullptr, nullptr);
+        sent_ok = redis_clone::network::send_upgrade_state(conn, sent, 5000, error);
+        close(conn);
+    });
+    UpgradeState received = redis_clone::network::receive_upgrade_state(path);
+    old_process.join();
+    EXPECT_TRUE(sent_ok) << error;
+
+    EXPECT_EQ(received.next_client_id, 1234u);
+    ASSERT_EQ(received.clients.size(), sent.clients.size());
+    for (size_t i = 0; i < received.clients.size(); ++i) {
+        EXPECT_EQ(received.clients[i].id, sent.clients[i].id);
+        EXPECT_EQ(received.clients[i].read_buffer, sent.clients[i].read_buffer);
+    }
+
+    // A received client fd is the same socket: what it writes reaches the peer
+    ASSERT_EQ(write(received.clients[7].fd, "x", 1), 1);
+    char byte = 0;
+    EXPECT_EQ(read(peers[15], &byte, 1), 1);
+    EXPECT_EQ(byte, 'x');
+
+    close(received.listener_fd);
+    close(received.keyspace_fd);
+    for (const auto& client : received.clients) close(client.fd);
+    for (int fd : peers) close(fd);
+    close(keyspace[0]);
+    close(keyspace[1]);
+    close(listen_fd);
+    std::remove(path.c_str());
+}
+
+TEST(UpgradeTest, QueuedCommandsRunAheadOfThePartialOne) {
+    // Parsed but held back (paused, over budget, behind AOF backpressure) when the handoff came
+    std::deque<redis_utils::CommandParts> pending = {
+        redis_utils::command_from_tokens({"SET", "k", "two words\r\n"}),
+        redis_utils::command_from_tokens({"GET", "k"}),
+    };
+    const std::string partial = "*2\r\n$3\r\nDEL";
+
+    std::string path = "upgrade_test_queued_" + std::to_string(getpid()) + ".sock";
+    int listen_fd = redis_clone::network::listen_upgrade_socket(path);
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    UpgradeState sent;
+    sent.listener_fd = fds[1];
+    sent.keyspace_fd = fds[1];
+    sent.clients.push_back({fds[0], 1, redis_clone::network::unexecuted_input(pending, partial)});
+
+    std::string error;
+    std::thread old_process([&] {
+        int conn = accept(listen_fd, nullptr, nullptr);
+        redis_clone::network::send_upgrade_state(conn, sent, 5000, error);
+        close(conn);
+    });
+    UpgradeState received = redis_clone::network::receive_upgrade_state(path);
+    old_process.join();
+    ASSERT_EQ(received.clients.size(), 1u);
+
+    // The new process parses them again, in order, and keeps waiting for the rest of the DEL
+    const std::string& input = received.clients[0].read_buffer;
+    size_t pos = 0;
+    redis_utils::CommandParts parts;
+    ASSERT_EQ(redis_utils::parse_command(input, pos, parts, error), redis_utils::ParseStatus::OK);
+    EXPECT_EQ(parts.args, (std::vector<std::string>{"k", "two words\r\n"}));
+    ASSERT_EQ(redis_utils::parse_command(input, pos, parts, error), redis_utils::ParseStatus::OK);
+    EXPECT_EQ(parts.command, "GET");
+    EXPECT_EQ(redis_utils::parse_command(input, pos, parts, error),
+              redis_utils::ParseStatus::INCOMPLETE);
+    EXPECT_EQ(input.substr(pos), partial);
+
+    close(received.listener_fd);
+    close(received.keyspace_fd);
+    close(received.clients[0].fd);
+    close(fds[0]);
+    close(fds[1]);
+    close(listen_fd);
+    std::remove(path.c_str());
+}
@@ -0,0 +1,96 @@
+#include "persistence/aof_format.h"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "common/temp_file.h"
+
+using redis_clone::persistence::AofReader;
+using redis_clone::persistence::AofRecord;
+using redis_clone::persistence::encode_aof_command;
+using redis_clone::persistence::encode_aof_timestamp;
+using redis_clone::persistence::find_aof_cutoff;
+
+class AofFormatTest : public ::testing::Test {
+   protected:
+    void write_file(const std::string& contents) {
+        std::ofstream file(file_.path(), std::ios::binary | std::ios::trunc);
+        file << contents;
+    }
+
+    redis_clone::test::TempFile file_{"aof_format_test", ".aof"};
+};
+
+TEST_F(AofFormatTest, ReadsFramesMarkersAndLegacyInlineLines) {
+    write_file("SET old 1\n" + encode_aof_timestamp(1700000000) +
+               encode_aof_command({"SET", "key with space", "line\r\nbreak"}) + "#note\r\n" +
+               encode_aof_command({"DEL", "old"}) + std::string(4096, '\0'));
+
+    AofReader reader(file_.path());
+    ASSERT_TRUE(reader.is_open());
+    AofRecord record;
+
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(record.type, AofRecord::Type::COMMAND);
+    EXPECT_EQ(record.tokens, (std::vector<std::string>{"SET", "old", "1"}));
+
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(record.type, AofRecord::Type::TIMESTAMP);
+    EXPECT_EQ(record.timestamp, 1700000000);
+    EXPECT_EQ(record.offset, 10u);
+
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(record.tokens, (std::vector<std::string>{"SET", "key with space", "line\r\nbreak"}));
+
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(record.type, AofRecord::Type::ANNOTATION);
+
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(record.tokens, (std::vector<std::string>{"DEL", "old"}));
+
+    // The NUL padding is not data
+    EXPECT_FALSE(reader.next(record));
+    EXPECT_TRUE(reader.error().empty());
+    EXPECT_EQ(reader.offset(), reader.data_size());
+}
+
+TEST_F(AofFormatTest, StopsAtTornRecord) {
+    std::string good = encode_aof_command({"SET", "a", "1"});
+    std::string torn = encode_aof_command({"SET", "b", "2"});
+    write_file(good + torn.substr(0, torn.size() - 3));
+
+    AofReader reader(file_.path());
+    AofRecord record;
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_FALSE(reader.next(record));
+    EXPECT_FALSE(reader.error().empty());
+    EXPECT_EQ(reader.offset(), good.size());
+}
+
+TEST_F(AofFormatTest, CutoffIsFirstMarkerAfterTimestamp) {
+    std::string before = encode_aof_command({"SET", "a", "1"}) + encode_aof_timestamp(100) +
+                         encode_aof_command({"SET", "b", "2"}) + encode_aof_timestamp(200) +
+                         encode_aof_command({"SET", "c", "3"});
+    std::string after = encode_aof_timestamp(300) + encode_aof_command({"DEL", "a"});
+    write_file(before + after);
+
+    {
+        AofReader reader(file_.path());
+        EXPECT_EQ(find_aof_cutoff(reader, 250), before.size());
+    }
+    {
+        AofReader reader(file_.path());
+        EXPECT_EQ(find_aof_cutoff(reader, 200), before.size());
+    }
+    {
+        AofReader reader(file_.path());
+        EXPECT_EQ(find_aof_cutoff(reader, 50), encode_aof_command({"SET", "a", "1"}).size());
+    }
+    {
+        AofReader reader(file_.path());
+        EXPECT_EQ(find_aof_cutoff(reader, 300), (before + after).size());
+    }
+}
@@ -0,0 +1,59 @@
+#include "persistence/background_writer.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+
+#include "common/temp_file.h"
+
+using redis_clone::persistence::BackgroundWriter;
+using redis_clone::persistence::BackgroundWriterOptions;
+
+class BackgroundWriterTest : public ::testing::Test {
+   protected:
+    redis_clone::test::TempFile file_{"background_writer_test"};
+};
+
+TEST_F(BackgroundWriterTest, WritesEverythingAcrossChunksAndSyncs) {
+    BackgroundWriterOptions options;
+    options.chunk_size = 4096;
+    options.sync_interval = 8192;
+    options.drop_page_cache = true;
+
+    std::string expected;
+    {
+        BackgroundWriter writer(file_.path(), options);
+        ASSERT_TRUE(writer.is_open());
+        for (int i = 0; i < 1000; ++i) {
+            std::string line = "SET key" + std::to_string(i) + " value\n";
+            writer << line;
+            expected += line;
+        }
+        EXPECT_TRUE(writer.finish());
+        EXPECT_EQ(writer.bytes_written(), expected.size());
+    }
+    EXPECT_EQ(file_.contents(), expected);
+}
+
+TEST_F(BackgroundWriterTest, BandwidthCapSlowsWrites) {
+    BackgroundWriterOptions options;
+    options.chunk_size = 64 * 1024;
+    options.max_bytes_per_sec = 4 * 1024 * 1024;
+
+    auto start = std::chrono::steady_clock::now();
+    BackgroundWriter writer(file_.path(), options);
+    writer.write(std::string(1024 * 1024, 'x'));
+    ASSERT_TRUE(writer.finish());
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    // 1MB at 4MB/s, minus the last partial chunk that is not throttled
+    EXPECT_GE(elapsed, std::chrono::milliseconds(200));
+}
+
+TEST_F(BackgroundWriterTest, OpenFailureIsReported) {
+    BackgroundWriter writer("/nonexistent-dir/file", BackgroundWriterOptions());
+    EXPECT_FALSE(writer.is_open());
+    writer.write("data");
+    EXPECT_FALSE(writer.finish());
+}
@@ -0,0 +1,144 @@
+#include "persistence/snapshot_format.h"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <map>
+#include <string>
+
+#include "common/temp_file.h"
+
+using redis_clone::persistence::BackgroundWriterOptions;
+using redis_clone::persistence::SnapshotReader;
+using redis_clone::persistence::SnapshotWriter;
+
+class SnapshotFormatTest : public ::testing::Test {
+   protected:
+    void write_snapshot(const std::map<std::string, std::string>& entries) {
+        SnapshotWriter writer(file_.path(), BackgroundWriterOptions());
+        ASSERT_TRUE(writer.is_open());
+        writer.begin(entries.size());
+        for (const auto& [key, value] : entries) writer.add(key, value);
+        ASSERT_TRUE(writer.finish());
+    }
+
+    std::map<std::string, std::string> read_all(const SnapshotReader& reader, size_t parts = 1) {
+        std::map<std::string, std::string> entries;
+        for (size_t part = 0; part < parts; ++part) {
+            std::string error;
+            EXPECT_TRUE(reader.for_each(
+                [&](std::string&& key, std::string&& value) { entries[key] = value; }, error,
+                part, parts));
+        }
+        return entries;
+    }
+
+    redis_clone::test::TempFile file_{"snapshot_format_test", ".json"};
+};
+
+TEST(Crc32Test, MatchesReferenceValue) {
+    EXPECT_EQ(redis_clone::persistence::crc32("123456789", 9), 0xCBF43926u);
+}
+
+TEST_F(SnapshotFormatTest, RoundTripsEscapedKeysAndValuesInParts) {
+    std::map<std::string, std::string> entries = {
+        {"plain", "value"},
+        {"q\"uote", "back\\slash"},
+        {"multi\nline", "tab\there\r\x01"},
+        {"empty", ""},
+    };
+    for (int i = 0; i < 100; ++i) entries["key:" + std::to_string(i)] = std::string(i, 'x');
+    write_snapshot(entries);
+
+    SnapshotReader reader(file_.path());
+    ASSERT_TRUE(reader.is_open()) << reader.error();
+    EXPECT_EQ(reader.metadata().version, "1.1");
+    EXPECT_EQ(reader.metadata().key_count, entries.size());
+    EXPECT_EQ(reader.verify_checksum(), SnapshotReader::ChecksumStatus::OK);
+    EXPECT_EQ(read_all(reader), entries);
+    EXPECT_EQ(read_all(reader, 7), entries);
+}
+
+TEST_F(SnapshotFormatTest, DetectsCorruption) {
+    write_snapshot({{"a", "1"}, {"b", "2"}});
+    std::string contents = file_.contents();
+    contents[contents.find("\"2\"") + 1] = '3';
+    std::ofstream(file_.path(), std::ios::binary | std::ios::trunc) << contents;
+
+    SnapshotReader reader(file_.path());
+    ASSERT_TRUE(reader.is_open());
+    EXPECT_EQ(reader.verify_checksum(), SnapshotReader::ChecksumStatus::MISMATCH);
+
+    // A torn file has no closing brace for the data section
+    std::ofstream(file_.path(), std::ios::binary | std::ios::trunc) << contents.substr(0, 80);
+    SnapshotReader truncated(file_.path());
+    EXPECT_FALSE(truncated.is_open());
+}
+
+TEST_F(SnapshotFormatTest, ReadsLegacyVersion) {
+    std::ofstream(file_.path()) << "{\n  \"metadata\": {\n    \"version\": \"1.0\",\n"
+                         << "    \"key_count\": 2\n  },\n  \"data\": {\n"
+                         << "    \"a\": \"x\\y\",\n    \"b\": \"2\"\n  }\n}\n";
+
+    SnapshotReader reader(file_.path());
+    ASSERT_TRUE(reader.is_open()) << reader.error();
+    EXPECT_EQ(reader.verify_checksum(), SnapshotReader::ChecksumStatus::MISSING);
+    EXPECT_EQ(read_all(reader), (std::map<std::string, std::string>{{"a", "x\\y"}, {"b", "2"}}));
+}
+
+TEST_F(SnapshotFormatTest, ChainsAndMergesDeltas) {
+    using redis_clone::persistence::snapshot_delta_path;
+    auto write_delta = [&](uint64_t base_epoch, uint64_t epoch,
+                           const std::vector<std::string>& deleted,
+                           const std::map<std::string, std::string>& entries) {
+        SnapshotWriter writer(snapshot_delta_path(file_.path(), epoch), BackgroundWriterOptions());
+        ASSERT_TRUE(writer.is_open());
+        writer.begin_delta(entries.size(), base_epoch, epoch, deleted);
+        for (const auto& [key, value] : entries) writer.add(key, value);
+        ASSERT_TRUE(writer.finish());
+    };
+
+    {
+        SnapshotWriter writer(file_.path(), BackgroundWriterOptions());
+        writer.begin(3, 3);
+        writer.add("a", "1");
+        writer.add("b", "2");
+        writer.add("c", "3");
+        ASSERT_TRUE(writer.finish());
+    }
+    write_delta(3, 5, {"a"}, {{"b", "20"}, {"new", "x"}});
+    write_delta(4, 6, {}, {{"stale", "y"}});  // Continues a base that no longer exists
+    write_delta(5, 7, {"new"}, {{"c", "30"}});
+
+    SnapshotReader delta(snapshot_delta_path(file_.path(), 5));
+    ASSERT_TRUE(delta.is_open()) << delta.error();
+    EXPECT_TRUE(delta.metadata().delta);
+    EXPECT_EQ(delta.metadata().base_epoch, 3u);
+    EXPECT_EQ(delta.verify_checksum(), SnapshotReader::ChecksumStatus::OK);
+    std::vector<std::string> deleted;
+    std::string error;
+    EXPECT_TRUE(delta.for_each_deleted([&](std::string&& key) { deleted.push_back(key); }, error));
+    EXPECT_EQ(deleted, std::vector<std::string>{"a"});
+    EXPECT_EQ(read_all(delta), (std::map<std::string, std::string>{{"b", "20"}, {"new", "x"}}));
+
+    auto chain = redis_clone::persistence::find_snapshot_chain(file_.path());
+    EXPECT_EQ(chain.epoch, 7u);
+    EXPECT_EQ(chain.latest_epoch, 7u);
+    EXPECT_EQ(chain.deltas, (std::vector<std::string>{snapshot_delta_path(file_.path(), 5),
+                                                      snapshot_delta_path(file_.path(), 7)}));
+    EXPECT_EQ(chain.stale, std::vector<std::string>{snapshot_delta_path(file_.path(), 6)});
+
+    ASSERT_TRUE(redis_clone::persistence::merge_snapshot_chain(file_.path(),
+                                                               BackgroundWriterOptions(), error))
+        << error;
+    SnapshotReader merged(file_.path());
+    ASSERT_TRUE(merged.is_open()) << merged.error();
+    EXPECT_FALSE(merged.metadata().delta);
+    EXPECT_EQ(merged.metadata().epoch, 7u);
+    EXPECT_EQ(merged.metadata().key_count, 2u);
+    EXPECT_EQ(read_all(merged), (std::map<std::string, std::string>{{"b", "20"}, {"c", "30"}}));
+
+    chain = redis_clone::persistence::find_snapshot_chain(file_.path());
+    EXPECT_TRUE(chain.deltas.empty());
+    EXPECT_TRUE(chain.stale.empty());
+}
@@ -0,0 +1,70 @@
+#include "storage/dash_table.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <unordered_set>
+
+using redis_clone::storage::DashTable;
+
+namespace {
+
+std::string key_for(size_t i) { return "key:" + std::to_string(i); }
+
+}  // namespace
+
+TEST(DashTableTest, FindsEveryKeyAcrossSplits) {
+    DashTable<size_t> table;
+    constexpr size_t kKeys = 100000;
+    for (size_t i = 0; i < kKeys; ++i) {
+        auto [node, inserted] = table.try_emplace(key_for(i));
+        ASSERT_TRUE(inserted);
+        node->second = i;
+    }
+    EXPECT_EQ(table.size(), kKeys);
+    EXPECT_GT(table.segment_count(), 1u);
+    EXPECT_FALSE(table.try_emplace(key_for(7)).second);
+
+    for (size_t i = 0; i < kKeys; ++i) {
+        const auto* node = table.find(key_for(i));
+        ASSERT_NE(node, nullptr) << key_for(i);
+        EXPECT_EQ(node->second, i);
+    }
+    EXPECT_EQ(table.find("missing"), nullptr);
+
+    for (size_t i = 0; i < kKeys; i += 2) EXPECT_TRUE(table.erase(key_for(i)));
+    EXPECT_FALSE(table.erase(key_for(0)));
+    EXPECT_EQ(table.size(), kKeys / 2);
+    for (size_t i = 0; i < kKeys; ++i) {
+        EXPECT_EQ(table.find(key_for(i)) != nullptr, i % 2 == 1);
+    }
+}
+
+TEST(DashTableTest, IteratesEachEntryOnce) {
+    DashTable<int> table;
+    for (size_t i = 0; i < 5000; ++i) table.try_emplace(key_for(i));
+    table.erase(key_for(10));
+
+    std::unordered_set<std::string> seen;
+    for (const auto& [key, value] : table) EXPECT_TRUE(seen.insert(key).second);
+    EXPECT_EQ(seen.size(), table.size());
+    EXPECT_EQ(seen.count(key_for(10)), 0u);
+}
+
+TEST(DashTableTest, EntriesStayPutWhileTheTableGrows) {
+    DashTable<int> table;
+    auto* first = table.try_emplace("first").first;
+    for (size_t i = 0; i < 50000; ++i) table.try_emplace(key_for(i));
+    EXPECT_EQ(table.find("first"), first);
+}
+
+TEST(DashTableTest, OverheadCountsEveryEntryNode) {
+    DashTable<int> table;
+    for (size_t i = 0; i < 200000; ++i) table.try_emplace(key_for(i));
+
+    // Buckets and directory alone stay small; the nodes are most of it
+    double table_per_key = static_cast<double>(table.table_memory()) / table.size();
+    EXPECT_LT(table_per_key, 20.0);
+    EXPECT_EQ(DashTable<int>::node_bytes(), 48u);
+    EXPECT_EQ(table.memory_overhead(), table.table_memory() + table.size() * 48);
+}
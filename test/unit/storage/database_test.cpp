@@ -2,6 +2,10 @@
 
 #include <gtest/gtest.h>
 
+#include <map>
+#include <string>
+#include <vector>
+
 TEST(DatabaseTest, BasicSetGet) {
     redis_clone::storage::Database db;
     db.set("foo", "bar");
@@ -26,3 +30,113 @@ TEST(DatabaseTest, ExistsKey) {
     db.del("a");
     EXPECT_FALSE(db.exists("a"));
 }
+
+TEST(DatabaseTest, PrefetchLeavesLookupsUnchanged) {
+    redis_clone::storage::Database db;
+    std::string missing = "missing";
+    db.prefetch({&missing});  // Empty table
+
+    std::vector<std::string> keys;
+    for (int i = 0; i < 100; ++i) {
+        keys.push_back("key:" + std::to_string(i));
+        db.set(keys.back(), std::string(i, 'v'));  // Short values stay inline, long ones do not
+    }
+    keys.push_back(missing);
+    std::vector<const std::string*> batch;
+    for (const auto& key : keys) batch.push_back(&key);
+    db.prefetch(batch);
+
+    for (int i = 0; i < 100; ++i) EXPECT_EQ(db.get(keys[i]), std::string(i, 'v'));
+    EXPECT_FALSE(db.exists(missing));
+    EXPECT_EQ(db.size(), 100u);
+}
+
+TEST(DatabaseTest, ChangeTrackingByEpoch) {
+    redis_clone::storage::Database db;
+    db.enable_change_tracking();
+    db.set("old", "1");
+    db.set("gone", "2");
+    uint32_t checkpoint = db.advance_epoch();
+
+    db.set("new", "3");
+    db.del("gone");
+    EXPECT_EQ(db.count_changed_since(checkpoint), 1u);
+    std::vector<std::string> changed;
+    db.for_each_changed_since(checkpoint,
+                              [&](const std::string& key, const std::string&) {
+                                  changed.push_back(key);
+                              });
+    EXPECT_EQ(changed, std::vector<std::string>{"new"});
+    std::vector<std::string> deleted;
+    db.for_each_deleted_since(checkpoint, [&](const std::string& key) { deleted.push_back(key); });
+    EXPECT_EQ(deleted, std::vector<std::string>{"gone"});
+
+    // Setting a deleted key again replaces its tombstone
+    db.del("new");
+    db.set("new", "4");
+    EXPECT_EQ(db.deletions_tracked(), 1u);
+
+    size_t memory = db.memory_usage();
+    db.forget_deletions_through(db.advance_epoch());
+    EXPECT_EQ(db.deletions_tracked(), 0u);
+    EXPECT_LT(db.memory_usage(), memory);
+}
+
+TEST(DatabaseTest, SharedValuesSurviveOverwrites) {
+    redis_clone::storage::Database db;
+    db.set("key", std::string(1000, 'a'));
+    auto held = db.get_shared("key");
+    ASSERT_NE(held, nullptr);
+    EXPECT_EQ(db.get_shared("key"), held);  // The stored value itself, not a copy
+    EXPECT_EQ(db.get_shared("missing"), nullptr);
+
+    // Writes swap the pointer, so a reply or checkpoint holding the old value keeps it
+    db.set("key", "b");
+    EXPECT_EQ(*held, std::string(1000, 'a'));
+    db.del("key");
+    EXPECT_EQ(held->size(), 1000u);
+}
+
+TEST(DatabaseTest, CopySharesTheValue) {
+    redis_clone::storage::Database db;
+    db.set("src", "value");
+    size_t memory = db.memory_usage();
+
+    EXPECT_TRUE(db.copy("src", "dst", false));
+    EXPECT_EQ(db.get_shared("dst"), db.get_shared("src"));
+    EXPECT_GT(db.memory_usage(), memory);  // Counted per key
+
+    db.set("other", "taken");
+    EXPECT_FALSE(db.copy("src", "other", false));
+    EXPECT_EQ(db.get("other"), "taken");
+    EXPECT_TRUE(db.copy("src", "other", true));
+    EXPECT_EQ(db.get("other"), "value");
+    EXPECT_FALSE(db.copy("missing", "dst", true));
+
+    // The copies are keys of their own
+    db.set("src", "changed");
+    EXPECT_EQ(db.get("dst"), "value");
+}
+
+TEST(DatabaseTest, PinnedKeyspaceIsPointInTime) {
+    redis_clone::storage::Database db;
+    db.enable_change_tracking();
+    db.set("a", "1");
+    db.set("b", "2");
+    uint32_t checkpoint = db.advance_epoch();
+    db.set("c", "3");
+    db.del("b");
+
+    auto all = db.pin_all();
+    auto changed = db.pin_changed_since(checkpoint);
+    db.set("a", "changed");
+    db.del("c");
+
+    std::map<std::string, std::string> pinned;
+    for (const auto& [key, value] : all.entries) pinned[key] = *value;
+    EXPECT_EQ(pinned, (std::map<std::string, std::string>{{"a", "1"}, {"c", "3"}}));
+    ASSERT_EQ(changed.entries.size(), 1u);
+    EXPECT_EQ(changed.entries[0].first, "c");
+    EXPECT_EQ(*changed.entries[0].second, "3");
+    EXPECT_EQ(changed.deleted, std::vector<std::string>{"b"});
+}
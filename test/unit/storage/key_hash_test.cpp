@@ -0,0 +1,67 @@
+#include "storage/key_hash.h"
+
+#include <gtest/gtest.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "storage/sharded_database.h"
+
+using redis_clone::storage::hash_key;
+using redis_clone::storage::KeyHashSeed;
+using redis_clone::storage::ShardedDatabase;
+using redis_clone::storage::siphash13;
+using redis_clone::storage::siphash24;
+using redis_clone::storage::wyhash;
+
+namespace {
+
+// Key 00 01 .. 0f, as in the SipHash paper
+const KeyHashSeed kReferenceKey{0x0706050403020100ULL, 0x0f0e0d0c0b0a0908ULL};
+
+std::string counting_bytes(size_t len) {
+    std::string bytes;
+    for (size_t i = 0; i < len; ++i) bytes.push_back(static_cast<char>(i));
+    return bytes;
+}
+
+}  // namespace
+
+TEST(KeyHashTest, SipHash24MatchesTheReferenceVectors) {
+    // SipHash-1-3 shares everything with 2-4 but the round counts
+    EXPECT_EQ(siphash24("", 0, kReferenceKey), 0x726fdb47dd0e0e31ULL);
+    std::string message = counting_bytes(15);
+    EXPECT_EQ(siphash24(message.data(), message.size(), kReferenceKey), 0xa129ca6149be45e5ULL);
+}
+
+TEST(KeyHashTest, SeedChangesEveryHash) {
+    const std::string key = "user:1000:session";
+    KeyHashSeed other{kReferenceKey.k0 + 1, kReferenceKey.k1};
+    EXPECT_NE(siphash13(key.data(), key.size(), kReferenceKey),
+              siphash13(key.data(), key.size(), other));
+    EXPECT_NE(wyhash(key.data(), key.size(), 1), wyhash(key.data(), key.size(), 2));
+    EXPECT_EQ(hash_key(key), hash_key(std::string(key)));
+}
+
+TEST(KeyHashTest, EveryLengthHashesDistinctly) {
+    // Covers the short, 16-byte block and 48-byte block paths of wyhash
+    std::string bytes = counting_bytes(130);
+    std::set<uint64_t> sip, wy;
+    for (size_t len = 0; len <= bytes.size(); ++len) {
+        sip.insert(siphash13(bytes.data(), len, kReferenceKey));
+        wy.insert(wyhash(bytes.data(), len, 42));
+    }
+    EXPECT_EQ(sip.size(), bytes.size() + 1);
+    EXPECT_EQ(wy.size(), bytes.size() + 1);
+}
+
+TEST(KeyHashTest, ShardsAreEvenlyLoaded) {
+    ShardedDatabase db(16);
+    std::vector<size_t> per_shard(db.shard_count());
+    for (int i = 0; i < 16000; ++i) ++per_shard[db.shard_for("key:" + std::to_string(i))];
+    for (size_t count : per_shard) {
+        EXPECT_GT(count, 800u);
+        EXPECT_LT(count, 1200u);
+    }
+}
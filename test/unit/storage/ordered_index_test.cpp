@@ -0,0 +1,95 @@
+#include "storage/ordered_index.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "storage/database.h"
+
+namespace {
+
+using redis_clone::storage::Database;
+using redis_clone::storage::KeyRange;
+using redis_clone::storage::OrderedIndex;
+
+std::vector<std::string> all_keys(const OrderedIndex& index) {
+    std::vector<std::string> keys;
+    for (auto it = index.begin(); it.valid(); it.next()) {
+        keys.push_back(it.key());
+    }
+    return keys;
+}
+
+TEST(OrderedIndexTest, MatchesStdSetUnderChurn) {
+    OrderedIndex index;
+    std::set<std::string> expected;
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> key_dist(0, 5000);
+
+    for (int i = 0; i < 50000; ++i) {
+        std::string key = "key:" + std::to_string(key_dist(rng));
+        if (rng() % 3 == 0) {
+            EXPECT_EQ(index.erase(key), expected.erase(key) > 0);
+        } else {
+            EXPECT_EQ(index.insert(key), expected.insert(key).second);
+        }
+    }
+
+    EXPECT_EQ(index.size(), expected.size());
+    EXPECT_EQ(all_keys(index), std::vector<std::string>(expected.begin(), expected.end()));
+
+    for (const auto& key : expected) {
+        index.erase(key);
+    }
+    EXPECT_EQ(index.size(), 0u);
+    EXPECT_FALSE(index.begin().valid());
+}
+
+TEST(OrderedIndexTest, ScansPrefixInOrder) {
+    OrderedIndex index;
+    for (const char* key : {"user:2:name", "user:10:session", "user:1:session", "users", "user;",
+                            "session:1", "user:1:name"}) {
+        index.insert(key);
+    }
+
+    auto keys = index.scan(KeyRange::for_prefix("user:1"), 10);
+    EXPECT_EQ(keys, (std::vector<std::string>{"user:10:session", "user:1:name", "user:1:session"}));
+
+    // Byte order, so "user:10" sorts before "user:1:" ('0' < ':')
+    keys = index.scan(KeyRange::for_prefix("user:"), 2);
+    EXPECT_EQ(keys, (std::vector<std::string>{"user:10:session", "user:1:name"}));
+}
+
+TEST(OrderedIndexTest, ScansBoundedRange) {
+    OrderedIndex index;
+    for (char c = 'a'; c <= 'z'; ++c) {
+        index.insert(std::string(1, c));
+    }
+
+    KeyRange range;
+    range.start = "c";
+    range.start_unbounded = false;
+    range.start_inclusive = false;
+    range.end = "f";
+    range.end_unbounded = false;
+    range.end_inclusive = true;
+
+    EXPECT_EQ(index.scan(range, 100), (std::vector<std::string>{"d", "e", "f"}));
+}
+
+TEST(OrderedIndexTest, DatabaseKeepsIndexInSync) {
+    Database db;
+    db.set("b", "1");
+    db.set("a", "1");
+    db.enable_ordered_index();
+    db.set("c", "1");
+    db.set("a", "2");  // Overwrite must not duplicate the key
+    db.del("b");
+
+    EXPECT_EQ(db.scan_keys(KeyRange{}, 10), (std::vector<std::string>{"a", "c"}));
+}
+
+}  // namespace
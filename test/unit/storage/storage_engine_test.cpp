@@ -0,0 +1,106 @@
+#include "storage/storage_engine.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "storage/concurrent_database.h"
+#include "storage/database.h"
+#include "storage/sharded_database.h"
+
+namespace {
+
+using redis_clone::storage::ConcurrentDatabase;
+using redis_clone::storage::Database;
+using redis_clone::storage::ShardedDatabase;
+
+static_assert(redis_clone::storage::is_storage_engine_v<Database>);
+static_assert(redis_clone::storage::is_storage_engine_v<ConcurrentDatabase>);
+static_assert(redis_clone::storage::is_storage_engine_v<ShardedDatabase>);
+static_assert(
+    !redis_clone::storage::is_storage_engine_v<std::unordered_map<std::string, std::string>>);
+
+template <typename Engine>
+class StorageEngineTest : public ::testing::Test {
+   protected:
+    Engine engine_;
+};
+
+using Engines = ::testing::Types<Database, ConcurrentDatabase, ShardedDatabase>;
+TYPED_TEST_SUITE(StorageEngineTest, Engines);
+
+TYPED_TEST(StorageEngineTest, SetGetDelExists) {
+    this->engine_.set("user:1", "alice");
+    ASSERT_TRUE(this->engine_.get("user:1").has_value());
+    EXPECT_EQ(*this->engine_.get("user:1"), "alice");
+    EXPECT_TRUE(this->engine_.exists("user:1"));
+
+    EXPECT_TRUE(this->engine_.del("user:1"));
+    EXPECT_FALSE(this->engine_.del("user:1"));
+    EXPECT_FALSE(this->engine_.exists("user:1"));
+}
+
+TYPED_TEST(StorageEngineTest, IteratesAllEntries) {
+    for (int i = 0; i < 100; ++i) {
+        this->engine_.set("key" + std::to_string(i), std::to_string(i));
+    }
+    EXPECT_EQ(this->engine_.size(), 100u);
+
+    std::map<std::string, std::string> seen;
+    this->engine_.for_each(
+        [&](const std::string& key, const std::string& value) { seen[key] = value; });
+    EXPECT_EQ(seen.size(), 100u);
+    EXPECT_EQ(seen["key42"], "42");
+}
+
+TYPED_TEST(StorageEngineTest, TracksMemoryUsage) {
+    EXPECT_EQ(this->engine_.memory_usage(), 0u);
+
+    this->engine_.set("key", "small");
+    size_t small = this->engine_.memory_usage();
+    EXPECT_GT(small, 0u);
+
+    this->engine_.set("key", std::string(1000, 'x'));
+    EXPECT_EQ(this->engine_.memory_usage(), small + 995);
+
+    this->engine_.del("key");
+    EXPECT_EQ(this->engine_.memory_usage(), 0u);
+}
+
+TYPED_TEST(StorageEngineTest, CopyPointsAtTheSameValue) {
+    static_assert(redis_clone::storage::supports_copy_v<TypeParam>);
+    // Enough keys that some pairs land on different shards
+    for (int i = 0; i < 20; ++i) {
+        std::string source = "src" + std::to_string(i);
+        std::string destination = "dst" + std::to_string(i);
+        this->engine_.set(source, std::string(100, 'a' + i % 26));
+        ASSERT_TRUE(this->engine_.copy(source, destination, false));
+        EXPECT_EQ(this->engine_.get_shared(destination), this->engine_.get_shared(source));
+        EXPECT_FALSE(this->engine_.copy(source, destination, false));
+        EXPECT_TRUE(this->engine_.copy(source, destination, true));
+    }
+    EXPECT_FALSE(this->engine_.copy("missing", "dst0", true));
+    EXPECT_EQ(this->engine_.size(), 40u);
+}
+
+TEST(ShardedDatabaseTest, ConcurrentWriters) {
+    ShardedDatabase db(8);
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++t) {
+        writers.emplace_back([&db, t] {
+            for (int i = 0; i < 1000; ++i) {
+                db.set("t" + std::to_string(t) + ":" + std::to_string(i), "v");
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    EXPECT_EQ(db.size(), 4000u);
+}
+
+}  // namespace
@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "common/temp_file.h"
+#include "storage/database.h"
+
+using redis_clone::storage::Database;
+using redis_clone::storage::TieringOptions;
+using redis_clone::storage::ValueLog;
+
+class TieredStorageTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        options_.log_path = log_file_.path();
+        options_.max_hot_memory = 0;  // Everything big enough is eligible
+        options_.compaction_min_size = 1;
+    }
+
+    static std::string value_for(int i) { return std::string(100, 'a' + i % 26); }
+
+    redis_clone::test::TempFile log_file_{"tiered_storage_test", ".log"};
+    TieringOptions options_;
+};
+
+TEST_F(TieredStorageTest, EvictedValuesAreStillReadable) {
+    Database db;
+    db.enable_tiering(options_);
+    for (int i = 0; i < 50; ++i) {
+        db.set("key" + std::to_string(i), value_for(i));
+    }
+    size_t hot_usage = db.memory_usage();
+
+    EXPECT_EQ(db.evict_cold_values(50), 50u);
+    EXPECT_EQ(db.tiering_stats().cold_keys, 50u);
+    EXPECT_EQ(db.memory_usage(), hot_usage - 50 * 100);
+
+    for (int i = 0; i < 50; ++i) {
+        std::string key = "key" + std::to_string(i);
+        EXPECT_TRUE(db.cold_location(key).has_value());
+        EXPECT_EQ(db.get(key), value_for(i));
+    }
+    EXPECT_EQ(db.size(), 50u);
+}
+
+TEST_F(TieredStorageTest, SmallValuesStayInMemory) {
+    Database db;
+    db.enable_tiering(options_);
+    db.set("small", "tiny");
+
+    EXPECT_EQ(db.evict_cold_values(10), 0u);
+    EXPECT_FALSE(db.cold_location("small").has_value());
+}
+
+TEST_F(TieredStorageTest, PromoteOnlyMatchingColdRecord) {
+    Database db;
+    db.enable_tiering(options_);
+    db.set("key", value_for(1));
+    ASSERT_EQ(db.evict_cold_values(1), 1u);
+
+    auto location = db.cold_location("key");
+    ASSERT_TRUE(location.has_value());
+    auto value = ValueLog::read(*location);
+    ASSERT_TRUE(value.has_value());
+
+    // An overwrite during the read wins over the stale value
+    db.set("key", "fresh");
+    EXPECT_FALSE(db.promote("key", *location, *value));
+    EXPECT_EQ(db.get("key"), "fresh");
+
+    db.set("other", value_for(2));
+    ASSERT_EQ(db.evict_cold_values(1), 1u);
+    location = db.cold_location("other");
+    ASSERT_TRUE(location.has_value());
+    EXPECT_TRUE(db.promote("other", *location, *ValueLog::read(*location)));
+    EXPECT_FALSE(db.cold_location("other").has_value());
+    EXPECT_EQ(db.tiering_stats().promotions, 1u);
+}
+
+TEST_F(TieredStorageTest, ForEachIncludesColdValues) {
+    Database db;
+    db.enable_tiering(options_);
+    db.set("cold", value_for(3));
+    db.evict_cold_values(1);
+    db.set("hot", "x");
+
+    size_t seen = 0;
+    db.for_each([&](const std::string& key, const std::string& value) {
+        EXPECT_EQ(value, key == "cold" ? value_for(3) : "x");
+        ++seen;
+    });
+    EXPECT_EQ(seen, 2u);
+}
+
+TEST_F(TieredStorageTest, CompactionDropsDeadRecords) {
+    Database db;
+    db.enable_tiering(options_);
+    for (int i = 0; i < 20; ++i) {
+        db.set("key" + std::to_string(i), value_for(i));
+    }
+    db.evict_cold_values(20);
+    for (int i = 0; i < 15; ++i) {
+        db.del("key" + std::to_string(i));
+    }
+    uint64_t size_before = db.tiering_stats().log_size;
+
+    auto job = db.prepare_compaction();
+    ASSERT_NE(job, nullptr);
+    EXPECT_EQ(job->records.size(), 5u);
+
+    // A cold key overwritten mid-compaction must not be remapped
+    db.set("key15", "overwritten");
+    job->run();
+    db.finish_compaction(*job);
+
+    auto stats = db.tiering_stats();
+    EXPECT_LT(stats.log_size, size_before);
+    EXPECT_EQ(stats.cold_keys, 4u);
+    EXPECT_GT(stats.log_dead_bytes, 0u);
+    EXPECT_EQ(db.get("key15"), "overwritten");
+    for (int i = 16; i < 20; ++i) {
+        EXPECT_EQ(db.get("key" + std::to_string(i)), value_for(i));
+    }
+}